@@ -0,0 +1,197 @@
+/**
+ * clustererperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <grove/clustering/ExampleClustererFactory.h>
+#include <grove/scoreforests/ScorePrediction.h>
+using namespace grove;
+
+#include <itmx/base/MemoryBlockFactory.h>
+using namespace itmx;
+
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+#include <tvgutil/timing/TimeUtil.h>
+using namespace tvgutil;
+
+//#################### TYPEDEFS ####################
+
+typedef ExampleClustererFactory<Keypoint3DColour,Keypoint3DColourCluster,ScorePrediction::Capacity> ClustererFactory;
+typedef ClustererFactory::Clusterer Clusterer;
+typedef ClustererFactory::Clusterer_Ptr Clusterer_Ptr;
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Determines whether or not two sets of clusters are identical.
+ *
+ * \param lhs             The first set of clusters.
+ * \param rhs             The second set of clusters.
+ * \param exampleSetCount The number of example sets that were clustered.
+ * \return                true, if the two sets of clusters are identical, or false otherwise.
+ */
+bool clusters_identical(const ScorePredictionsMemoryBlock_Ptr& lhs, const ScorePredictionsMemoryBlock_Ptr& rhs, uint32_t exampleSetCount)
+{
+  const ScorePrediction *l = lhs->GetData(MEMORYDEVICE_CPU);
+  const ScorePrediction *r = rhs->GetData(MEMORYDEVICE_CPU);
+
+  for(uint32_t i = 0; i < exampleSetCount; ++i)
+  {
+    if(l[i].size != r[i].size) return false;
+
+    for(int j = 0; j < l[i].size; ++j)
+    {
+      const Keypoint3DColourCluster& a = l[i].elts[j];
+      const Keypoint3DColourCluster& b = r[i].elts[j];
+      if(a.colour != b.colour || a.determinant != b.determinant || a.nbInliers != b.nbInliers || a.position != b.position)
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * \brief Makes synthetic sets of examples that resemble the contents of the reservoirs in a relocalisation forest.
+ *
+ * Each set contains a few tight clusters of keypoints (the modes of the leaf), placed at random positions
+ * within a 4m cube, together with a proportion of outliers scattered uniformly throughout the cube.
+ *
+ * \param exampleSetCapacity  The number of examples in each set.
+ * \param exampleSetCount     The number of example sets to make.
+ * \param rng                 The random number generator to use.
+ * \return                    An image containing the example sets (one set per row).
+ */
+Keypoint3DColourImage_Ptr make_example_sets(uint32_t exampleSetCapacity, uint32_t exampleSetCount, RandomNumberGenerator& rng)
+{
+  const float halfExtent = 2.0f;
+  const float modeSigma = 0.05f;
+  const int maxModeCount = 4;
+
+  Keypoint3DColourImage_Ptr exampleSets = MemoryBlockFactory::instance().make_image<Keypoint3DColour>(
+    Vector2i(static_cast<int>(exampleSetCapacity), static_cast<int>(exampleSetCount))
+  );
+  Keypoint3DColour *examples = exampleSets->GetData(MEMORYDEVICE_CPU);
+
+  for(uint32_t exampleSetIdx = 0; exampleSetIdx < exampleSetCount; ++exampleSetIdx)
+  {
+    Vector3f modes[maxModeCount];
+    const int modeCount = rng.generate_int_from_uniform(1, maxModeCount);
+    for(int i = 0; i < modeCount; ++i)
+    {
+      modes[i] = Vector3f(
+        rng.generate_real_from_uniform<float>(-halfExtent, halfExtent),
+        rng.generate_real_from_uniform<float>(-halfExtent, halfExtent),
+        rng.generate_real_from_uniform<float>(-halfExtent, halfExtent)
+      );
+    }
+
+    for(uint32_t exampleIdx = 0; exampleIdx < exampleSetCapacity; ++exampleIdx)
+    {
+      Keypoint3DColour& example = examples[exampleSetIdx * exampleSetCapacity + exampleIdx];
+
+      // Make roughly 20% of the examples outliers.
+      if(rng.generate_int_from_uniform(0, 4) == 0)
+      {
+        example.position = Vector3f(
+          rng.generate_real_from_uniform<float>(-halfExtent, halfExtent),
+          rng.generate_real_from_uniform<float>(-halfExtent, halfExtent),
+          rng.generate_real_from_uniform<float>(-halfExtent, halfExtent)
+        );
+      }
+      else
+      {
+        const Vector3f& mode = modes[rng.generate_int_from_uniform(0, modeCount - 1)];
+        example.position = Vector3f(
+          rng.generate_from_gaussian<float>(mode.x, modeSigma),
+          rng.generate_from_gaussian<float>(mode.y, modeSigma),
+          rng.generate_from_gaussian<float>(mode.z, modeSigma)
+        );
+      }
+
+      example.colour = Vector3u(
+        static_cast<unsigned char>(rng.generate_int_from_uniform(0, 255)),
+        static_cast<unsigned char>(rng.generate_int_from_uniform(0, 255)),
+        static_cast<unsigned char>(rng.generate_int_from_uniform(0, 255))
+      );
+      example.valid = true;
+    }
+  }
+
+  return exampleSets;
+}
+
+int main(int argc, char *argv[])
+try
+{
+  if(argc > 3)
+  {
+    std::cerr << "Usage: clustererperf [<example set count> [<iteration count>]]\n";
+    return EXIT_FAILURE;
+  }
+
+  const uint32_t exampleSetCount = argc > 1 ? boost::lexical_cast<uint32_t>(argv[1]) : 256;
+  const int iterationCount = argc > 2 ? boost::lexical_cast<int>(argv[2]) : 5;
+
+  // These match the defaults used by ScoreRelocaliser.
+  const float sigma = 0.1f;
+  const float tau = 0.05f;
+  const uint32_t maxClusterCount = ScorePrediction::Capacity;
+  const uint32_t minClusterSize = 20;
+
+  Clusterer_Ptr exhaustiveClusterer = ClustererFactory::make_clusterer(sigma, tau, maxClusterCount, minClusterSize, DEVICE_CPU, false);
+  Clusterer_Ptr gridClusterer = ClustererFactory::make_clusterer(sigma, tau, maxClusterCount, minClusterSize, DEVICE_CPU, true);
+
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  ScorePredictionsMemoryBlock_Ptr exhaustiveClusters = mbf.make_block<ScorePrediction>(exampleSetCount);
+  ScorePredictionsMemoryBlock_Ptr gridClusters = mbf.make_block<ScorePrediction>(exampleSetCount);
+
+  RandomNumberGenerator rng(12345);
+
+  std::cout << "Clustering " << exampleSetCount << " example sets (average of " << iterationCount << " runs)\n";
+  std::cout << std::setw(10) << "Capacity" << std::setw(18) << "Exhaustive (ms)" << std::setw(12) << "Grid (ms)"
+            << std::setw(12) << "Speedup" << std::setw(12) << "Identical" << '\n';
+
+  bool allIdentical = true;
+  for(uint32_t exampleSetCapacity = 256; exampleSetCapacity <= 4096; exampleSetCapacity *= 2)
+  {
+    Keypoint3DColourImage_CPtr exampleSets = make_example_sets(exampleSetCapacity, exampleSetCount, rng);
+
+    ITMIntMemoryBlock_Ptr exampleSetSizes = mbf.make_block<int>(exampleSetCount);
+    int *sizes = exampleSetSizes->GetData(MEMORYDEVICE_CPU);
+    for(uint32_t i = 0; i < exampleSetCount; ++i) sizes[i] = static_cast<int>(exampleSetCapacity);
+
+    const ITMIntMemoryBlock_CPtr constExampleSetSizes = exampleSetSizes;
+    const double exhaustiveTime = TimeUtil::time_average_ms(
+      boost::bind(&Clusterer::cluster_examples, exhaustiveClusterer, exampleSets, constExampleSetSizes, 0, exampleSetCount, boost::ref(exhaustiveClusters)),
+      iterationCount
+    );
+    const double gridTime = TimeUtil::time_average_ms(
+      boost::bind(&Clusterer::cluster_examples, gridClusterer, exampleSets, constExampleSetSizes, 0, exampleSetCount, boost::ref(gridClusters)),
+      iterationCount
+    );
+    const bool identical = clusters_identical(exhaustiveClusters, gridClusters, exampleSetCount);
+    allIdentical = allIdentical && identical;
+
+    std::cout << std::setw(10) << exampleSetCapacity << std::fixed << std::setprecision(3)
+              << std::setw(18) << exhaustiveTime << std::setw(12) << gridTime
+              << std::setw(11) << std::setprecision(2) << exhaustiveTime / gridTime << 'x'
+              << std::setw(12) << (identical ? "yes" : "NO") << '\n';
+  }
+
+  return allIdentical ? 0 : EXIT_FAILURE;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,177 @@
+/**
+ * medianfilterperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <itmx/base/ITMImagePtrTypes.h>
+
+#include <spaint/imageprocessing/MedianFilterer.h>
+#ifdef WITH_ARRAYFIRE
+#include <spaint/imageprocessing/ImageProcessorFactory.h>
+#endif
+using namespace spaint;
+
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+#include <tvgutil/timing/TimeUtil.h>
+using namespace tvgutil;
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Makes a synthetic RGBA test image consisting of a smooth gradient corrupted by salt-and-pepper noise.
+ *
+ * \param imgSize The size of the image to make.
+ * \param rng     The random number generator to use when adding the noise.
+ * \return        The test image.
+ */
+ITMUChar4Image_Ptr make_test_image(const Vector2i& imgSize, RandomNumberGenerator& rng)
+{
+  ITMUChar4Image_Ptr image(new ITMUChar4Image(imgSize, true, false));
+  Vector4u *pixels = image->GetData(MEMORYDEVICE_CPU);
+
+  for(int y = 0; y < imgSize.y; ++y)
+  {
+    for(int x = 0; x < imgSize.x; ++x)
+    {
+      Vector4u& pixel = pixels[y * imgSize.x + x];
+      pixel.x = static_cast<unsigned char>(255 * x / imgSize.x);
+      pixel.y = static_cast<unsigned char>(255 * y / imgSize.y);
+      pixel.z = static_cast<unsigned char>((pixel.x + pixel.y) / 2);
+      pixel.w = 255;
+
+      // Corrupt roughly 5% of the pixels.
+      const int r = rng.generate_int_from_uniform(0, 39);
+      if(r == 0) pixel = Vector4u((unsigned char)0);
+      else if(r == 1) pixel = Vector4u((unsigned char)255);
+    }
+  }
+
+  return image;
+}
+
+/**
+ * \brief Calculates the largest absolute difference between corresponding channel values in two images of the same size.
+ *
+ * \param lhs The first image.
+ * \param rhs The second image.
+ * \return    The largest absolute difference between corresponding channel values in the two images.
+ */
+int max_difference(const ITMUChar4Image_CPtr& lhs, const ITMUChar4Image_CPtr& rhs)
+{
+  const unsigned char *l = reinterpret_cast<const unsigned char*>(lhs->GetData(MEMORYDEVICE_CPU));
+  const unsigned char *r = reinterpret_cast<const unsigned char*>(rhs->GetData(MEMORYDEVICE_CPU));
+
+  int result = 0;
+  for(int i = 0, size = lhs->dataSize * 4; i < size; ++i)
+  {
+    result = std::max(result, abs(static_cast<int>(l[i]) - static_cast<int>(r[i])));
+  }
+
+  return result;
+}
+
+#ifdef WITH_ARRAYFIRE
+/**
+ * \brief An instance of this class performs median filtering by round-tripping an image through ArrayFire
+ *        (this is how spaint's median filterer used to work, and is retained here as a reference).
+ */
+class ArrayFireMedianFilterer
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  ImageProcessor_CPtr m_imageProcessor;
+  mutable ImageProcessor::AFArray_Ptr m_intermediate;
+  unsigned int m_kernelWidth;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  ArrayFireMedianFilterer(unsigned int kernelWidth, DeviceType deviceType)
+  : m_imageProcessor(ImageProcessorFactory::make_image_processor(deviceType)), m_kernelWidth(kernelWidth)
+  {}
+
+  //#################### PUBLIC OPERATORS ####################
+public:
+  void operator()(const ITMUChar4Image_CPtr& input, const ITMUChar4Image_Ptr& output) const
+  {
+    if(!m_intermediate || ImageProcessor::image_size(input) != ImageProcessor::image_size(m_intermediate))
+    {
+      m_intermediate.reset(new af::array(input->noDims.y, input->noDims.x, 4, u8));
+    }
+
+    m_imageProcessor->copy_itm_to_af(input, m_intermediate);
+    *m_intermediate = af::medfilt(*m_intermediate, m_kernelWidth, m_kernelWidth);
+    m_imageProcessor->copy_af_to_itm(m_intermediate, output);
+  }
+};
+#endif
+
+int main(int argc, char *argv[])
+try
+{
+  if(argc > 2)
+  {
+    std::cerr << "Usage: medianfilterperf [<iteration count>]\n";
+    return EXIT_FAILURE;
+  }
+
+  const int iterationCount = argc > 1 ? boost::lexical_cast<int>(argv[1]) : 50;
+
+  const int resolutionCount = 4;
+  const Vector2i resolutions[resolutionCount] = { Vector2i(320, 240), Vector2i(640, 480), Vector2i(1280, 960), Vector2i(1920, 1080) };
+
+  const int kernelWidthCount = 4;
+  const unsigned int kernelWidths[kernelWidthCount] = { 3, 5, 7, 15 };
+
+  RandomNumberGenerator rng(12345);
+
+  std::cout << std::left << std::setw(12) << "Resolution" << std::setw(8) << "Kernel" << std::right << std::setw(14) << "Native (ms)";
+#ifdef WITH_ARRAYFIRE
+  std::cout << std::setw(18) << "ArrayFire (ms)" << std::setw(12) << "Speedup" << std::setw(10) << "Max Diff";
+#endif
+  std::cout << '\n';
+
+  for(int i = 0; i < resolutionCount; ++i)
+  {
+    const Vector2i& imgSize = resolutions[i];
+    ITMUChar4Image_CPtr input = make_test_image(imgSize, rng);
+    ITMUChar4Image_Ptr nativeOutput(new ITMUChar4Image(imgSize, true, false));
+
+    for(int j = 0; j < kernelWidthCount; ++j)
+    {
+      const unsigned int kernelWidth = kernelWidths[j];
+      const MedianFilterer nativeFilterer(kernelWidth, DEVICE_CPU);
+      const double nativeTime = TimeUtil::time_average_ms(boost::bind<void>(boost::cref(nativeFilterer), input, nativeOutput), iterationCount);
+
+      const std::string resolution = boost::lexical_cast<std::string>(imgSize.x) + "x" + boost::lexical_cast<std::string>(imgSize.y);
+      const std::string kernel = boost::lexical_cast<std::string>(kernelWidth) + "x" + boost::lexical_cast<std::string>(kernelWidth);
+      std::cout << std::left << std::setw(12) << resolution << std::setw(8) << kernel
+                << std::right << std::setw(14) << std::fixed << std::setprecision(3) << nativeTime;
+
+#ifdef WITH_ARRAYFIRE
+      ITMUChar4Image_Ptr arrayFireOutput(new ITMUChar4Image(imgSize, true, false));
+      const ArrayFireMedianFilterer arrayFireFilterer(kernelWidth, DEVICE_CPU);
+      const double arrayFireTime = TimeUtil::time_average_ms(boost::bind<void>(boost::cref(arrayFireFilterer), input, arrayFireOutput), iterationCount);
+      std::cout << std::setw(18) << arrayFireTime
+                << std::setw(11) << std::setprecision(2) << arrayFireTime / nativeTime << 'x'
+                << std::setw(10) << max_difference(nativeOutput, arrayFireOutput);
+#endif
+
+      std::cout << '\n';
+    }
+  }
+
+  return 0;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,134 @@
+/**
+ * pooledqueueperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread.hpp>
+
+#include <tvgutil/containers/LockFreePooledQueue.h>
+#include <tvgutil/containers/PooledQueue.h>
+#include <tvgutil/timing/Timer.h>
+using namespace tvgutil;
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Repeatedly pops elements from the specified queue until the specified number of elements have been consumed.
+ *
+ * \param queue         The queue.
+ * \param elementCount  The number of elements to consume.
+ * \param checksum      A variable in which to accumulate the sum of the consumed elements (to stop the work being optimised away).
+ */
+template <typename Queue>
+void consume(Queue& queue, size_t elementCount, size_t& checksum)
+{
+  for(size_t i = 0; i < elementCount; ++i)
+  {
+    checksum += queue.peek();
+    queue.pop();
+  }
+}
+
+/**
+ * \brief Pushes the specified number of elements onto the specified queue.
+ *
+ * \param queue         The queue.
+ * \param elementCount  The number of elements to push.
+ */
+template <typename Queue>
+void produce(Queue& queue, size_t elementCount)
+{
+  for(size_t i = 0; i < elementCount; ++i)
+  {
+    typename Queue::PushHandler_Ptr pushHandler = queue.begin_push();
+    boost::optional<size_t&> elt = pushHandler->get();
+    if(elt) *elt = i;
+  }
+}
+
+/**
+ * \brief Measures the throughput of the specified queue when it is shared between the specified number of producers and a single consumer.
+ *
+ * Each producer pushes the specified number of elements. Since the queue uses the 'wait' strategy, no elements are discarded.
+ *
+ * \param name                  The name of the queue (for output purposes).
+ * \param queue                 The queue.
+ * \param producerCount         The number of producers.
+ * \param elementsPerProducer   The number of elements each producer should push.
+ */
+template <typename Queue>
+void run_benchmark(const std::string& name, Queue& queue, size_t producerCount, size_t elementsPerProducer)
+{
+  size_t checksum = 0;
+  Timer<boost::chrono::microseconds> timer(name);
+
+  boost::thread_group producers;
+  for(size_t i = 0; i < producerCount; ++i)
+  {
+    producers.create_thread(boost::bind(&produce<Queue>, boost::ref(queue), elementsPerProducer));
+  }
+
+  consume(queue, producerCount * elementsPerProducer, checksum);
+  producers.join_all();
+  timer.stop();
+
+  const double seconds = timer.duration().count() / 1000000.0;
+  const double elementsPerSecond = producerCount * elementsPerProducer / seconds;
+  std::cout << std::left << std::setw(24) << name
+            << std::right << std::setw(12) << std::fixed << std::setprecision(0) << elementsPerSecond << " elements/s"
+            << " (checksum " << checksum << ")\n";
+}
+
+int main(int argc, char *argv[])
+try
+{
+  if(argc > 4)
+  {
+    std::cerr << "Usage: pooledqueueperf [<max producer count> [<capacity> [<elements per producer>]]]\n";
+    return EXIT_FAILURE;
+  }
+
+  const size_t maxProducerCount = argc > 1 ? boost::lexical_cast<size_t>(argv[1]) : 4;
+  const size_t capacity = argc > 2 ? boost::lexical_cast<size_t>(argv[2]) : 5;
+  const size_t elementsPerProducer = argc > 3 ? boost::lexical_cast<size_t>(argv[3]) : 100000;
+
+  for(size_t producerCount = 1; producerCount <= maxProducerCount; producerCount *= 2)
+  {
+    std::cout << "Producers: " << producerCount << ", Capacity: " << capacity << '\n';
+
+    {
+      PooledQueue<size_t> queue(pooled_queue::PES_WAIT);
+      queue.initialise(capacity);
+      run_benchmark("PooledQueue", queue, producerCount, elementsPerProducer);
+    }
+
+    if(producerCount == 1)
+    {
+      LockFreePooledQueue<size_t,pooled_queue::PM_SINGLE> queue(pooled_queue::PES_WAIT);
+      queue.initialise(capacity);
+      run_benchmark("LockFreePooledQueue (SP)", queue, producerCount, elementsPerProducer);
+    }
+
+    {
+      LockFreePooledQueue<size_t,pooled_queue::PM_MULTIPLE> queue(pooled_queue::PES_WAIT);
+      queue.initialise(capacity);
+      run_benchmark("LockFreePooledQueue (MP)", queue, producerCount, elementsPerProducer);
+    }
+
+    std::cout << '\n';
+  }
+
+  return 0;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -19,7 +19,7 @@ using namespace evaluation;
 #include <rafl/examples/UnitCircleExampleGenerator.h>
 using namespace rafl;
 
-#include <raflevaluation/RandomForestEvaluator.h>
+#include <raflevaluation/RandomForestBatchEvaluator.h>
 using namespace raflevaluation;
 
 #include <tvgutil/timing/Timer.h>
@@ -44,9 +44,17 @@ int main(int argc, char *argv[])
   if(argc != 1 && argc != 4)
   {
     std::cerr << "Usage: raflperf [<training set file> <test set file> <output path>]\n";
+    std::cerr << "       raflperf --convert <CSV example file> <binary example file>\n";
     return EXIT_FAILURE;
   }
 
+  if(argc == 4 && std::string(argv[1]) == "--convert")
+  {
+    size_t exampleCount = ExampleUtil::convert_csv_to_binary<Label>(argv[2], argv[3]);
+    std::cout << "Converted " << exampleCount << " examples from " << argv[2] << " to " << argv[3] << '\n';
+    return 0;
+  }
+
   std::vector<Example_CPtr> examples;
   std::vector<ParamSet> params;
   std::string outputResultPath;
@@ -147,12 +155,11 @@ int main(int argc, char *argv[])
 
   // Evaluate the random forest on the various different parameter sets.
   PerformanceTable results(list_of("Accuracy"));
-  boost::shared_ptr<RandomForestEvaluator<Label> > evaluator;
+  RandomForestBatchEvaluator<Label> evaluator(splitGenerator);
+  std::vector<PerformanceResult> paramSetResults = evaluator.evaluate(examples, params);
   for(size_t n = 0, size = params.size(); n < size; ++n)
   {
-    evaluator.reset(new RandomForestEvaluator<Label>(splitGenerator, params[n]));
-    PerformanceResult result = evaluator->evaluate(examples);
-    results.record_performance(params[n], result);
+    results.record_performance(params[n], paramSetResults[n]);
   }
 
   timer.stop();
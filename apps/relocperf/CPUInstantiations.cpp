@@ -0,0 +1,11 @@
+/**
+ * relocperf: CPUInstantiations.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <ITMLib/ITMLibDefines.h>
+
+#include <itmx/relocalisation/ICPRefiningRelocaliser.tpp>
+using namespace itmx;
+
+template class ICPRefiningRelocaliser<ITMVoxel,ITMVoxelIndex>;
@@ -0,0 +1,721 @@
+/**
+ * relocperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+  #include <windows.h>
+  #include <psapi.h>
+  #ifdef _MSC_VER
+    #pragma comment(lib, "psapi.lib")
+  #endif
+#else
+  #include <sys/resource.h>
+#endif
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <InputSource/ImageSourceEngine.h>
+
+#include <ITMLib/Core/ITMDenseMapper.h>
+#include <ITMLib/Engines/LowLevel/ITMLowLevelEngineFactory.h>
+#include <ITMLib/Engines/ViewBuilding/ITMViewBuilderFactory.h>
+#include <ITMLib/Engines/Visualisation/ITMVisualisationEngineFactory.h>
+#include <ITMLib/ITMLibDefines.h>
+#include <ITMLib/Objects/Camera/ITMCalibIO.h>
+#include <ITMLib/Objects/Misc/ITMIMUCalibrator.h>
+#include <ITMLib/Objects/RenderStates/ITMRenderStateFactory.h>
+using namespace InputSource;
+using namespace ITMLib;
+
+#include <ORUtils/FileUtils.h>
+
+#include <grove/relocalisation/ScoreRelocaliserFactory.h>
+using namespace grove;
+
+#include <itmx/base/ITMImagePtrTypes.h>
+#include <itmx/base/ITMObjectPtrTypes.h>
+#include <itmx/base/Settings.h>
+#include <itmx/persistence/PosePersister.h>
+#include <itmx/relocalisation/FernRelocaliser.h>
+#include <itmx/relocalisation/ICPRefiningRelocaliser.h>
+#include <itmx/trackers/TrackerFactory.h>
+using namespace itmx;
+
+#include <tvgutil/timing/AverageTimer.h>
+
+//#################### NAMESPACE ALIASES ####################
+
+namespace bf = boost::filesystem;
+namespace po = boost::program_options;
+
+//#################### TYPEDEFS ####################
+
+typedef tvgutil::AverageTimer<boost::chrono::microseconds> AverageTimer;
+typedef ITMDenseMapper<ITMVoxel,ITMVoxelIndex> DenseMapper;
+typedef boost::shared_ptr<DenseMapper> DenseMapper_Ptr;
+typedef ITMScene<ITMVoxel,ITMVoxelIndex> Scene;
+typedef boost::shared_ptr<Scene> Scene_Ptr;
+
+/** The latencies (in milliseconds) recorded for each timed quantity, keyed by the name of the quantity. */
+typedef std::map<std::string,std::vector<double> > Latencies;
+
+//#################### TYPES ####################
+
+struct CommandLineArguments
+{
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+  std::string forestFilename;
+  std::string outputFilename;
+  bool refine;
+  std::string relocaliserType;
+  int testCount;
+  int testFirst;
+  std::string testSequence;
+  int testStride;
+  int trainCount;
+  int trainFirst;
+  std::string trainSequence;
+};
+
+/**
+ * \brief An instance of this class can be used to time the calls made to another relocaliser.
+ *
+ * This allows us to separate the time taken by the relocaliser wrapped by an ICP-refining relocaliser from the time taken by the refinement itself.
+ */
+class TimedRelocaliser : public Relocaliser
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The relocaliser whose calls are being timed. */
+  Relocaliser_Ptr m_relocaliser;
+
+  /** The timer used to profile the relocalisation calls. */
+  mutable AverageTimer m_timerRelocalisation;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a timed relocaliser.
+   *
+   * \param relocaliser The relocaliser whose calls are to be timed.
+   */
+  explicit TimedRelocaliser(const Relocaliser_Ptr& relocaliser)
+  : m_relocaliser(relocaliser), m_timerRelocalisation("Relocalisation")
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual void finish_training()
+  {
+    m_relocaliser->finish_training();
+  }
+
+  /**
+   * \brief Gets the timer used to profile the relocalisation calls.
+   *
+   * \return  The timer used to profile the relocalisation calls.
+   */
+  const AverageTimer& get_relocalisation_timer() const
+  {
+    return m_timerRelocalisation;
+  }
+
+  /** Override */
+  virtual void load_from_disk(const std::string& inputFolder)
+  {
+    m_relocaliser->load_from_disk(inputFolder);
+  }
+
+  /** Override */
+  virtual std::vector<Result> relocalise(const ITMUChar4Image *colourImage, const ITMFloatImage *depthImage, const Vector4f& depthIntrinsics) const
+  {
+    m_timerRelocalisation.start();
+    std::vector<Result> results = m_relocaliser->relocalise(colourImage, depthImage, depthIntrinsics);
+    m_timerRelocalisation.stop();
+    return results;
+  }
+
+  /** Override */
+  virtual void reset()
+  {
+    m_relocaliser->reset();
+  }
+
+  /** Override */
+  virtual void save_to_disk(const std::string& outputFolder) const
+  {
+    m_relocaliser->save_to_disk(outputFolder);
+  }
+
+  /** Override */
+  virtual void train(const ITMUChar4Image *colourImage, const ITMFloatImage *depthImage, const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose)
+  {
+    m_relocaliser->train(colourImage, depthImage, depthIntrinsics, cameraPose);
+  }
+
+  /** Override */
+  virtual void update()
+  {
+    m_relocaliser->update();
+  }
+};
+
+/**
+ * \brief An instance of this class can be used to read the frames of an RGB-D sequence saved by spaintgui from disk.
+ *
+ * Each frame i consists of a depth image (depthm%06i.pgm), an optional colour image (rgbm%06i.ppm) and the ground-truth
+ * camera -> world transformation (posem%06i.txt). The calibration parameters for the sequence are stored in calib.txt.
+ */
+class SequenceReader
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The calibration parameters of the camera used to capture the sequence. */
+  ITMRGBDCalib m_calib;
+
+  /** The directory containing the sequence. */
+  bf::path m_dir;
+
+  /** The generator used to make the paths to the colour and depth images. */
+  ImageMaskPathGenerator m_pathGenerator;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a sequence reader.
+   *
+   * \param dir The directory containing the sequence.
+   *
+   * \throws std::runtime_error If the calibration parameters for the sequence cannot be read.
+   */
+  explicit SequenceReader(const bf::path& dir)
+  : m_dir(dir), m_pathGenerator((dir / "rgbm%06i.ppm").string().c_str(), (dir / "depthm%06i.pgm").string().c_str())
+  {
+    const std::string calibFilename = (dir / "calib.txt").string();
+    if(!readRGBDCalib(calibFilename.c_str(), m_calib))
+    {
+      throw std::runtime_error("Error: Could not read the calibration parameters from " + calibFilename);
+    }
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the calibration parameters of the camera used to capture the sequence.
+   *
+   * \return  The calibration parameters of the camera used to capture the sequence.
+   */
+  const ITMRGBDCalib& get_calib() const
+  {
+    return m_calib;
+  }
+
+  /**
+   * \brief Determines whether or not the sequence contains the specified frame.
+   *
+   * \param frameIdx  The index of the frame.
+   * \return          true, if the sequence contains the frame, or false otherwise.
+   */
+  bool has_frame(int frameIdx) const
+  {
+    return bf::exists(m_pathGenerator.getDepthImagePath(frameIdx));
+  }
+
+  /**
+   * \brief Reads the specified frame from disk.
+   *
+   * \note If the colour image for the frame is missing, the colour image will be cleared.
+   *
+   * \param frameIdx      The index of the frame.
+   * \param rgb           An image into which to read the colour image for the frame.
+   * \param rawDepth      An image into which to read the depth image for the frame.
+   * \param cameraToWorld A location into which to store the ground-truth camera -> world transformation for the frame.
+   *
+   * \throws std::runtime_error If the depth image or pose for the frame cannot be read.
+   */
+  void read_frame(int frameIdx, ITMUChar4Image *rgb, ITMShortImage *rawDepth, Matrix4f& cameraToWorld) const
+  {
+    const std::string depthPath = m_pathGenerator.getDepthImagePath(frameIdx);
+    if(!ReadImageFromFile(rawDepth, depthPath.c_str()))
+    {
+      throw std::runtime_error("Error: Could not read the depth image " + depthPath);
+    }
+
+    const std::string rgbPath = m_pathGenerator.getRgbImagePath(frameIdx);
+    if(!bf::exists(rgbPath) || !ReadImageFromFile(rgb, rgbPath.c_str())) rgb->Clear();
+
+    cameraToWorld = PosePersister::load_pose(m_dir / (boost::format("posem%06i.txt") % frameIdx).str());
+  }
+};
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Adds any unregistered options in a set of parsed options to a settings object.
+ *
+ * \param parsedOptions The set of parsed options.
+ * \param settings      The settings object.
+ */
+void add_unregistered_options_to_settings(const po::parsed_options& parsedOptions, const Settings_Ptr& settings)
+{
+  for(size_t i = 0, optionCount = parsedOptions.options.size(); i < optionCount; ++i)
+  {
+    const po::basic_option<char>& option = parsedOptions.options[i];
+    if(option.unregistered)
+    {
+      // Add all the specified values for the option in the correct order.
+      for(size_t j = 0, valueCount = option.value.size(); j < valueCount; ++j)
+      {
+        settings->add_value(option.string_key, option.value[j]);
+      }
+    }
+  }
+}
+
+/**
+ * \brief Computes the translation error (in metres) and rotation error (in degrees) between an estimated camera pose and the ground truth.
+ *
+ * \param estimatedCameraToWorld  The estimated camera -> world transformation.
+ * \param trueCameraToWorld       The ground-truth camera -> world transformation.
+ * \param translationError        A location into which to store the distance between the estimated and true camera centres.
+ * \param rotationError           A location into which to store the angle of the rotation between the estimated and true camera orientations.
+ */
+void compute_pose_error(const Matrix4f& estimatedCameraToWorld, const Matrix4f& trueCameraToWorld, double& translationError, double& rotationError)
+{
+  // Note that the matrices are stored in column-major order, so the translation components are in elements 12-14.
+  const double dx = estimatedCameraToWorld.m[12] - trueCameraToWorld.m[12];
+  const double dy = estimatedCameraToWorld.m[13] - trueCameraToWorld.m[13];
+  const double dz = estimatedCameraToWorld.m[14] - trueCameraToWorld.m[14];
+  translationError = sqrt(dx * dx + dy * dy + dz * dz);
+
+  // The trace of R_est^T * R_true is the sum of the element-wise products of the two rotation matrices.
+  double trace = 0.0;
+  for(int col = 0; col < 3; ++col)
+  {
+    for(int row = 0; row < 3; ++row)
+    {
+      trace += estimatedCameraToWorld.m[col * 4 + row] * trueCameraToWorld.m[col * 4 + row];
+    }
+  }
+
+  const double cosAngle = std::max(-1.0, std::min(1.0, (trace - 1.0) / 2.0));
+  rotationError = acos(cosAngle) * 180.0 / M_PI;
+}
+
+/**
+ * \brief Computes the specified percentile of a sorted set of samples (interpolating linearly between the closest ranks).
+ *
+ * \param sortedSamples The samples, sorted in non-decreasing order.
+ * \param p             The percentile to compute (in [0,100]).
+ * \return              The specified percentile of the samples.
+ */
+double compute_percentile(const std::vector<double>& sortedSamples, double p)
+{
+  const double rank = p / 100.0 * (sortedSamples.size() - 1);
+  const size_t lower = static_cast<size_t>(rank);
+  const size_t upper = std::min(lower + 1, sortedSamples.size() - 1);
+  return sortedSamples[lower] + (rank - lower) * (sortedSamples[upper] - sortedSamples[lower]);
+}
+
+/**
+ * \brief Gets the peak amount of physical memory used by the process so far (in bytes).
+ *
+ * \return  The peak amount of physical memory used by the process so far (in bytes), or 0 if it cannot be determined.
+ */
+size_t get_peak_memory_usage()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+  rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+  // On Mac OS X, the maximum resident set size is reported in bytes.
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  // On Linux, the maximum resident set size is reported in kilobytes.
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/**
+ * \brief Parses a configuration file and adds its unregistered options to the application's settings.
+ *
+ * \param filename  The name of the configuration file.
+ * \param options   The registered options for the application.
+ * \param vm        The variables map for the application.
+ * \param settings  The settings for the application.
+ */
+void parse_configuration_file(const std::string& filename, const po::options_description& options, po::variables_map& vm, const Settings_Ptr& settings)
+{
+  // Parse the options in the configuration file.
+  po::parsed_options parsedConfigFileOptions = po::parse_config_file<char>(filename.c_str(), options, true);
+
+  // Add any registered options to the variables map.
+  po::store(parsedConfigFileOptions, vm);
+
+  // Add any unregistered options to the settings.
+  add_unregistered_options_to_settings(parsedConfigFileOptions, settings);
+}
+
+/**
+ * \brief Parses any command-line arguments passed in by the user and adds them to the application settings.
+ *
+ * \param argc      The command-line argument count.
+ * \param argv      The raw command-line arguments.
+ * \param args      The parsed command-line arguments.
+ * \param settings  The application settings.
+ * \return          true, if the program should continue after parsing the command-line arguments, or false otherwise.
+ */
+bool parse_command_line(int argc, char *argv[], CommandLineArguments& args, const Settings_Ptr& settings)
+{
+  // Specify the possible options.
+  po::options_description options("Options");
+  options.add_options()
+    ("help", "produce help message")
+    ("configFile,f", po::value<std::string>(), "additional parameters filename")
+    ("forest", po::value<std::string>(&args.forestFilename)->default_value(""), "the file containing the pre-trained forest (forest relocaliser only)")
+    ("output,o", po::value<std::string>(&args.outputFilename)->default_value(""), "the file to which to write the results (defaults to standard output)")
+    ("refine", po::bool_switch(&args.refine), "refine the relocalised poses using ICP against a scene fused from the training frames")
+    ("relocaliserType", po::value<std::string>(&args.relocaliserType)->default_value("forest"), "relocaliser type (ferns|forest)")
+    ("testCount", po::value<int>(&args.testCount)->default_value(-1), "the maximum number of frames to relocalise (-1 = until the end of the sequence)")
+    ("testFirst", po::value<int>(&args.testFirst)->default_value(-1), "the index of the first frame to relocalise (-1 = the first frame after the training frames)")
+    ("testSequence", po::value<std::string>(&args.testSequence)->default_value(""), "the directory containing the sequence to relocalise (defaults to the training sequence)")
+    ("testStride", po::value<int>(&args.testStride)->default_value(1), "the number of frames to advance between successive relocalisations")
+    ("trainCount", po::value<int>(&args.trainCount)->default_value(-1), "the maximum number of frames on which to train (-1 = until the end of the sequence)")
+    ("trainFirst", po::value<int>(&args.trainFirst)->default_value(0), "the index of the first frame on which to train")
+    ("trainSequence,s", po::value<std::string>(&args.trainSequence), "the directory containing the sequence on which to train")
+  ;
+
+  // Parse the command line.
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+
+  // If a configuration file was specified, parse additional options from it. Unregistered options
+  // (e.g. ScoreRelocaliser.* or PreemptiveRansac.* settings) are added directly to the settings.
+  if(vm.count("configFile"))
+  {
+    parse_configuration_file(vm["configFile"].as<std::string>(), options, vm, settings);
+  }
+
+  po::notify(vm);
+
+  // If the user specifies the --help flag, or fails to specify a training sequence, print a help message.
+  if(vm.count("help") || args.trainSequence.empty())
+  {
+    std::cerr << "Usage: relocperf --trainSequence <dir> [options]\n\n" << options << '\n';
+    return false;
+  }
+
+  if(args.testSequence.empty()) args.testSequence = args.trainSequence;
+  if(args.testStride < 1) throw std::invalid_argument("Error: The test stride must be positive");
+
+  return true;
+}
+
+/**
+ * \brief Records the latency of each stage of a SCoRe relocaliser's pipeline that has run since this function was last called.
+ *
+ * \param relocaliser     The SCoRe relocaliser.
+ * \param phase           The phase of the benchmark during which the stages were run (e.g. "train").
+ * \param lastCounts      The number of times each stage had run when this function was last called (updated by this function).
+ * \param lastDurations   The total time taken by each stage when this function was last called (updated by this function).
+ * \param latencies       The latencies recorded so far.
+ */
+void record_stage_latencies(const ScoreRelocaliser_CPtr& relocaliser, const std::string& phase, std::vector<size_t>& lastCounts,
+                            std::vector<boost::chrono::microseconds>& lastDurations, Latencies& latencies)
+{
+  for(int i = 0; i < ScoreRelocaliser::STAGE_COUNT; ++i)
+  {
+    const AverageTimer& timer = relocaliser->get_stage_timer(static_cast<ScoreRelocaliser::Stage>(i));
+    if(timer.count() == lastCounts[i]) continue;
+
+    // Note that a stage can run more than once per call (e.g. clustering during finish_training), so we record the total time it took.
+    latencies[phase + "." + timer.name()].push_back((timer.total_duration() - lastDurations[i]).count() / 1000.0);
+    lastCounts[i] = timer.count();
+    lastDurations[i] = timer.total_duration();
+  }
+}
+
+/**
+ * \brief Writes a JSON object summarising the distribution of a set of samples to a stream.
+ *
+ * \param os      The stream.
+ * \param samples The samples.
+ */
+void write_distribution(std::ostream& os, std::vector<double> samples)
+{
+  os << "{ \"count\": " << samples.size();
+  if(!samples.empty())
+  {
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for(size_t i = 0, size = samples.size(); i < size; ++i) sum += samples[i];
+
+    os << ", \"mean\": " << sum / samples.size()
+       << ", \"min\": " << samples.front()
+       << ", \"p50\": " << compute_percentile(samples, 50)
+       << ", \"p90\": " << compute_percentile(samples, 90)
+       << ", \"p95\": " << compute_percentile(samples, 95)
+       << ", \"p99\": " << compute_percentile(samples, 99)
+       << ", \"max\": " << samples.back();
+  }
+  os << " }";
+}
+
+/**
+ * \brief Writes a JSON object containing a summary of the distribution of each set of samples in a map to a stream.
+ *
+ * \param os      The stream.
+ * \param samples The map of samples.
+ * \param indent  The indentation to use for the entries in the JSON object.
+ */
+void write_distributions(std::ostream& os, const Latencies& samples, const std::string& indent)
+{
+  os << "{\n";
+  for(Latencies::const_iterator it = samples.begin(), iend = samples.end(); it != iend; ++it)
+  {
+    if(it != samples.begin()) os << ",\n";
+    os << indent << '"' << it->first << "\": ";
+    write_distribution(os, it->second);
+  }
+  os << '\n' << indent.substr(2) << '}';
+}
+
+int main(int argc, char *argv[])
+try
+{
+  // Set up the settings. The benchmark always runs on the CPU, so that its results are comparable across machines and commits.
+  Settings_Ptr settings(new Settings);
+  settings->deviceType = DEVICE_CPU;
+  settings->add_value("ScoreRelocaliser.timersEnabled", "true");
+
+  // Parse the command-line arguments.
+  CommandLineArguments args;
+  if(!parse_command_line(argc, argv, args, settings))
+  {
+    return EXIT_FAILURE;
+  }
+
+  SequenceReader trainSequence(args.trainSequence);
+  SequenceReader testSequence(args.testSequence);
+
+  // Determine the frames on which to train and the frames to relocalise.
+  std::vector<int> trainFrames;
+  for(int i = args.trainFirst; trainSequence.has_frame(i) && (args.trainCount < 0 || i < args.trainFirst + args.trainCount); ++i)
+  {
+    trainFrames.push_back(i);
+  }
+
+  if(trainFrames.empty()) throw std::runtime_error("Error: There are no frames on which to train");
+
+  const bool sameSequence = bf::equivalent(args.trainSequence, args.testSequence);
+  const int testFirst = args.testFirst >= 0 ? args.testFirst : sameSequence ? trainFrames.back() + 1 : 0;
+  std::vector<int> testFrames;
+  for(int i = testFirst; testSequence.has_frame(i) && (args.testCount < 0 || static_cast<int>(testFrames.size()) < args.testCount); i += args.testStride)
+  {
+    testFrames.push_back(i);
+  }
+
+  if(testFrames.empty()) throw std::runtime_error("Error: There are no frames to relocalise");
+
+  // Set up the images and the view into which each frame will be read. We read the first training frame up-front to determine the image sizes.
+  const MemoryDeviceType memoryType = MEMORYDEVICE_CPU;
+  ITMUChar4Image_Ptr rgb(new ITMUChar4Image(true, false));
+  ITMShortImage_Ptr rawDepth(new ITMShortImage(true, false));
+  Matrix4f cameraToWorld;
+  trainSequence.read_frame(trainFrames[0], rgb.get(), rawDepth.get(), cameraToWorld);
+
+  const Vector2i depthImageSize = rawDepth->noDims;
+  if(rgb->noDims.x == 0 || rgb->noDims.y == 0) rgb->ChangeDims(depthImageSize);
+  const Vector2i rgbImageSize = rgb->noDims;
+
+  // Note that the training and test sequences are assumed to have been captured with the same camera.
+  const ITMRGBDCalib& calib = trainSequence.get_calib();
+  ViewBuilder_Ptr viewBuilder(ITMViewBuilderFactory::MakeViewBuilder(calib, settings->deviceType));
+  View_Ptr view(new ITMView(calib, rgbImageSize, depthImageSize, false));
+
+  // Construct the relocaliser to benchmark.
+  Relocaliser_Ptr innerRelocaliser;
+  ScoreRelocaliser_Ptr scoreRelocaliser;
+  if(args.relocaliserType == "forest")
+  {
+    if(args.forestFilename.empty()) throw std::invalid_argument("Error: The forest relocaliser requires a pre-trained forest (--forest)");
+    scoreRelocaliser = ScoreRelocaliserFactory::make_score_relocaliser(args.forestFilename, settings, settings->deviceType);
+    innerRelocaliser = scoreRelocaliser;
+  }
+  else if(args.relocaliserType == "ferns")
+  {
+    innerRelocaliser.reset(new FernRelocaliser(
+      depthImageSize,
+      settings->sceneParams.viewFrustum_min,
+      settings->sceneParams.viewFrustum_max,
+      FernRelocaliser::get_default_harvesting_threshold(),
+      FernRelocaliser::get_default_num_ferns(),
+      FernRelocaliser::get_default_num_decisions_per_fern(),
+      FernRelocaliser::ALWAYS_TRY_ADD
+    ));
+  }
+  else throw std::invalid_argument("Error: Invalid relocaliser type: " + args.relocaliserType);
+
+  // If requested, decorate the relocaliser with one that uses ICP to refine its results against a scene fused from the training frames.
+  boost::shared_ptr<TimedRelocaliser> timedInnerRelocaliser(new TimedRelocaliser(innerRelocaliser));
+  Relocaliser_Ptr relocaliser = timedInnerRelocaliser;
+
+  DenseMapper_Ptr denseMapper;
+  VoxelRenderState_Ptr renderState;
+  Scene_Ptr scene;
+  TrackingState_Ptr trackingState;
+  if(args.refine)
+  {
+    scene.reset(new Scene(&settings->sceneParams, false, memoryType));
+    denseMapper.reset(new DenseMapper(settings.get()));
+    denseMapper->ResetScene(scene.get());
+    renderState.reset(ITMRenderStateFactory<ITMVoxelIndex>::CreateRenderState(depthImageSize, scene->sceneParams, memoryType));
+    trackingState.reset(new ITMTrackingState(depthImageSize, memoryType));
+
+    LowLevelEngine_CPtr lowLevelEngine(ITMLowLevelEngineFactory::MakeLowLevelEngine(settings->deviceType));
+    IMUCalibrator_Ptr imuCalibrator(new ITMIMUCalibrator_iPad);
+    FallibleTracker *fallibleTracker = NULL;
+    Tracker_Ptr tracker = TrackerFactory::make_tracker_from_string(
+      "<tracker type='infinitam'/>", false, rgbImageSize, depthImageSize, lowLevelEngine, imuCalibrator, settings, fallibleTracker
+    );
+
+    boost::shared_ptr<const ITMVisualisationEngine<ITMVoxel,ITMVoxelIndex> > visualisationEngine(
+      ITMVisualisationEngineFactory::MakeVisualisationEngine<ITMVoxel,ITMVoxelIndex>(settings->deviceType)
+    );
+
+    relocaliser.reset(new ICPRefiningRelocaliser<ITMVoxel,ITMVoxelIndex>(
+      timedInnerRelocaliser, tracker, rgbImageSize, depthImageSize, calib, scene, denseMapper, settings, visualisationEngine
+    ));
+  }
+
+  Latencies latencies;
+  std::vector<size_t> lastStageCounts(ScoreRelocaliser::STAGE_COUNT, 0);
+  std::vector<boost::chrono::microseconds> lastStageDurations(ScoreRelocaliser::STAGE_COUNT, boost::chrono::microseconds(0));
+  AverageTimer timer("Call");
+
+  // Train the relocaliser on the training frames, calling update after each one (as spaintgui does when it has spare time).
+  std::cerr << "Training on " << trainFrames.size() << " frames from " << args.trainSequence << "...\n";
+  for(size_t i = 0, size = trainFrames.size(); i < size; ++i)
+  {
+    trainSequence.read_frame(trainFrames[i], rgb.get(), rawDepth.get(), cameraToWorld);
+    ITMView *newView = view.get();
+    viewBuilder->UpdateView(&newView, rgb.get(), rawDepth.get(), false);
+
+    ORUtils::SE3Pose cameraPose;
+    cameraPose.SetInvM(cameraToWorld);
+
+    // If we're refining the relocalised poses, fuse the frame into the scene using its ground-truth pose.
+    if(args.refine)
+    {
+      trackingState->pose_d->SetFrom(&cameraPose);
+      denseMapper->ProcessFrame(view.get(), trackingState.get(), scene.get(), renderState.get(), true);
+    }
+
+    timer.start();
+    relocaliser->train(view->rgb, view->depth, view->calib.intrinsics_d.projectionParamsSimple.all, cameraPose);
+    timer.stop();
+    latencies["train.Total"].push_back(timer.last_duration().count() / 1000.0);
+    if(scoreRelocaliser) record_stage_latencies(scoreRelocaliser, "train", lastStageCounts, lastStageDurations, latencies);
+
+    timer.start();
+    relocaliser->update();
+    timer.stop();
+    latencies["update.Total"].push_back(timer.last_duration().count() / 1000.0);
+    if(scoreRelocaliser) record_stage_latencies(scoreRelocaliser, "update", lastStageCounts, lastStageDurations, latencies);
+  }
+
+  timer.start();
+  relocaliser->finish_training();
+  timer.stop();
+  latencies["finishTraining.Total"].push_back(timer.last_duration().count() / 1000.0);
+  if(scoreRelocaliser) record_stage_latencies(scoreRelocaliser, "finishTraining", lastStageCounts, lastStageDurations, latencies);
+
+  const size_t peakMemoryAfterTraining = get_peak_memory_usage();
+
+  // Relocalise the test frames, and compare the results to the ground truth.
+  std::cerr << "Relocalising " << testFrames.size() << " frames from " << args.testSequence << "...\n";
+  Latencies errors;
+  size_t failureCount = 0, successCount5cm5deg = 0;
+  for(size_t i = 0, size = testFrames.size(); i < size; ++i)
+  {
+    testSequence.read_frame(testFrames[i], rgb.get(), rawDepth.get(), cameraToWorld);
+    ITMView *newView = view.get();
+    viewBuilder->UpdateView(&newView, rgb.get(), rawDepth.get(), false);
+
+    const size_t innerCount = timedInnerRelocaliser->get_relocalisation_timer().count();
+    timer.start();
+    std::vector<Relocaliser::Result> results = relocaliser->relocalise(view->rgb, view->depth, view->calib.intrinsics_d.projectionParamsSimple.all);
+    timer.stop();
+    latencies["relocalise.Total"].push_back(timer.last_duration().count() / 1000.0);
+    if(scoreRelocaliser) record_stage_latencies(scoreRelocaliser, "relocalise", lastStageCounts, lastStageDurations, latencies);
+
+    // If the relocaliser's results were refined, record the time spent on refinement (i.e. the time not spent in the inner relocaliser).
+    if(args.refine && timedInnerRelocaliser->get_relocalisation_timer().count() > innerCount)
+    {
+      latencies["relocalise.Refinement"].push_back((timer.last_duration() - timedInnerRelocaliser->get_relocalisation_timer().last_duration()).count() / 1000.0);
+    }
+
+    if(results.empty())
+    {
+      ++failureCount;
+      continue;
+    }
+
+    double translationError, rotationError;
+    compute_pose_error(results[0].pose.GetInvM(), cameraToWorld, translationError, rotationError);
+    errors["translationError"].push_back(translationError);
+    errors["rotationError"].push_back(rotationError);
+    if(translationError <= 0.05 && rotationError <= 5.0) ++successCount5cm5deg;
+  }
+
+  // Write the results in JSON format. All latencies are in milliseconds, translation errors in metres and rotation errors in degrees.
+  std::ofstream fs;
+  if(!args.outputFilename.empty())
+  {
+    fs.open(args.outputFilename.c_str());
+    if(!fs) throw std::runtime_error("Error: Could not open output file: " + args.outputFilename);
+  }
+
+  std::ostream& os = args.outputFilename.empty() ? std::cout : fs;
+  os << std::setprecision(6);
+  os << "{\n";
+  os << "  \"relocaliserType\": \"" << args.relocaliserType << "\",\n";
+  os << "  \"refine\": " << (args.refine ? "true" : "false") << ",\n";
+  os << "  \"trainFrameCount\": " << trainFrames.size() << ",\n";
+  os << "  \"testFrameCount\": " << testFrames.size() << ",\n";
+  os << "  \"failureCount\": " << failureCount << ",\n";
+  os << "  \"accuracy5cm5deg\": " << static_cast<double>(successCount5cm5deg) / testFrames.size() << ",\n";
+  os << "  \"peakMemoryAfterTraining\": " << peakMemoryAfterTraining << ",\n";
+  os << "  \"peakMemory\": " << get_peak_memory_usage() << ",\n";
+  os << "  \"latencies\": ";
+  write_distributions(os, latencies, "    ");
+  os << ",\n  \"errors\": ";
+  write_distributions(os, errors, "    ");
+  os << "\n}\n";
+
+  return 0;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,246 @@
+/**
+ * reservoirperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+
+#include <grove/clustering/ExampleClustererFactory.h>
+#include <grove/reservoirs/ExampleReservoirsFactory.h>
+#include <grove/reservoirs/cpu/PagedExampleReservoirs_CPU.h>
+#include <grove/scoreforests/ScorePrediction.h>
+using namespace grove;
+
+#include <itmx/base/MemoryBlockFactory.h>
+using namespace itmx;
+
+#include <tvgutil/numbers/CounterBasedRNG.h>
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+#include <tvgutil/timing/Timer.h>
+using namespace tvgutil;
+
+//#################### CONSTANTS ####################
+
+/** The number of trees in the forest (this must match the number for which the reservoirs were instantiated). */
+const int FOREST_TREE_COUNT = 5;
+
+//#################### TYPEDEFS ####################
+
+typedef ExampleClustererFactory<Keypoint3DColour,Keypoint3DColourCluster,ScorePrediction::Capacity> ClustererFactory;
+typedef ClustererFactory::Clusterer_Ptr Clusterer_Ptr;
+typedef ORUtils::VectorX<int,FOREST_TREE_COUNT> LeafIndices;
+typedef ORUtils::Image<LeafIndices> LeafIndicesImage;
+typedef boost::shared_ptr<LeafIndicesImage> LeafIndicesImage_Ptr;
+typedef ExampleReservoirsFactory<Keypoint3DColour> ReservoirsFactory;
+typedef ReservoirsFactory::Reservoirs Reservoirs;
+typedef ReservoirsFactory::Reservoirs_Ptr Reservoirs_Ptr;
+
+//#################### TYPES ####################
+
+/**
+ * \brief The parameters of a synthetic forest and of the training frames used to fill its reservoirs.
+ */
+struct ForestParameters
+{
+  /** The fraction of the leaves in each tree that receive examples. */
+  float activeLeafFraction;
+
+  /** The number of training frames. */
+  int frameCount;
+
+  /** The size of the keypoints image for each training frame. */
+  Vector2i frameSize;
+
+  /** The number of leaves in each tree. */
+  uint32_t leavesPerTree;
+
+  /** The capacity of each reservoir. */
+  uint32_t reservoirCapacity;
+};
+
+/**
+ * \brief The performance figures for a set of example reservoirs.
+ */
+struct ReservoirsPerformance
+{
+  /** The average time taken to add the examples from a single frame to the reservoirs (in milliseconds). */
+  double addTime;
+
+  /** The time taken to cluster all of the reservoirs (in milliseconds). */
+  double clusteringTime;
+
+  /** The number of bytes of memory used to store the examples. */
+  size_t memoryUsage;
+};
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Fills a keypoints image and a leaf indices image with synthetic data that resembles a training frame for a relocalisation forest.
+ *
+ * Each keypoint is assigned to a leaf in each tree. Only a fraction of the leaves in each tree ever receive keypoints, and those that do
+ * are not all equally likely to receive them. The keypoints that are assigned to a leaf in the first tree are placed in a tight cluster
+ * around a position associated with that leaf, so that they form modes when the reservoirs are clustered.
+ *
+ * \param params      The parameters of the forest.
+ * \param keypoints   The keypoints image to fill.
+ * \param leafIndices The leaf indices image to fill.
+ * \param rng         The random number generator to use.
+ */
+void make_frame(const ForestParameters& params, const Keypoint3DColourImage_Ptr& keypoints, const LeafIndicesImage_Ptr& leafIndices, RandomNumberGenerator& rng)
+{
+  const uint32_t activeLeafCount = std::max(1U, static_cast<uint32_t>(params.leavesPerTree * params.activeLeafFraction));
+  const float halfExtent = 2.0f;
+  const float modeSigma = 0.05f;
+
+  Keypoint3DColour *keypointsData = keypoints->GetData(MEMORYDEVICE_CPU);
+  LeafIndices *leafIndicesData = leafIndices->GetData(MEMORYDEVICE_CPU);
+
+  for(int i = 0, size = static_cast<int>(keypoints->dataSize); i < size; ++i)
+  {
+    for(int treeIdx = 0; treeIdx < FOREST_TREE_COUNT; ++treeIdx)
+    {
+      // Pick one of the active leaves, favouring those with lower indices, and scatter the active leaves throughout the tree.
+      const float u = rng.generate_real_from_uniform<float>(0.0f, 1.0f);
+      const uint32_t activeLeafIdx = std::min(activeLeafCount - 1, static_cast<uint32_t>(activeLeafCount * u * u));
+      const uint32_t leafIdx = static_cast<uint32_t>((static_cast<uint64_t>(activeLeafIdx) * 2654435761U) % params.leavesPerTree);
+      leafIndicesData[i].v[treeIdx] = static_cast<int>(leafIdx * FOREST_TREE_COUNT + treeIdx);
+    }
+
+    // Place the keypoint near the position associated with its leaf in the first tree (which we derive by hashing the leaf index).
+    const int leafIdx = leafIndicesData[i].v[0];
+    float centre[3];
+    for(int j = 0; j < 3; ++j)
+    {
+      centre[j] = CounterBasedRNG::generate_uint32(42, leafIdx, j) * (2.0f * halfExtent / 4294967296.0f) - halfExtent;
+    }
+
+    Keypoint3DColour& keypoint = keypointsData[i];
+    keypoint.position = Vector3f(
+      rng.generate_from_gaussian<float>(centre[0], modeSigma),
+      rng.generate_from_gaussian<float>(centre[1], modeSigma),
+      rng.generate_from_gaussian<float>(centre[2], modeSigma)
+    );
+    keypoint.colour = Vector3u(
+      static_cast<unsigned char>(rng.generate_int_from_uniform(0, 255)),
+      static_cast<unsigned char>(rng.generate_int_from_uniform(0, 255)),
+      static_cast<unsigned char>(rng.generate_int_from_uniform(0, 255))
+    );
+
+    // Make roughly 10% of the keypoints invalid (e.g. because they have no depth).
+    keypoint.valid = rng.generate_int_from_uniform(0, 9) != 0;
+  }
+}
+
+/**
+ * \brief Fills a set of example reservoirs with synthetic training data, and then clusters all of them.
+ *
+ * \param params      The parameters of the forest.
+ * \param reservoirs  The example reservoirs.
+ * \param clusterer   The example clusterer.
+ * \return            The performance figures for the reservoirs.
+ */
+ReservoirsPerformance time_reservoirs(const ForestParameters& params, const Reservoirs_Ptr& reservoirs, const Clusterer_Ptr& clusterer)
+{
+  ReservoirsPerformance result;
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+
+  // Use the same random number generator seed for each set of reservoirs, so that they all receive the same examples.
+  RandomNumberGenerator rng(12345);
+  Keypoint3DColourImage_Ptr keypoints = mbf.make_image<Keypoint3DColour>(params.frameSize);
+  LeafIndicesImage_Ptr leafIndices = mbf.make_image<LeafIndices>(params.frameSize);
+
+  // Add the examples from each training frame to the reservoirs.
+  boost::chrono::microseconds addDuration(0);
+  for(int i = 0; i < params.frameCount; ++i)
+  {
+    make_frame(params, keypoints, leafIndices, rng);
+
+    Timer<boost::chrono::microseconds> timer("Add");
+    reservoirs->add_examples(keypoints, leafIndices);
+    timer.stop();
+    addDuration += timer.duration();
+  }
+
+  result.addTime = addDuration.count() / (1000.0 * params.frameCount);
+
+  // Cluster all of the reservoirs, in batches of the size used by the relocaliser.
+  const uint32_t batchSize = 256;
+  const uint32_t reservoirCount = reservoirs->get_reservoir_count();
+  ScorePredictionsMemoryBlock_Ptr predictions = mbf.make_block<ScorePrediction>(batchSize);
+
+  Timer<boost::chrono::microseconds> timer("Clustering");
+  for(uint32_t startIdx = 0; startIdx < reservoirCount; startIdx += batchSize)
+  {
+    const uint32_t count = std::min(batchSize, reservoirCount - startIdx);
+    Reservoirs::ReservoirsImage_CPtr reservoirsImage;
+    ITMIntMemoryBlock_CPtr reservoirSizes;
+    const uint32_t rowIdx = reservoirs->get_reservoir_range(startIdx, count, reservoirsImage, reservoirSizes);
+    clusterer->cluster_examples(reservoirsImage, reservoirSizes, rowIdx, count, predictions, 0);
+  }
+  timer.stop();
+
+  result.clusteringTime = timer.duration().count() / 1000.0;
+
+  // Determine how much memory is used to store the examples.
+  boost::shared_ptr<PagedExampleReservoirs_CPU<Keypoint3DColour> > pagedReservoirs = boost::dynamic_pointer_cast<PagedExampleReservoirs_CPU<Keypoint3DColour> >(reservoirs);
+  result.memoryUsage = pagedReservoirs ? pagedReservoirs->get_memory_usage() : reservoirs->get_reservoirs()->dataSize * sizeof(Keypoint3DColour);
+
+  return result;
+}
+
+int main(int argc, char *argv[])
+try
+{
+  if(argc > 4)
+  {
+    std::cerr << "Usage: reservoirperf [<leaves per tree> [<frame count> [<active leaf fraction>]]]\n";
+    return EXIT_FAILURE;
+  }
+
+  ForestParameters params;
+  params.leavesPerTree = argc > 1 ? boost::lexical_cast<uint32_t>(argv[1]) : 8192;
+  params.frameCount = argc > 2 ? boost::lexical_cast<int>(argv[2]) : 20;
+  params.activeLeafFraction = argc > 3 ? boost::lexical_cast<float>(argv[3]) : 0.25f;
+  params.frameSize = Vector2i(320, 240);
+
+  // These match the defaults used by ScoreRelocaliser.
+  params.reservoirCapacity = 1024;
+  const float sigma = 0.1f;
+  const float tau = 0.05f;
+  const uint32_t maxClusterCount = ScorePrediction::Capacity;
+  const uint32_t minClusterSize = 20;
+
+  const uint32_t reservoirCount = params.leavesPerTree * FOREST_TREE_COUNT;
+  Clusterer_Ptr clusterer = ClustererFactory::make_clusterer(sigma, tau, maxClusterCount, minClusterSize, DEVICE_CPU);
+
+  std::cout << "Filling " << reservoirCount << " reservoirs of capacity " << params.reservoirCapacity << " from " << params.frameCount
+            << " frames (" << params.activeLeafFraction * 100 << "% of leaves active)\n";
+  std::cout << std::setw(14) << "Storage" << std::setw(14) << "Memory (MB)" << std::setw(18) << "Add (ms/frame)" << std::setw(18) << "Clustering (ms)" << '\n';
+
+  const uint32_t pageCapacities[] = { 0, 32, 64, 128 };
+  for(size_t i = 0; i < sizeof(pageCapacities) / sizeof(uint32_t); ++i)
+  {
+    const uint32_t pageCapacity = pageCapacities[i];
+    Reservoirs_Ptr reservoirs = ReservoirsFactory::make_reservoirs(reservoirCount, params.reservoirCapacity, DEVICE_CPU, 42, pageCapacity);
+    const ReservoirsPerformance perf = time_reservoirs(params, reservoirs, clusterer);
+
+    const std::string storage = pageCapacity > 0 ? "Paged (" + boost::lexical_cast<std::string>(pageCapacity) + ")" : "Dense";
+    std::cout << std::setw(14) << storage << std::fixed << std::setprecision(1)
+              << std::setw(14) << perf.memoryUsage / (1024.0 * 1024.0) << std::setprecision(3)
+              << std::setw(18) << perf.addTime << std::setw(18) << perf.clusteringTime << '\n';
+  }
+
+  return 0;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -46,7 +46,7 @@ using namespace tvgutil;
 Application::Application(const MultiScenePipeline_Ptr& pipeline, bool renderFiducials)
 : m_activeSubwindowIndex(0),
   m_batchModeEnabled(false),
-  m_commandManager(10),
+  m_commandManager(10, pipeline->get_model()->get_settings()->get_first_value<size_t>("CommandManager.maxHistoryMemoryUsage", 64 * 1024 * 1024)),
   m_pauseBetweenFrames(true),
   m_paused(true),
   m_pipeline(pipeline),
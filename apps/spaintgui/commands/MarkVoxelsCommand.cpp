@@ -6,9 +6,14 @@
 #include "MarkVoxelsCommand.h"
 using namespace spaint;
 
+#include <algorithm>
+#include <vector>
+
 #include <itmx/base/MemoryBlockFactory.h>
 using namespace itmx;
 
+#include <spaint/markers/shared/VoxelMarker_Shared.h>
+
 //#################### CONSTRUCTORS ####################
 
 MarkVoxelsCommand::MarkVoxelsCommand(const std::string& sceneID, const boost::shared_ptr<const ORUtils::MemoryBlock<Vector3s> >& voxelLocationsMB,
@@ -16,7 +21,6 @@ MarkVoxelsCommand::MarkVoxelsCommand(const std::string& sceneID, const boost::sh
 : Command(get_static_description()),
   m_label(label),
   m_model(model),
-  m_oldVoxelLabelsMB(MemoryBlockFactory::instance().make_block<SpaintVoxel::PackedLabel>(voxelLocationsMB->dataSize)),
   m_sceneID(sceneID),
   m_voxelLocationsMB(voxelLocationsMB)
 {}
@@ -25,12 +29,40 @@ MarkVoxelsCommand::MarkVoxelsCommand(const std::string& sceneID, const boost::sh
 
 void MarkVoxelsCommand::execute() const
 {
-  m_model->mark_voxels(m_sceneID, m_voxelLocationsMB, m_label, NORMAL_MARKING, m_oldVoxelLabelsMB);
+  if(m_voxelLocationsMB)
+  {
+    // If this is the first time the command has been executed, mark the whole selection, recording the old labels of the voxels,
+    // and then retain only the voxels whose labels were actually changed.
+    boost::shared_ptr<ORUtils::MemoryBlock<SpaintVoxel::PackedLabel> > oldVoxelLabelsMB = MemoryBlockFactory::instance().make_block<SpaintVoxel::PackedLabel>(m_voxelLocationsMB->dataSize);
+
+    // Note: Voxels that are not found in the scene are not marked and have no old label recorded, so we pre-fill the old labels
+    //       with the new label to make sure that such voxels are not mistaken for ones whose labels were changed.
+    std::fill_n(oldVoxelLabelsMB->GetData(MEMORYDEVICE_CPU), oldVoxelLabelsMB->dataSize, m_label);
+    oldVoxelLabelsMB->UpdateDeviceFromHost();
+
+    m_model->mark_voxels(m_sceneID, m_voxelLocationsMB, m_label, NORMAL_MARKING, oldVoxelLabelsMB);
+    record_changed_voxels(oldVoxelLabelsMB);
+    m_voxelLocationsMB.reset();
+  }
+  else if(m_changedVoxelLocationsMB)
+  {
+    // Otherwise, the command is being redone, so the scene is in the same state as it was before the command was first executed,
+    // and only the voxels that were changed then need to be re-marked.
+    m_model->mark_voxels(m_sceneID, m_changedVoxelLocationsMB, m_label, NORMAL_MARKING);
+  }
+}
+
+size_t MarkVoxelsCommand::get_memory_usage() const
+{
+  size_t memoryUsage = 0;
+  if(m_changedVoxelLocationsMB) memoryUsage += m_changedVoxelLocationsMB->dataSize * (sizeof(Vector3s) + sizeof(SpaintVoxel::PackedLabel));
+  if(m_voxelLocationsMB) memoryUsage += m_voxelLocationsMB->dataSize * sizeof(Vector3s);
+  return memoryUsage;
 }
 
 void MarkVoxelsCommand::undo() const
 {
-  m_model->mark_voxels(m_sceneID, m_voxelLocationsMB, m_oldVoxelLabelsMB, FORCED_MARKING);
+  if(m_changedVoxelLocationsMB) m_model->mark_voxels(m_sceneID, m_changedVoxelLocationsMB, m_changedVoxelOldLabelsMB, FORCED_MARKING);
 }
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
@@ -39,3 +71,37 @@ std::string MarkVoxelsCommand::get_static_description()
 {
   return "Mark Voxels";
 }
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void MarkVoxelsCommand::record_changed_voxels(const boost::shared_ptr<ORUtils::MemoryBlock<SpaintVoxel::PackedLabel> >& oldVoxelLabelsMB) const
+{
+  oldVoxelLabelsMB->UpdateHostFromDevice();
+  m_voxelLocationsMB->UpdateHostFromDevice();
+
+  // Find the voxels whose labels were changed by the marking (i.e. those whose old labels could be overwritten, and differed from the new label).
+  const SpaintVoxel::PackedLabel *oldVoxelLabels = oldVoxelLabelsMB->GetData(MEMORYDEVICE_CPU);
+  const Vector3s *voxelLocations = m_voxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+  std::vector<size_t> changedIndices;
+  for(size_t i = 0, size = m_voxelLocationsMB->dataSize; i < size; ++i)
+  {
+    if(can_overwrite_label(oldVoxelLabels[i], m_label) && !(oldVoxelLabels[i] == m_label)) changedIndices.push_back(i);
+  }
+
+  if(changedIndices.empty()) return;
+
+  // Copy their locations and old labels into compact memory blocks.
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  m_changedVoxelLocationsMB = mbf.make_block<Vector3s>(changedIndices.size());
+  m_changedVoxelOldLabelsMB = mbf.make_block<SpaintVoxel::PackedLabel>(changedIndices.size());
+  Vector3s *changedVoxelLocations = m_changedVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+  SpaintVoxel::PackedLabel *changedVoxelOldLabels = m_changedVoxelOldLabelsMB->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0, size = changedIndices.size(); i < size; ++i)
+  {
+    changedVoxelLocations[i] = voxelLocations[changedIndices[i]];
+    changedVoxelOldLabels[i] = oldVoxelLabels[changedIndices[i]];
+  }
+
+  m_changedVoxelLocationsMB->UpdateDeviceFromHost();
+  m_changedVoxelOldLabelsMB->UpdateDeviceFromHost();
+}
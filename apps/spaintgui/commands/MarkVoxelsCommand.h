@@ -12,6 +12,10 @@
 
 /**
  * \brief An instance of this class represents a command that can be used to mark voxels in a scene.
+ *
+ * To keep the command history small, the command only retains the voxels whose labels were actually changed when it was
+ * first executed (together with their old labels), rather than the whole selection. Undoing the command restores the old
+ * labels of those voxels, and redoing it re-marks them.
  */
 class MarkVoxelsCommand : public tvgutil::Command
 {
@@ -23,14 +27,17 @@ private:
   /** The spaint model. */
   Model_Ptr m_model;
 
-  /** A memory block into which to store the old labels of the voxels being marked. */
-  boost::shared_ptr<ORUtils::MemoryBlock<spaint::SpaintVoxel::PackedLabel> > m_oldVoxelLabelsMB;
+  /** The locations of the voxels whose labels were changed when the command was first executed (null if there were none). */
+  mutable boost::shared_ptr<ORUtils::MemoryBlock<Vector3s> > m_changedVoxelLocationsMB;
+
+  /** The old labels of the voxels whose labels were changed when the command was first executed (null if there were none). */
+  mutable boost::shared_ptr<ORUtils::MemoryBlock<spaint::SpaintVoxel::PackedLabel> > m_changedVoxelOldLabelsMB;
 
   /** The ID of the scene in which to mark voxels. */
   std::string m_sceneID;
 
-  /** The locations of the voxels in the scene to mark. */
-  boost::shared_ptr<const ORUtils::MemoryBlock<Vector3s> > m_voxelLocationsMB;
+  /** The locations of the voxels in the scene to mark (this is released once the command has first been executed). */
+  mutable boost::shared_ptr<const ORUtils::MemoryBlock<Vector3s> > m_voxelLocationsMB;
 
   //#################### CONSTRUCTORS ####################
 public:
@@ -50,6 +57,9 @@ public:
   /** Override */
   virtual void execute() const;
 
+  /** Override */
+  virtual size_t get_memory_usage() const;
+
   /** Override */
   virtual void undo() const;
 
@@ -61,6 +71,15 @@ public:
    * \return  A short description of what the command does.
    */
   static std::string get_static_description();
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Records the locations and old labels of the voxels whose labels were changed when the command was first executed.
+   *
+   * \param oldVoxelLabelsMB  The old labels of all of the voxels in the selection (one per voxel location).
+   */
+  void record_changed_voxels(const boost::shared_ptr<ORUtils::MemoryBlock<spaint::SpaintVoxel::PackedLabel> >& oldVoxelLabelsMB) const;
 };
 
 #endif
@@ -51,8 +51,10 @@ Model::Model(const Settings_CPtr& settings, const std::string& resourcesDir, siz
 
 void Model::clear_labels(const std::string& sceneID, ClearingSettings settings)
 {
-  ITMLocalVBA<SpaintVoxel>& localVBA = get_slam_state(sceneID)->get_voxel_scene()->localVBA;
+  const SLAMState_Ptr& slamState = get_slam_state(sceneID);
+  ITMLocalVBA<SpaintVoxel>& localVBA = slamState->get_voxel_scene()->localVBA;
   m_voxelMarker->clear_labels(localVBA.GetVoxelBlocks(), localVBA.allocatedSize, settings);
+  slamState->record_labels_cleared();
 }
 
 const LabelManager_Ptr& Model::get_label_manager()
@@ -119,12 +121,16 @@ Model::VoxelVisualisationEngine_CPtr Model::get_voxel_visualisation_engine() con
 void Model::mark_voxels(const std::string& sceneID, const Selection_CPtr& selection, SpaintVoxel::PackedLabel label,
                         MarkingMode mode, const PackedLabels_Ptr& oldLabels)
 {
-  m_voxelMarker->mark_voxels(*selection, label, get_slam_state(sceneID)->get_voxel_scene().get(), mode, oldLabels.get());
+  const SLAMState_Ptr& slamState = get_slam_state(sceneID);
+  m_voxelMarker->mark_voxels(*selection, label, slamState->get_voxel_scene().get(), mode, oldLabels.get());
+  slamState->record_labels_changed();
 }
 
 void Model::mark_voxels(const std::string& sceneID, const Selection_CPtr& selection, const PackedLabels_CPtr& labels, MarkingMode mode)
 {
-  m_voxelMarker->mark_voxels(*selection, *labels, get_slam_state(sceneID)->get_voxel_scene().get(), mode);
+  const SLAMState_Ptr& slamState = get_slam_state(sceneID);
+  m_voxelMarker->mark_voxels(*selection, *labels, slamState->get_voxel_scene().get(), mode);
+  slamState->record_labels_changed();
 }
 
 void Model::set_leap_fiducial_id(const std::string& leapFiducialID)
@@ -157,8 +163,10 @@ void Model::update_selector(const InputState& inputState, const SLAMState_CPtr&
       const size_t maxKeptTouchPoints = 50;
       m_selector.reset(new TouchSelector(m_settings, touchSettings, get_slam_state(Model::get_world_scene_id())->get_depth_image_size(), maxKeptTouchPoints));
 
+      // Note: The cubes around nearby touch points overlap heavily, so we deduplicate the selection to avoid marking the same voxels many times.
       const int initialSelectionRadius = 1;
-      m_selectionTransformer = SelectionTransformerFactory::make_voxel_to_cube(initialSelectionRadius, m_settings->deviceType);
+      const bool deduplicateSelection = true;
+      m_selectionTransformer = SelectionTransformerFactory::make_voxel_to_cube(initialSelectionRadius, m_settings->deviceType, deduplicateSelection);
     }
 #endif
   }
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <string>
 
+#include <boost/bind.hpp>
 #include <boost/program_options.hpp>
 #include <boost/tokenizer.hpp>
 
@@ -38,6 +39,8 @@
 #include <spaint/fiducials/ArUcoFiducialDetector.h>
 #endif
 
+#include <ORUtils/FileUtils.h>
+
 #include <itmx/base/MemoryBlockFactory.h>
 #include <itmx/imagesources/AsyncImageSourceEngine.h>
 #ifdef WITH_ZED
@@ -45,6 +48,7 @@
 #endif
 
 #include <tvgutil/filesystem/PathFinder.h>
+#include <tvgutil/misc/ThreadPool.h>
 
 #include "core/ObjectivePipeline.h"
 #include "core/SemanticPipeline.h"
@@ -83,6 +87,8 @@ struct CommandLineArguments
   std::string openNIDeviceURI;
   std::string pipelineType;
   size_t prefetchBufferCapacity;
+  size_t prefetchWorkerCount;
+  bool printPrefetchStats;
   std::string relocaliserType;
   bool renderFiducials;
   std::vector<std::string> rgbImageMasks;
@@ -123,6 +129,8 @@ struct CommandLineArguments
       ADD_SETTING(openNIDeviceURI);
       ADD_SETTING(pipelineType);
       ADD_SETTING(prefetchBufferCapacity);
+      ADD_SETTING(prefetchWorkerCount);
+      ADD_SETTING(printPrefetchStats);
       ADD_SETTING(relocaliserType);
       ADD_SETTING(renderFiducials);
       ADD_SETTINGS(rgbImageMasks);
@@ -181,6 +189,30 @@ ImageSourceEngine *check_camera_subengine(ImageSourceEngine *cameraSubengine)
   else return cameraSubengine;
 }
 
+/**
+ * \brief Loads the specified frame of a disk sequence.
+ *
+ * \note This is safe to call concurrently, so it can be used to decode frames on several threads at once.
+ *
+ * \param pathGenerator The path generator for the disk sequence.
+ * \param frameNumber   The number of the frame to load.
+ * \param rgb           The image into which to load the RGB component of the frame.
+ * \param rawDepth      The image into which to load the depth component of the frame.
+ * \return              true, if the frame was successfully loaded, or false if it does not exist.
+ */
+bool load_disk_frame(const ImageMaskPathGenerator& pathGenerator, int frameNumber, ITMUChar4Image *rgb, ITMShortImage *rawDepth)
+{
+  // If the depth image for the frame does not exist, we have reached the end of the sequence.
+  const std::string depthPath = pathGenerator.getDepthImagePath(frameNumber);
+  if(!bf::exists(depthPath) || !ReadImageFromFile(rawDepth, depthPath.c_str())) return false;
+
+  // Note: The RGB images are optional, so if one of them is missing, we simply clear the RGB component.
+  const std::string rgbPath = pathGenerator.getRgbImagePath(frameNumber);
+  if(!bf::exists(rgbPath) || !ReadImageFromFile(rgb, rgbPath.c_str())) rgb->Clear();
+
+  return true;
+}
+
 /**
  * \brief Attempts to make a camera subengine to read images from any suitable camera that is attached.
  *
@@ -441,6 +473,8 @@ bool parse_command_line(int argc, char *argv[], CommandLineArguments& args, cons
     ("initialFrame,n", po::value<int>(&args.initialFrameNumber)->default_value(0), "initial frame number")
     ("modelSpecifier,m", po::value<std::string>(&args.modelSpecifier)->default_value(""), "model specifier")
     ("prefetchBufferCapacity,b", po::value<size_t>(&args.prefetchBufferCapacity)->default_value(60), "capacity of the prefetch buffer")
+    ("prefetchWorkerCount", po::value<size_t>(&args.prefetchWorkerCount)->default_value(2), "number of threads on which to decode disk images (0 = read them sequentially)")
+    ("printPrefetchStats", po::bool_switch(&args.printPrefetchStats), "output statistics about the prefetching of disk images on exit")
     ("rgbMask,r", po::value<std::vector<std::string> >(&args.rgbImageMasks)->multitoken(), "RGB image mask")
     ("sequenceSpecifier,s", po::value<std::vector<std::string> >(&args.sequenceSpecifiers)->multitoken(), "sequence specifier")
     ("sequenceType", po::value<std::vector<std::string> >(&args.sequenceTypes)->multitoken(), "sequence type")
@@ -556,6 +590,9 @@ try
   // Pass the device type to the memory block factory.
   MemoryBlockFactory::instance().set_device_type(settings->deviceType);
 
+  // Specify the number of threads to use for the global thread pool (0 = one per hardware thread).
+  ThreadPool::set_default_thread_count(settings->get_first_value<size_t>("ThreadPool.threadCount", 0));
+
   // Construct the image source engine.
   boost::shared_ptr<CompositeImageSourceEngine> imageSourceEngine(new CompositeImageSourceEngine);
 
@@ -574,10 +611,26 @@ try
 
     std::cout << "[spaint] Reading images from disk: " << rgbImageMask << ' ' << depthImageMask << '\n';
     ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
-    imageSourceEngine->addSubengine(new AsyncImageSourceEngine(
-      new ImageFileReader<ImageMaskPathGenerator>(args.calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber),
-      args.prefetchBufferCapacity
-    ));
+    ImageSourceEngine *fileReader = new ImageFileReader<ImageMaskPathGenerator>(args.calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber);
+    AsyncImageSourceEngine *asyncImageSourceEngine;
+    if(args.prefetchWorkerCount > 0)
+    {
+      // Decode the images on several threads at once (the file reader is only used for the calibration and the image sizes).
+      asyncImageSourceEngine = new AsyncImageSourceEngine(
+        fileReader,
+        boost::bind(&load_disk_frame, pathGenerator, _1, _2, _3),
+        args.initialFrameNumber,
+        args.prefetchBufferCapacity,
+        args.prefetchWorkerCount
+      );
+    }
+    else
+    {
+      asyncImageSourceEngine = new AsyncImageSourceEngine(fileReader, args.prefetchBufferCapacity);
+    }
+
+    asyncImageSourceEngine->set_print_stats_on_destruction(args.printPrefetchStats);
+    imageSourceEngine->addSubengine(asyncImageSourceEngine);
   }
 
   // If no model and no disk sequences were specified, or we want to switch to the camera once all the disk sequences finish, add a camera subengine.
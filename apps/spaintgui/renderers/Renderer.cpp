@@ -8,9 +8,12 @@ using namespace ITMLib;
 using namespace ORUtils;
 using namespace rigging;
 
+#include <iostream>
+
 #include <itmx/util/CameraPoseConverter.h>
 using namespace itmx;
 
+#include <spaint/imageprocessing/MedianFilterer.h>
 #include <spaint/ogl/CameraRenderer.h>
 #include <spaint/ogl/QuadricRenderer.h>
 #include <spaint/selectiontransformers/interface/VoxelToCubeSelectionTransformer.h>
@@ -19,7 +22,6 @@ using namespace itmx;
 using namespace spaint;
 
 #ifdef WITH_ARRAYFIRE
-#include <spaint/imageprocessing/MedianFilterer.h>
 #include <spaint/selectors/TouchSelector.h>
 #endif
 
@@ -187,6 +189,15 @@ Renderer::Renderer(const Model_CPtr& model, const SubwindowConfiguration_Ptr& su
   m_supersamplingEnabled(false),
   m_windowViewportSize(windowViewportSize)
 {
+  // Determine whether or not the free camera renderings of the scene should be cached, and if so, whether the caches should be allowed to
+  // reproject the scene for small camera movements. Reprojection is disabled by default, since it leaves the raycast result used for picking
+  // corresponding to the pose of the last full raycast rather than the current one.
+  const static std::string settingsNamespace = "Renderer.";
+  const Settings_CPtr& settings = model->get_settings();
+  m_printRenderCacheStats = settings->get_first_value<bool>(settingsNamespace + "printRenderCacheStats", false);
+  m_renderCacheEnabled = settings->get_first_value<bool>(settingsNamespace + "renderCacheEnabled", true);
+  m_reprojectionEnabled = settings->get_first_value<bool>(settingsNamespace + "reprojectionEnabled", false);
+
   // Reset the camera for each sub-window.
   for(size_t i = 0, subwindowCount = m_subwindowConfiguration->subwindow_count(); i < subwindowCount; ++i)
   {
@@ -196,7 +207,25 @@ Renderer::Renderer(const Model_CPtr& model, const SubwindowConfiguration_Ptr& su
 
 //#################### DESTRUCTOR ####################
 
-Renderer::~Renderer() {}
+Renderer::~Renderer()
+{
+  if(!m_printRenderCacheStats) return;
+
+  // Print statistics about the render caches for each sub-window.
+  for(size_t i = 0, subwindowCount = m_subwindowConfiguration->subwindow_count(); i < subwindowCount; ++i)
+  {
+    const std::map<int,VoxelRenderCache_Ptr>& voxelRenderCaches = m_subwindowConfiguration->subwindow(i).get_voxel_render_caches();
+    for(std::map<int,VoxelRenderCache_Ptr>::const_iterator it = voxelRenderCaches.begin(), iend = voxelRenderCaches.end(); it != iend; ++it)
+    {
+      if(!it->second) continue;
+
+      const VoxelRenderCache::Statistics stats = it->second->get_statistics();
+      std::cout << "Render cache (sub-window " << i << ", view " << it->first << "): "
+                << stats.hitCount << " hits, " << stats.reprojectionCount << " reprojections, " << stats.reshadeCount << " reshades, " << stats.missCount << " misses"
+                << " (hit rate: " << 100.0 * stats.hit_rate() << "%, estimated time saved: " << stats.estimated_saved_time().count() / 1000 << "ms)\n";
+    }
+  }
+}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
@@ -387,9 +416,10 @@ void Renderer::set_window(const SDL_Window_Ptr& window)
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
 void Renderer::generate_visualisation(const ITMUChar4Image_Ptr& output, const SpaintVoxelScene_CPtr& voxelScene, const SpaintSurfelScene_CPtr& surfelScene,
-                                      VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState, const ORUtils::SE3Pose& pose,
-                                      const View_CPtr& view, const ITMIntrinsics& intrinsics, VisualisationGenerator::VisualisationType visualisationType,
-                                      bool surfelFlag, const boost::optional<VisualisationGenerator::Postprocessor>& postprocessor) const
+                                      VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState, const VoxelRenderCache_Ptr& voxelRenderCache,
+                                      unsigned int fusionGeneration, unsigned int labelGeneration, const ORUtils::SE3Pose& pose, const View_CPtr& view,
+                                      const ITMIntrinsics& intrinsics, VisualisationGenerator::VisualisationType visualisationType, bool surfelFlag,
+                                      const boost::optional<VisualisationGenerator::Postprocessor>& postprocessor) const
 {
   VisualisationGenerator_CPtr visualisationGenerator = m_model->get_visualisation_generator();
 
@@ -406,7 +436,12 @@ void Renderer::generate_visualisation(const ITMUChar4Image_Ptr& output, const Sp
       if(view)
       {
         if(surfelFlag) visualisationGenerator->generate_surfel_visualisation(output, surfelScene, pose, intrinsics, surfelRenderState, visualisationType);
-        else visualisationGenerator->generate_voxel_visualisation(output, voxelScene, pose, intrinsics, voxelRenderState, visualisationType, postprocessor);
+        else
+        {
+          visualisationGenerator->generate_voxel_visualisation(
+            output, voxelScene, pose, intrinsics, voxelRenderState, visualisationType, postprocessor, voxelRenderCache, fusionGeneration, labelGeneration
+          );
+        }
       }
       else output->Clear();
 
@@ -461,17 +496,17 @@ void Renderer::render_pixel_value(const Vector2f& fracWindowPos, const Subwindow
 void Renderer::render_reconstructed_scene(const std::string& sceneID, const SE3Pose& pose, Subwindow& subwindow, int viewIndex) const
 {
   // Set up any post-processing that needs to be applied to the rendering result.
-  // FIXME: At present, median filtering breaks in CPU mode, so we prevent it from running, but we should investigate why.
   static boost::optional<VisualisationGenerator::Postprocessor> postprocessor = boost::none;
   if(!m_medianFilteringEnabled && postprocessor)
   {
     postprocessor.reset();
   }
-  else if(m_medianFilteringEnabled && !postprocessor && m_model->get_settings()->deviceType == DEVICE_CUDA)
+  else if(m_medianFilteringEnabled && !postprocessor)
   {
-#if defined(WITH_ARRAYFIRE) && !defined(USE_LOW_POWER_MODE)
+#ifndef USE_LOW_POWER_MODE
+    // Note: The visualisation generator applies the post-processing to a CPU copy of the rendering result, so the filterer always runs on the CPU.
     const unsigned int kernelWidth = 3;
-    postprocessor = MedianFilterer(kernelWidth, m_model->get_settings()->deviceType);
+    postprocessor = MedianFilterer(kernelWidth, DEVICE_CPU);
 #endif
   }
 
@@ -481,9 +516,14 @@ void Renderer::render_reconstructed_scene(const std::string& sceneID, const SE3P
   const View_CPtr view = slamState->get_view();
   const ITMIntrinsics intrinsics = view->calib.intrinsics_d.MakeRescaled(subwindow.get_original_image_size(), image->noDims);
 
+  // If render caching is enabled, make sure that the free camera view has a render cache.
+  VoxelRenderCache_Ptr& voxelRenderCache = subwindow.get_voxel_render_cache(viewIndex);
+  if(m_renderCacheEnabled && !voxelRenderCache) voxelRenderCache.reset(new VoxelRenderCache(m_reprojectionEnabled));
+
   generate_visualisation(
     image, slamState->get_voxel_scene(), slamState->get_surfel_scene(),
     subwindow.get_voxel_render_state(viewIndex), subwindow.get_surfel_render_state(viewIndex),
+    voxelRenderCache, slamState->get_fusion_generation(), slamState->get_label_generation(),
     pose, view, intrinsics, subwindow.get_type(), subwindow.get_surfel_flag(), postprocessor
   );
 
@@ -43,6 +43,15 @@ private:
   /** The spaint model. */
   Model_CPtr m_model;
 
+  /** A flag indicating whether or not to print statistics about the render caches when the renderer is destroyed. */
+  bool m_printRenderCacheStats;
+
+  /** A flag indicating whether or not to cache the free camera renderings of the scene, so that they can be reused if nothing has changed. */
+  bool m_renderCacheEnabled;
+
+  /** A flag indicating whether or not to allow the render caches to reproject the scene for small camera movements, rather than re-raycasting it. */
+  bool m_reprojectionEnabled;
+
   /** The sub-window configuration to use for visualising the scene. */
   SubwindowConfiguration_Ptr m_subwindowConfiguration;
 
@@ -233,6 +242,9 @@ private:
    * \param surfelScene       The surfel version of the scene to visualise.
    * \param voxelRenderState  The voxel render state to use for intermediate storage (if relevant).
    * \param surfelRenderState The surfel render state to use for intermediate storage (if relevant).
+   * \param voxelRenderCache  An optional cache with which to avoid re-raycasting the voxel scene when neither it nor the pose have changed.
+   * \param fusionGeneration  The current fusion generation of the scene (only used if a voxel render cache is specified).
+   * \param labelGeneration   The current label generation of the scene (only used if a voxel render cache is specified).
    * \param pose              The pose from which to visualise the scene (if relevant).
    * \param view              The current view of the scene.
    * \param intrinsics        The intrinsics to use when rendering synthetic visualisations of the scene.
@@ -241,7 +253,8 @@ private:
    * \param postprocessor     An optional function with which to postprocess the visualisation before returning it.
    */
   void generate_visualisation(const ITMUChar4Image_Ptr& output, const spaint::SpaintVoxelScene_CPtr& voxelScene, const spaint::SpaintSurfelScene_CPtr& surfelScene,
-                              VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState, const ORUtils::SE3Pose& pose, const View_CPtr& view,
+                              VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState, const spaint::VoxelRenderCache_Ptr& voxelRenderCache,
+                              unsigned int fusionGeneration, unsigned int labelGeneration, const ORUtils::SE3Pose& pose, const View_CPtr& view,
                               const ITMLib::ITMIntrinsics& intrinsics, spaint::VisualisationGenerator::VisualisationType visualisationType, bool surfelFlag,
                               const boost::optional<spaint::VisualisationGenerator::Postprocessor>& postprocessor) const;
 
@@ -89,6 +89,16 @@ VisualisationGenerator::VisualisationType Subwindow::get_type() const
   return m_type;
 }
 
+VoxelRenderCache_Ptr& Subwindow::get_voxel_render_cache(int viewIndex)
+{
+  return m_voxelRenderCaches[viewIndex];
+}
+
+const std::map<int,VoxelRenderCache_Ptr>& Subwindow::get_voxel_render_caches() const
+{
+  return m_voxelRenderCaches;
+}
+
 VoxelRenderState_Ptr& Subwindow::get_voxel_render_state(int viewIndex)
 {
   return m_voxelRenderStates[viewIndex];
@@ -113,6 +123,7 @@ void Subwindow::reset_camera()
 void Subwindow::resize_image(const Vector2i& newImgSize)
 {
   m_image.reset(new ITMUChar4Image(newImgSize, true, true));
+  m_voxelRenderCaches.clear();
   m_voxelRenderStates.clear();
   m_surfelRenderStates.clear();
 }
@@ -65,6 +65,9 @@ private:
   /** The type of scene visualisation to render in the sub-window. */
   spaint::VisualisationGenerator::VisualisationType m_type;
 
+  /** The voxel render cache(s) for the free camera view(s). */
+  std::map<int,spaint::VoxelRenderCache_Ptr> m_voxelRenderCaches;
+
   /** The voxel render state(s) for the free camera view(s). */
   std::map<int,VoxelRenderState_Ptr> m_voxelRenderStates;
 
@@ -167,6 +170,20 @@ public:
    */
   spaint::VisualisationGenerator::VisualisationType get_type() const;
 
+  /**
+   * \brief Gets the voxel render cache for the specified free camera view.
+   *
+   * \param viewIndex The index of the free camera view.
+   */
+  spaint::VoxelRenderCache_Ptr& get_voxel_render_cache(int viewIndex = 0);
+
+  /**
+   * \brief Gets the voxel render caches for all of the free camera views that have been rendered.
+   *
+   * \return  The voxel render caches for all of the free camera views that have been rendered, indexed by view.
+   */
+  const std::map<int,spaint::VoxelRenderCache_Ptr>& get_voxel_render_caches() const;
+
   /**
    * \brief Gets the voxel render state for the specified free camera view.
    *
@@ -0,0 +1,164 @@
+/**
+ * touchtrain: TouchDescriptorCache.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
+ */
+
+#ifndef H_TOUCHTRAIN_TOUCHDESCRIPTORCACHE
+#define H_TOUCHTRAIN_TOUCHDESCRIPTORCACHE
+
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <rafl/base/Descriptor.h>
+
+#include <tvgutil/persistence/SerializationUtil.h>
+
+/**
+ * \brief An instance of this class represents an on-disk cache of the touch descriptors that have been calculated for a set of images.
+ *
+ * Each descriptor is keyed by the path to the image from which it was calculated, and stamped with the image's last
+ * modification time. A cached descriptor is only used if the image has not been modified since it was calculated.
+ * This allows touchtrain to be rerun (e.g. with a different parameter grid) without recalculating the descriptors.
+ */
+class TouchDescriptorCache
+{
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents an entry in the cache.
+   */
+  struct Entry
+  {
+    //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+    /** The descriptor that was calculated for the image. */
+    rafl::Descriptor descriptor;
+
+    /** The last modification time of the image when the descriptor was calculated. */
+    long long modificationTime;
+
+    //~~~~~~~~~~~~~~~~~~~~ SERIALIZATION ~~~~~~~~~~~~~~~~~~~~
+
+    /**
+     * \brief Serializes the entry to/from an archive.
+     *
+     * \param ar      The archive.
+     * \param version The file format version number.
+     */
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+      ar & descriptor;
+      ar & modificationTime;
+    }
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The path to the file in which the cache is stored. */
+  std::string m_cachePath;
+
+  /** A flag indicating whether or not the cache has been changed since it was loaded. */
+  bool m_dirty;
+
+  /** The entries in the cache, keyed by image path. */
+  std::map<std::string,Entry> m_entries;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a touch descriptor cache, loading any existing entries from the specified file.
+   *
+   * If the file does not exist or cannot be read, the cache starts out empty.
+   *
+   * \param cachePath The path to the file in which the cache is stored.
+   */
+  explicit TouchDescriptorCache(const std::string& cachePath)
+  : m_cachePath(cachePath), m_dirty(false)
+  {
+    if(!boost::filesystem::exists(cachePath)) return;
+
+    try
+    {
+      std::ifstream fs(cachePath.c_str(), std::ios_base::in | std::ios_base::binary);
+      boost::archive::binary_iarchive ar(fs);
+      ar >> m_entries;
+    }
+    catch(std::exception&)
+    {
+      std::cout << "[touchtrain] Warning: Could not read the descriptor cache at " << cachePath << ", so starting with an empty cache\n";
+      m_entries.clear();
+    }
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Looks up the cached descriptor (if any) for the specified image.
+   *
+   * \param imagePath The path to the image.
+   * \return          The cached descriptor for the image, if it exists and is up-to-date, or NULL otherwise.
+   */
+  rafl::Descriptor_CPtr lookup(const std::string& imagePath) const
+  {
+    std::map<std::string,Entry>::const_iterator it = m_entries.find(imagePath);
+    if(it == m_entries.end() || it->second.modificationTime != get_modification_time(imagePath)) return rafl::Descriptor_CPtr();
+    return rafl::Descriptor_CPtr(new rafl::Descriptor(it->second.descriptor));
+  }
+
+  /**
+   * \brief Saves the cache to disk (if it has changed since it was loaded).
+   */
+  void save()
+  {
+    if(!m_dirty) return;
+
+    boost::filesystem::path parentDir = boost::filesystem::path(m_cachePath).parent_path();
+    if(!parentDir.empty()) boost::filesystem::create_directories(parentDir);
+
+    std::ofstream fs(m_cachePath.c_str(), std::ios_base::out | std::ios_base::binary);
+    if(!fs)
+    {
+      std::cout << "[touchtrain] Warning: Could not write the descriptor cache to " << m_cachePath << '\n';
+      return;
+    }
+
+    boost::archive::binary_oarchive ar(fs);
+    ar << m_entries;
+    m_dirty = false;
+  }
+
+  /**
+   * \brief Stores the descriptor for the specified image in the cache.
+   *
+   * \param imagePath   The path to the image.
+   * \param descriptor  The descriptor that was calculated for the image.
+   */
+  void store(const std::string& imagePath, const rafl::Descriptor_CPtr& descriptor)
+  {
+    Entry& entry = m_entries[imagePath];
+    entry.descriptor = *descriptor;
+    entry.modificationTime = get_modification_time(imagePath);
+    m_dirty = true;
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the last modification time of the specified file.
+   *
+   * \param path  The path to the file.
+   * \return      The last modification time of the file.
+   */
+  static long long get_modification_time(const std::string& path)
+  {
+    return static_cast<long long>(boost::filesystem::last_write_time(path));
+  }
+};
+
+#endif
@@ -25,6 +25,9 @@ class TouchTrainDataset
 {
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The directory in which to cache the descriptors calculated for the training images. */
+  std::string m_cacheDir;
+
   /** The directory in which to store the tables of results generated during cross-validation. */
   std::string m_crossValidationResultsDir;
 
@@ -51,6 +54,9 @@ public:
     // Maintain a count of the files and directories that are unexpectedly not found.
     size_t invalidCount = 0;
 
+    // Determine the cache directory (this is optional, and will be created on demand).
+    m_cacheDir = rootDir + "/cache";
+
     // Find the cross-validation results directory.
     m_crossValidationResultsDir = rootDir + "/crossvalidation-results";
     if(!check_path_exists(m_crossValidationResultsDir)) ++invalidCount;
@@ -94,6 +100,16 @@ public:
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Gets the directory in which to cache the descriptors calculated for the training images.
+   *
+   * \return  The directory in which to cache the descriptors calculated for the training images.
+   */
+  const std::string& get_cache_directory() const
+  {
+    return m_cacheDir;
+  }
+
   /**
    * \brief Gets the directory in which to store the tables of results generated during cross-validation.
    *
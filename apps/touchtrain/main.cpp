@@ -13,9 +13,10 @@ using boost::assign::list_of;
 using namespace evaluation;
 
 #include <rafl/decisionfunctions/DecisionFunctionGeneratorFactory.h>
+#include <rafl/examples/ExampleUtil.h>
 using namespace rafl;
 
-#include <raflevaluation/RandomForestEvaluator.h>
+#include <raflevaluation/RandomForestBatchEvaluator.h>
 using namespace raflevaluation;
 
 #include <spaint/touch/TouchDescriptorCalculator.h>
@@ -27,6 +28,7 @@ using namespace spaint;
 using namespace tvgutil;
 
 #include "LabelledPath.h"
+#include "TouchDescriptorCache.h"
 #include "TouchTrainDataset.h"
 
 //#################### TYPEDEFS ####################
@@ -42,21 +44,56 @@ typedef boost::shared_ptr<RF> RF_Ptr;
 /**
  * \brief Generates an array of examples given an array of labelled image paths.
  *
+ * Descriptors that are already in the cache (and whose images have not changed since they were calculated) are reused.
+ * The remaining descriptors are calculated in parallel: each thread only loads one image at a time, so the memory used
+ * is bounded by the number of threads rather than by the number of images. The new descriptors are added to the cache.
+ *
  * \param labelledImagePaths  The labelled image paths.
+ * \param cache               The cache of previously calculated descriptors.
  * \return                    The examples.
  */
-std::vector<boost::shared_ptr<const Example<Label> > > generate_examples(const std::vector<LabelledPath<Label> >& labelledImagePaths)
+std::vector<boost::shared_ptr<const Example<Label> > > generate_examples(const std::vector<LabelledPath<Label> >& labelledImagePaths, TouchDescriptorCache& cache)
 {
-  const size_t labelledImagePathCount = labelledImagePaths.size();
+  const int labelledImagePathCount = static_cast<int>(labelledImagePaths.size());
 
   typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
   std::vector<Example_CPtr> examples(labelledImagePathCount);
 
-  for(size_t i = 0; i < labelledImagePathCount; ++i)
+  // Look up any descriptors that have already been calculated, and make a list of the images whose descriptors are missing.
+  std::vector<Descriptor_CPtr> descriptors(labelledImagePathCount);
+  std::vector<int> missingIndices;
+  for(int i = 0; i < labelledImagePathCount; ++i)
   {
+    descriptors[i] = cache.lookup(labelledImagePaths[i].path);
+    if(!descriptors[i]) missingIndices.push_back(i);
+  }
+
+  std::cout << "[touchtrain] Found " << labelledImagePathCount - missingIndices.size() << " cached descriptors, calculating " << missingIndices.size() << " more...\n";
+
+  // Calculate the missing descriptors.
+  const int missingCount = static_cast<int>(missingIndices.size());
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(dynamic)
+#endif
+  for(int j = 0; j < missingCount; ++j)
+  {
+    const int i = missingIndices[j];
     af::array img = af::loadImage(labelledImagePaths[i].path.c_str());
-    Descriptor_CPtr descriptor = TouchDescriptorCalculator::calculate_histogram_descriptor(img);
-    examples[i].reset(new Example<Label>(descriptor, labelledImagePaths[i].label));
+    descriptors[i] = TouchDescriptorCalculator::calculate_histogram_descriptor(img);
+  }
+
+  // Add the newly-calculated descriptors to the cache.
+  for(int j = 0; j < missingCount; ++j)
+  {
+    const int i = missingIndices[j];
+    cache.store(labelledImagePaths[i].path, descriptors[i]);
+  }
+
+  // Make the examples.
+  for(int i = 0; i < labelledImagePathCount; ++i)
+  {
+    examples[i].reset(new Example<Label>(descriptors[i], labelledImagePaths[i].label));
   }
 
   return examples;
@@ -64,9 +101,9 @@ std::vector<boost::shared_ptr<const Example<Label> > > generate_examples(const s
 
 int main(int argc, char *argv[])
 {
-  if(argc != 2)
+  if(argc != 2 && argc != 3)
   {
-    std::cerr << "Usage: touchtrain [<touch training set path>]\n";
+    std::cerr << "Usage: touchtrain <touch training set path> [<example file>]\n";
     return EXIT_FAILURE;
   }
 
@@ -77,9 +114,20 @@ int main(int argc, char *argv[])
   TouchTrainDataset<Label> dataset(argv[1], list_of(2)(3)(4)(5));
   std::cout << "[touchtrain] Training set root: " << dataset.get_root_directory() << '\n';
 
-  // Generate the examples with which to train the random forest.
-  std::cout << "[touchtrain] Generating examples...\n";
-  std::vector<Example_CPtr> examples = generate_examples(dataset.get_training_image_paths());
+  // Generate the examples with which to train the random forest (or load them from a CSV or binary example file if one was specified).
+  std::vector<Example_CPtr> examples;
+  if(argc == 3)
+  {
+    std::cout << "[touchtrain] Loading examples from " << argv[2] << "...\n";
+    examples = ExampleUtil::load_examples<Label>(argv[2]);
+  }
+  else
+  {
+    std::cout << "[touchtrain] Generating examples...\n";
+    TouchDescriptorCache cache(dataset.get_cache_directory() + "/touchdescriptors.bin");
+    examples = generate_examples(dataset.get_training_image_paths(), cache);
+    cache.save();
+  }
   std::cout << "[touchtrain] Number of examples = " << examples.size() << '\n';
 
   // Generate the parameter sets with which to test the random forest.
@@ -114,12 +162,11 @@ int main(int argc, char *argv[])
   // Evaluate the random forest on the various different parameter sets.
   std::cout << "[touchtrain] Cross-validating the performance of the forest on various parameter sets...\n";
   PerformanceTable results(list_of("Accuracy"));
-  boost::shared_ptr<RandomForestEvaluator<Label> > evaluator;
+  RandomForestBatchEvaluator<Label> evaluator(splitGenerator);
+  std::vector<PerformanceResult> paramSetResults = evaluator.evaluate(examples, params);
   for(size_t n = 0, size = params.size(); n < size; ++n)
   {
-    evaluator.reset(new RandomForestEvaluator<Label>(splitGenerator, params[n]));
-    PerformanceResult result = evaluator->evaluate(examples);
-    results.record_performance(params[n], result);
+    results.record_performance(params[n], paramSetResults[n]);
   }
 
   // Output the performance table.
@@ -149,10 +196,14 @@ int main(int argc, char *argv[])
   std::cout << "[touchtrain] The final trained forest statistics:\n";
   if(randomForest->train(splitBudget) != 0) randomForest->output_statistics(std::cout);
 
-  // Output the forest itself to a file.
+  // Output the forest itself to a file, using both a text archive and a (much faster to load) binary archive.
   std::string forestPath = dataset.get_models_directory() + "/randomForest-" + timestamp + ".rf";
   std::cout << "[touchtrain] Saving the forest to: " << forestPath << "\n";
   SerializationUtil::save_text(forestPath, *randomForest);
 
+  std::string binaryForestPath = forestPath + "b";
+  std::cout << "[touchtrain] Saving the forest to: " << binaryForestPath << "\n";
+  SerializationUtil::save_binary(binaryForestPath, *randomForest);
+
   return 0;
 }
@@ -0,0 +1,11 @@
+/**
+ * vopfeatureperf: CPUInstantiations.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <ITMLib/Engines/Reconstruction/CPU/ITMSceneReconstructionEngine_CPU.tpp>
+
+#include <spaint/util/SpaintVoxel.h>
+using namespace spaint;
+
+template class ITMSceneReconstructionEngine_CPU<SpaintVoxel,ITMVoxelIndex>;
@@ -0,0 +1,285 @@
+/**
+ * vopfeatureperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ITMLib/Engines/Reconstruction/CPU/ITMSceneReconstructionEngine_CPU.h>
+#include <ITMLib/Objects/RenderStates/ITMRenderStateFactory.h>
+#include <ITMLib/Utils/ITMLibSettings.h>
+using namespace ITMLib;
+
+#include <itmx/base/ITMObjectPtrTypes.h>
+
+#include <spaint/features/cpu/VOPFeatureCalculator_CPU.h>
+#include <spaint/features/shared/VOPFeatureCalculator_Shared.h>
+#include <spaint/util/SpaintVoxelScene.h>
+using namespace spaint;
+
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+#include <tvgutil/timing/TimeUtil.h>
+using namespace tvgutil;
+
+//#################### TYPES ####################
+
+/**
+ * \brief An instance of this struct holds the inputs needed to generate RGB patches for a set of voxels in a scene.
+ */
+struct PatchInputs
+{
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+  /** The number of features in a feature descriptor for a voxel. */
+  size_t featureCount;
+
+  /** The scene's index data. */
+  const ITMVoxelIndex::IndexData *indexData;
+
+  /** The spacing in the scene (in voxels) between individual pixels in a patch. */
+  float patchSpacing;
+
+  /** The side length of a VOP patch. */
+  size_t patchSize;
+
+  /** The scene's voxel data. */
+  const SpaintVoxel *voxelData;
+
+  /** The locations of the voxels for which to generate RGB patches. */
+  std::vector<Vector3s> voxelLocations;
+
+  /** The x axes of the coordinate systems in the tangent planes to the surfaces at the voxel locations. */
+  std::vector<Vector3f> xAxes;
+
+  /** The y axes of the coordinate systems in the tangent planes to the surfaces at the voxel locations. */
+  std::vector<Vector3f> yAxes;
+};
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Generates RGB patches for the specified voxels, looking up each pixel of each patch independently in the scene's voxel hash.
+ *
+ * This is how VOPFeatureCalculator_CPU used to generate its patches, and is retained here as a reference.
+ *
+ * \param inputs    The inputs needed to generate the patches.
+ * \param features  The feature descriptors into which to write the patches.
+ */
+void generate_rgb_patches_with_hash_lookups(const PatchInputs& inputs, float *features)
+{
+  const int voxelLocationCount = static_cast<int>(inputs.voxelLocations.size());
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
+  {
+    generate_rgb_patch(
+      voxelLocationIndex, &inputs.voxelLocations[0], &inputs.xAxes[0], &inputs.yAxes[0], inputs.voxelData, inputs.indexData,
+      inputs.patchSize, inputs.patchSpacing, inputs.featureCount, features
+    );
+  }
+}
+
+/**
+ * \brief Generates RGB patches for the specified voxels in the specified order, using a block-caching voxel reader in each thread.
+ *
+ * \param inputs      The inputs needed to generate the patches.
+ * \param visitOrder  The order in which to visit the voxels.
+ * \param features    The feature descriptors into which to write the patches.
+ */
+void generate_rgb_patches_with_block_cache(const PatchInputs& inputs, const std::vector<int>& visitOrder, float *features)
+{
+  const int voxelLocationCount = static_cast<int>(visitOrder.size());
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    BlockCachingVoxelReader voxelReader(inputs.voxelData, inputs.indexData);
+
+#ifdef WITH_OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for(int i = 0; i < voxelLocationCount; ++i)
+    {
+      generate_rgb_patch(
+        visitOrder[i], &inputs.voxelLocations[0], &inputs.xAxes[0], &inputs.yAxes[0], voxelReader,
+        inputs.patchSize, inputs.patchSpacing, inputs.featureCount, features
+      );
+    }
+  }
+}
+
+/**
+ * \brief Makes a synthetic view of a gently undulating, noisily-textured surface, seen from the origin.
+ *
+ * \param imgSize The size of the depth and RGB images in the view.
+ * \param rng     The random number generator to use when texturing the surface.
+ * \return        The view.
+ */
+View_Ptr make_test_view(const Vector2i& imgSize, RandomNumberGenerator& rng)
+{
+  ITMRGBDCalib calib;
+  const float f = 525.0f * imgSize.x / 640.0f, cx = (imgSize.x - 1) / 2.0f, cy = (imgSize.y - 1) / 2.0f;
+  calib.intrinsics_d.SetFrom(imgSize.x, imgSize.y, f, f, cx, cy);
+  calib.intrinsics_rgb.SetFrom(imgSize.x, imgSize.y, f, f, cx, cy);
+
+  View_Ptr view(new ITMView(calib, imgSize, imgSize, false));
+  float *depths = view->depth->GetData(MEMORYDEVICE_CPU);
+  Vector4u *colours = view->rgb->GetData(MEMORYDEVICE_CPU);
+
+  for(int y = 0; y < imgSize.y; ++y)
+  {
+    for(int x = 0; x < imgSize.x; ++x)
+    {
+      const int pixelIndex = y * imgSize.x + x;
+      depths[pixelIndex] = 1.5f + 0.1f * sinf(x * 0.05f) * cosf(y * 0.05f);
+
+      Vector4u& colour = colours[pixelIndex];
+      colour.x = static_cast<unsigned char>(255 * x / imgSize.x);
+      colour.y = static_cast<unsigned char>(255 * y / imgSize.y);
+      colour.z = static_cast<unsigned char>(rng.generate_int_from_uniform(0, 255));
+      colour.w = 255;
+    }
+  }
+
+  return view;
+}
+
+/**
+ * \brief Outputs a row of the results table for a method of generating RGB patches.
+ *
+ * \param methodName          The name of the method.
+ * \param time                The average time taken by the method to generate the patches (in milliseconds).
+ * \param referenceTime       The average time taken to generate the patches using independent hash lookups (in milliseconds).
+ * \param voxelLocationCount  The number of voxels for which patches were generated.
+ * \param identical           Whether or not the method generated the same patches as independent hash lookups.
+ */
+void output_result(const std::string& methodName, double time, double referenceTime, int voxelLocationCount, bool identical)
+{
+  std::cout << std::left << std::setw(30) << methodName
+            << std::right << std::setw(12) << std::fixed << std::setprecision(3) << time
+            << std::setw(14) << std::setprecision(0) << voxelLocationCount / (time / 1000.0)
+            << std::setw(9) << std::setprecision(2) << referenceTime / time << 'x'
+            << std::setw(12) << (identical ? "yes" : "NO") << '\n';
+}
+
+int main(int argc, char *argv[])
+try
+{
+  if(argc > 3)
+  {
+    std::cerr << "Usage: vopfeatureperf [<voxel count> [<iteration count>]]\n";
+    return EXIT_FAILURE;
+  }
+
+  const int voxelLocationCount = argc > 1 ? boost::lexical_cast<int>(argv[1]) : 8192;
+  const int iterationCount = argc > 2 ? boost::lexical_cast<int>(argv[2]) : 20;
+  if(voxelLocationCount <= 0 || iterationCount <= 0) throw std::runtime_error("Error: The voxel and iteration counts must be positive");
+
+  RandomNumberGenerator rng(12345);
+
+  // Fuse a synthetic view into a scene.
+  ITMLibSettings settings;
+  settings.deviceType = ITMLibSettings::DEVICE_CPU;
+  SpaintVoxelScene scene(&settings.sceneParams, false, MEMORYDEVICE_CPU);
+
+  const Vector2i imgSize(640, 480);
+  View_Ptr view = make_test_view(imgSize, rng);
+  TrackingState_Ptr trackingState(new ITMTrackingState(imgSize, MEMORYDEVICE_CPU));
+  VoxelRenderState_Ptr renderState(ITMRenderStateFactory<ITMVoxelIndex>::CreateRenderState(imgSize, scene.sceneParams, MEMORYDEVICE_CPU));
+
+  ITMSceneReconstructionEngine_CPU<SpaintVoxel,ITMVoxelIndex> reconstructionEngine;
+  reconstructionEngine.ResetScene(&scene);
+  reconstructionEngine.AllocateSceneFromDepth(&scene, view.get(), trackingState.get(), renderState.get());
+  reconstructionEngine.IntegrateIntoScene(&scene, view.get(), trackingState.get(), renderState.get());
+
+  // Sample voxels on the surface by back-projecting randomly-chosen pixels (the camera is at the origin, so camera space is world space).
+  const size_t patchSize = 13;
+  const float voxelSize = settings.sceneParams.voxelSize;
+  const float patchSpacing = 0.01f / voxelSize;
+  const VOPFeatureCalculator_CPU featureCalculator(voxelLocationCount, patchSize, patchSpacing, 36);
+
+  PatchInputs inputs;
+  inputs.featureCount = featureCalculator.get_feature_count();
+  inputs.indexData = scene.index.getIndexData();
+  inputs.patchSize = patchSize;
+  inputs.patchSpacing = patchSpacing;
+  inputs.voxelData = scene.localVBA.GetVoxelBlocks();
+
+  const float *depths = view->depth->GetData(MEMORYDEVICE_CPU);
+  const Vector4f& intrinsics = view->calib.intrinsics_d.projectionParamsSimple.all;
+  for(int i = 0; i < voxelLocationCount; ++i)
+  {
+    const int x = rng.generate_int_from_uniform(0, imgSize.x - 1), y = rng.generate_int_from_uniform(0, imgSize.y - 1);
+    const float z = depths[y * imgSize.x + x];
+    const Vector3f p((x - intrinsics.z) * z / intrinsics.x, (y - intrinsics.w) * z / intrinsics.y, z);
+    inputs.voxelLocations.push_back((p / voxelSize).toShortRound());
+  }
+
+  // Set up a coordinate system in the tangent plane at each voxel, as the feature calculator does before generating the patches.
+  std::vector<float> features(voxelLocationCount * inputs.featureCount);
+  std::vector<Vector3f> surfaceNormals(voxelLocationCount);
+  inputs.xAxes.resize(voxelLocationCount);
+  inputs.yAxes.resize(voxelLocationCount);
+  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
+  {
+    write_surface_normal(voxelLocationIndex, &inputs.voxelLocations[0], inputs.voxelData, inputs.indexData, &surfaceNormals[0], inputs.featureCount, &features[0]);
+    generate_coordinate_system(voxelLocationIndex, &surfaceNormals[0], &inputs.xAxes[0], &inputs.yAxes[0]);
+  }
+
+  // Determine the orders in which to visit the voxels: the order in which they were sampled, and Morton order.
+  std::vector<int> sampledOrder(voxelLocationCount);
+  std::vector<std::pair<boost::uint64_t,int> > mortonCodes(voxelLocationCount);
+  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
+  {
+    sampledOrder[voxelLocationIndex] = voxelLocationIndex;
+    mortonCodes[voxelLocationIndex] = std::make_pair(VOPFeatureCalculator_CPU::make_morton_code(inputs.voxelLocations[voxelLocationIndex]), voxelLocationIndex);
+  }
+
+  std::sort(mortonCodes.begin(), mortonCodes.end());
+  std::vector<int> mortonOrder(voxelLocationCount);
+  for(int i = 0; i < voxelLocationCount; ++i) mortonOrder[i] = mortonCodes[i].second;
+
+  // Time each method of generating the patches, and check that they produce the same patches as independent hash lookups.
+  // Note that both sets of descriptors start out with the surface normals written above, so that they can be compared in full.
+  std::vector<float> referenceFeatures(features);
+  const double referenceTime = TimeUtil::time_average_ms(
+    boost::bind(generate_rgb_patches_with_hash_lookups, boost::cref(inputs), &referenceFeatures[0]), iterationCount
+  );
+
+  std::cout << voxelLocationCount << " voxels, " << patchSize << "x" << patchSize << " patches\n\n";
+  std::cout << std::left << std::setw(30) << "Method" << std::right << std::setw(12) << "Time (ms)" << std::setw(14) << "Patches/s"
+            << std::setw(10) << "Speedup" << std::setw(12) << "Identical" << '\n';
+  output_result("Hash lookups", referenceTime, referenceTime, voxelLocationCount, true);
+
+  double time = TimeUtil::time_average_ms(
+    boost::bind(generate_rgb_patches_with_block_cache, boost::cref(inputs), boost::cref(sampledOrder), &features[0]), iterationCount
+  );
+  output_result("Block cache (sampled order)", time, referenceTime, voxelLocationCount, features == referenceFeatures);
+
+  time = TimeUtil::time_average_ms(
+    boost::bind(generate_rgb_patches_with_block_cache, boost::cref(inputs), boost::cref(mortonOrder), &features[0]), iterationCount
+  );
+  output_result("Block cache (Morton order)", time, referenceTime, voxelLocationCount, features == referenceFeatures);
+
+  return 0;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
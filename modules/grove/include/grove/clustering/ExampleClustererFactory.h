@@ -34,11 +34,13 @@ struct ExampleClustererFactory
    *                         but only the maxClusterCount largest ones are returned). Must be <= MaxClusters.
    * \param minClusterSize   The minimum size of cluster to keep.
    * \param deviceType       The device on which the example clusterer should operate.
+   * \param useGrid          Whether or not a CPU-based clusterer should use uniform grids to accelerate the density and parent
+   *                         computations (this does not affect the clusters produced, and is ignored by CUDA-based clusterers).
    * \return                 The example clusterer.
    *
    * \throws std::invalid_argument If maxClusterCount > MaxClusters.
    */
-  static Clusterer_Ptr make_clusterer(float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize, DeviceType deviceType);
+  static Clusterer_Ptr make_clusterer(float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize, DeviceType deviceType, bool useGrid = true);
 };
 
 }
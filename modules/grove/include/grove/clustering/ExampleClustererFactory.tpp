@@ -18,7 +18,7 @@ namespace grove {
 template <typename ExampleType, typename ClusterType, int MaxClusters>
 typename ExampleClustererFactory<ExampleType,ClusterType,MaxClusters>::Clusterer_Ptr
 ExampleClustererFactory<ExampleType,ClusterType,MaxClusters>::make_clusterer(
-  float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize, DeviceType deviceType
+  float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize, DeviceType deviceType, bool useGrid
 )
 {
   Clusterer_Ptr clusterer;
@@ -33,7 +33,7 @@ ExampleClustererFactory<ExampleType,ClusterType,MaxClusters>::make_clusterer(
   }
   else
   {
-    clusterer.reset(new ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>(sigma, tau, maxClusterCount, minClusterSize));
+    clusterer.reset(new ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>(sigma, tau, maxClusterCount, minClusterSize, useGrid));
   }
 
   return clusterer;
@@ -6,6 +6,8 @@
 #ifndef H_GROVE_EXAMPLECLUSTERER_CPU
 #define H_GROVE_EXAMPLECLUSTERER_CPU
 
+#include <vector>
+
 #include "../interface/ExampleClusterer.h"
 
 namespace grove {
@@ -13,6 +15,15 @@ namespace grove {
 /**
  * \brief An instance of this class can be used to cluster sets of examples using the CPU.
  *
+ * By default, the density and parent computations avoid comparing every pair of examples in a set by first bucketing
+ * the examples into a uniform grid whose cells are at least as large as the radius of either computation (3 * sigma
+ * for the densities, tau for the parents), so that each example only needs to be compared with the examples in its
+ * own cell and the 26 neighbouring ones. The neighbouring examples are visited in the same order as they would be by
+ * the exhaustive approach, so the clusters produced are identical. The positions of the examples are copied into a
+ * separate array for each set while the grids are being built, so that the density and parent computations only
+ * read the positions they need, rather than the whole of each example (the rest of each example, e.g. its colour,
+ * is only read when the selected clusters are created).
+ *
  * See the base class template for additional documentation.
  *
  * \param ExampleType  The type of example to cluster.
@@ -31,6 +42,54 @@ public:
   using typename Base::ExampleImage;
   using typename Base::ExampleImage_CPtr;
 
+  //#################### ENUMERATIONS ####################
+private:
+  /** The number of bits used for each coordinate in a cell key, and the bias added to each coordinate to make it non-negative. */
+  enum
+  {
+    CELL_COORD_BITS = 21,
+    CELL_COORD_BIAS = 1 << (CELL_COORD_BITS - 1)
+  };
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents an example in the uniform grid built for an example set.
+   */
+  struct GridEntry
+  {
+    /** The key of the grid cell containing the example. */
+    uint64_t cellKey;
+
+    /** The index of the example within its example set. */
+    int exampleIdx;
+
+    bool operator<(const GridEntry& rhs) const;
+  };
+
+  /**
+   * \brief An instance of this struct can be used to compare grid entries with cell keys (for binary searching).
+   */
+  struct CellKeyLess
+  {
+    bool operator()(const GridEntry& lhs, uint64_t rhs) const;
+    bool operator()(uint64_t lhs, const GridEntry& rhs) const;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The side length of the cells in the uniform grids. */
+  float m_gridCellSize;
+
+  /** The uniform grids built for the example sets being clustered (each grid consists of entries sorted by cell key, then by example index). */
+  std::vector<std::vector<GridEntry> > m_grids;
+
+  /** The positions of the examples in the example sets being clustered (only filled in when the grids are used). */
+  std::vector<std::vector<Vector3f> > m_positions;
+
+  /** Whether or not to use uniform grids to accelerate the density and parent computations. */
+  bool m_useGrid;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -41,10 +100,11 @@ public:
    * \param maxClusterCount  The maximum number of clusters retained for each set of examples (all clusters are estimated
    *                         but only the maxClusterCount largest ones are returned). Must be <= MaxClusters.
    * \param minClusterSize   The minimum size of cluster to keep.
+   * \param useGrid          Whether or not to use uniform grids to accelerate the density and parent computations.
    *
    * \throws std::invalid_argument If maxClusterCount > MaxClusters.
    */
-  ExampleClusterer_CPU(float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize);
+  ExampleClusterer_CPU(float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize, bool useGrid = true);
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
@@ -82,6 +142,53 @@ private:
 
   /** Override */
   virtual void select_clusters(uint32_t exampleSetCapacity, uint32_t exampleSetCount);
+
+  /**
+   * \brief Builds a uniform grid for each example set being clustered, and copies the positions of the examples in each set into m_positions.
+   *
+   * \param exampleSets         An image containing the sets of examples to be clustered (one set per row).
+   * \param exampleSetSizes     The number of valid examples in each example set.
+   * \param exampleSetCapacity  The maximum size of each example set.
+   * \param exampleSetCount     The number of example sets being clustered.
+   */
+  void build_grids(const ExampleType *exampleSets, const int *exampleSetSizes, uint32_t exampleSetCapacity, uint32_t exampleSetCount);
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Clamps a grid cell coordinate to the range that can be represented in a cell key.
+   *
+   * \param coord The (integral) cell coordinate.
+   * \return      The clamped cell coordinate.
+   */
+  static int clamp_cell_coord(float coord);
+
+  /**
+   * \brief Clamps a grid cell coordinate to the range that can be represented in a cell key.
+   *
+   * \param coord The cell coordinate.
+   * \return      The clamped cell coordinate.
+   */
+  static int clamp_cell_coord(int coord);
+
+  /**
+   * \brief Finds the examples in an example set that are in the specified grid cell or one of its 26 neighbours.
+   *
+   * \param grid        The uniform grid for the example set.
+   * \param cellKey     The key of the grid cell.
+   * \param neighbours  A vector into which to write the indices of the examples, in increasing order.
+   */
+  static void find_neighbours(const std::vector<GridEntry>& grid, uint64_t cellKey, std::vector<int>& neighbours);
+
+  /**
+   * \brief Computes the key of the grid cell with the specified (clamped) coordinates.
+   *
+   * \param x The x coordinate of the cell.
+   * \param y The y coordinate of the cell.
+   * \param z The z coordinate of the cell.
+   * \return  The key of the cell. Cells that are adjacent along the z axis have consecutive keys.
+   */
+  static uint64_t make_cell_key(int x, int y, int z);
 };
 
 }
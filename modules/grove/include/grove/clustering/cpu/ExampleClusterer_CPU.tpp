@@ -5,6 +5,8 @@
 
 #include "ExampleClusterer_CPU.h"
 
+#include <algorithm>
+
 #include "../shared/ExampleClusterer_Shared.h"
 
 namespace grove {
@@ -12,9 +14,37 @@ namespace grove {
 //#################### CONSTRUCTORS ####################
 
 template <typename ExampleType, typename ClusterType, int MaxClusters>
-ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::ExampleClusterer_CPU(float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize)
+ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::ExampleClusterer_CPU(float sigma, float tau, uint32_t maxClusterCount, uint32_t minClusterSize, bool useGrid)
 : ExampleClusterer<ExampleType,ClusterType,MaxClusters>(sigma, tau, maxClusterCount, minClusterSize)
-{}
+{
+  // The grid cells must be at least as large as the radii of both the density and parent computations. We enlarge them
+  // slightly to make sure that pairs of examples whose squared distances are rounded down below the thresholds are still
+  // found in neighbouring cells.
+  m_gridCellSize = std::max(3.0f * sigma, tau) * 1.01f;
+
+  // If the cell size is degenerate, fall back to comparing every pair of examples.
+  m_useGrid = useGrid && m_gridCellSize > 0.0f;
+}
+
+//#################### PRIVATE NESTED TYPE MEMBER FUNCTIONS ####################
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+bool ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::GridEntry::operator<(const GridEntry& rhs) const
+{
+  return cellKey < rhs.cellKey || (cellKey == rhs.cellKey && exampleIdx < rhs.exampleIdx);
+}
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+bool ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::CellKeyLess::operator()(const GridEntry& lhs, uint64_t rhs) const
+{
+  return lhs.cellKey < rhs;
+}
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+bool ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::CellKeyLess::operator()(uint64_t lhs, const GridEntry& rhs) const
+{
+  return lhs < rhs.cellKey;
+}
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
@@ -62,14 +92,73 @@ void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::compute_densitie
 {
   float *densities = this->m_densities->GetData(MEMORYDEVICE_CPU);
 
+  if(!m_useGrid)
+  {
+#ifdef WITH_OPENMP
+    #pragma omp parallel for
+#endif
+    for(int exampleSetIdx = 0; exampleSetIdx < static_cast<int>(exampleSetCount); ++exampleSetIdx)
+    {
+      for(uint32_t exampleIdx = 0; exampleIdx < exampleSetCapacity; ++exampleIdx)
+      {
+        compute_density(exampleSetIdx, exampleIdx, examples, exampleSetSizes, exampleSetCapacity, Base::m_sigma, densities);
+      }
+    }
+
+    return;
+  }
+
+  // Bucket the examples in each set into a uniform grid, copying out their positions as we go (both are reused by compute_parents).
+  build_grids(examples, exampleSetSizes, exampleSetCapacity, exampleSetCount);
+
+  // Note: These must be computed in exactly the same way as in compute_density, so that the densities are identical.
+  const float sigma = Base::m_sigma;
+  const float threeSigmaSq = (3.0f * sigma) * (3.0f * sigma);
+  const float minusOneOverTwoSigmaSq = -1.0f / (2.0f * sigma * sigma);
+
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
   for(int exampleSetIdx = 0; exampleSetIdx < static_cast<int>(exampleSetCount); ++exampleSetIdx)
   {
-    for(uint32_t exampleIdx = 0; exampleIdx < exampleSetCapacity; ++exampleIdx)
+    const int exampleSetOffset = exampleSetIdx * exampleSetCapacity;
+    const std::vector<GridEntry>& grid = m_grids[exampleSetIdx];
+    const std::vector<Vector3f>& positions = m_positions[exampleSetIdx];
+    std::vector<int> neighbours;
+
+    // Examples that are invalid or not in the grid have zero density.
+    std::fill(densities + exampleSetOffset, densities + exampleSetOffset + exampleSetCapacity, 0.0f);
+
+    // For each occupied cell in the grid:
+    for(size_t cellBegin = 0, gridSize = grid.size(), cellEnd; cellBegin < gridSize; cellBegin = cellEnd)
     {
-      compute_density(exampleSetIdx, exampleIdx, examples, exampleSetSizes, exampleSetCapacity, Base::m_sigma, densities);
+      const uint64_t cellKey = grid[cellBegin].cellKey;
+      for(cellEnd = cellBegin + 1; cellEnd < gridSize && grid[cellEnd].cellKey == cellKey; ++cellEnd);
+
+      // Find the examples that might be near the examples in the cell.
+      find_neighbours(grid, cellKey, neighbours);
+
+      // Compute the density of each example in the cell. Since the neighbours are visited in increasing order
+      // of index, the contributions to each density are summed in the same order as in compute_density.
+      // Note: The squared distances are computed from the positions in the same way as by distance_squared.
+      for(size_t k = cellBegin; k < cellEnd; ++k)
+      {
+        const int exampleIdx = grid[k].exampleIdx;
+        const Vector3f centrePosition = positions[exampleIdx];
+
+        float density = 0.0f;
+        for(size_t j = 0, neighbourCount = neighbours.size(); j < neighbourCount; ++j)
+        {
+          const Vector3f diff = positions[neighbours[j]] - centrePosition;
+          const float normSq = dot(diff, diff);
+          if(normSq < threeSigmaSq)
+          {
+            density += expf(normSq * minusOneOverTwoSigmaSq);
+          }
+        }
+
+        densities[exampleSetOffset + exampleIdx] = density;
+      }
     }
   }
 }
@@ -83,17 +172,90 @@ void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::compute_parents(
   int *nbClustersPerExampleSet = this->m_nbClustersPerExampleSet->GetData(MEMORYDEVICE_CPU);
   int *parents = this->m_parents->GetData(MEMORYDEVICE_CPU);
 
+  if(!m_useGrid)
+  {
+#ifdef WITH_OPENMP
+    #pragma omp parallel for
+#endif
+    for(int exampleSetIdx = 0; exampleSetIdx < static_cast<int>(exampleSetCount); ++exampleSetIdx)
+    {
+      for(uint32_t exampleIdx = 0; exampleIdx < exampleSetCapacity; ++exampleIdx)
+      {
+        compute_parent(
+          exampleSetIdx, exampleIdx, exampleSets, exampleSetCapacity, exampleSetSizes,
+          densities, tauSq, parents, clusterIndices, nbClustersPerExampleSet
+        );
+      }
+    }
+
+    return;
+  }
+
+  // Note: The grids and positions were built by compute_densities, which is always called first.
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
   for(int exampleSetIdx = 0; exampleSetIdx < static_cast<int>(exampleSetCount); ++exampleSetIdx)
   {
-    for(uint32_t exampleIdx = 0; exampleIdx < exampleSetCapacity; ++exampleIdx)
+    const int exampleSetOffset = exampleSetIdx * exampleSetCapacity;
+    const int exampleSetSize = exampleSetSizes[exampleSetIdx];
+    const std::vector<GridEntry>& grid = m_grids[exampleSetIdx];
+    const std::vector<Vector3f>& positions = m_positions[exampleSetIdx];
+    std::vector<int> neighbours;
+
+    // Unless it becomes part of a subtree, each example starts as its own parent.
+    for(int exampleIdx = 0; exampleIdx < static_cast<int>(exampleSetCapacity); ++exampleIdx)
     {
-      compute_parent(
-        exampleSetIdx, exampleIdx, exampleSets, exampleSetCapacity, exampleSetSizes,
-        densities, tauSq, parents, clusterIndices, nbClustersPerExampleSet
-      );
+      parents[exampleSetOffset + exampleIdx] = exampleIdx;
+      clusterIndices[exampleSetOffset + exampleIdx] = -1;
+    }
+
+    // For each occupied cell in the grid:
+    for(size_t cellBegin = 0, gridSize = grid.size(), cellEnd; cellBegin < gridSize; cellBegin = cellEnd)
+    {
+      const uint64_t cellKey = grid[cellBegin].cellKey;
+      for(cellEnd = cellBegin + 1; cellEnd < gridSize && grid[cellEnd].cellKey == cellKey; ++cellEnd);
+
+      // Find the examples that might be near the examples in the cell.
+      find_neighbours(grid, cellKey, neighbours);
+
+      // Find the parent of each example in the cell. Since the neighbours are visited in increasing
+      // order of index, ties are broken in the same way as in compute_parent.
+      for(size_t k = cellBegin; k < cellEnd; ++k)
+      {
+        const int exampleIdx = grid[k].exampleIdx;
+        const Vector3f centrePosition = positions[exampleIdx];
+        const float centreDensity = densities[exampleSetOffset + exampleIdx];
+
+        float minDistanceSq = tauSq;
+        int parentIdx = exampleIdx;
+        for(size_t j = 0, neighbourCount = neighbours.size(); j < neighbourCount; ++j)
+        {
+          const int i = neighbours[j];
+          if(i == exampleIdx) continue;
+
+          const Vector3f diff = positions[i] - centrePosition;
+          const float otherDensity = densities[exampleSetOffset + i];
+          const float otherDistSq = dot(diff, diff);
+          if(otherDensity > centreDensity && otherDistSq < minDistanceSq)
+          {
+            minDistanceSq = otherDistSq;
+            parentIdx = i;
+          }
+        }
+
+        parents[exampleSetOffset + exampleIdx] = parentIdx;
+      }
+    }
+
+    // Allocate cluster indices to the subtree roots in increasing order of example index (as compute_parent
+    // would if run sequentially). Each example set is processed by a single thread, so this need not be atomic.
+    for(int exampleIdx = 0; exampleIdx < exampleSetSize; ++exampleIdx)
+    {
+      if(parents[exampleSetOffset + exampleIdx] == exampleIdx)
+      {
+        clusterIndices[exampleSetOffset + exampleIdx] = nbClustersPerExampleSet[exampleSetIdx]++;
+      }
     }
   }
 }
@@ -189,4 +351,112 @@ void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::select_clusters(
   }
 }
 
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::build_grids(const ExampleType *exampleSets, const int *exampleSetSizes,
+                                                                            uint32_t exampleSetCapacity, uint32_t exampleSetCount)
+{
+  // Note: The grids and positions are retained between calls so as to avoid repeatedly reallocating them.
+  if(m_grids.size() < exampleSetCount)
+  {
+    m_grids.resize(exampleSetCount);
+    m_positions.resize(exampleSetCount);
+  }
+
+  const float oneOverCellSize = 1.0f / m_gridCellSize;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int exampleSetIdx = 0; exampleSetIdx < static_cast<int>(exampleSetCount); ++exampleSetIdx)
+  {
+    const int exampleSetOffset = exampleSetIdx * exampleSetCapacity;
+    const int exampleSetSize = exampleSetSizes[exampleSetIdx];
+    std::vector<GridEntry>& grid = m_grids[exampleSetIdx];
+    std::vector<Vector3f>& positions = m_positions[exampleSetIdx];
+    grid.clear();
+    positions.resize(exampleSetSize);
+
+    for(int exampleIdx = 0; exampleIdx < exampleSetSize; ++exampleIdx)
+    {
+      const Vector3f position = get_position(exampleSets[exampleSetOffset + exampleIdx]);
+      positions[exampleIdx] = position;
+
+      // Examples with invalid positions are deliberately left out of the grid, since they cannot be near any other example.
+      if(position.x != position.x || position.y != position.y || position.z != position.z) continue;
+
+      GridEntry entry;
+      entry.cellKey = make_cell_key(
+        clamp_cell_coord(floorf(position.x * oneOverCellSize)),
+        clamp_cell_coord(floorf(position.y * oneOverCellSize)),
+        clamp_cell_coord(floorf(position.z * oneOverCellSize))
+      );
+      entry.exampleIdx = exampleIdx;
+      grid.push_back(entry);
+    }
+
+    std::sort(grid.begin(), grid.end());
+  }
+}
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::find_neighbours(const std::vector<GridEntry>& grid, uint64_t cellKey,
+                                                                                std::vector<int>& neighbours)
+{
+  neighbours.clear();
+
+  // Recover the coordinates of the cell from its key.
+  const uint64_t mask = (1ULL << CELL_COORD_BITS) - 1;
+  const int x = static_cast<int>((cellKey >> (2 * CELL_COORD_BITS)) & mask) - CELL_COORD_BIAS;
+  const int y = static_cast<int>((cellKey >> CELL_COORD_BITS) & mask) - CELL_COORD_BIAS;
+  const int z = static_cast<int>(cellKey & mask) - CELL_COORD_BIAS;
+
+  // Since cells that are adjacent along the z axis have consecutive keys, the examples in each column of three
+  // neighbouring cells form a contiguous range of the grid, which we can find using binary search.
+  for(int dy = -1; dy <= 1; ++dy)
+  {
+    for(int dx = -1; dx <= 1; ++dx)
+    {
+      const int cx = clamp_cell_coord(x + dx), cy = clamp_cell_coord(y + dy);
+
+      // Avoid visiting the same column twice at the edges of the clamped range.
+      if((dx != 0 && cx == x) || (dy != 0 && cy == y)) continue;
+
+      const uint64_t firstKey = make_cell_key(cx, cy, clamp_cell_coord(z - 1));
+      const uint64_t lastKey = make_cell_key(cx, cy, clamp_cell_coord(z + 1));
+      typename std::vector<GridEntry>::const_iterator it = std::lower_bound(grid.begin(), grid.end(), firstKey, CellKeyLess());
+      typename std::vector<GridEntry>::const_iterator end = std::upper_bound(it, grid.end(), lastKey, CellKeyLess());
+      for(; it != end; ++it)
+      {
+        neighbours.push_back(it->exampleIdx);
+      }
+    }
+  }
+
+  std::sort(neighbours.begin(), neighbours.end());
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+int ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::clamp_cell_coord(float coord)
+{
+  const float minCoord = static_cast<float>(-CELL_COORD_BIAS), maxCoord = static_cast<float>(CELL_COORD_BIAS - 1);
+  return static_cast<int>(std::min(std::max(coord, minCoord), maxCoord));
+}
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+int ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::clamp_cell_coord(int coord)
+{
+  return std::min(std::max(coord, -CELL_COORD_BIAS), CELL_COORD_BIAS - 1);
+}
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+uint64_t ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::make_cell_key(int x, int y, int z)
+{
+  const uint64_t bx = static_cast<uint64_t>(x + CELL_COORD_BIAS);
+  const uint64_t by = static_cast<uint64_t>(y + CELL_COORD_BIAS);
+  const uint64_t bz = static_cast<uint64_t>(z + CELL_COORD_BIAS);
+  return (bx << (2 * CELL_COORD_BITS)) | (by << CELL_COORD_BITS) | bz;
+}
+
 }
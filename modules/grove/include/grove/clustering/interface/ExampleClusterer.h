@@ -35,6 +35,14 @@ namespace grove {
  *
  *           Aggregates all the examples in the examples array that have a certain key into a single cluster.
  *
+ *        The CPU clusterer can optionally use a uniform grid to avoid comparing every pair of examples in a set. To make
+ *        use of this, the following function must also be defined for the example type:
+ *
+ *        3) _CPU_AND_GPU_CODE_ inline Vector3f get_position(const ExampleType& example);
+ *
+ *           Returns the position of the example in 3D space. The squared distance returned by distance_squared
+ *           must be the squared Euclidean distance between the positions of the two examples.
+ *
  * \param ExampleType  The type of example to cluster.
  * \param ClusterType  The type of cluster being generated.
  * \param MaxClusters  The maximum number of clusters being generated for each set of examples.
@@ -142,6 +150,27 @@ public:
   void cluster_examples(const ExampleImage_CPtr& exampleSets, const ITMIntMemoryBlock_CPtr& exampleSetSizes,
                         uint32_t exampleSetStart, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers);
 
+  /**
+   * \brief Clusters several sets of examples in parallel, writing the clusters into a specified range of the output containers.
+   *
+   * \note This is a variant of the other cluster_examples function that can be used when the example sets are not
+   *       stored at the same indices as their cluster containers (e.g. because they have been gathered into a
+   *       smaller image from some sparser storage).
+   *
+   * \param exampleSets           An image containing the sets of examples to be clustered (one set per row). The width of
+   *                              the image specifies the maximum number of examples that can be contained in each set.
+   * \param exampleSetSizes       The number of valid examples in each example set.
+   * \param exampleSetStart       The index of the first example set for which to compute clusters.
+   * \param exampleSetCount       The number of example sets for which to compute clusters.
+   * \param clusterContainers     Output containers that will hold the clusters computed for each example set.
+   * \param clusterContainerStart The index of the container that will hold the clusters computed for the first example set.
+   *
+   * \throws std::invalid_argument If exampleSetStart + exampleSetCount would result in out-of-bounds access in exampleSets,
+   *                               or clusterContainerStart + exampleSetCount would result in out-of-bounds access in clusterContainers.
+   */
+  void cluster_examples(const ExampleImage_CPtr& exampleSets, const ITMIntMemoryBlock_CPtr& exampleSetSizes, uint32_t exampleSetStart,
+                        uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers, uint32_t clusterContainerStart);
+
   //#################### PRIVATE ABSTRACT MEMBER FUNCTIONS ####################
 private:
   /**
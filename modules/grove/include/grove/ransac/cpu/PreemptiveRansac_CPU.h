@@ -6,6 +6,8 @@
 #ifndef H_GROVE_PREEMPTIVERANSAC_CPU
 #define H_GROVE_PREEMPTIVERANSAC_CPU
 
+#include <vector>
+
 #include "../interface/PreemptiveRansac.h"
 #include "../../numbers/CPURNG.h"
 
@@ -19,17 +21,46 @@ namespace grove {
  *
  * "On-the-Fly Adaptation of Regression Forests for Online Camera Relocalisation" (Cavallari et al., CVPR 2017)
  *
+ * The candidate energies are computed in the log domain (avoiding an exp per mode and a log per inlier), using inlier
+ * and mode data that is laid out in structure-of-arrays form so that four inliers can be evaluated at once using SIMD.
+ * The energy computation for a candidate is abandoned as soon as it is certain that the candidate cannot be one of those
+ * whose energies are needed, i.e. that it will neither survive the subsequent cull nor be returned by get_best_poses.
+ * In practice, this means that it is only abandoned during the initial cull of the candidates.
  */
 class PreemptiveRansac_CPU : public PreemptiveRansac
 {
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The number of candidates whose energy computation was abandoned early. */
+  size_t m_earlyTerminationCount;
+
+  /** The mode counts of the blocks of inliers in m_energyInlierData (the largest number of modes predicted for any inlier in each block). */
+  std::vector<int> m_energyBlockModeCounts;
+
+  /** The offsets of the blocks of inliers in m_energyInlierData. */
+  std::vector<size_t> m_energyBlockOffsets;
+
+  /** Upper bounds on the sums of the (negated) log-domain energy terms for the inliers in each block. */
+  std::vector<float> m_energyBlockTermBounds;
+
+  /** The number of candidates whose energies we have started to compute. */
+  size_t m_energyComputationCount;
+
+  /** The number of inliers whose data has been added to m_energyInlierData. */
+  uint32_t m_energyInlierCount;
+
+  /** The positions and predicted modes of the inliers, in blocks of four inliers stored in structure-of-arrays form. */
+  std::vector<float> m_energyInlierData;
+
   /** The random number generators used during the P-RANSAC process. */
   CPURNGMemoryBlock_Ptr m_rngs;
 
   /** The seed used to initialise the random number generators. */
   uint32_t m_rngSeed;
 
+  /** The timer for the preparation of the inlier data used to compute the energies. */
+  AverageTimer m_timerEnergyInlierPreparation;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -39,6 +70,13 @@ public:
    */
   PreemptiveRansac_CPU(const tvgutil::SettingsContainer_CPtr& settings);
 
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the instance of PreemptiveRansac_CPU.
+   */
+  virtual ~PreemptiveRansac_CPU();
+
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /** Override */
@@ -50,6 +88,9 @@ protected:
   /** Override */
   virtual void prepare_inliers_for_optimisation();
 
+  /** Override */
+  virtual void reset_inliers(bool resetMask);
+
   /** Override */
   virtual void sample_inliers(bool useMask);
 
@@ -59,16 +100,24 @@ protected:
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Computes the energy of a single pose candidate.
+   * \brief Computes the energy of a single pose candidate, unless it becomes clear that the candidate will not survive the next cull.
    *
-   * \param candidate The pose candidate whose energy we want to compute.
+   * \param candidate           The pose candidate whose energy we want to compute.
+   * \param blockTermBoundSums  The suffix sums of the upper bounds on the energy terms of the inlier blocks (with a trailing zero).
+   * \param energyThreshold     A location containing the energy above which a candidate cannot survive the next cull (shared between threads).
+   * \return                    true, if the energy of the candidate was computed, or false if its computation was abandoned.
    */
-  void compute_pose_energy(PoseCandidate& candidate) const;
+  bool compute_pose_energy(PoseCandidate& candidate, const std::vector<float>& blockTermBoundSums, const float *energyThreshold) const;
 
   /**
    * \brief Initialises the random number generators in a deterministic manner.
    */
   void init_random();
+
+  /**
+   * \brief Adds the data for any inliers that have been sampled since the last call to m_energyInlierData.
+   */
+  void prepare_inliers_for_energy_computation();
 };
 
 }
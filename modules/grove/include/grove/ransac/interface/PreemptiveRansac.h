@@ -58,9 +58,6 @@ private:
 
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** Whether or not to print a summary of the timings of the various steps of preemptive RANSAC on destruction. */
-  bool m_printTimers;
-
   /** The timer for the pose hypothesis generation phase. */
   AverageTimer m_timerCandidateGeneration;
 
@@ -133,6 +130,17 @@ protected:
   /** A memory block storing the pose candidates. */
   PoseCandidateMemoryBlock_Ptr m_poseCandidates;
 
+  /**
+   * The number of best pose candidates whose energies must be computed exactly by the current call to compute_energies_and_sort.
+   * The energies of candidates that cannot be among these do not need to be computed exactly (their energies can just be set to
+   * a large value). This is never less than m_nbPoseCandidatesToKeep, and is larger whenever some of the candidates that are
+   * culled can still be returned (with their energies) by get_best_poses.
+   */
+  uint32_t m_nbPoseCandidatesNeedingEnergies;
+
+  /** The number of pose candidates that will be kept after the current call to compute_energies_and_sort. */
+  uint32_t m_nbPoseCandidatesToKeep;
+
   /** The number of pose candidates that survived the culling process. */
   uint32_t m_poseCandidatesAfterCull;
 
@@ -163,6 +171,9 @@ protected:
   /** Whether or not to optimise the surviving poses after each preemptive RANSAC iteration. */
   bool m_poseUpdate;
 
+  /** Whether or not to print a summary of the timings of the various steps of preemptive RANSAC on destruction. */
+  bool m_printTimers;
+
   /** An image storing the forest predictions associated with the keypoints in m_keypointsImage. Not owned by this class. */
   ScorePredictionsImage_CPtr m_predictionsImage;
 
@@ -242,6 +253,7 @@ public:
    *
    * \pre   This function should only be called after a prior call to estimate_pose.
    * \note  The first entry of the vector will be the candidate (if any) returned by estimate_pose.
+   * \note  The energy of each candidate is the one computed in the last P-RANSAC iteration it took part in (and is always computed exactly).
    *
    * \param poseCandidates An output array that will be filled with the candidate poses that survived the initial culling process.
    */
@@ -281,6 +293,15 @@ protected:
    */
   bool update_candidate_pose(int candidateIdx) const;
 
+  //#################### PROTECTED STATIC MEMBER FUNCTIONS ####################
+protected:
+  /**
+   * \brief Pretty prints the value of a timer.
+   *
+   * \param timer The timer.
+   */
+  static void print_timer(const AverageTimer& timer);
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
@@ -380,13 +401,6 @@ private:
    * \return      The corresponding 6D twist vector.
    */
   static alglib::real_1d_array make_twist_from_pose(const ORUtils::SE3Pose& pose);
-
-  /**
-   * \brief Pretty prints the value of a timer.
-   *
-   * \param timer The timer.
-   */
-  static void print_timer(const AverageTimer& timer);
 };
 
 //#################### TYPEDEFS ####################
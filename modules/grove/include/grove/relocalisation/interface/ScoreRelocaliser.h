@@ -11,6 +11,8 @@
 #include <itmx/base/ITMObjectPtrTypes.h>
 #include <itmx/relocalisation/Relocaliser.h>
 
+#include <tvgutil/timing/AverageTimer.h>
+
 #include "../base/ScoreRelocaliserState.h"
 #include "../../clustering/interface/ExampleClusterer.h"
 #include "../../features/interface/RGBDPatchFeatureCalculator.h"
@@ -32,6 +34,22 @@ class ScoreRelocaliser : public itmx::Relocaliser
 public:
   enum { FOREST_TREE_COUNT = 5 };
 
+  //#################### ENUMERATIONS ####################
+public:
+  /**
+   * \brief The values of this enumeration denote the stages of the relocaliser's pipeline that can be timed.
+   */
+  enum Stage
+  {
+    STAGE_FEATURES,
+    STAGE_LEAFLOOKUP,
+    STAGE_RESERVOIRUPDATE,
+    STAGE_CLUSTERING,
+    STAGE_PREDICTIONMERGE,
+    STAGE_RANSAC,
+    STAGE_COUNT
+  };
+
   //#################### TYPEDEFS ####################
 public:
   typedef Keypoint3DColour ExampleType;
@@ -39,6 +57,8 @@ public:
   typedef RGBDPatchDescriptor DescriptorType;
   typedef ScorePrediction PredictionType;
 
+  typedef tvgutil::AverageTimer<boost::chrono::microseconds> AverageTimer;
+
   typedef ExampleClusterer<ExampleType, ClusterType, PredictionType::Capacity> Clusterer;
   typedef boost::shared_ptr<Clusterer> Clusterer_Ptr;
 
@@ -67,6 +87,12 @@ private:
   /** The image containing the forest predictions associated with the keypoint/descriptor pairs. */
   mutable ScorePredictionsImage_Ptr m_predictionsImage;
 
+  /** The timers used to profile the individual stages of the relocaliser's pipeline (one per stage). */
+  mutable std::vector<AverageTimer> m_stageTimers;
+
+  /** Whether or not the stage timers are enabled. */
+  bool m_timersEnabled;
+
   //#################### PROTECTED VARIABLES ####################
 protected:
   /** The sigma of the Gaussian used when computing the example densities (used during clustering). */
@@ -111,6 +137,13 @@ protected:
   /** The total number of example reservoirs used by the relocaliser (in practice, this is equal to the number of leaves in the forest). */
   uint32_t m_reservoirCount;
 
+  /**
+   * The number of examples in each page of reservoir storage (or 0 if the reservoirs are stored densely, at full capacity).
+   * Paged storage is only available on the CPU, so this defaults to 0. Note that relocalisers saved with one kind of storage
+   * cannot be loaded with the other, since the reservoirs are saved in different forms.
+   */
+  uint32_t m_reservoirPageCapacity;
+
   /** The seed for the random number generators used by the example reservoirs. */
   uint32_t m_rngSeed;
 
@@ -129,7 +162,8 @@ protected:
    * \param settings        The settings used to configure the relocaliser.
    * \param deviceType      The device on which the relocaliser should operate.
    *
-   * \throws std::runtime_error If the forest cannot be loaded.
+   * \throws std::runtime_error    If the forest cannot be loaded.
+   * \throws std::invalid_argument If the settings are invalid (e.g. if paged reservoir storage is requested on the GPU).
    */
   ScoreRelocaliser(const std::string& forestFilename, const tvgutil::SettingsContainer_CPtr& settings, DeviceType deviceType);
 
@@ -211,6 +245,19 @@ public:
    */
   ScoreRelocaliserState_CPtr get_relocaliser_state() const;
 
+  /**
+   * \brief Gets the timer used to profile the specified stage of the relocaliser's pipeline.
+   *
+   * \note  The timers are only updated if the ScoreRelocaliser.timersEnabled setting is true. When the relocaliser
+   *        is running on the GPU, each stage is synchronised with the device before its timer is stopped.
+   *
+   * \param stage The stage whose timer we want to get.
+   * \return      The timer used to profile the stage.
+   *
+   * \throws std::invalid_argument If stage is not a valid stage.
+   */
+  const AverageTimer& get_stage_timer(Stage stage) const;
+
   /**
    * \brief Gets the contents of the reservoir associated with the specified leaf in the forest.
    *
@@ -258,6 +305,13 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Clusters the examples in a contiguous range of reservoirs, starting from the current reservoir update index.
+   *
+   * \param reservoirCount  The number of reservoirs to cluster.
+   */
+  void cluster_reservoirs(uint32_t reservoirCount);
+
   /**
    * \brief Computes the number of reservoirs to subject to clustering during a train/update call.
    *
@@ -275,6 +329,20 @@ private:
    */
   void ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) const;
 
+  /**
+   * \brief Starts the timer for the specified stage of the relocaliser's pipeline (waiting for all CUDA operations to terminate first, if necessary).
+   *
+   * \param stage The stage whose timer should be started.
+   */
+  void start_timer(Stage stage) const;
+
+  /**
+   * \brief Stops the timer for the specified stage of the relocaliser's pipeline (waiting for all CUDA operations to terminate first, if necessary).
+   *
+   * \param stage The stage whose timer should be stopped.
+   */
+  void stop_timer(Stage stage) const;
+
   /**
    * \brief Updates the index of the first reservoir to subject to clustering during the next train/update call.
    */
@@ -32,9 +32,13 @@ struct ExampleReservoirsFactory
    * \param reservoirCapacity The capacity (maximum size) of each reservoir.
    * \param deviceType        The device on which the example reservoirs should be stored.
    * \param rngSeed           The seed for the random number generators.
+   * \param pageCapacity      The number of examples in each page of storage allocated for the reservoirs as they receive examples
+   *                          (or 0 to store every reservoir densely, at full capacity). Paged storage is only available on the CPU.
    * \return                  The set of example reservoirs.
+   *
+   * \throws std::runtime_error If paged storage is requested for reservoirs on the GPU.
    */
-  static Reservoirs_Ptr make_reservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, DeviceType deviceType, uint32_t rngSeed = 42);
+  static Reservoirs_Ptr make_reservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, DeviceType deviceType, uint32_t rngSeed = 42, uint32_t pageCapacity = 0);
 };
 
 }
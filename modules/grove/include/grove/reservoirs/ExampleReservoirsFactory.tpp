@@ -6,6 +6,7 @@
 #include "reservoirs/ExampleReservoirsFactory.h"
 
 #include "reservoirs/cpu/ExampleReservoirs_CPU.h"
+#include "reservoirs/cpu/PagedExampleReservoirs_CPU.h"
 
 #ifdef WITH_CUDA
 #include "reservoirs/cuda/ExampleReservoirs_CUDA.h"
@@ -17,18 +18,27 @@ namespace grove {
 
 template <typename ExampleType>
 typename ExampleReservoirsFactory<ExampleType>::Reservoirs_Ptr
-ExampleReservoirsFactory<ExampleType>::make_reservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, DeviceType deviceType, uint32_t rngSeed)
+ExampleReservoirsFactory<ExampleType>::make_reservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, DeviceType deviceType, uint32_t rngSeed, uint32_t pageCapacity)
 {
   Reservoirs_Ptr reservoir;
 
   if(deviceType == DEVICE_CUDA)
   {
+    if(pageCapacity > 0)
+    {
+      throw std::runtime_error("Error: Paged example reservoirs are currently only available on the CPU.");
+    }
+
 #ifdef WITH_CUDA
     reservoir.reset(new ExampleReservoirs_CUDA<ExampleType>(reservoirCount, reservoirCapacity, rngSeed));
 #else
     throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
 #endif
   }
+  else if(pageCapacity > 0)
+  {
+    reservoir.reset(new PagedExampleReservoirs_CPU<ExampleType>(reservoirCount, reservoirCapacity, pageCapacity, rngSeed));
+  }
   else
   {
     reservoir.reset(new ExampleReservoirs_CPU<ExampleType>(reservoirCount, reservoirCapacity, rngSeed));
@@ -7,7 +7,6 @@
 #define H_GROVE_EXAMPLERESERVOIRS_CPU
 
 #include "../interface/ExampleReservoirs.h"
-#include "../../numbers/CPURNG.h"
 
 namespace grove {
 
@@ -25,11 +24,6 @@ public:
   using typename Base::ExampleImage_CPtr;
   using typename Base::Visitor;
 
-  //#################### PRIVATE MEMBER VARIABLES ####################
-private:
-  /** A set of random number generators (used when adding examples). */
-  CPURNGMemoryBlock_Ptr m_rngs;
-
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -37,15 +31,10 @@ public:
    *
    * \param reservoirCount    The number of reservoirs to create.
    * \param reservoirCapacity The capacity of each reservoir.
-   * \param rngSeed           The seed for the random number generators.
+   * \param rngSeed           The seed for the random number generator used when adding examples.
    */
   ExampleReservoirs_CPU(uint32_t reservoirCount, uint32_t reservoirCapacity, uint32_t rngSeed = 42);
 
-  //#################### PUBLIC MEMBER FUNCTIONS ####################
-public:
-  /** Override */
-  virtual void reset();
-
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /** Override */
@@ -55,17 +44,6 @@ private:
   template <int ReservoirIndexCount>
   void add_examples_sub(const ExampleImage_CPtr& examples, const boost::shared_ptr<const ORUtils::Image<ORUtils::VectorX<int,ReservoirIndexCount> > >& reservoirIndices);
 
-  /** Override */
-  virtual void load_from_disk_sub(const std::string& inputFolder);
-
-  /**
-   * \brief Reinitialises the random number generators using known seeds.
-   */
-  void reinit_rngs();
-
-  /** Override */
-  virtual void save_to_disk_sub(const std::string& outputFolder);
-
   //#################### FRIENDS ####################
 
   friend class ExampleReservoirs<ExampleType>;
@@ -0,0 +1,158 @@
+/**
+ * grove: PagedExampleReservoirs_CPU.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_PAGEDEXAMPLERESERVOIRS_CPU
+#define H_GROVE_PAGEDEXAMPLERESERVOIRS_CPU
+
+#include <vector>
+
+#include "../interface/ExampleReservoirs.h"
+
+namespace grove {
+
+/**
+ * \brief An instance of this class can be used to store a number of examples in a set of fixed-size reservoirs using the CPU,
+ *        allocating storage for the reservoirs in fixed-size pages as and when they receive examples.
+ *
+ * In a trained forest, most leaves never receive any examples, so storing every reservoir at full capacity (as ExampleReservoirs_CPU
+ * does) wastes a great deal of memory. Instead, we store the examples in a pool of pages, each of which holds m_pageCapacity examples,
+ * and maintain a page table that maps each page of each reservoir to a page in the pool (or -1 if no page has been allocated for it).
+ * The pages of reservoirs that are reset are returned to a free list for later reuse, and the pool can be compacted to release them.
+ *
+ * \param ExampleType The type of example stored in the reservoirs. Must have a member named "valid", convertible to bool.
+ */
+template <typename ExampleType>
+class PagedExampleReservoirs_CPU : public ExampleReservoirs<ExampleType>
+{
+  //#################### TYPEDEFS AND USINGS ####################
+public:
+  typedef ExampleReservoirs<ExampleType> Base;
+  using typename Base::ExampleImage_CPtr;
+  using typename Base::ReservoirsImage_CPtr;
+  using typename Base::ReservoirsImage_Ptr;
+  using typename Base::Visitor;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /**
+   * The add call ordinals assigned to the examples passed to the current add_examples call (one for each reservoir
+   * to which each example is being added), or -1 for those examples that are invalid.
+   */
+  std::vector<int> m_addCallOrdinals;
+
+  /** The indices (in the pool) of the pages that are currently unused. */
+  std::vector<int> m_freePages;
+
+  /** The indices (in the page table) of the pages that must be allocated during the current add_examples call. */
+  std::vector<int> m_pagesToAllocate;
+
+  /** The number of examples stored in each page. */
+  uint32_t m_pageCapacity;
+
+  /** The number of pages in the pool (including any that are free). */
+  uint32_t m_pageCount;
+
+  /** The pool of pages in which the examples are stored. Page i occupies elements [i * m_pageCapacity, (i+1) * m_pageCapacity). */
+  std::vector<ExampleType> m_pages;
+
+  /** The number of pages needed to store a full reservoir. */
+  uint32_t m_pagesPerReservoir;
+
+  /** The page table: element (i * m_pagesPerReservoir + j) is the index in the pool of page j of reservoir i, or -1 if it has not been allocated. */
+  std::vector<int> m_pageTable;
+
+  /**
+   * An image into which the examples in a range of reservoirs can be gathered for use by clients that need them to be stored densely.
+   * This has a row for each reservoir in the largest range requested so far (it is never shrunk, to avoid repeated reallocations).
+   */
+  ReservoirsImage_Ptr m_rangeReservoirs;
+
+  /** The sizes of the reservoirs whose examples have been gathered into m_rangeReservoirs. */
+  ITMIntMemoryBlock_Ptr m_rangeReservoirSizes;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a set of paged example reservoirs.
+   *
+   * \param reservoirCount    The number of reservoirs to create.
+   * \param reservoirCapacity The capacity of each reservoir.
+   * \param pageCapacity      The number of examples stored in each page.
+   * \param rngSeed           The seed for the random number generator used when adding examples.
+   *
+   * \throws std::invalid_argument If pageCapacity is zero.
+   */
+  PagedExampleReservoirs_CPU(uint32_t reservoirCount, uint32_t reservoirCapacity, uint32_t pageCapacity, uint32_t rngSeed = 42);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Compacts the pool of pages by discarding any free pages.
+   *
+   * \note The pages are rearranged so that the pages of each reservoir are adjacent in the pool.
+   */
+  void compact();
+
+  /**
+   * \brief Gets the number of pages in use (i.e. that currently store the examples of some reservoir).
+   *
+   * \return  The number of pages in use.
+   */
+  uint32_t get_allocated_page_count() const;
+
+  /**
+   * \brief Gets the number of bytes of memory used to store the examples and the page table.
+   *
+   * \note This excludes the memory used for the per-reservoir add call counts and sizes, which is the same as for dense storage.
+   *
+   * \return  The number of bytes of memory used to store the examples and the page table.
+   */
+  size_t get_memory_usage() const;
+
+  /**
+   * \brief Gets the number of examples stored in each page.
+   *
+   * \return  The number of examples stored in each page.
+   */
+  uint32_t get_page_capacity() const;
+
+  /** Override */
+  virtual uint32_t get_reservoir_range(uint32_t startIdx, uint32_t count, ReservoirsImage_CPtr& reservoirs, ITMIntMemoryBlock_CPtr& reservoirSizes);
+
+  /** Override */
+  virtual void reset();
+
+  /**
+   * \brief Clears a single reservoir, discarding its examples and returning its pages to the free list.
+   *
+   * \param reservoirIdx  The index of the reservoir to clear.
+   *
+   * \throws std::invalid_argument If reservoirIdx is out of range.
+   */
+  void reset_reservoir(uint32_t reservoirIdx);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /** Override */
+  virtual void accept(const Visitor& visitor);
+
+  /** Derived Implementation */
+  template <int ReservoirIndexCount>
+  void add_examples_sub(const ExampleImage_CPtr& examples, const boost::shared_ptr<const ORUtils::Image<ORUtils::VectorX<int,ReservoirIndexCount> > >& reservoirIndices);
+
+  /** Override */
+  virtual void load_from_disk_sub(const std::string& inputFolder);
+
+  /** Override */
+  virtual void save_to_disk_sub(const std::string& outputFolder);
+
+  //#################### FRIENDS ####################
+
+  friend class ExampleReservoirs<ExampleType>;
+};
+
+}
+
+#endif
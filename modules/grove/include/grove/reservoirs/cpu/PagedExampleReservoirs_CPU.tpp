@@ -0,0 +1,358 @@
+/**
+ * grove: PagedExampleReservoirs_CPU.tpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "PagedExampleReservoirs_CPU.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include <itmx/base/MemoryBlockFactory.h>
+
+#include <ORUtils/MemoryBlockPersister.h>
+
+#include "../shared/ExampleReservoirs_Shared.h"
+
+namespace grove {
+
+//#################### CONSTRUCTORS ####################
+
+template <typename ExampleType>
+PagedExampleReservoirs_CPU<ExampleType>::PagedExampleReservoirs_CPU(uint32_t reservoirCount, uint32_t reservoirCapacity, uint32_t pageCapacity, uint32_t rngSeed)
+: ExampleReservoirs<ExampleType>(reservoirCount, reservoirCapacity, rngSeed, false), m_pageCapacity(pageCapacity), m_pageCount(0)
+{
+  if(pageCapacity == 0)
+  {
+    throw std::invalid_argument("Error: The page capacity must be greater than zero");
+  }
+
+  m_pagesPerReservoir = (reservoirCapacity + pageCapacity - 1) / pageCapacity;
+
+  itmx::MemoryBlockFactory& mbf = itmx::MemoryBlockFactory::instance();
+  m_rangeReservoirs = mbf.make_image<ExampleType>();
+  m_rangeReservoirSizes = mbf.make_block<int>();
+
+  this->reset();
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+template <typename ExampleType>
+void PagedExampleReservoirs_CPU<ExampleType>::compact()
+{
+  // If there are no free pages, early out.
+  if(m_freePages.empty()) return;
+
+  // Copy the pages that are in use into a new pool, in page table order, and update the page table accordingly.
+  std::vector<ExampleType> pages(get_allocated_page_count() * m_pageCapacity);
+  uint32_t pageCount = 0;
+
+  for(size_t i = 0, size = m_pageTable.size(); i < size; ++i)
+  {
+    int& pageIdx = m_pageTable[i];
+    if(pageIdx < 0) continue;
+
+    std::copy(m_pages.begin() + pageIdx * m_pageCapacity, m_pages.begin() + (pageIdx + 1) * m_pageCapacity, pages.begin() + pageCount * m_pageCapacity);
+    pageIdx = static_cast<int>(pageCount++);
+  }
+
+  m_pages.swap(pages);
+  m_pageCount = pageCount;
+  m_freePages.clear();
+}
+
+template <typename ExampleType>
+uint32_t PagedExampleReservoirs_CPU<ExampleType>::get_allocated_page_count() const
+{
+  return m_pageCount - static_cast<uint32_t>(m_freePages.size());
+}
+
+template <typename ExampleType>
+size_t PagedExampleReservoirs_CPU<ExampleType>::get_memory_usage() const
+{
+  return m_pages.capacity() * sizeof(ExampleType) + m_pageTable.capacity() * sizeof(int) + m_freePages.capacity() * sizeof(int);
+}
+
+template <typename ExampleType>
+uint32_t PagedExampleReservoirs_CPU<ExampleType>::get_page_capacity() const
+{
+  return m_pageCapacity;
+}
+
+template <typename ExampleType>
+uint32_t PagedExampleReservoirs_CPU<ExampleType>::get_reservoir_range(uint32_t startIdx, uint32_t count, ReservoirsImage_CPtr& reservoirs, ITMIntMemoryBlock_CPtr& reservoirSizes)
+{
+  if(startIdx + count > this->m_reservoirCount)
+  {
+    throw std::invalid_argument("Error: startIdx + count > m_reservoirCount");
+  }
+
+  // Make sure that the image and memory block into which we gather the reservoirs are large enough. Note that we only
+  // ever grow them: the clusterer only reads the rows it is asked to cluster, so there is no need to shrink the image
+  // to fit a smaller range (e.g. the last batch of reservoirs, or a single reservoir whose contents are being read),
+  // and doing so would cause it to be reallocated again as soon as the next full-sized range was requested.
+  if(m_rangeReservoirs->noDims.height < static_cast<int>(count))
+  {
+    m_rangeReservoirs->ChangeDims(Vector2i(this->m_reservoirCapacity, count));
+    m_rangeReservoirSizes = itmx::MemoryBlockFactory::instance().make_block<int>(count);
+  }
+
+  const int *allReservoirSizes = this->m_reservoirSizes->GetData(MEMORYDEVICE_CPU);
+  ExampleType *rangeReservoirs = m_rangeReservoirs->GetData(MEMORYDEVICE_CPU);
+  int *rangeReservoirSizes = m_rangeReservoirSizes->GetData(MEMORYDEVICE_CPU);
+
+  // Copy the valid examples in each reservoir in the range into the corresponding row of the image. Only the first
+  // reservoirSize elements of each row are written, since those are the only ones the clusterer will read.
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(dynamic)
+#endif
+  for(int i = 0; i < static_cast<int>(count); ++i)
+  {
+    const uint32_t reservoirIdx = startIdx + i;
+    const uint32_t reservoirSize = static_cast<uint32_t>(allReservoirSizes[reservoirIdx]);
+    const int *reservoirPages = &m_pageTable[reservoirIdx * m_pagesPerReservoir];
+    ExampleType *row = rangeReservoirs + i * this->m_reservoirCapacity;
+
+    for(uint32_t pageStart = 0, j = 0; pageStart < reservoirSize; pageStart += m_pageCapacity, ++j)
+    {
+      const ExampleType *page = &m_pages[reservoirPages[j] * m_pageCapacity];
+      std::copy(page, page + std::min(m_pageCapacity, reservoirSize - pageStart), row + pageStart);
+    }
+
+    rangeReservoirSizes[i] = static_cast<int>(reservoirSize);
+  }
+
+  reservoirs = m_rangeReservoirs;
+  reservoirSizes = m_rangeReservoirSizes;
+  return 0;
+}
+
+template <typename ExampleType>
+void PagedExampleReservoirs_CPU<ExampleType>::reset()
+{
+  Base::reset();
+
+  // Release all of the pages.
+  std::vector<ExampleType>().swap(m_pages);
+  std::vector<int>().swap(m_freePages);
+  m_pageCount = 0;
+  m_pageTable.assign(this->m_reservoirCount * m_pagesPerReservoir, -1);
+}
+
+template <typename ExampleType>
+void PagedExampleReservoirs_CPU<ExampleType>::reset_reservoir(uint32_t reservoirIdx)
+{
+  if(reservoirIdx >= this->m_reservoirCount)
+  {
+    throw std::invalid_argument("Error: reservoirIdx >= m_reservoirCount");
+  }
+
+  this->m_reservoirAddCalls->GetData(MEMORYDEVICE_CPU)[reservoirIdx] = 0;
+  this->m_reservoirSizes->GetData(MEMORYDEVICE_CPU)[reservoirIdx] = 0;
+
+  // Return the reservoir's pages to the free list.
+  for(uint32_t i = reservoirIdx * m_pagesPerReservoir, end = i + m_pagesPerReservoir; i < end; ++i)
+  {
+    if(m_pageTable[i] >= 0)
+    {
+      m_freePages.push_back(m_pageTable[i]);
+      m_pageTable[i] = -1;
+    }
+  }
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+template <typename ExampleType>
+void PagedExampleReservoirs_CPU<ExampleType>::accept(const Visitor& visitor)
+{
+  visitor.visit(*this);
+}
+
+template <typename ExampleType>
+template <int ReservoirIndexCount>
+void PagedExampleReservoirs_CPU<ExampleType>::add_examples_sub(const ExampleImage_CPtr& examples, const boost::shared_ptr<const ORUtils::Image<ORUtils::VectorX<int,ReservoirIndexCount> > >& reservoirIndices)
+{
+  const int exampleCount = static_cast<int>(examples->dataSize);
+  const uint32_t reservoirCapacity = this->m_reservoirCapacity;
+
+  const ExampleType *examplesPtr = examples->GetData(MEMORYDEVICE_CPU);
+  int *reservoirAddCalls = this->m_reservoirAddCalls->GetData(MEMORYDEVICE_CPU);
+  const ORUtils::VectorX<int,ReservoirIndexCount> *reservoirIndicesPtr = reservoirIndices->GetData(MEMORYDEVICE_CPU);
+  int *reservoirSizes = this->m_reservoirSizes->GetData(MEMORYDEVICE_CPU);
+
+  m_addCallOrdinals.resize(exampleCount * ReservoirIndexCount);
+  m_pagesToAllocate.clear();
+
+  // Step 1: Assign an add call ordinal to each valid example for each reservoir to which it is being added, update the reservoir
+  //         sizes, and record which pages will need to be allocated (a page must be allocated when the first example lands in it).
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < exampleCount; ++i)
+  {
+    int *ordinals = &m_addCallOrdinals[i * ReservoirIndexCount];
+
+    if(!examplesPtr[i].valid)
+    {
+      std::fill(ordinals, ordinals + ReservoirIndexCount, -1);
+      continue;
+    }
+
+    for(int k = 0; k < ReservoirIndexCount; ++k)
+    {
+      const int reservoirIdx = reservoirIndicesPtr[i].v[k];
+
+      int ordinal;
+    #ifdef WITH_OPENMP
+      #pragma omp atomic capture
+    #endif
+      ordinal = reservoirAddCalls[reservoirIdx]++;
+
+      ordinals[k] = ordinal;
+
+      if(static_cast<uint32_t>(ordinal) < reservoirCapacity)
+      {
+      #ifdef WITH_OPENMP
+        #pragma omp atomic
+      #endif
+        ++reservoirSizes[reservoirIdx];
+
+        if(ordinal % m_pageCapacity == 0)
+        {
+        #ifdef WITH_OPENMP
+          #pragma omp critical(PagedExampleReservoirs_CPU_pagesToAllocate)
+        #endif
+          m_pagesToAllocate.push_back(reservoirIdx * m_pagesPerReservoir + ordinal / m_pageCapacity);
+        }
+      }
+    }
+  }
+
+  // Step 2: Allocate the necessary pages, reusing free pages where possible.
+  for(size_t i = 0, size = m_pagesToAllocate.size(); i < size; ++i)
+  {
+    if(m_freePages.empty())
+    {
+      m_pageTable[m_pagesToAllocate[i]] = static_cast<int>(m_pageCount++);
+    }
+    else
+    {
+      m_pageTable[m_pagesToAllocate[i]] = m_freePages.back();
+      m_freePages.pop_back();
+    }
+  }
+
+  if(m_pages.size() < m_pageCount * m_pageCapacity) m_pages.resize(m_pageCount * m_pageCapacity);
+
+  // Step 3: Store the examples in the relevant reservoirs, replacing existing examples at random in any reservoirs that are full.
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < exampleCount; ++i)
+  {
+    const int *ordinals = &m_addCallOrdinals[i * ReservoirIndexCount];
+    if(ordinals[0] < 0) continue;
+
+    for(int k = 0; k < ReservoirIndexCount; ++k)
+    {
+      const int reservoirIdx = reservoirIndicesPtr[i].v[k];
+      const uint32_t ordinal = static_cast<uint32_t>(ordinals[k]);
+      const uint32_t offset = ordinal < reservoirCapacity ? ordinal : select_replacement_offset(reservoirIdx, ordinal, reservoirCapacity, this->m_rngSeed);
+
+      if(offset < reservoirCapacity)
+      {
+        const int pageIdx = m_pageTable[reservoirIdx * m_pagesPerReservoir + offset / m_pageCapacity];
+        m_pages[pageIdx * m_pageCapacity + offset % m_pageCapacity] = examplesPtr[i];
+      }
+    }
+  }
+}
+
+template <typename ExampleType>
+void PagedExampleReservoirs_CPU<ExampleType>::load_from_disk_sub(const std::string& inputFolder)
+{
+  boost::filesystem::path inputPath(inputFolder);
+  itmx::MemoryBlockFactory& mbf = itmx::MemoryBlockFactory::instance();
+
+  // Check that the reservoirs were saved in paged form, and with the same reservoir and page capacities as these ones (the
+  // page table and pages cannot be interpreted otherwise). If not, reset the reservoirs before throwing, since the base class
+  // has already loaded their sizes and we must not leave them in an inconsistent state.
+  const boost::filesystem::path layoutPath = inputPath / "reservoirPageLayout.bin";
+  std::string error;
+  if(!boost::filesystem::exists(layoutPath))
+  {
+    error = "Error: The example reservoirs in '" + inputFolder + "' were not saved in paged form";
+  }
+  else
+  {
+    ITMIntMemoryBlock_Ptr layout = mbf.make_block<int>(2);
+    ORUtils::MemoryBlockPersister::LoadMemoryBlock(layoutPath.string(), *layout, MEMORYDEVICE_CPU);
+    const int *layoutData = layout->GetData(MEMORYDEVICE_CPU);
+    if(layoutData[0] != static_cast<int>(this->m_reservoirCapacity) || layoutData[1] != static_cast<int>(m_pageCapacity))
+    {
+      error = "Error: The example reservoirs in '" + inputFolder + "' were saved with a different reservoir or page capacity";
+    }
+  }
+
+  if(!error.empty())
+  {
+    reset();
+    throw std::runtime_error(error);
+  }
+
+  // Load the page table.
+  ITMIntMemoryBlock_Ptr pageTable = mbf.make_block<int>(m_pageTable.size());
+  ORUtils::MemoryBlockPersister::LoadMemoryBlock((inputPath / "reservoirPageTable.bin").string(), *pageTable, MEMORYDEVICE_CPU);
+  const int *pageTableData = pageTable->GetData(MEMORYDEVICE_CPU);
+  std::copy(pageTableData, pageTableData + m_pageTable.size(), m_pageTable.begin());
+
+  // The pages were compacted before they were saved, so the pages in use are exactly those that are referenced by the page table.
+  m_pageCount = static_cast<uint32_t>(m_pageTable.size() - std::count(m_pageTable.begin(), m_pageTable.end(), -1));
+  m_freePages.clear();
+  m_pages.resize(m_pageCount * m_pageCapacity);
+
+  // Load the pages themselves (if there are any).
+  if(m_pageCount > 0)
+  {
+    boost::shared_ptr<ORUtils::MemoryBlock<ExampleType> > pages = mbf.make_block<ExampleType>(m_pages.size());
+    ORUtils::MemoryBlockPersister::LoadMemoryBlock((inputPath / "reservoirPages.bin").string(), *pages, MEMORYDEVICE_CPU);
+    const ExampleType *pagesData = pages->GetData(MEMORYDEVICE_CPU);
+    std::copy(pagesData, pagesData + m_pages.size(), m_pages.begin());
+  }
+}
+
+template <typename ExampleType>
+void PagedExampleReservoirs_CPU<ExampleType>::save_to_disk_sub(const std::string& outputFolder)
+{
+  boost::filesystem::path outputPath(outputFolder);
+  itmx::MemoryBlockFactory& mbf = itmx::MemoryBlockFactory::instance();
+
+  // Discard any free pages so that we only save the pages that are in use.
+  compact();
+
+  // Save the reservoir and page capacities, so that we can check that they match when the reservoirs are loaded.
+  ITMIntMemoryBlock_Ptr layout = mbf.make_block<int>(2);
+  int *layoutData = layout->GetData(MEMORYDEVICE_CPU);
+  layoutData[0] = static_cast<int>(this->m_reservoirCapacity);
+  layoutData[1] = static_cast<int>(m_pageCapacity);
+  ORUtils::MemoryBlockPersister::SaveMemoryBlock((outputPath / "reservoirPageLayout.bin").string(), *layout, MEMORYDEVICE_CPU);
+
+  // Save the page table.
+  ITMIntMemoryBlock_Ptr pageTable = mbf.make_block<int>(m_pageTable.size());
+  std::copy(m_pageTable.begin(), m_pageTable.end(), pageTable->GetData(MEMORYDEVICE_CPU));
+  ORUtils::MemoryBlockPersister::SaveMemoryBlock((outputPath / "reservoirPageTable.bin").string(), *pageTable, MEMORYDEVICE_CPU);
+
+  // Save the pages themselves (if there are any).
+  if(m_pageCount > 0)
+  {
+    boost::shared_ptr<ORUtils::MemoryBlock<ExampleType> > pages = mbf.make_block<ExampleType>(m_pageCount * m_pageCapacity);
+    std::copy(m_pages.begin(), m_pages.begin() + m_pageCount * m_pageCapacity, pages->GetData(MEMORYDEVICE_CPU));
+    ORUtils::MemoryBlockPersister::SaveMemoryBlock((outputPath / "reservoirPages.bin").string(), *pages, MEMORYDEVICE_CPU);
+  }
+}
+
+}
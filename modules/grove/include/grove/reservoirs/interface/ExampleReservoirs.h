@@ -15,6 +15,7 @@ namespace grove {
 
 template <typename ExampleType> class ExampleReservoirs_CPU;
 template <typename ExampleType> class ExampleReservoirs_CUDA;
+template <typename ExampleType> class PagedExampleReservoirs_CPU;
 
 /**
  * \brief An instance of a class deriving from this one can be used to store a number of examples in a set of fixed-size reservoirs.
@@ -42,6 +43,7 @@ protected:
 #ifdef WITH_CUDA
     virtual void visit(ExampleReservoirs_CUDA<ExampleType>& target) const = 0;
 #endif
+    virtual void visit(PagedExampleReservoirs_CPU<ExampleType>& target) const = 0;
   };
 
 private:
@@ -62,6 +64,7 @@ private:
 #ifdef WITH_CUDA
     virtual void visit(ExampleReservoirs_CUDA<ExampleType>& target) const { target.add_examples_sub(examples, reservoirIndices); }
 #endif
+    virtual void visit(PagedExampleReservoirs_CPU<ExampleType>& target) const { target.add_examples_sub(examples, reservoirIndices); }
   };
 
   //#################### PROTECTED MEMBER VARIABLES ####################
@@ -72,7 +75,10 @@ protected:
   /** The number of reservoirs. */
   uint32_t m_reservoirCount;
 
-  /** The example reservoirs: an image in which each row allows the storage of up to m_reservoirCapacity examples. */
+  /**
+   * The example reservoirs: an image in which each row allows the storage of up to m_reservoirCapacity examples.
+   * This is null for subclasses that store the examples in some other way.
+   */
   ReservoirsImage_Ptr m_reservoirs;
 
   /** The number of times the insertion of an example has been attempted for each reservoir. Has an element for each reservoir (i.e. row in m_reservoirs). */
@@ -81,7 +87,7 @@ protected:
   /** The current size of each reservoir. Has an element for each reservoir (i.e. row in m_reservoirs). */
   ITMIntMemoryBlock_Ptr m_reservoirSizes;
 
-  /** The seed for the random number generators. */
+  /** The seed for the random number generator used to decide which examples to replace when a reservoir is full. */
   uint32_t m_rngSeed;
 
   //#################### CONSTRUCTORS ####################
@@ -89,11 +95,12 @@ protected:
   /**
    * \brief Constructs a set of example reservoirs.
    *
-   * \param reservoirCount    The number of reservoirs to create.
-   * \param reservoirCapacity The capacity (maximum size) of each reservoir.
-   * \param rngSeed           The seed for the random number generators.
+   * \param reservoirCount        The number of reservoirs to create.
+   * \param reservoirCapacity     The capacity (maximum size) of each reservoir.
+   * \param rngSeed               The seed for the random number generators.
+   * \param allocateDenseStorage  Whether or not to allocate the image in which the reservoirs are densely stored.
    */
-  ExampleReservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, uint32_t rngSeed);
+  ExampleReservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, uint32_t rngSeed, bool allocateDenseStorage = true);
 
   //#################### DESTRUCTOR ####################
 public:
@@ -111,23 +118,25 @@ private:
    */
   virtual void accept(const Visitor& visitor) = 0;
 
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
   /**
-   * \brief An overridable hook function that is called at the end of load_from_disk to allow subclasses to perform additional loading steps.
+   * \brief An overridable hook function (which does nothing by default) that is called at the end of load_from_disk to allow subclasses to perform additional loading steps.
    *
    * \param inputFolder The folder containing the reservoir state.
    *
    * \throws std::runtime_error If the loading fails.
    */
-  virtual void load_from_disk_sub(const std::string& inputFolder) = 0;
+  virtual void load_from_disk_sub(const std::string& inputFolder);
 
   /**
-   * \brief An overridable hook function that is called at the end of save_to_disk to allow subclasses to perform additional saving steps.
+   * \brief An overridable hook function (which does nothing by default) that is called at the end of save_to_disk to allow subclasses to perform additional saving steps.
    *
    * \param outputFolder  The folder into which to save the reservoir state.
    *
    * \throws std::runtime_error If the saving fails.
    */
-  virtual void save_to_disk_sub(const std::string& outputFolder) = 0;
+  virtual void save_to_disk_sub(const std::string& outputFolder);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -163,13 +172,30 @@ public:
    */
   uint32_t get_reservoir_capacity() const;
 
+  /**
+   * \brief Gets the examples in a contiguous range of reservoirs.
+   *
+   * \note The examples are returned in an image in which each row corresponds to a reservoir. Each row can store up to
+   *       get_reservoir_capacity() examples, but only the first reservoirSizes[rowIdx] are valid. The image may also
+   *       contain rows for reservoirs outside the range, so the index of the row for the first reservoir is returned.
+   *
+   * \param startIdx        The index of the first reservoir in the range.
+   * \param count           The number of reservoirs in the range.
+   * \param reservoirs      An output image containing the examples in the reservoirs.
+   * \param reservoirSizes  An output memory block containing the size of the reservoir associated with each row of the image.
+   * \return                The index of the row in the image that corresponds to the first reservoir in the range.
+   *
+   * \throws std::invalid_argument If the range extends beyond the last reservoir.
+   */
+  virtual uint32_t get_reservoir_range(uint32_t startIdx, uint32_t count, ReservoirsImage_CPtr& reservoirs, ITMIntMemoryBlock_CPtr& reservoirSizes);
+
   /**
    * \brief Gets the example reservoirs.
    *
    * \note These are stored in an image in which each row corresponds to a reservoir. Each row can store up to
    *       get_reservoir_capacity() examples, but only the first get_reservoir_sizes()[rowIdx] are valid.
    *
-   * \return The example reservoirs.
+   * \return The example reservoirs, or null if they are not stored densely (in which case get_reservoir_range should be used).
    */
   ReservoirsImage_CPtr get_reservoirs() const;
 
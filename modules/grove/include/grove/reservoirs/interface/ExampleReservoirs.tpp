@@ -17,13 +17,13 @@ namespace grove {
 //#################### CONSTRUCTORS ####################
 
 template <typename ExampleType>
-ExampleReservoirs<ExampleType>::ExampleReservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, uint32_t rngSeed)
+ExampleReservoirs<ExampleType>::ExampleReservoirs(uint32_t reservoirCount, uint32_t reservoirCapacity, uint32_t rngSeed, bool allocateDenseStorage)
 : m_reservoirCapacity(reservoirCapacity), m_reservoirCount(reservoirCount), m_rngSeed(rngSeed)
 {
   itmx::MemoryBlockFactory& mbf = itmx::MemoryBlockFactory::instance();
 
   // One row per reservoir, width equal to the capacity.
-  m_reservoirs = mbf.make_image<ExampleType>(Vector2i(reservoirCapacity, reservoirCount));
+  if(allocateDenseStorage) m_reservoirs = mbf.make_image<ExampleType>(Vector2i(reservoirCapacity, reservoirCount));
   m_reservoirAddCalls = mbf.make_block<int>(reservoirCount);
   m_reservoirSizes = mbf.make_block<int>(reservoirCount);
 }
@@ -63,6 +63,20 @@ uint32_t ExampleReservoirs<ExampleType>::get_reservoir_capacity() const
   return m_reservoirCapacity;
 }
 
+template <typename ExampleType>
+uint32_t ExampleReservoirs<ExampleType>::get_reservoir_range(uint32_t startIdx, uint32_t count, ReservoirsImage_CPtr& reservoirs, ITMIntMemoryBlock_CPtr& reservoirSizes)
+{
+  if(startIdx + count > m_reservoirCount)
+  {
+    throw std::invalid_argument("Error: startIdx + count > m_reservoirCount");
+  }
+
+  // The reservoirs are stored densely, so we can simply return all of them.
+  reservoirs = m_reservoirs;
+  reservoirSizes = m_reservoirSizes;
+  return startIdx;
+}
+
 template <typename ExampleType>
 typename ExampleReservoirs<ExampleType>::ExampleImage_CPtr ExampleReservoirs<ExampleType>::get_reservoirs() const
 {
@@ -87,12 +101,12 @@ void ExampleReservoirs<ExampleType>::load_from_disk(const std::string& inputFold
   bf::path inputPath(inputFolder);
 
   // Load the data into memory on the CPU.
-  ORUtils::MemoryBlockPersister::LoadImageFrom((inputPath / "reservoirs.bin").string(), *m_reservoirs, MEMORYDEVICE_CPU);
+  if(m_reservoirs) ORUtils::MemoryBlockPersister::LoadImageFrom((inputPath / "reservoirs.bin").string(), *m_reservoirs, MEMORYDEVICE_CPU);
   ORUtils::MemoryBlockPersister::LoadMemoryBlock((inputPath / "reservoirAddCalls.bin").string(), *m_reservoirAddCalls, MEMORYDEVICE_CPU);
   ORUtils::MemoryBlockPersister::LoadMemoryBlock((inputPath / "reservoirSizes.bin").string(), *m_reservoirSizes, MEMORYDEVICE_CPU);
 
   // If we're using the GPU, copy the data across.
-  m_reservoirs->UpdateDeviceFromHost();
+  if(m_reservoirs) m_reservoirs->UpdateDeviceFromHost();
   m_reservoirAddCalls->UpdateDeviceFromHost();
   m_reservoirSizes->UpdateDeviceFromHost();
 
@@ -114,12 +128,12 @@ void ExampleReservoirs<ExampleType>::save_to_disk(const std::string& outputFolde
   bf::path outputPath(outputFolder);
 
   // If we're using the GPU, copy the data across to the CPU so that it can be saved.
-  m_reservoirs->UpdateHostFromDevice();
+  if(m_reservoirs) m_reservoirs->UpdateHostFromDevice();
   m_reservoirAddCalls->UpdateHostFromDevice();
   m_reservoirSizes->UpdateHostFromDevice();
 
   // Save the data to disk.
-  ORUtils::MemoryBlockPersister::SaveImage((outputPath / "reservoirs.bin").string(), *m_reservoirs, MEMORYDEVICE_CPU);
+  if(m_reservoirs) ORUtils::MemoryBlockPersister::SaveImage((outputPath / "reservoirs.bin").string(), *m_reservoirs, MEMORYDEVICE_CPU);
   ORUtils::MemoryBlockPersister::SaveMemoryBlock((outputPath / "reservoirAddCalls.bin").string(), *m_reservoirAddCalls, MEMORYDEVICE_CPU);
   ORUtils::MemoryBlockPersister::SaveMemoryBlock((outputPath / "reservoirSizes.bin").string(), *m_reservoirSizes, MEMORYDEVICE_CPU);
 
@@ -127,4 +141,18 @@ void ExampleReservoirs<ExampleType>::save_to_disk(const std::string& outputFolde
   save_to_disk_sub(outputFolder);
 }
 
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+template <typename ExampleType>
+void ExampleReservoirs<ExampleType>::load_from_disk_sub(const std::string& /*inputFolder*/)
+{
+  // No-op by default
+}
+
+template <typename ExampleType>
+void ExampleReservoirs<ExampleType>::save_to_disk_sub(const std::string& /*outputFolder*/)
+{
+  // No-op by default
+}
+
 }
@@ -8,10 +8,38 @@
 
 #include <ORUtils/PlatformIndependence.h>
 
+#include <tvgutil/numbers/CounterBasedRNG.h>
+
 #define ALWAYS_ADD_EXAMPLES 0
 
 namespace grove {
 
+/**
+ * \brief Randomly selects the offset in a full reservoir at which to store a new example.
+ *
+ * If ALWAYS_ADD_EXAMPLES is 1, the offset is always that of an existing example in the reservoir. If ALWAYS_ADD_EXAMPLES
+ * is 0, the offset may be greater than or equal to the reservoir's capacity, in which case the new example is discarded.
+ *
+ * \param reservoirIdx      The index of the reservoir.
+ * \param oldAddCallsCount  The number of add calls that had been made for the reservoir before the current one (>= reservoirCapacity).
+ * \param reservoirCapacity The capacity (maximum size) of the reservoir.
+ * \param rngSeed           The seed for the random number generator.
+ * \return                  The offset at which to store the new example (only meaningful if it is less than reservoirCapacity).
+ */
+_CPU_AND_GPU_CODE_
+inline uint32_t select_replacement_offset(int reservoirIdx, uint32_t oldAddCallsCount, uint32_t reservoirCapacity, uint32_t rngSeed)
+{
+  const uint32_t randomValue = tvgutil::CounterBasedRNG::generate_uint32(rngSeed, reservoirIdx, oldAddCallsCount);
+
+#if ALWAYS_ADD_EXAMPLES
+  // Generate a random offset that will always result in an example being evicted from the reservoir.
+  return tvgutil::CounterBasedRNG::map_to_int_range(randomValue, 0, reservoirCapacity - 1);
+#else
+  // Generate a random offset that may or may not result in an example being evicted from the reservoir.
+  return tvgutil::CounterBasedRNG::map_to_int_range(randomValue, 0, oldAddCallsCount - 1);
+#endif
+}
+
 /**
  * \brief Attempts to add an example to some reservoirs.
  *
@@ -21,6 +49,10 @@ namespace grove {
  * example. If ALWAYS_ADD_EXAMPLES is 0, then an additional random decision is made as
  * to *whether* to replace an existing example.
  *
+ * The random decisions are made using a counter-based generator, keyed on the reservoir index and the
+ * reservoir's add call count. Since each add call for a reservoir has a unique count, no per-thread
+ * generator state needs to be stored, and the decisions do not depend on which thread adds which example.
+ *
  * \param example             The example to attempt to add to the reservoirs.
  * \param reservoirIndices    The indices of the reservoirs to which to attempt to add the example.
  * \param reservoirIndexCount The number of reservoirs to which to attempt to add the example.
@@ -28,13 +60,13 @@ namespace grove {
  * \param reservoirSizes      The current size of each reservoir.
  * \param reservoirAddCalls   The number of times the insertion of an example has been attempted for each reservoir.
  * \param reservoirCapacity   The capacity (maximum size) of each reservoir.
- * \param randomGenerator     A random number generator.
+ * \param rngSeed             The seed for the random number generator.
  */
-template <typename ExampleType, typename RNGType>
+template <typename ExampleType>
 _CPU_AND_GPU_CODE_TEMPLATE_
 inline void add_example_to_reservoirs(const ExampleType& example, const int *reservoirIndices, uint32_t reservoirIndexCount,
                                       ExampleType *reservoirs, int *reservoirSizes, int *reservoirAddCalls, uint32_t reservoirCapacity,
-                                      RNGType& randomGenerator)
+                                      uint32_t rngSeed)
 {
   // If the example is invalid, early out.
   if(!example.valid) return;
@@ -83,15 +115,8 @@ inline void add_example_to_reservoirs(const ExampleType& example, const int *res
     }
     else
     {
-#if ALWAYS_ADD_EXAMPLES
-      // Generate a random offset that will always result in an example being evicted from the reservoir.
-      const uint32_t randomOffset = randomGenerator.generate_int_from_uniform(0, reservoirCapacity - 1);
-#else
-      // Generate a random offset that may or may not result in an example being evicted from the reservoir.
-      const uint32_t randomOffset = randomGenerator.generate_int_from_uniform(0, oldAddCallsCount - 1);
-#endif
-
       // If the random offset corresponds to an example in the reservoir, replace that with the new example.
+      const uint32_t randomOffset = select_replacement_offset(reservoirIdx, oldAddCallsCount, reservoirCapacity, rngSeed);
       if(randomOffset < reservoirCapacity)
       {
         reservoirs[reservoirStartIdx + randomOffset] = example;
@@ -134,6 +134,18 @@ inline float distance_squared(const Keypoint3DColour& a, const Keypoint3DColour&
   return dot(diff, diff);
 }
 
+/**
+ * \brief Gets the position of a 3D colour keypoint.
+ *
+ * \param keypoint  The 3D colour keypoint.
+ * \return          The position of the keypoint.
+ */
+_CPU_AND_GPU_CODE_
+inline Vector3f get_position(const Keypoint3DColour& keypoint)
+{
+  return keypoint.position;
+}
+
 }
 
 #endif
@@ -14,6 +14,7 @@
 #include "forests/interface/DecisionForest.tpp"
 #include "reservoirs/ExampleReservoirsFactory.tpp"
 #include "reservoirs/cpu/ExampleReservoirs_CPU.tpp"
+#include "reservoirs/cpu/PagedExampleReservoirs_CPU.tpp"
 #include "reservoirs/interface/ExampleReservoirs.tpp"
 #include "scoreforests/Keypoint3DColourCluster.h"
 #include "scoreforests/ScorePrediction.h"
@@ -79,6 +80,8 @@ template class ExampleReservoirs<Keypoint2D>;
 template class ExampleReservoirs<Keypoint3DColour>;
 template class ExampleReservoirs_CPU<Keypoint2D>;
 template class ExampleReservoirs_CPU<Keypoint3DColour>;
+template class PagedExampleReservoirs_CPU<Keypoint2D>;
+template class PagedExampleReservoirs_CPU<Keypoint3DColour>;
 template struct ExampleReservoirsFactory<Keypoint2D>;
 template struct ExampleReservoirsFactory<Keypoint3DColour>;
 
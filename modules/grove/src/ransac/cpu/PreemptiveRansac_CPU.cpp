@@ -6,6 +6,18 @@
 #include "ransac/cpu/PreemptiveRansac_CPU.h"
 using namespace tvgutil;
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define GROVE_RANSAC_USE_SSE2 1
+#else
+  #define GROVE_RANSAC_USE_SSE2 0
+#endif
+
 #include <Eigen/Dense>
 
 #include <itmx/base/MemoryBlockFactory.h>
@@ -15,10 +27,98 @@ using namespace itmx;
 
 namespace grove {
 
+//#################### LOCAL CONSTANTS ####################
+
+namespace {
+
+/**
+ * The layout of a block of inliers in the structure-of-arrays energy data. Each block starts with a header containing
+ * the x, y and z coordinates of the inliers in camera space and a mask indicating which lanes contain real inliers,
+ * followed by one mode slot for each of the modes predicted for the inliers. Each mode slot contains the coordinates
+ * of the mode, the six distinct coefficients of the quadratic form defined by its inverse covariance, and the two
+ * log-domain weights used to select the best mode and compute the energy term, respectively. Each field is an array
+ * of 4 floats (one per inlier in the block).
+ */
+enum
+{
+  LANE_COUNT = 4,
+  HEADER_FIELD_COUNT = 4,
+  MODE_FIELD_COUNT = 11
+};
+
+/** The number of blocks of inliers to process between successive checks for early termination. */
+const int EARLY_TERMINATION_CHECK_INTERVAL = 8;
+
+/**
+ * The margin by which the lower bound on a candidate's energy must exceed the energy threshold for the computation of
+ * its energy to be abandoned (this guards against the bound being ever so slightly off due to rounding).
+ */
+const float EARLY_TERMINATION_MARGIN = 1e-3f;
+
+/** The natural logarithm of the smallest energy allowed for an inlier (see compute_energy_sum_for_inlier_subset). */
+const float LN_MIN_INLIER_ENERGY = -13.815510558f;
+
+/** The reciprocal of the natural logarithm of 10. */
+const float ONE_OVER_LN_10 = 0.434294482f;
+
+}
+
+//#################### LOCAL TYPES ####################
+
+/**
+ * \brief An instance of this struct holds 4 floats, on which arithmetic can be performed lane-wise.
+ */
+#if GROVE_RANSAC_USE_SSE2
+struct Lanes4
+{
+  __m128 v;
+
+  static Lanes4 load(const float *p) { Lanes4 l; l.v = _mm_loadu_ps(p); return l; }
+  static Lanes4 set1(float f) { Lanes4 l; l.v = _mm_set1_ps(f); return l; }
+  float sum() const { float f[LANE_COUNT]; _mm_storeu_ps(f, v); return (f[0] + f[1]) + (f[2] + f[3]); }
+};
+
+inline Lanes4 operator+(const Lanes4& a, const Lanes4& b) { Lanes4 l; l.v = _mm_add_ps(a.v, b.v); return l; }
+inline Lanes4 operator-(const Lanes4& a, const Lanes4& b) { Lanes4 l; l.v = _mm_sub_ps(a.v, b.v); return l; }
+inline Lanes4 operator*(const Lanes4& a, const Lanes4& b) { Lanes4 l; l.v = _mm_mul_ps(a.v, b.v); return l; }
+inline Lanes4 lane_max(const Lanes4& a, const Lanes4& b) { Lanes4 l; l.v = _mm_max_ps(a.v, b.v); return l; }
+
+/** Selects the lanes of a for which c > d, and the lanes of b otherwise. */
+inline Lanes4 select_gt(const Lanes4& c, const Lanes4& d, const Lanes4& a, const Lanes4& b)
+{
+  const __m128 mask = _mm_cmpgt_ps(c.v, d.v);
+  Lanes4 l; l.v = _mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, b.v)); return l;
+}
+#else
+struct Lanes4
+{
+  float v[LANE_COUNT];
+
+  static Lanes4 load(const float *p) { Lanes4 l; for(int i = 0; i < LANE_COUNT; ++i) l.v[i] = p[i]; return l; }
+  static Lanes4 set1(float f) { Lanes4 l; for(int i = 0; i < LANE_COUNT; ++i) l.v[i] = f; return l; }
+  float sum() const { return (v[0] + v[1]) + (v[2] + v[3]); }
+};
+
+inline Lanes4 operator+(const Lanes4& a, const Lanes4& b) { Lanes4 l; for(int i = 0; i < LANE_COUNT; ++i) l.v[i] = a.v[i] + b.v[i]; return l; }
+inline Lanes4 operator-(const Lanes4& a, const Lanes4& b) { Lanes4 l; for(int i = 0; i < LANE_COUNT; ++i) l.v[i] = a.v[i] - b.v[i]; return l; }
+inline Lanes4 operator*(const Lanes4& a, const Lanes4& b) { Lanes4 l; for(int i = 0; i < LANE_COUNT; ++i) l.v[i] = a.v[i] * b.v[i]; return l; }
+inline Lanes4 lane_max(const Lanes4& a, const Lanes4& b) { Lanes4 l; for(int i = 0; i < LANE_COUNT; ++i) l.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return l; }
+
+/** Selects the lanes of a for which c > d, and the lanes of b otherwise. */
+inline Lanes4 select_gt(const Lanes4& c, const Lanes4& d, const Lanes4& a, const Lanes4& b)
+{
+  Lanes4 l; for(int i = 0; i < LANE_COUNT; ++i) l.v[i] = c.v[i] > d.v[i] ? a.v[i] : b.v[i]; return l;
+}
+#endif
+
 //#################### CONSTRUCTORS ####################
 
 PreemptiveRansac_CPU::PreemptiveRansac_CPU(const SettingsContainer_CPtr& settings)
-: PreemptiveRansac(settings)
+: PreemptiveRansac(settings),
+  m_earlyTerminationCount(0),
+  m_energyComputationCount(0),
+  m_energyInlierCount(0),
+  m_timerEnergyInlierPreparation("Energy Inlier Preparation")
 {
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
   m_rngs = mbf.make_block<CPURNG>(m_maxPoseCandidates);
@@ -27,22 +127,93 @@ PreemptiveRansac_CPU::PreemptiveRansac_CPU(const SettingsContainer_CPtr& setting
   init_random();
 }
 
+//#################### DESTRUCTOR ####################
+
+PreemptiveRansac_CPU::~PreemptiveRansac_CPU()
+{
+  if(m_printTimers)
+  {
+    print_timer(m_timerEnergyInlierPreparation);
+    std::cout << "Energy computations abandoned early: " << m_earlyTerminationCount << " of " << m_energyComputationCount << ".\n";
+  }
+}
+
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
 void PreemptiveRansac_CPU::compute_energies_and_sort()
 {
-  const size_t nbPoseCandidates = m_poseCandidates->dataSize;
+  const int nbPoseCandidates = static_cast<int>(m_poseCandidates->dataSize);
   PoseCandidate *poseCandidates = m_poseCandidates->GetData(MEMORYDEVICE_CPU);
 
+  // Make sure that the structure-of-arrays data for all of the inliers sampled so far is available.
+  m_timerEnergyInlierPreparation.start();
+  prepare_inliers_for_energy_computation();
+  m_timerEnergyInlierPreparation.stop();
+
+  // Compute the suffix sums of the upper bounds on the energy terms of the inlier blocks. These allow us to bound the energy
+  // of a candidate from below once we have processed only some of the blocks.
+  const size_t blockCount = m_energyBlockOffsets.size();
+  std::vector<float> blockTermBoundSums(blockCount + 1, 0.0f);
+  for(int i = static_cast<int>(blockCount) - 1; i >= 0; --i)
+  {
+    blockTermBoundSums[i] = blockTermBoundSums[i + 1] + m_energyBlockTermBounds[i];
+  }
+
+  // The energy threshold is the m_nbPoseCandidatesNeedingEnergies'th smallest energy computed so far (or +infinity if we
+  // have not yet computed that many energies): a candidate whose energy must exceed this cannot be one of the candidates
+  // whose energies are needed. We maintain the smallest energies computed so far in a max-heap.
+  const size_t nbNeedingEnergies = m_nbPoseCandidatesNeedingEnergies > 0 ? m_nbPoseCandidatesNeedingEnergies : nbPoseCandidates;
+  float energyThreshold = std::numeric_limits<float>::infinity();
+  std::vector<float> smallestEnergies;
+  smallestEnergies.reserve(nbNeedingEnergies);
+  size_t earlyTerminationCount = 0;
+
   // Compute the energies for all pose candidates.
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(dynamic) reduction(+:earlyTerminationCount)
 #endif
-  for(size_t i = 0; i < nbPoseCandidates; ++i)
+  for(int i = 0; i < nbPoseCandidates; ++i)
   {
-    compute_pose_energy(poseCandidates[i]);
+    if(compute_pose_energy(poseCandidates[i], blockTermBoundSums, &energyThreshold))
+    {
+    #ifdef WITH_OPENMP
+      #pragma omp critical(PreemptiveRansac_CPU_energyThreshold)
+    #endif
+      {
+        const float energy = poseCandidates[i].energy;
+        if(smallestEnergies.size() < nbNeedingEnergies || energy < smallestEnergies.front())
+        {
+          if(smallestEnergies.size() == nbNeedingEnergies)
+          {
+            std::pop_heap(smallestEnergies.begin(), smallestEnergies.end());
+            smallestEnergies.pop_back();
+          }
+
+          smallestEnergies.push_back(energy);
+          std::push_heap(smallestEnergies.begin(), smallestEnergies.end());
+
+          if(smallestEnergies.size() == nbNeedingEnergies)
+          {
+          #ifdef WITH_OPENMP
+            #pragma omp atomic write
+          #endif
+            energyThreshold = smallestEnergies.front();
+          }
+        }
+      }
+    }
+    else
+    {
+      // The candidate cannot survive the next cull (and will not be returned by get_best_poses), so give it an energy that will
+      // sort it after all of the candidates whose energies are needed.
+      poseCandidates[i].energy = std::numeric_limits<float>::max();
+      ++earlyTerminationCount;
+    }
   }
 
+  m_earlyTerminationCount += earlyTerminationCount;
+  m_energyComputationCount += nbPoseCandidates;
+
   // Sort the candidates into non-decreasing order of energy.
   std::sort(poseCandidates, poseCandidates + nbPoseCandidates);
 }
@@ -120,6 +291,18 @@ void PreemptiveRansac_CPU::prepare_inliers_for_optimisation()
   m_poseOptimisationPredictedModes->dataSize = bufferSize;
 }
 
+void PreemptiveRansac_CPU::reset_inliers(bool resetMask)
+{
+  PreemptiveRansac::reset_inliers(resetMask);
+
+  // Discard the structure-of-arrays data for the old inliers.
+  m_energyBlockModeCounts.clear();
+  m_energyBlockOffsets.clear();
+  m_energyBlockTermBounds.clear();
+  m_energyInlierCount = 0;
+  m_energyInlierData.clear();
+}
+
 void PreemptiveRansac_CPU::sample_inliers(bool useMask)
 {
   const Vector2i imgSize = m_keypointsImage->noDims;
@@ -162,15 +345,85 @@ void PreemptiveRansac_CPU::update_candidate_poses()
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void PreemptiveRansac_CPU::compute_pose_energy(PoseCandidate& candidate) const
+bool PreemptiveRansac_CPU::compute_pose_energy(PoseCandidate& candidate, const std::vector<float>& blockTermBoundSums, const float *energyThreshold) const
 {
-  const int *inlierRasterIndices = m_inlierRasterIndicesBlock->GetData(MEMORYDEVICE_CPU);
-  const Keypoint3DColour *keypointsImage = m_keypointsImage->GetData(MEMORYDEVICE_CPU);
-  const uint32_t nbInliers = static_cast<uint32_t>(m_inlierRasterIndicesBlock->dataSize);
-  const ScorePrediction *predictionsImage = m_predictionsImage->GetData(MEMORYDEVICE_CPU);
+  const uint32_t nbInliers = m_energyInlierCount;
+  const int blockCount = static_cast<int>(m_energyBlockOffsets.size());
+  const float *data = m_energyInlierData.empty() ? NULL : &m_energyInlierData[0];
+
+  // Note: Matrix4f is stored in column-major order.
+  const float *m = candidate.cameraPose.m;
+  const Lanes4 m00 = Lanes4::set1(m[0]), m01 = Lanes4::set1(m[4]), m02 = Lanes4::set1(m[8]), m03 = Lanes4::set1(m[12]);
+  const Lanes4 m10 = Lanes4::set1(m[1]), m11 = Lanes4::set1(m[5]), m12 = Lanes4::set1(m[9]), m13 = Lanes4::set1(m[13]);
+  const Lanes4 m20 = Lanes4::set1(m[2]), m21 = Lanes4::set1(m[6]), m22 = Lanes4::set1(m[10]), m23 = Lanes4::set1(m[14]);
+  const Lanes4 minusHalf = Lanes4::set1(-0.5f);
+  const Lanes4 lnMinInlierEnergy = Lanes4::set1(LN_MIN_INLIER_ENERGY);
+
+  // The sum of the log-domain energy terms, which are the negated natural logs of the inlier energies. The energy of the candidate
+  // is the sum of -log10 of the inlier energies, divided by the number of inliers (see compute_energy_sum_for_inlier_subset).
+  Lanes4 termSums = Lanes4::set1(0.0f);
+
+  for(int blockIdx = 0; blockIdx < blockCount; ++blockIdx)
+  {
+    const float *block = data + m_energyBlockOffsets[blockIdx];
+
+    // Compute the hypothesised positions of the inliers in world space.
+    const Lanes4 cx = Lanes4::load(block), cy = Lanes4::load(block + LANE_COUNT), cz = Lanes4::load(block + 2 * LANE_COUNT);
+    const Lanes4 laneMask = Lanes4::load(block + 3 * LANE_COUNT);
+    const Lanes4 wx = m00 * cx + m01 * cy + m02 * cz + m03;
+    const Lanes4 wy = m10 * cx + m11 * cy + m12 * cz + m13;
+    const Lanes4 wz = m20 * cx + m21 * cy + m22 * cz + m23;
+
+    // Find the best mode for each inlier, i.e. the one that maximises log(nbInliers * N(x; mode)), as in find_closest_mode.
+    // The first mode is always selected initially (for consistency with find_closest_mode).
+    Lanes4 bestSelection, bestTerm;
+    const int modeCount = m_energyBlockModeCounts[blockIdx];
+    const float *mode = block + HEADER_FIELD_COUNT * LANE_COUNT;
+    for(int modeIdx = 0; modeIdx < modeCount; ++modeIdx, mode += MODE_FIELD_COUNT * LANE_COUNT)
+    {
+      const Lanes4 dx = wx - Lanes4::load(mode);
+      const Lanes4 dy = wy - Lanes4::load(mode + LANE_COUNT);
+      const Lanes4 dz = wz - Lanes4::load(mode + 2 * LANE_COUNT);
+
+      const Lanes4 mahalanobisSq =
+        Lanes4::load(mode + 3 * LANE_COUNT) * dx * dx + Lanes4::load(mode + 4 * LANE_COUNT) * dy * dy + Lanes4::load(mode + 5 * LANE_COUNT) * dz * dz +
+        Lanes4::load(mode + 6 * LANE_COUNT) * dx * dy + Lanes4::load(mode + 7 * LANE_COUNT) * dx * dz + Lanes4::load(mode + 8 * LANE_COUNT) * dy * dz;
+
+      const Lanes4 exponent = minusHalf * mahalanobisSq;
+      const Lanes4 selection = Lanes4::load(mode + 9 * LANE_COUNT) + exponent;
+      const Lanes4 term = Lanes4::load(mode + 10 * LANE_COUNT) + exponent;
+
+      if(modeIdx == 0)
+      {
+        bestSelection = selection;
+        bestTerm = term;
+      }
+      else
+      {
+        bestTerm = select_gt(selection, bestSelection, term, bestTerm);
+        bestSelection = select_gt(selection, bestSelection, selection, bestSelection);
+      }
+    }
+
+    // Clamp the log energy of each inlier from below (as in compute_energy_sum_for_inlier_subset), and accumulate it.
+    termSums = termSums + lane_max(bestTerm, lnMinInlierEnergy) * laneMask;
+
+    // Every so often, check whether the candidate's energy is now bound to exceed the threshold. If so, abandon it.
+    if((blockIdx + 1) % EARLY_TERMINATION_CHECK_INTERVAL == 0 && blockIdx + 1 < blockCount)
+    {
+      float threshold;
+    #ifdef WITH_OPENMP
+      #pragma omp atomic read
+    #endif
+      threshold = *energyThreshold;
+
+      const float energyLowerBound = -(termSums.sum() + blockTermBoundSums[blockIdx + 1]) * ONE_OVER_LN_10 / static_cast<float>(nbInliers);
+      if(energyLowerBound > threshold + EARLY_TERMINATION_MARGIN) return false;
+    }
+  }
 
-  const float energySum = compute_energy_sum_for_inliers(candidate.cameraPose, keypointsImage, predictionsImage, inlierRasterIndices, nbInliers);
-  candidate.energy = energySum / static_cast<float>(nbInliers);
+  candidate.energy = -termSums.sum() * ONE_OVER_LN_10 / static_cast<float>(nbInliers);
+  return true;
 }
 
 void PreemptiveRansac_CPU::init_random()
@@ -183,4 +436,107 @@ void PreemptiveRansac_CPU::init_random()
   }
 }
 
+void PreemptiveRansac_CPU::prepare_inliers_for_energy_computation()
+{
+  const int *inlierRasterIndices = m_inlierRasterIndicesBlock->GetData(MEMORYDEVICE_CPU);
+  const Keypoint3DColour *keypoints = m_keypointsImage->GetData(MEMORYDEVICE_CPU);
+  const uint32_t nbInliers = static_cast<uint32_t>(m_inlierRasterIndicesBlock->dataSize);
+  const ScorePrediction *predictions = m_predictionsImage->GetData(MEMORYDEVICE_CPU);
+  const float lnTwoPiCubed = 3.0f * logf(2.0f * static_cast<float>(M_PI));
+
+  // If the last block is only partially filled, discard it so that it can be rebuilt with the new inliers.
+  if(m_energyInlierCount % LANE_COUNT != 0)
+  {
+    m_energyInlierCount -= m_energyInlierCount % LANE_COUNT;
+    m_energyInlierData.resize(m_energyBlockOffsets.back());
+    m_energyBlockModeCounts.pop_back();
+    m_energyBlockOffsets.pop_back();
+    m_energyBlockTermBounds.pop_back();
+  }
+
+  // Add a block for each group of (up to) four new inliers.
+  for(uint32_t blockStart = m_energyInlierCount; blockStart < nbInliers; blockStart += LANE_COUNT)
+  {
+    const uint32_t laneCount = std::min<uint32_t>(LANE_COUNT, nbInliers - blockStart);
+
+    // Determine the number of mode slots needed for the block.
+    int modeCount = 1;
+    for(uint32_t lane = 0; lane < laneCount; ++lane)
+    {
+      modeCount = std::max(modeCount, predictions[inlierRasterIndices[blockStart + lane]].size);
+    }
+
+    // Allocate the block (padding lanes and mode slots are zeroed, which makes them harmless).
+    const size_t blockOffset = m_energyInlierData.size();
+    m_energyInlierData.resize(blockOffset + (HEADER_FIELD_COUNT + modeCount * MODE_FIELD_COUNT) * LANE_COUNT, 0.0f);
+    float *block = &m_energyInlierData[blockOffset];
+
+    float termBound = 0.0f;
+    for(uint32_t lane = 0; lane < laneCount; ++lane)
+    {
+      const int inlierRasterIdx = inlierRasterIndices[blockStart + lane];
+      const Vector3f& position = keypoints[inlierRasterIdx].position;
+      const ScorePrediction& pred = predictions[inlierRasterIdx];
+
+      // We expect the inlier to have at least one valid mode (this is guaranteed by the inlier sampling process).
+      // If this isn't the case for some reason, defensively throw.
+      if(pred.size <= 0) throw std::runtime_error("prediction has no valid modes");
+
+      block[lane] = position.x;
+      block[LANE_COUNT + lane] = position.y;
+      block[2 * LANE_COUNT + lane] = position.z;
+      block[3 * LANE_COUNT + lane] = 1.0f;
+
+      // The energy term for the inlier is the log of the normalised Gaussian density of the best mode, divided by
+      // the number of modes, clamped from below. Assuming that the inverse covariances are positive semi-definite,
+      // the largest log normalisation term (or the clamp value) is therefore an upper bound on it.
+      float inlierTermBound = LN_MIN_INLIER_ENERGY;
+      const float lnModeCount = logf(static_cast<float>(pred.size));
+
+      float *mode = block + HEADER_FIELD_COUNT * LANE_COUNT;
+      for(int modeIdx = 0; modeIdx < modeCount; ++modeIdx, mode += MODE_FIELD_COUNT * LANE_COUNT)
+      {
+        if(modeIdx >= pred.size)
+        {
+          // Pad the lane with a mode that can never be selected.
+          mode[9 * LANE_COUNT + lane] = -std::numeric_limits<float>::infinity();
+          continue;
+        }
+
+        const Keypoint3DColourCluster& currentMode = pred.elts[modeIdx];
+
+        // We expect each mode to have at least some inliers (this is guaranteed by the clustering process).
+        // If this isn't the case for some reason, defensively throw.
+        if(currentMode.nbInliers == 0) throw std::runtime_error("mode has no inliers");
+
+        // Note: The quadratic form only depends on the sums of the symmetric pairs of off-diagonal elements.
+        const float *invCov = currentMode.positionInvCovariance.m;
+        const float lnNormalisation = -0.5f * (logf(currentMode.determinant) + lnTwoPiCubed);
+
+        mode[lane] = currentMode.position.x;
+        mode[LANE_COUNT + lane] = currentMode.position.y;
+        mode[2 * LANE_COUNT + lane] = currentMode.position.z;
+        mode[3 * LANE_COUNT + lane] = invCov[0];
+        mode[4 * LANE_COUNT + lane] = invCov[4];
+        mode[5 * LANE_COUNT + lane] = invCov[8];
+        mode[6 * LANE_COUNT + lane] = invCov[1] + invCov[3];
+        mode[7 * LANE_COUNT + lane] = invCov[2] + invCov[6];
+        mode[8 * LANE_COUNT + lane] = invCov[5] + invCov[7];
+        mode[9 * LANE_COUNT + lane] = logf(static_cast<float>(currentMode.nbInliers)) + lnNormalisation;
+        mode[10 * LANE_COUNT + lane] = lnNormalisation - lnModeCount;
+
+        inlierTermBound = std::max(inlierTermBound, lnNormalisation - lnModeCount);
+      }
+
+      termBound += inlierTermBound;
+    }
+
+    m_energyBlockModeCounts.push_back(modeCount);
+    m_energyBlockOffsets.push_back(blockOffset);
+    m_energyBlockTermBounds.push_back(termBound);
+  }
+
+  m_energyInlierCount = nbInliers;
+}
+
 }
@@ -6,6 +6,8 @@
 #include "ransac/interface/PreemptiveRansac.h"
 using namespace tvgutil;
 
+#include <algorithm>
+
 #include <boost/lexical_cast.hpp>
 #include <boost/timer/timer.hpp>
 
@@ -29,7 +31,9 @@ namespace grove {
 //#################### CONSTRUCTORS ####################
 
 PreemptiveRansac::PreemptiveRansac(const SettingsContainer_CPtr& settings)
-: m_poseCandidatesAfterCull(0),
+: m_nbPoseCandidatesNeedingEnergies(0),
+  m_nbPoseCandidatesToKeep(0),
+  m_poseCandidatesAfterCull(0),
   m_timerCandidateGeneration("Candidate Generation"),
   m_timerFirstComputeEnergy("First Energy Computation"),
   m_timerFirstTrim("First Trim"),
@@ -60,7 +64,8 @@ PreemptiveRansac::PreemptiveRansac(const SettingsContainer_CPtr& settings)
   m_usePredictionCovarianceForPoseOptimization = m_settings->get_first_value<bool>(settingsNamespace + "usePredictionCovarianceForPoseOptimization", true);     // If false, use L2.
 
   // Each RANSAC iteration after the initial cull adds m_ransacInliersPerIteration inliers to the set, so we allocate enough space for all of them up-front.
-  m_nbMaxInliers = m_ransacInliersPerIteration * static_cast<uint32_t>(std::ceil(log2(m_maxPoseCandidatesAfterCull)));
+  const uint32_t maxRansacIterations = static_cast<uint32_t>(std::ceil(log2(m_maxPoseCandidatesAfterCull)));
+  m_nbMaxInliers = m_ransacInliersPerIteration * maxRansacIterations;
 
   // Allocate memory.
   const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
@@ -77,8 +82,8 @@ PreemptiveRansac::PreemptiveRansac(const SettingsContainer_CPtr& settings)
   m_printTimers = true;
 #endif
 
-  // Set up the remaining timers.
-  for(int i = 1; i <= 6; ++i)
+  // Set up the remaining timers (one per RANSAC iteration, with at least one for the case in which only a single candidate was generated).
+  for(uint32_t i = 1; i <= std::max(maxRansacIterations, 1U); ++i)
   {
     m_timerInlierSampling.push_back(AverageTimer("Inlier Sampling " + boost::lexical_cast<std::string>(i)));
     m_timerPrepareOptimisation.push_back(AverageTimer("Prepare Optimisation " + boost::lexical_cast<std::string>(i)));
@@ -180,6 +185,9 @@ boost::optional<PoseCandidate> PreemptiveRansac::estimate_pose(const Keypoint3DC
 #ifdef ENABLE_TIMERS
       boost::timer::auto_cpu_timer t(6, "compute energies and sort: %ws wall, %us user + %ss system = %ts CPU (%p%)\n");
 #endif
+      // The candidates that are culled here are discarded for good, so their energies are not needed.
+      m_nbPoseCandidatesToKeep = m_maxPoseCandidatesAfterCull;
+      m_nbPoseCandidatesNeedingEnergies = m_nbPoseCandidatesToKeep;
       m_timerFirstComputeEnergy.start();
       compute_energies_and_sort();
       m_timerFirstComputeEnergy.stop();
@@ -187,7 +195,7 @@ boost::optional<PoseCandidate> PreemptiveRansac::estimate_pose(const Keypoint3DC
 
     // Step 2(c): Finally, trim the number of candidates down to the maximum number allowed. Since we previously sorted
     //            the candidates by quality, this has the effect of keeping only the best ones.
-    m_poseCandidates->dataSize = m_maxPoseCandidatesAfterCull;
+    m_poseCandidates->dataSize = m_nbPoseCandidatesToKeep;
 
     m_timerFirstTrim.stop();
   }
@@ -237,13 +245,17 @@ boost::optional<PoseCandidate> PreemptiveRansac::estimate_pose(const Keypoint3DC
       m_timerOptimisation[iteration].stop();
     }
 
-    // Step 4(c): Compute the energy for each candidate and sort them in non-increasing order of quality.
+    // Step 4(c): Compute the energy for each candidate and sort them in non-increasing order of quality. Note that the
+    //            candidates that are culled in this step can still be returned by get_best_poses, so the energies of
+    //            all of the candidates are needed.
+    m_nbPoseCandidatesToKeep = static_cast<uint32_t>(m_poseCandidates->dataSize / 2);
+    m_nbPoseCandidatesNeedingEnergies = static_cast<uint32_t>(m_poseCandidates->dataSize);
     m_timerComputeEnergy[iteration].start();
     compute_energies_and_sort();
     m_timerComputeEnergy[iteration].stop();
 
     // Step 4(d): Remove the worse half of the candidates.
-    m_poseCandidates->dataSize /= 2;
+    m_poseCandidates->dataSize = m_nbPoseCandidatesToKeep;
 
     ++iteration;
   }
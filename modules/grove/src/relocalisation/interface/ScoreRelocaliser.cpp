@@ -11,6 +11,10 @@ namespace bf = boost::filesystem;
 #include <ITMLib/Engines/LowLevel/ITMLowLevelEngineFactory.h>
 using namespace ITMLib;
 
+#ifdef WITH_CUDA
+#include <ORUtils/CUDADefines.h>
+#endif
+
 #include <itmx/base/MemoryBlockFactory.h>
 using namespace itmx;
 
@@ -34,10 +38,12 @@ ScoreRelocaliser::ScoreRelocaliser(const std::string& forestFilename, const Sett
 
   // Determine the top-level parameters for the relocaliser.
   m_maxRelocalisationsToOutput = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxRelocalisationsToOutput", 1);
+  m_timersEnabled = m_settings->get_first_value<bool>(settingsNamespace + "timersEnabled", false);
 
   // Determine the reservoir-related parameters.
   m_maxReservoirsToUpdate = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxReservoirsToUpdate", 256);  // Update the modes associated with this number of reservoirs for each train/update call.
   m_reservoirCapacity = m_settings->get_first_value<uint32_t>(settingsNamespace + "reservoirCapacity", 1024);
+  m_reservoirPageCapacity = m_settings->get_first_value<uint32_t>(settingsNamespace + "reservoirPageCapacity", 0);     // If non-zero, only allocate storage for reservoirs that receive examples (CPU only, so off by default).
   m_rngSeed = m_settings->get_first_value<uint32_t>(settingsNamespace + "rngSeed", 42);
 
   // Determine the clustering-related parameters (the defaults are tentative values that seem to work).
@@ -45,6 +51,7 @@ ScoreRelocaliser::ScoreRelocaliser(const std::string& forestFilename, const Sett
   m_clustererTau = m_settings->get_first_value<float>(settingsNamespace + "clustererTau", 0.05f);
   m_maxClusterCount = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxClusterCount", ScorePrediction::Capacity);
   m_minClusterSize = m_settings->get_first_value<uint32_t>(settingsNamespace + "minClusterSize", 20);
+  const bool clustererUseGrid = m_settings->get_first_value<bool>(settingsNamespace + "clustererUseGrid", true);
 
   // Check that the maximum number of clusters to store in each leaf is within range.
   if(m_maxClusterCount > ScorePrediction::Capacity)
@@ -52,6 +59,14 @@ ScoreRelocaliser::ScoreRelocaliser(const std::string& forestFilename, const Sett
     throw std::invalid_argument(settingsNamespace + "maxClusterCount > ScorePrediction::Capacity");
   }
 
+  // Check that paged reservoir storage has only been requested if the relocaliser is running on the CPU (paged reservoirs
+  // are not available on the GPU). We check this here, rather than waiting for the reservoirs to be allocated, so that a
+  // bad configuration is reported as soon as the relocaliser is constructed.
+  if(m_reservoirPageCapacity > 0 && m_deviceType == DEVICE_CUDA)
+  {
+    throw std::invalid_argument(settingsNamespace + "reservoirPageCapacity must be 0 when the relocaliser runs on the GPU");
+  }
+
   // Allocate the internal images.
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
   m_descriptorsImage = mbf.make_image<DescriptorType>();
@@ -59,13 +74,21 @@ ScoreRelocaliser::ScoreRelocaliser(const std::string& forestFilename, const Sett
   m_leafIndicesImage = mbf.make_image<LeafIndices>();
   m_predictionsImage = mbf.make_image<ScorePrediction>();
 
+  // Set up the stage timers (these must be added in the same order as the stages in the Stage enumeration).
+  m_stageTimers.push_back(AverageTimer("Features"));
+  m_stageTimers.push_back(AverageTimer("Leaf Lookup"));
+  m_stageTimers.push_back(AverageTimer("Reservoir Update"));
+  m_stageTimers.push_back(AverageTimer("Clustering"));
+  m_stageTimers.push_back(AverageTimer("Prediction Merge"));
+  m_stageTimers.push_back(AverageTimer("RANSAC"));
+
   // Instantiate the sub-algorithms.
   m_featureCalculator = FeatureCalculatorFactory::make_da_rgbd_patch_feature_calculator(deviceType);
   m_lowLevelEngine.reset(ITMLowLevelEngineFactory::MakeLowLevelEngine(deviceType));
   m_scoreForest = DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_forest(forestFilename, deviceType);
   m_reservoirCount = m_scoreForest->get_nb_leaves();
   m_exampleClusterer = ExampleClustererFactory<ExampleType,ClusterType,PredictionType::Capacity>::make_clusterer(
-    m_clustererSigma, m_clustererTau, m_maxClusterCount, m_minClusterSize, deviceType
+    m_clustererSigma, m_clustererTau, m_maxClusterCount, m_minClusterSize, deviceType, clustererUseGrid
   );
   m_preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(settings, deviceType);
 
@@ -126,19 +149,28 @@ ScoreRelocaliserState_CPtr ScoreRelocaliser::get_relocaliser_state() const
   return m_relocaliserState;
 }
 
+const ScoreRelocaliser::AverageTimer& ScoreRelocaliser::get_stage_timer(Stage stage) const
+{
+  if(stage < 0 || stage >= STAGE_COUNT) throw std::invalid_argument("Error: Invalid relocaliser stage");
+  return m_stageTimers[stage];
+}
+
 std::vector<Keypoint3DColour> ScoreRelocaliser::get_reservoir_contents(uint32_t treeIdx, uint32_t leafIdx) const
 {
   // Ensure that the specified leaf is valid (throw if not).
   ensure_valid_leaf(treeIdx, leafIdx);
 
-  // Look up the size of the reservoir associated with the leaf.
+  // Look up the reservoir associated with the leaf and its size.
   const MemoryDeviceType memoryType = m_deviceType == DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU;
   const uint32_t linearReservoirIdx = leafIdx * m_scoreForest->get_nb_trees() + treeIdx;
-  const uint32_t reservoirSize = m_relocaliserState->exampleReservoirs->get_reservoir_sizes()->GetElement(linearReservoirIdx, memoryType);
+  Reservoirs::ReservoirsImage_CPtr reservoirs;
+  ITMIntMemoryBlock_CPtr reservoirSizes;
+  const uint32_t rowIdx = m_relocaliserState->exampleReservoirs->get_reservoir_range(linearReservoirIdx, 1, reservoirs, reservoirSizes);
+  const uint32_t reservoirSize = reservoirSizes->GetElement(rowIdx, memoryType);
 
   // Copy the contents of the reservoir into a suitably-sized buffer and return it.
-  if(m_deviceType == DEVICE_CUDA) m_relocaliserState->exampleReservoirs->get_reservoirs()->UpdateHostFromDevice();
-  const Keypoint3DColour *reservoirsData = m_relocaliserState->exampleReservoirs->get_reservoirs()->GetData(MEMORYDEVICE_CPU);
+  if(m_deviceType == DEVICE_CUDA) reservoirs->UpdateHostFromDevice();
+  const Keypoint3DColour *reservoirsData = reservoirs->GetData(MEMORYDEVICE_CPU);
   const uint32_t reservoirCapacity = m_relocaliserState->exampleReservoirs->get_reservoir_capacity();
 
   std::vector<Keypoint3DColour> reservoirContents;
@@ -146,7 +178,7 @@ std::vector<Keypoint3DColour> ScoreRelocaliser::get_reservoir_contents(uint32_t
 
   for(uint32_t i = 0; i < reservoirSize; ++i)
   {
-    reservoirContents.push_back(reservoirsData[linearReservoirIdx * reservoirCapacity + i]);
+    reservoirContents.push_back(reservoirsData[rowIdx * reservoirCapacity + i]);
   }
 
   return reservoirContents;
@@ -166,17 +198,25 @@ std::vector<Relocaliser::Result> ScoreRelocaliser::relocalise(const ITMUChar4Ima
   if(m_lowLevelEngine->CountValidDepths(depthImage) > m_preemptiveRansac->get_min_nb_required_points())
   {
     // Step 1: Extract keypoints from the RGB-D image and compute descriptors for them.
+    start_timer(STAGE_FEATURES);
     m_featureCalculator->compute_keypoints_and_features(colourImage, depthImage, depthIntrinsics, m_keypointsImage.get(), m_descriptorsImage.get());
+    stop_timer(STAGE_FEATURES);
 
     // Step 2: Find all of the leaves in the forest that are associated with the descriptors for the keypoints.
+    start_timer(STAGE_LEAFLOOKUP);
     m_scoreForest->find_leaves(m_descriptorsImage, m_leafIndicesImage);
+    stop_timer(STAGE_LEAFLOOKUP);
 
     // Step 3: Merge the SCoRe predictions (sets of clusters) associated with each keypoint to create a single
     //         SCoRe prediction (a single set of clusters) for each keypoint.
+    start_timer(STAGE_PREDICTIONMERGE);
     merge_predictions_for_keypoints(m_leafIndicesImage, m_predictionsImage);
+    stop_timer(STAGE_PREDICTIONMERGE);
 
     // Step 4: Perform P-RANSAC to try to estimate the camera pose.
+    start_timer(STAGE_RANSAC);
     boost::optional<PoseCandidate> poseCandidate = m_preemptiveRansac->estimate_pose(m_keypointsImage, m_predictionsImage);
+    stop_timer(STAGE_RANSAC);
 
     // Step 5: If we succeeded in estimated a camera pose:
     if(poseCandidate)
@@ -217,7 +257,9 @@ void ScoreRelocaliser::reset()
   // Set up the reservoirs if they haven't been allocated yet.
   if(!m_relocaliserState->exampleReservoirs)
   {
-    m_relocaliserState->exampleReservoirs = ExampleReservoirsFactory<ExampleType>::make_reservoirs(m_reservoirCount, m_reservoirCapacity, m_deviceType, m_rngSeed);
+    m_relocaliserState->exampleReservoirs = ExampleReservoirsFactory<ExampleType>::make_reservoirs(
+      m_reservoirCount, m_reservoirCapacity, m_deviceType, m_rngSeed, m_reservoirPageCapacity
+    );
   }
 
   // Set up the predictions block if it hasn't been allocated yet.
@@ -256,20 +298,22 @@ void ScoreRelocaliser::train(const ITMUChar4Image *colourImage, const ITMFloatIm
 
   // Step 1: Extract keypoints from the RGB-D image and compute descriptors for them.
   const Matrix4f invCameraPose = cameraPose.GetInvM();
+  start_timer(STAGE_FEATURES);
   m_featureCalculator->compute_keypoints_and_features(colourImage, depthImage, invCameraPose, depthIntrinsics, m_keypointsImage.get(), m_descriptorsImage.get());
+  stop_timer(STAGE_FEATURES);
 
   // Step 2: Find all of the leaves in the forest that are associated with the descriptors for the keypoints.
+  start_timer(STAGE_LEAFLOOKUP);
   m_scoreForest->find_leaves(m_descriptorsImage, m_leafIndicesImage);
+  stop_timer(STAGE_LEAFLOOKUP);
 
   // Step 3: Add the keypoints to the relevant reservoirs.
+  start_timer(STAGE_RESERVOIRUPDATE);
   m_relocaliserState->exampleReservoirs->add_examples(m_keypointsImage, m_leafIndicesImage);
+  stop_timer(STAGE_RESERVOIRUPDATE);
 
   // Step 4: Cluster some of the reservoirs.
-  const uint32_t nbReservoirsToUpdate = compute_nb_reservoirs_to_update();
-  m_exampleClusterer->cluster_examples(
-    m_relocaliserState->exampleReservoirs->get_reservoirs(), m_relocaliserState->exampleReservoirs->get_reservoir_sizes(),
-    m_relocaliserState->reservoirUpdateStartIdx, nbReservoirsToUpdate, m_relocaliserState->predictionsBlock
-  );
+  cluster_reservoirs(compute_nb_reservoirs_to_update());
 
   // Step 5: Store the index of the first reservoir that was just updated so that we can tell when there are no more clusters to update.
   m_relocaliserState->lastExamplesAddedStartIdx = m_relocaliserState->reservoirUpdateStartIdx;
@@ -292,11 +336,7 @@ void ScoreRelocaliser::update()
 
   // Otherwise, cluster the next batch of reservoirs, and update the index of the first reservoir to subject to
   // clustering during the next train/update call.
-  const uint32_t updateCount = compute_nb_reservoirs_to_update();
-  m_exampleClusterer->cluster_examples(
-    m_relocaliserState->exampleReservoirs->get_reservoirs(), m_relocaliserState->exampleReservoirs->get_reservoir_sizes(),
-    m_relocaliserState->reservoirUpdateStartIdx, updateCount, m_relocaliserState->predictionsBlock
-  );
+  cluster_reservoirs(compute_nb_reservoirs_to_update());
 
   update_reservoir_start_idx();
 }
@@ -312,6 +352,22 @@ void ScoreRelocaliser::update_all_clusters()
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+void ScoreRelocaliser::cluster_reservoirs(uint32_t reservoirCount)
+{
+  start_timer(STAGE_CLUSTERING);
+
+  const uint32_t startIdx = m_relocaliserState->reservoirUpdateStartIdx;
+
+  // Get the examples in the reservoirs (gathering them into a dense image first if the reservoirs are paged), and cluster them.
+  Reservoirs::ReservoirsImage_CPtr reservoirs;
+  ITMIntMemoryBlock_CPtr reservoirSizes;
+  const uint32_t rowIdx = m_relocaliserState->exampleReservoirs->get_reservoir_range(startIdx, reservoirCount, reservoirs, reservoirSizes);
+
+  m_exampleClusterer->cluster_examples(reservoirs, reservoirSizes, rowIdx, reservoirCount, m_relocaliserState->predictionsBlock, startIdx);
+
+  stop_timer(STAGE_CLUSTERING);
+}
+
 uint32_t ScoreRelocaliser::compute_nb_reservoirs_to_update() const
 {
   // Either the standard number of reservoirs to update, or the number remaining before the end of the memory block.
@@ -326,6 +382,28 @@ void ScoreRelocaliser::ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) con
   }
 }
 
+void ScoreRelocaliser::start_timer(Stage stage) const
+{
+  if(!m_timersEnabled) return;
+
+#ifdef WITH_CUDA
+  if(m_deviceType == DEVICE_CUDA) ORcudaSafeCall(cudaDeviceSynchronize());
+#endif
+
+  m_stageTimers[stage].start();
+}
+
+void ScoreRelocaliser::stop_timer(Stage stage) const
+{
+  if(!m_timersEnabled) return;
+
+#ifdef WITH_CUDA
+  if(m_deviceType == DEVICE_CUDA) ORcudaSafeCall(cudaDeviceSynchronize());
+#endif
+
+  m_stageTimers[stage].stop();
+}
+
 void ScoreRelocaliser::update_reservoir_start_idx()
 {
   m_relocaliserState->reservoirUpdateStartIdx += m_maxReservoirsToUpdate;
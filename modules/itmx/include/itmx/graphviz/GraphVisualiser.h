@@ -6,7 +6,13 @@
 #ifndef H_ITMX_GRAPHVISUALISER
 #define H_ITMX_GRAPHVISUALISER
 
+#include <iosfwd>
+#include <list>
+#include <map>
+
+#include <boost/chrono/duration.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 #include <boost/thread.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 
@@ -16,6 +22,11 @@ namespace itmx {
 
 /**
  * \brief An instance of this class can be used to generate graph visualisations using Graphviz.
+ *
+ * Generated visualisations are cached (with least-recently-used eviction), keyed on a hash of the graph description and
+ * the Graphviz executable used, so that repeatedly visualising the same graph does not repeatedly invoke Graphviz.
+ * Visualisations can either be generated synchronously, or requested asynchronously, in which case the most recently
+ * generated visualisation is returned immediately whilst the new one is generated on a background thread.
  */
 class GraphVisualiser
 {
@@ -30,26 +41,182 @@ public:
     GV_NEATO
   };
 
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct contains statistics about the effectiveness of a graph visualiser's cache.
+   */
+  struct Statistics
+  {
+    /** The average time taken to run Graphviz and decode its output (0 if Graphviz has not yet been run). */
+    boost::chrono::microseconds averageRenderTime;
+
+    /** The number of visualisations that were found in the cache. */
+    size_t hitCount;
+
+    /** The number of visualisations that were not found in the cache. */
+    size_t missCount;
+
+    /** The number of times Graphviz has been run. */
+    size_t renderCount;
+  };
+
+private:
+  /**
+   * \brief An instance of this struct represents a request to visualise a graph.
+   */
+  struct Request
+  {
+    /** The graph description. */
+    std::string graphDesc;
+
+    /** The Graphviz executable to use. */
+    GraphvizExe graphvizExe;
+
+    /** The hash of the graph description and the Graphviz executable. */
+    size_t hash;
+
+    Request(const std::string& graphDesc_, GraphvizExe graphvizExe_);
+
+    bool operator==(const Request& rhs) const;
+  };
+
+  /**
+   * \brief An instance of this struct represents an entry in the cache.
+   */
+  struct CacheEntry
+  {
+    /** The request whose visualisation is stored in the entry. */
+    Request request;
+
+    /** The visualisation. */
+    ITMUChar4Image_CPtr image;
+
+    CacheEntry(const Request& request_, const ITMUChar4Image_CPtr& image_);
+  };
+
+  //#################### TYPEDEFS ####################
+private:
+  typedef std::list<CacheEntry> CacheList;
+
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The asynchronous request currently being processed by the worker thread (if any). */
+  boost::optional<Request> m_activeRequest;
+
+  /** The cache entries, in order from most to least recently used. */
+  CacheList m_cache;
+
+  /** A map from request hashes to the corresponding cache entries. */
+  std::map<size_t,CacheList::iterator> m_cacheIndex;
+
   /** The random number generator needed for creating UUIDs. */
   boost::uuids::random_generator m_gen;
 
+  /** The number of visualisations that were found in the cache. */
+  size_t m_hitCount;
+
+  /** The most recently generated visualisation (if any). */
+  ITMUChar4Image_CPtr m_latestImage;
+
+  /** The maximum number of visualisations to store in the cache. */
+  size_t m_maxCacheSize;
+
+  /** The number of visualisations that were not found in the cache. */
+  size_t m_missCount;
+
   /** The synchronisation mutex. */
-  boost::mutex m_mutex;
+  mutable boost::mutex m_mutex;
+
+  /** The most recent asynchronous request that has not yet been started by the worker thread (if any). */
+  boost::optional<Request> m_pendingRequest;
+
+  /** The number of times Graphviz has been run. */
+  size_t m_renderCount;
+
+  /** A condition variable used to wake the worker thread when an asynchronous request is made (or the visualiser is being destroyed). */
+  boost::condition_variable m_requestReady;
+
+  /** A flag used to tell the worker thread to terminate. */
+  bool m_terminate;
+
+  /** The total time spent running Graphviz and decoding its output. */
+  boost::chrono::microseconds m_totalRenderTime;
+
+  /** Whether or not to communicate with Graphviz via temporary files rather than pipes. */
+  bool m_useTempFiles;
+
+  /** The worker thread used to generate visualisations asynchronously (created on the first asynchronous request). */
+  boost::shared_ptr<boost::thread> m_workerThread;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a graph visualiser.
+   *
+   * \param maxCacheSize  The maximum number of visualisations to store in the cache.
+   * \param useTempFiles  Whether or not to communicate with Graphviz via temporary files rather than pipes (pipes are not supported on Windows).
+   */
+  explicit GraphVisualiser(size_t maxCacheSize = 16, bool useTempFiles = false);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the graph visualiser.
+   */
+  ~GraphVisualiser();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  GraphVisualiser(const GraphVisualiser&);
+  GraphVisualiser& operator=(const GraphVisualiser&);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
-   * \brief Generates a graph visualisation by running a Graphviz executable on the specified graph description.
+   * \brief Generates a graph visualisation by running a Graphviz executable on the specified graph description
+   *        (or by looking it up in the cache, if the same graph has recently been visualised).
+   *
+   * \param graphDesc           The graph description (i.e. the contents of the Graphviz source file).
+   * \param graphvizExe         The Graphviz executable to use.
+   * \return                    The graph visualisation.
+   * \throws std::runtime_error If Graphviz fails.
+   */
+  ITMUChar4Image_CPtr generate_visualisation(const std::string& graphDesc, GraphvizExe graphvizExe = GV_NEATO);
+
+  /**
+   * \brief Gets statistics about the effectiveness of the cache.
+   *
+   * \return  Statistics about the effectiveness of the cache.
+   */
+  Statistics get_statistics() const;
+
+  /**
+   * \brief Requests a graph visualisation without waiting for it to be generated.
+   *
+   * If the visualisation is in the cache, it is returned immediately. If not, it is generated on a background thread
+   * (superseding any earlier request that has not yet been started), and the most recently generated visualisation
+   * is returned in the meantime.
    *
    * \param graphDesc   The graph description (i.e. the contents of the Graphviz source file).
    * \param graphvizExe The Graphviz executable to use.
+   * \return            The requested visualisation, if it is in the cache, or else the most recently generated visualisation (if any).
    */
-  ITMUChar4Image_Ptr generate_visualisation(const std::string& graphDesc, GraphvizExe graphvizExe = GV_NEATO);
+  ITMUChar4Image_CPtr request_visualisation(const std::string& graphDesc, GraphvizExe graphvizExe = GV_NEATO);
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Adds a visualisation to the cache, evicting the least recently used visualisation if the cache is full.
+   *
+   * \note The caller must hold the synchronisation mutex.
+   *
+   * \param request The request whose visualisation is to be added.
+   * \param image   The visualisation.
+   */
+  void add_to_cache(const Request& request, const ITMUChar4Image_CPtr& image);
+
   /**
    * \brief Gets the path to the specified Graphviz executable.
    *
@@ -58,14 +225,64 @@ private:
    */
   boost::filesystem::path get_path(GraphvizExe graphvizExe) const;
 
+  /**
+   * \brief Looks up the visualisation for the specified request in the cache (marking it as the most recently used, if found).
+   *
+   * \note The caller must hold the synchronisation mutex.
+   *
+   * \param request The request.
+   * \return        The visualisation, if it is in the cache, or NULL otherwise.
+   */
+  ITMUChar4Image_CPtr look_up(const Request& request);
+
   /**
    * \brief Makes a UUID.
    *
    * \return  The UUID (in string form).
    */
   std::string make_uuid();
+
+  /**
+   * \brief Runs Graphviz to generate the visualisation for the specified request, and adds it to the cache.
+   *
+   * \param request The request.
+   * \return        The visualisation.
+   */
+  ITMUChar4Image_CPtr render(const Request& request);
+
+  /**
+   * \brief Runs Graphviz on the specified request, communicating with it via pipes.
+   *
+   * \param request The request.
+   * \return        The PNG-encoded visualisation.
+   */
+  std::vector<unsigned char> run_graphviz_via_pipes(const Request& request) const;
+
+  /**
+   * \brief Runs Graphviz on the specified request, communicating with it via temporary files.
+   *
+   * \param request The request.
+   * \return        The visualisation.
+   */
+  ITMUChar4Image_Ptr run_graphviz_via_temp_files(const Request& request);
+
+  /**
+   * \brief Generates visualisations for asynchronous requests until the visualiser is destroyed.
+   */
+  void run_worker();
 };
 
+//#################### STREAM OPERATORS ####################
+
+/**
+ * \brief Outputs statistics about the effectiveness of a graph visualiser's cache to a stream.
+ *
+ * \param os    The stream.
+ * \param stats The statistics.
+ * \return      The stream.
+ */
+std::ostream& operator<<(std::ostream& os, const GraphVisualiser::Statistics& stats);
+
 }
 
 #endif
@@ -6,8 +6,12 @@
 #ifndef H_ITMX_ASYNCIMAGESOURCEENGINE
 #define H_ITMX_ASYNCIMAGESOURCEENGINE
 
+#include <map>
+#include <ostream>
 #include <queue>
 
+#include <boost/chrono/chrono.hpp>
+#include <boost/function.hpp>
 #include <boost/thread.hpp>
 
 #include "../base/ITMImagePtrTypes.h"
@@ -19,10 +23,58 @@ namespace itmx {
  * \brief An instance of this class can be used to read RGB-D images asynchronously from an existing image source.
  *        Images are read from the existing source on a separate thread and stored in an in-memory queue. This
  *        leads to lower latency when processing a disk sequence.
+ *
+ * If a frame loader (a function that can load an arbitrary frame of the sequence) is provided, the images are
+ * instead decoded by several worker threads at once: the workers load frames k, k+1, ... concurrently into
+ * pooled images, and the images are then handed to the consumer strictly in order. The number of frames that
+ * can be in flight (i.e. claimed by a worker but not yet consumed) is bounded by the queue capacity. If no
+ * frame loader is provided (e.g. because the existing source cannot seek), a single thread reads the images
+ * sequentially from the existing source.
  */
 class AsyncImageSourceEngine : public InputSource::ImageSourceEngine
 {
+  //#################### TYPEDEFS ####################
+public:
+  /**
+   * A function that can be used to load the specified frame of a sequence into the specified images. It should return
+   * false if the frame does not exist (i.e. it is beyond the end of the sequence), and must be safe to call concurrently.
+   */
+  typedef boost::function<bool(int,ITMUChar4Image*,ITMShortImage*)> FrameLoader;
+
   //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct contains statistics about the prefetching performed by the image source.
+   */
+  struct PrefetchStats
+  {
+    /** The number of frames that have been loaded (by either the workers or the single image grabber). */
+    size_t framesLoaded;
+
+    /** The total time spent loading frames (summed over all threads). */
+    boost::chrono::microseconds totalLoadTime;
+
+    /** The longest time spent loading a single frame. */
+    boost::chrono::microseconds maxLoadTime;
+
+    /** The number of frames that have been handed to the consumer. */
+    size_t framesDelivered;
+
+    /** The number of ready frames that were waiting in the queue when each frame was handed to the consumer, summed over all frames delivered. */
+    size_t totalQueueOccupancy;
+
+    /** The largest number of ready frames that have ever been waiting in the queue. */
+    size_t maxQueueOccupancy;
+
+    /** The number of times the consumer has had to wait for the next frame to become available. */
+    size_t consumerStalls;
+
+    /** The total time the consumer has spent waiting for frames to become available. */
+    boost::chrono::microseconds totalStallTime;
+
+    PrefetchStats();
+  };
+
 private:
   /**
    * \brief An instance of this struct can be used to represent an RGB-D image.
@@ -41,46 +93,80 @@ private:
 
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The thread on which images are grabbed from the existing image source. */
-  boost::thread m_grabber;
+  /** The number of the first frame that is known not to exist (INT_MAX until the end of the sequence has been found). */
+  int m_endFrame;
 
-  /** A flag set in the destructor to indicate that the image grabber should terminate. */
-  bool m_grabberShouldTerminate;
+  /** The function used to load frames by number (if any). */
+  FrameLoader m_frameLoader;
 
   /** The image source from which to obtain the images to cache. */
   ImageSourceEngine_Ptr m_innerSource;
 
+  /** The mutex used to synchronise access to the inner source. */
+  mutable boost::mutex m_innerSourceMutex;
+
   /** The synchronisation mutex. */
   mutable boost::mutex m_mutex;
 
+  /** The number of the next frame to be claimed by a worker (or by the image grabber). */
+  int m_nextFrameToClaim;
+
+  /** The number of the next frame to be handed to the consumer. */
+  int m_nextFrameToDeliver;
+
   /** A pool of reusable RGB-D images. */
   std::queue<RGBDImage> m_pool;
 
   /** The maximum number of elements that can be stored in the RGB-D image pool. */
   size_t m_poolCapacity;
 
-  /** A queue in which to cache images from the inner source. */
-  std::queue<RGBDImage> m_queue;
+  /** Whether or not to output the prefetching statistics when the image source is destroyed. */
+  bool m_printStatsOnDestruction;
 
-  /** The maximum number of images to cache. */
+  /** The maximum number of frames that can be in flight at once (i.e. claimed, but not yet handed to the consumer). */
   size_t m_queueCapacity;
 
-  /** A condition variable used to wait for elements to be added to the queue. */
+  /** A condition variable used to wait for the next frame to be handed to the consumer to become available. */
   mutable boost::condition_variable m_queueNotEmpty;
 
-  /** A condition variable used to wait for elements to be removed from the queue. */
+  /** A condition variable used to wait for frames to be handed to the consumer. */
   boost::condition_variable m_queueNotFull;
 
+  /** The frames that have been loaded but not yet handed to the consumer, indexed by frame number. */
+  std::map<int,RGBDImage> m_readyFrames;
+
+  /** Statistics about the prefetching performed by the image source. */
+  mutable PrefetchStats m_stats;
+
+  /** A flag set in the destructor to indicate that the workers (or the image grabber) should terminate. */
+  bool m_workersShouldTerminate;
+
+  /** The threads on which images are loaded (either the workers, or the single image grabber). */
+  boost::thread_group m_workers;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
-   * \brief Constructs an asynchronous image source engine.
+   * \brief Constructs an asynchronous image source engine that reads images sequentially from an existing image source on a single thread.
    *
    * \param innerSource   The image source from which to obtain the images to cache.
    * \param queueCapacity The maximum number of images to cache (0 means no limit).
    */
   explicit AsyncImageSourceEngine(ImageSourceEngine *innerSource, size_t queueCapacity = 0);
 
+  /**
+   * \brief Constructs an asynchronous image source engine that loads images on several worker threads at once.
+   *
+   * \note  The inner source is used to provide the calibration and the initial image sizes, but its images are never read.
+   *
+   * \param innerSource         The image source describing the sequence.
+   * \param frameLoader         The function to use to load frames by number.
+   * \param initialFrameNumber  The number of the first frame to load.
+   * \param queueCapacity       The maximum number of frames that can be in flight at once (0 means no limit).
+   * \param workerCount         The number of worker threads to use (0 means one per hardware thread).
+   */
+  AsyncImageSourceEngine(ImageSourceEngine *innerSource, const FrameLoader& frameLoader, int initialFrameNumber, size_t queueCapacity = 0, size_t workerCount = 0);
+
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -99,20 +185,78 @@ public:
   /** Override */
   virtual void getImages(ITMUChar4Image *rgb, ITMShortImage *rawDepth);
 
+  /**
+   * \brief Gets statistics about the prefetching performed by the image source.
+   *
+   * \return  Statistics about the prefetching performed by the image source.
+   */
+  PrefetchStats get_prefetch_stats() const;
+
   /** Override */
   virtual Vector2i getRGBImageSize() const;
 
   /** Override */
   virtual bool hasMoreImages() const;
 
+  /**
+   * \brief Sets whether or not to output the prefetching statistics (to std::cout) when the image source is destroyed.
+   *
+   * \param printStatsOnDestruction  Whether or not to output the prefetching statistics when the image source is destroyed.
+   */
+  void set_print_stats_on_destruction(bool printStatsOnDestruction);
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Runs the image grabber.
+   * \brief Waits until a frame can be claimed, and then claims it.
+   *
+   * \param lock        A lock on the synchronisation mutex.
+   * \param frameNumber A location into which to store the number of the claimed frame.
+   * \param rgbdImage   A location into which to store a pooled RGB-D image into which to load the frame.
+   * \return            true, if a frame was claimed, or false if the thread should terminate.
+   */
+  bool claim_frame(boost::unique_lock<boost::mutex>& lock, int& frameNumber, RGBDImage& rgbdImage);
+
+  /**
+   * \brief Fills the RGB-D image pool, to avoid allocating memory at runtime.
+   *
+   * \note  The images are sized using the image sizes reported by the inner source. We deliberately avoid asking the inner source
+   *        whether it has any images, since for some sources this involves decoding a frame.
+   */
+  void fill_pool();
+
+  /**
+   * \brief Records the result of loading a frame, and wakes any threads that may be waiting for it.
+   *
+   * \param frameNumber The number of the frame.
+   * \param rgbdImage   The RGB-D image into which the frame was loaded.
+   * \param loaded      Whether or not the frame was successfully loaded (if not, it is taken to mark the end of the sequence).
+   * \param loadTime    The time spent loading the frame.
+   */
+  void finish_frame(int frameNumber, const RGBDImage& rgbdImage, bool loaded, boost::chrono::microseconds loadTime);
+
+  /**
+   * \brief Runs the image grabber, which reads images sequentially from the inner source.
    */
   void run_image_grabber();
+
+  /**
+   * \brief Runs a worker, which loads frames by number using the frame loader.
+   */
+  void run_worker();
 };
 
+//#################### STREAM OPERATORS ####################
+
+/**
+ * \brief Outputs statistics about the prefetching performed by an asynchronous image source to a stream.
+ *
+ * \param os    The stream.
+ * \param stats The statistics.
+ * \return      The stream.
+ */
+std::ostream& operator<<(std::ostream& os, const AsyncImageSourceEngine::PrefetchStats& stats);
+
 }
 
 #endif
@@ -204,6 +204,18 @@ public:
    */
   static cv::Mat3b make_rgb_image(const Vector4u *rgbaData, int width, int height);
 
+  /**
+   * \brief Makes an RGB image from a rectangular region of some RGBA pixel data.
+   *
+   * Note: The alpha channel is discarded during this process.
+   *
+   * \param rgbaData  The pixel data for the whole image, in the format [(R1,G1,B1,A1),(R2,G2,B2,A2),...].
+   * \param width     The width of the whole image.
+   * \param roi       The region of the whole image to use (must lie within the image).
+   * \return          The image.
+   */
+  static cv::Mat3b make_rgb_image(const Vector4u *rgbaData, int width, const cv::Rect& roi);
+
   /**
    * \brief Makes a copy of an RGB image that has been padded with a black border.
    *
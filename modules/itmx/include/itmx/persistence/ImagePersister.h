@@ -37,6 +37,16 @@ public:
 
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Decodes a buffer in RGBA PNG format into an image.
+   *
+   * \param buffer              The buffer to decode.
+   * \param path                The name of the file from which the buffer was originally loaded (if known).
+   * \return                    The decoded image.
+   * \throws std::runtime_error If the buffer could not be decoded.
+   */
+  static ITMUChar4Image_Ptr decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path);
+
   /**
    * \brief Attempts to load an RGBA image from a file.
    *
@@ -95,7 +105,7 @@ public:
   static void save_image_on_thread(const boost::shared_ptr<const ORUtils::Image<T> >& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN)
   {
     void (*p)(const boost::shared_ptr<const ORUtils::Image<T> >&, const std::string&, ImageFileType) = &save_image;
-    tvgutil::ThreadPool::instance().post_task(boost::bind(p, image, path, fileType));
+    tvgutil::ThreadPool::instance().post_task(boost::bind(p, image, path, fileType), tvgutil::thread_pool::TP_BACKGROUND);
   }
 
   /**
@@ -130,15 +140,6 @@ public:
 
   //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 private:
-  /**
-   * \brief Decodes a buffer in RGBA PNG format into an image.
-   *
-   * \param buffer  The buffer to decode.
-   * \param path    The name of the file from which the buffer was originally loaded (if known).
-   * \return        The decoded image.
-   */
-  static ITMUChar4Image_Ptr decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path);
-
   /**
    * \brief Attempts to deduce an image file's type based on its file extension.
    *
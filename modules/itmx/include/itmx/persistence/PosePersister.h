@@ -15,12 +15,34 @@
 namespace itmx {
 
 /**
- * \brief This class contains utility functions for saving camera poses.
+ * \brief This class contains utility functions for loading and saving camera poses.
  */
 class PosePersister
 {
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Attempts to load a camera pose from a file.
+   *
+   * \note The file must be in the format written by save_pose (four lines, each containing one row of the matrix).
+   *
+   * \param path                The path to the file from which to load the pose.
+   * \return                    The loaded pose matrix.
+   * \throws std::runtime_error If the pose could not be loaded.
+   */
+  static Matrix4f load_pose(const std::string& path);
+
+  /**
+   * \brief Attempts to load a camera pose from a file.
+   *
+   * \note The file must be in the format written by save_pose (four lines, each containing one row of the matrix).
+   *
+   * \param path                The path to the file from which to load the pose.
+   * \return                    The loaded pose matrix.
+   * \throws std::runtime_error If the pose could not be loaded.
+   */
+  static Matrix4f load_pose(const boost::filesystem::path& path);
+
   /**
    * \brief Attempts to save a camera pose to a file.
    *
@@ -20,6 +20,10 @@ public:
   /** Override */
   virtual bool pick(int x, int y, const ITMLib::ITMRenderState *renderState, ORUtils::MemoryBlock<Vector3f>& pickPointsMB, size_t offset) const;
 
+  /** Override */
+  virtual void pick(const ORUtils::MemoryBlock<Vector2i>& pointsMB, const ITMLib::ITMRenderState *renderState,
+                    ORUtils::MemoryBlock<Vector3f>& pickPointsMB, ORUtils::MemoryBlock<bool>& pickPointsValidMB) const;
+
   /** Override */
   virtual void to_short(const ORUtils::MemoryBlock<Vector3f>& pickPointsFloatMB, ORUtils::MemoryBlock<Vector3s>& pickPointsShortMB) const;
 };
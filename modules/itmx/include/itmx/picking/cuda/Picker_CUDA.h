@@ -7,6 +7,7 @@
 #define H_ITMX_PICKER_CUDA
 
 #include "../interface/Picker.h"
+#include "../../base/ITMMemoryBlockPtrTypes.h"
 
 namespace itmx {
 
@@ -15,11 +16,27 @@ namespace itmx {
  */
 class Picker_CUDA : public Picker
 {
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A memory block into which to write whether or not a single-point pick hit the scene (one per picker, rather than one shared by all pickers). */
+  ITMBoolMemoryBlock_Ptr m_pickPointValidMB;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a CUDA-based picker.
+   */
+  Picker_CUDA();
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /** Override */
   virtual bool pick(int x, int y, const ITMLib::ITMRenderState *renderState, ORUtils::MemoryBlock<Vector3f>& pickPointsMB, size_t offset) const;
 
+  /** Override */
+  virtual void pick(const ORUtils::MemoryBlock<Vector2i>& pointsMB, const ITMLib::ITMRenderState *renderState,
+                    ORUtils::MemoryBlock<Vector3f>& pickPointsMB, ORUtils::MemoryBlock<bool>& pickPointsValidMB) const;
+
   /** Override */
   virtual void to_short(const ORUtils::MemoryBlock<Vector3f>& pickPointsFloatMB, ORUtils::MemoryBlock<Vector3s>& pickPointsShortMB) const;
 };
@@ -15,7 +15,7 @@
 namespace itmx {
 
 /**
- * \brief An instance of a class deriving from this one can be used to pick an individual point in the scene.
+ * \brief An instance of a class deriving from this one can be used to pick individual points in the scene.
  */
 class Picker
 {
@@ -41,6 +41,25 @@ public:
    */
   virtual bool pick(int x, int y, const ITMLib::ITMRenderState *renderState, ORUtils::MemoryBlock<Vector3f>& pickPointsMB, size_t offset = 0) const = 0;
 
+  /**
+   * \brief Determines the nearest scene points (if any) that would be hit by rays cast through a batch of points on the image plane
+   *        when viewed from the camera pose with the specified render state.
+   *
+   * This is equivalent to calling the single-point version of pick for each point in turn (writing the pick point for the i'th point
+   * into the i'th element of the memory block), but picks all of the points at once (in parallel), and so is much cheaper when there
+   * are many points to pick (e.g. for multi-touch). Points that are outside the image plane are treated as misses.
+   *
+   * \param pointsMB          A memory block containing the points on the image plane through which the rays are cast.
+   * \param renderState       A render state corresponding to the camera pose.
+   * \param pickPointsMB      A memory block into which to write the voxel coordinates of the nearest scene point (if any) that is hit
+   *                          by each ray. Element i corresponds to point i, and is only meaningful if the ray through point i hit the scene.
+   * \param pickPointsValidMB A memory block into which to write a flag for each point indicating whether or not its ray hit the scene.
+   *
+   * \throws std::runtime_error If either pickPointsMB or pickPointsValidMB is smaller than pointsMB.
+   */
+  virtual void pick(const ORUtils::MemoryBlock<Vector2i>& pointsMB, const ITMLib::ITMRenderState *renderState,
+                    ORUtils::MemoryBlock<Vector3f>& pickPointsMB, ORUtils::MemoryBlock<bool>& pickPointsValidMB) const = 0;
+
   /**
    * \brief Converts one or more pick points in Vector3f format into Vector3s format.
    *
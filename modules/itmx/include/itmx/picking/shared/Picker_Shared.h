@@ -28,6 +28,25 @@ inline bool get_pick_point(int x, int y, int width, const Vector4f *pointImage,
   return p.w > 0;
 }
 
+/**
+ * \brief Gets the scene point (if any) that would be picked by clicking at one of a batch of locations on the image plane.
+ *
+ * \param pointIdx        The index of the location in the batch.
+ * \param points          The locations clicked.
+ * \param width           The width of the viewing area on the image plane.
+ * \param height          The height of the viewing area on the image plane.
+ * \param pointImage      An image specifying the scene points that would be picked for every pixel on the image plane.
+ * \param pickPoints      An array in which to store the scene point (if any) that is picked for each location.
+ * \param pickPointsValid An array in which to store whether or not a scene point was picked for each location.
+ */
+_CPU_AND_GPU_CODE_
+inline void get_pick_point(int pointIdx, const Vector2i *points, int width, int height, const Vector4f *pointImage, Vector3f *pickPoints, bool *pickPointsValid)
+{
+  const Vector2i& p = points[pointIdx];
+  const bool inImage = p.x >= 0 && p.x < width && p.y >= 0 && p.y < height;
+  pickPointsValid[pointIdx] = inImage && get_pick_point(p.x, p.y, width, pointImage, pickPoints[pointIdx]);
+}
+
 }
 
 #endif
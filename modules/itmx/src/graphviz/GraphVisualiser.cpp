@@ -6,11 +6,23 @@
 #include "graphviz/GraphVisualiser.h"
 
 #include <fstream>
+#include <iostream>
 
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
 #include <tvgutil/filesystem/PathFinder.h>
+#include <tvgutil/timing/Timer.h>
 using namespace tvgutil;
 
 #include "persistence/ImagePersister.h"
@@ -27,9 +39,311 @@ namespace bf = boost::filesystem;
 
 namespace itmx {
 
+//#################### LOCAL FUNCTIONS ####################
+
+#ifndef _WIN32
+/**
+ * \brief Makes a pipe whose file descriptors are closed automatically in any child process that calls exec.
+ *
+ * This stops the pipe being inherited by processes that are forked concurrently by other threads, which would otherwise keep the
+ * pipe open after we close our ends of it (e.g. stopping a Graphviz process that is reading from it from ever seeing end-of-file).
+ *
+ * \param fds An array into which to write the file descriptors for the read and write ends of the pipe.
+ * \return    0, if the pipe was successfully created, or -1 otherwise.
+ */
+static int make_cloexec_pipe(int fds[2])
+{
+#ifdef __linux__
+  // On Linux, we can create the pipe and set the flag atomically, so that there is no window in which it can be inherited.
+  return pipe2(fds, O_CLOEXEC);
+#else
+  if(pipe(fds) != 0) return -1;
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+#endif
+}
+#endif
+
+//#################### CONSTRUCTORS ####################
+
+GraphVisualiser::Request::Request(const std::string& graphDesc_, GraphvizExe graphvizExe_)
+: graphDesc(graphDesc_), graphvizExe(graphvizExe_), hash(boost::hash<std::string>()(graphDesc_))
+{
+  boost::hash_combine(hash, static_cast<int>(graphvizExe_));
+}
+
+GraphVisualiser::CacheEntry::CacheEntry(const Request& request_, const ITMUChar4Image_CPtr& image_)
+: request(request_), image(image_)
+{}
+
+GraphVisualiser::GraphVisualiser(size_t maxCacheSize, bool useTempFiles)
+: m_hitCount(0),
+  m_maxCacheSize(maxCacheSize),
+  m_missCount(0),
+  m_renderCount(0),
+  m_terminate(false),
+  m_totalRenderTime(0),
+  m_useTempFiles(useTempFiles)
+{}
+
+//#################### DESTRUCTOR ####################
+
+GraphVisualiser::~GraphVisualiser()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_terminate = true;
+  }
+
+  m_requestReady.notify_one();
+  if(m_workerThread) m_workerThread->join();
+}
+
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-ITMUChar4Image_Ptr GraphVisualiser::generate_visualisation(const std::string& graphDesc, GraphvizExe graphvizExe)
+bool GraphVisualiser::Request::operator==(const Request& rhs) const
+{
+  return hash == rhs.hash && graphvizExe == rhs.graphvizExe && graphDesc == rhs.graphDesc;
+}
+
+ITMUChar4Image_CPtr GraphVisualiser::generate_visualisation(const std::string& graphDesc, GraphvizExe graphvizExe)
+{
+  Request request(graphDesc, graphvizExe);
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    ITMUChar4Image_CPtr image = look_up(request);
+    if(image)
+    {
+      ++m_hitCount;
+      return image;
+    }
+    else ++m_missCount;
+  }
+
+  return render(request);
+}
+
+GraphVisualiser::Statistics GraphVisualiser::get_statistics() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+
+  Statistics stats;
+  stats.averageRenderTime = m_renderCount > 0 ? m_totalRenderTime / static_cast<boost::chrono::microseconds::rep>(m_renderCount) : boost::chrono::microseconds(0);
+  stats.hitCount = m_hitCount;
+  stats.missCount = m_missCount;
+  stats.renderCount = m_renderCount;
+  return stats;
+}
+
+ITMUChar4Image_CPtr GraphVisualiser::request_visualisation(const std::string& graphDesc, GraphvizExe graphvizExe)
+{
+  Request request(graphDesc, graphvizExe);
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+
+  // If the requested visualisation is in the cache, return it.
+  ITMUChar4Image_CPtr image = look_up(request);
+  if(image)
+  {
+    ++m_hitCount;
+    return image;
+  }
+
+  // Otherwise, unless the requested visualisation is already being generated, ask the worker thread to generate it
+  // (replacing any request it has not yet started), and return the most recently generated visualisation for now.
+  if(!(m_activeRequest && *m_activeRequest == request) && !(m_pendingRequest && *m_pendingRequest == request))
+  {
+    ++m_missCount;
+    m_pendingRequest = request;
+
+    if(!m_workerThread) m_workerThread.reset(new boost::thread(boost::bind(&GraphVisualiser::run_worker, this)));
+    m_requestReady.notify_one();
+  }
+
+  return m_latestImage;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void GraphVisualiser::add_to_cache(const Request& request, const ITMUChar4Image_CPtr& image)
+{
+  // If there is already an entry with the same hash (either for the same request, or for a colliding one), remove it.
+  std::map<size_t,CacheList::iterator>::iterator it = m_cacheIndex.find(request.hash);
+  if(it != m_cacheIndex.end())
+  {
+    m_cache.erase(it->second);
+    m_cacheIndex.erase(it);
+  }
+
+  // Add the new entry as the most recently used one.
+  m_cache.push_front(CacheEntry(request, image));
+  m_cacheIndex[request.hash] = m_cache.begin();
+
+  // If the cache is now over-full, evict the least recently used entry.
+  if(m_cache.size() > m_maxCacheSize)
+  {
+    m_cacheIndex.erase(m_cache.back().request.hash);
+    m_cache.pop_back();
+  }
+}
+
+bf::path GraphVisualiser::get_path(GraphvizExe graphvizExe) const
+{
+  bf::path result;
+
+  switch(graphvizExe)
+  {
+    case GV_DOT:
+      result = bf::path(STRINGIZE(GRAPHVIZ_DOT));
+      break;
+    default:
+      result = bf::path(STRINGIZE(GRAPHVIZ_NEATO));
+      break;
+  }
+
+  if(bf::exists(result)) return result;
+  else throw std::runtime_error("Error: Cannot find " + result.string());
+}
+
+ITMUChar4Image_CPtr GraphVisualiser::look_up(const Request& request)
+{
+  std::map<size_t,CacheList::iterator>::const_iterator it = m_cacheIndex.find(request.hash);
+  if(it == m_cacheIndex.end() || !(it->second->request == request)) return ITMUChar4Image_CPtr();
+
+  // Mark the entry as the most recently used one (note that splicing does not invalidate the iterator in the index).
+  m_cache.splice(m_cache.begin(), m_cache, it->second);
+  return it->second->image;
+}
+
+std::string GraphVisualiser::make_uuid()
+{
+  return boost::lexical_cast<std::string>(m_gen());
+}
+
+ITMUChar4Image_CPtr GraphVisualiser::render(const Request& request)
+{
+  Timer<boost::chrono::microseconds> timer("Render");
+
+#ifdef _WIN32
+  ITMUChar4Image_CPtr image = run_graphviz_via_temp_files(request);
+#else
+  ITMUChar4Image_CPtr image = m_useTempFiles ? run_graphviz_via_temp_files(request) : ImagePersister::decode_rgba_png(run_graphviz_via_pipes(request), "Graphviz output");
+#endif
+
+  timer.stop();
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  ++m_renderCount;
+  m_totalRenderTime += timer.duration();
+  add_to_cache(request, image);
+  m_latestImage = image;
+  return image;
+}
+
+std::vector<unsigned char> GraphVisualiser::run_graphviz_via_pipes(const Request& request) const
+{
+#ifdef _WIN32
+  throw std::runtime_error("Error: Communicating with Graphviz via pipes is not supported on Windows");
+#else
+  const std::string graphvizExePath = get_path(request.graphvizExe).string();
+
+  // Make a pipe for each direction of communication with the Graphviz process. Note that dup2 clears the close-on-exec
+  // flag on the descriptors it creates, so the child's standard input and output streams survive the call to execl.
+  int toChild[2], fromChild[2];
+  if(make_cloexec_pipe(toChild) != 0) throw std::runtime_error("Error: Could not create a pipe to Graphviz");
+  if(make_cloexec_pipe(fromChild) != 0)
+  {
+    close(toChild[0]);
+    close(toChild[1]);
+    throw std::runtime_error("Error: Could not create a pipe from Graphviz");
+  }
+
+  pid_t pid = fork();
+  if(pid == 0)
+  {
+    // In the child process, connect the pipes to the standard input and output streams and run Graphviz.
+    dup2(toChild[0], STDIN_FILENO);
+    dup2(fromChild[1], STDOUT_FILENO);
+    close(toChild[0]);
+    close(toChild[1]);
+    close(fromChild[0]);
+    close(fromChild[1]);
+    execl(graphvizExePath.c_str(), graphvizExePath.c_str(), "-Tpng", static_cast<char*>(NULL));
+    _exit(127);
+  }
+
+  close(toChild[0]);
+  close(fromChild[1]);
+
+  if(pid < 0)
+  {
+    close(toChild[1]);
+    close(fromChild[0]);
+    throw std::runtime_error("Error: Could not start Graphviz");
+  }
+
+  // Write the graph description to the Graphviz process. Graphviz reads its entire input before it starts writing its
+  // output, so we can safely do this before reading the output without risking a deadlock. If Graphviz exits early
+  // (e.g. because the description is invalid), the write will fail: we block SIGPIPE whilst writing so that this does
+  // not terminate the application, and discard the signal afterwards if it was raised.
+  sigset_t sigpipeSet, oldSet;
+  sigemptyset(&sigpipeSet);
+  sigaddset(&sigpipeSet, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipeSet, &oldSet);
+
+  const char *data = request.graphDesc.data();
+  size_t remaining = request.graphDesc.size();
+  while(remaining > 0)
+  {
+    ssize_t written = write(toChild[1], data, remaining);
+    if(written < 0)
+    {
+      if(errno == EINTR) continue;
+      else break;
+    }
+
+    data += written;
+    remaining -= written;
+  }
+
+  close(toChild[1]);
+
+  sigset_t pendingSet;
+  sigpending(&pendingSet);
+  if(sigismember(&pendingSet, SIGPIPE))
+  {
+    int sig;
+    sigwait(&sigpipeSet, &sig);
+  }
+
+  pthread_sigmask(SIG_SETMASK, &oldSet, NULL);
+
+  // Read the PNG-encoded graph image back from the Graphviz process.
+  std::vector<unsigned char> buffer;
+  unsigned char chunk[4096];
+  for(;;)
+  {
+    ssize_t bytesRead = read(fromChild[0], chunk, sizeof(chunk));
+    if(bytesRead > 0) buffer.insert(buffer.end(), chunk, chunk + bytesRead);
+    else if(bytesRead == 0 || errno != EINTR) break;
+  }
+
+  close(fromChild[0]);
+
+  // Wait for the Graphviz process to finish, and check that it succeeded.
+  int status = 0;
+  pid_t waitResult;
+  while((waitResult = waitpid(pid, &status, 0)) < 0 && errno == EINTR);
+  if(waitResult < 0) throw std::runtime_error("Error: Could not wait for Graphviz to finish");
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0 || buffer.empty()) throw std::runtime_error("Error: Graphviz execution failed");
+
+  return buffer;
+#endif
+}
+
+ITMUChar4Image_Ptr GraphVisualiser::run_graphviz_via_temp_files(const Request& request)
 {
   std::string stem;
 
@@ -51,11 +365,11 @@ ITMUChar4Image_Ptr GraphVisualiser::generate_visualisation(const std::string& gr
 
   {
     std::ofstream fs(sourceFile.string().c_str());
-    fs << graphDesc;
+    fs << request.graphDesc;
   }
 
   // Run the chosen Graphviz executable to generate the graph image.
-  bf::path graphvizExePath = get_path(graphvizExe);
+  bf::path graphvizExePath = get_path(request.graphvizExe);
 #ifdef _WIN32
   std::string command = "\"\"" + graphvizExePath.string() + "\" \"" + bf::absolute(sourceFile).string() + "\" -Tpng -O\"";
 #else
@@ -75,29 +389,45 @@ ITMUChar4Image_Ptr GraphVisualiser::generate_visualisation(const std::string& gr
   return graphImage;
 }
 
-//#################### PRIVATE MEMBER FUNCTIONS ####################
-
-bf::path GraphVisualiser::get_path(GraphvizExe graphvizExe) const
+void GraphVisualiser::run_worker()
 {
-  bf::path result;
-
-  switch(graphvizExe)
+  for(;;)
   {
-    case GV_DOT:
-      result = bf::path(STRINGIZE(GRAPHVIZ_DOT));
-      break;
-    default:
-      result = bf::path(STRINGIZE(GRAPHVIZ_NEATO));
-      break;
-  }
+    // Wait for a request to arrive (or for the visualiser to be destroyed).
+    boost::optional<Request> request;
 
-  if(bf::exists(result)) return result;
-  else throw std::runtime_error("Error: Cannot find " + result.string());
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      while(!m_pendingRequest && !m_terminate) m_requestReady.wait(lock);
+      if(m_terminate) return;
+
+      request = m_activeRequest = m_pendingRequest;
+      m_pendingRequest.reset();
+    }
+
+    // Generate the visualisation. If Graphviz fails, report the error and keep going: the previous visualisation
+    // will continue to be returned until a later request succeeds.
+    try
+    {
+      render(*request);
+    }
+    catch(std::exception& e)
+    {
+      std::cerr << "Warning: Failed to generate graph visualisation: " << e.what() << '\n';
+    }
+
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_activeRequest.reset();
+  }
 }
 
-std::string GraphVisualiser::make_uuid()
+//#################### STREAM OPERATORS ####################
+
+std::ostream& operator<<(std::ostream& os, const GraphVisualiser::Statistics& stats)
 {
-  return boost::lexical_cast<std::string>(m_gen());
+  os << "Hits: " << stats.hitCount << ", Misses: " << stats.missCount << ", Renders: " << stats.renderCount
+     << ", Average Render Time: " << stats.averageRenderTime.count() << "us";
+  return os;
 }
 
 }
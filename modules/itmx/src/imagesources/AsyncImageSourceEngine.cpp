@@ -5,55 +5,89 @@
 
 #include "imagesources/AsyncImageSourceEngine.h"
 
+#include <climits>
+#include <iostream>
 #include <stdexcept>
 
 namespace itmx {
 
 //#################### CONSTRUCTORS ####################
 
+AsyncImageSourceEngine::PrefetchStats::PrefetchStats()
+: framesLoaded(0), totalLoadTime(0), maxLoadTime(0),
+  framesDelivered(0), totalQueueOccupancy(0), maxQueueOccupancy(0),
+  consumerStalls(0), totalStallTime(0)
+{}
+
 AsyncImageSourceEngine::AsyncImageSourceEngine(ImageSourceEngine *innerSource, size_t queueCapacity)
-: m_grabberShouldTerminate(false),
+: m_endFrame(INT_MAX),
   m_innerSource(innerSource),
-  m_queueCapacity(queueCapacity > 0 ? queueCapacity : std::numeric_limits<size_t>::max())
+  m_nextFrameToClaim(0),
+  m_nextFrameToDeliver(0),
+  m_printStatsOnDestruction(false),
+  m_queueCapacity(queueCapacity > 0 ? queueCapacity : std::numeric_limits<size_t>::max()),
+  m_workersShouldTerminate(false)
 {
   if(!innerSource)
   {
     throw std::runtime_error("Error: Cannot initialise an AsyncImageSourceEngine with a NULL ImageSourceEngine.");
   }
 
-  // Determine the maximum number of RGB-D images to store in the pool.
-  const size_t MAX_POOL_CAPACITY = 60;
-  m_poolCapacity = std::min(m_queueCapacity, MAX_POOL_CAPACITY);
+  fill_pool();
+
+  // Start the image grabber.
+  m_workers.create_thread(boost::bind(&AsyncImageSourceEngine::run_image_grabber, this));
+}
 
-  // If the inner source has images available, fill the pool to avoid allocating memory at runtime.
-  // If the inner source doesn't have any images available, there is no need to allocate.
-  if(m_innerSource->hasMoreImages())
+AsyncImageSourceEngine::AsyncImageSourceEngine(ImageSourceEngine *innerSource, const FrameLoader& frameLoader, int initialFrameNumber,
+                                               size_t queueCapacity, size_t workerCount)
+: m_endFrame(INT_MAX),
+  m_frameLoader(frameLoader),
+  m_innerSource(innerSource),
+  m_nextFrameToClaim(initialFrameNumber),
+  m_nextFrameToDeliver(initialFrameNumber),
+  m_printStatsOnDestruction(false),
+  m_queueCapacity(queueCapacity > 0 ? queueCapacity : std::numeric_limits<size_t>::max()),
+  m_workersShouldTerminate(false)
+{
+  if(!innerSource)
   {
-    for(size_t i = 0; i < m_poolCapacity; ++i)
-    {
-      RGBDImage rgbdImage;
-      rgbdImage.rawDepth.reset(new ITMShortImage(m_innerSource->getDepthImageSize(), true, false));
-      rgbdImage.rgb.reset(new ITMUChar4Image(m_innerSource->getRGBImageSize(), true, false));
-      m_pool.push(rgbdImage);
-    }
+    throw std::runtime_error("Error: Cannot initialise an AsyncImageSourceEngine with a NULL ImageSourceEngine.");
   }
 
-  // Start the image grabber.
-  m_grabber = boost::thread(boost::bind(&AsyncImageSourceEngine::run_image_grabber, this));
+  if(!frameLoader)
+  {
+    throw std::runtime_error("Error: Cannot initialise an AsyncImageSourceEngine with an empty frame loader.");
+  }
+
+  fill_pool();
+
+  // Start the workers.
+  if(workerCount == 0) workerCount = std::max(boost::thread::hardware_concurrency(), 1U);
+  for(size_t i = 0; i < workerCount; ++i)
+  {
+    m_workers.create_thread(boost::bind(&AsyncImageSourceEngine::run_worker, this));
+  }
 }
 
 //#################### DESTRUCTOR ####################
 
 AsyncImageSourceEngine::~AsyncImageSourceEngine()
 {
-  // Set the flag that informs the image grabber that it should terminate.
-  m_grabberShouldTerminate = true;
+  // Set the flag that informs the workers that they should terminate.
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_workersShouldTerminate = true;
+  }
 
-  // Wake the image grabber (it might be waiting on a full queue).
-  m_queueNotFull.notify_one();
+  // Wake the workers (they might be waiting for frames to be consumed).
+  m_queueNotFull.notify_all();
 
-  // Wait for the image grabber to terminate gracefully.
-  m_grabber.join();
+  // Wait for the workers to terminate gracefully.
+  m_workers.join_all();
+
+  // If requested, output the prefetching statistics.
+  if(m_printStatsOnDestruction) std::cout << "Prefetching: " << m_stats << '\n';
 }
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -62,30 +96,39 @@ ITMLib::ITMRGBDCalib AsyncImageSourceEngine::getCalib() const
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are images in the queue, return the first image's calibration; if not, defer to the inner source.
-  return !m_queue.empty() ? m_queue.front().calib : m_innerSource->getCalib();
+  // If the next frame is ready, return its calibration; if not, defer to the inner source.
+  std::map<int,RGBDImage>::const_iterator it = m_readyFrames.find(m_nextFrameToDeliver);
+  if(it != m_readyFrames.end()) return it->second.calib;
+
+  boost::lock_guard<boost::mutex> innerLock(m_innerSourceMutex);
+  return m_innerSource->getCalib();
 }
 
 Vector2i AsyncImageSourceEngine::getDepthImageSize() const
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are images in the queue, return the first image's depth size; if not, defer to the inner source.
-  return !m_queue.empty() ? m_queue.front().rawDepth->noDims : m_innerSource->getDepthImageSize();
+  // If the next frame is ready, return its depth size; if not, defer to the inner source.
+  std::map<int,RGBDImage>::const_iterator it = m_readyFrames.find(m_nextFrameToDeliver);
+  if(it != m_readyFrames.end()) return it->second.rawDepth->noDims;
+
+  boost::lock_guard<boost::mutex> innerLock(m_innerSourceMutex);
+  return m_innerSource->getDepthImageSize();
 }
 
 void AsyncImageSourceEngine::getImages(ITMUChar4Image *rgb, ITMShortImage *rawDepth)
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are no more images available, early out.
-  if(m_queue.empty())
+  // If the next frame is not available, early out.
+  std::map<int,RGBDImage>::iterator it = m_readyFrames.find(m_nextFrameToDeliver);
+  if(it == m_readyFrames.end())
   {
     throw std::runtime_error("Error: No more images to get. Make sure to call hasMoreImages before calling getImages.");
   }
 
-  // Otherwise, get the first RGB-D image from the queue.
-  RGBDImage& rgbdImage = m_queue.front();
+  // Otherwise, get the next RGB-D image.
+  RGBDImage& rgbdImage = it->second;
 
   // Ensure that the output images have the correct size (this is generally a no-op).
   rawDepth->ChangeDims(rgbdImage.rawDepth->noDims);
@@ -95,86 +138,257 @@ void AsyncImageSourceEngine::getImages(ITMUChar4Image *rgb, ITMShortImage *rawDe
   rawDepth->SetFrom(rgbdImage.rawDepth.get(), ITMShortImage::CPU_TO_CPU);
   rgb->SetFrom(rgbdImage.rgb.get(), ITMUChar4Image::CPU_TO_CPU);
 
+  // Update the statistics.
+  ++m_stats.framesDelivered;
+  m_stats.totalQueueOccupancy += m_readyFrames.size();
+
   // If there is space available in the RGB-D image pool, store the RGB-D image to avoid reallocating memory later.
   if(m_pool.size() < m_poolCapacity) m_pool.push(rgbdImage);
 
-  // Remove the RGB-D image from the queue and inform the image grabber that the queue is not full.
-  m_queue.pop();
+  // Remove the RGB-D image from the queue and inform the workers that another frame can now be claimed.
+  m_readyFrames.erase(it);
+  ++m_nextFrameToDeliver;
   m_queueNotFull.notify_one();
 }
 
+AsyncImageSourceEngine::PrefetchStats AsyncImageSourceEngine::get_prefetch_stats() const
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  return m_stats;
+}
+
 Vector2i AsyncImageSourceEngine::getRGBImageSize() const
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are images in the queue, return the first image's RGB size; if not, defer to the inner source.
-  return !m_queue.empty() ? m_queue.front().rgb->noDims : m_innerSource->getRGBImageSize();
+  // If the next frame is ready, return its RGB size; if not, defer to the inner source.
+  std::map<int,RGBDImage>::const_iterator it = m_readyFrames.find(m_nextFrameToDeliver);
+  if(it != m_readyFrames.end()) return it->second.rgb->noDims;
+
+  boost::lock_guard<boost::mutex> innerLock(m_innerSourceMutex);
+  return m_innerSource->getRGBImageSize();
 }
 
 bool AsyncImageSourceEngine::hasMoreImages() const
 {
-  // We need to grab the mutex in case the queue is empty, in which case we need to wait to see if an image becomes available.
+  // We need to grab the mutex in case the next frame is not yet ready, in which case we need to wait to see if it becomes available.
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If the inner source has more images, wait for one to be added to the queue by the image grabber.
-  while(m_innerSource->hasMoreImages() && m_queue.empty()) m_queueNotEmpty.wait(lock);
+  // If the next frame might still exist but is not yet ready, wait for it to be loaded (and record the stall).
+  if(m_nextFrameToDeliver < m_endFrame && m_readyFrames.find(m_nextFrameToDeliver) == m_readyFrames.end())
+  {
+    boost::chrono::high_resolution_clock::time_point t0 = boost::chrono::high_resolution_clock::now();
+
+    while(m_nextFrameToDeliver < m_endFrame && m_readyFrames.find(m_nextFrameToDeliver) == m_readyFrames.end())
+    {
+      m_queueNotEmpty.wait(lock);
+    }
+
+    boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
+    ++m_stats.consumerStalls;
+    m_stats.totalStallTime += boost::chrono::duration_cast<boost::chrono::microseconds>(t1 - t0);
+  }
 
-  // At this point, either there is now an image in the queue, in which case we return true,
-  // or the inner source has terminated, in which case we return false.
-  return !m_queue.empty();
+  // At this point, either the next frame is now ready, in which case we return true,
+  // or the end of the sequence has been reached, in which case we return false.
+  return m_readyFrames.find(m_nextFrameToDeliver) != m_readyFrames.end();
+}
+
+void AsyncImageSourceEngine::set_print_stats_on_destruction(bool printStatsOnDestruction)
+{
+  m_printStatsOnDestruction = printStatsOnDestruction;
 }
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void AsyncImageSourceEngine::run_image_grabber()
+bool AsyncImageSourceEngine::claim_frame(boost::unique_lock<boost::mutex>& lock, int& frameNumber, RGBDImage& rgbdImage)
 {
-  while(!m_grabberShouldTerminate)
+  // Wait until either a frame can be claimed without exceeding the queue capacity, the end of the sequence has been found, or termination is requested.
+  while(!m_workersShouldTerminate && m_nextFrameToClaim < m_endFrame && static_cast<size_t>(m_nextFrameToClaim - m_nextFrameToDeliver) >= m_queueCapacity)
   {
-    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_queueNotFull.wait(lock);
+  }
 
-    // If the queue is full, wait until some images have been consumed or termination is requested.
-    while(!m_grabberShouldTerminate && m_queue.size() >= m_queueCapacity) m_queueNotFull.wait(lock);
+  // If we were asked to terminate, or there are no more frames to load, tell the caller to terminate.
+  if(m_workersShouldTerminate || m_nextFrameToClaim >= m_endFrame) return false;
 
-    // If we were asked to terminate, do so.
-    if(m_grabberShouldTerminate) return;
+  // Otherwise, claim the next frame, and if possible, get an existing RGB-D image from the pool into which to load it.
+  frameNumber = m_nextFrameToClaim++;
 
-    // If there are no more images available from the inner source, notify anyone waiting for an image and terminate.
-    if(!m_innerSource->hasMoreImages())
+  if(!m_pool.empty())
+  {
+    rgbdImage = m_pool.front();
+    m_pool.pop();
+  }
+
+  return true;
+}
+
+void AsyncImageSourceEngine::fill_pool()
+{
+  // Determine the maximum number of RGB-D images to store in the pool.
+  const size_t MAX_POOL_CAPACITY = 60;
+  m_poolCapacity = std::min(m_queueCapacity, MAX_POOL_CAPACITY);
+
+  // If the inner source reports valid image sizes, fill the pool to avoid allocating memory at runtime.
+  const Vector2i depthImageSize = m_innerSource->getDepthImageSize();
+  const Vector2i rgbImageSize = m_innerSource->getRGBImageSize();
+  if(depthImageSize.x > 0 && depthImageSize.y > 0 && rgbImageSize.x > 0 && rgbImageSize.y > 0)
+  {
+    for(size_t i = 0; i < m_poolCapacity; ++i)
+    {
+      RGBDImage rgbdImage;
+      rgbdImage.rawDepth.reset(new ITMShortImage(depthImageSize, true, false));
+      rgbdImage.rgb.reset(new ITMUChar4Image(rgbImageSize, true, false));
+      m_pool.push(rgbdImage);
+    }
+  }
+}
+
+void AsyncImageSourceEngine::finish_frame(int frameNumber, const RGBDImage& rgbdImage, bool loaded, boost::chrono::microseconds loadTime)
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+
+  if(loaded)
+  {
+    ++m_stats.framesLoaded;
+    m_stats.totalLoadTime += loadTime;
+    m_stats.maxLoadTime = std::max(m_stats.maxLoadTime, loadTime);
+  }
+  else if(frameNumber < m_endFrame)
+  {
+    // If the frame does not exist, it marks the (new) end of the sequence, so discard any later frames that have already been loaded.
+    m_endFrame = frameNumber;
+
+    std::map<int,RGBDImage>::iterator it = m_readyFrames.lower_bound(m_endFrame);
+    while(it != m_readyFrames.end())
     {
-      m_queueNotEmpty.notify_one();
-      return;
+      if(m_pool.size() < m_poolCapacity) m_pool.push(it->second);
+      m_readyFrames.erase(it++);
     }
 
-    // Construct an RGB-D image into which to copy the data from the inner source.
+    // Wake any workers that are waiting to claim a frame, so that they can terminate.
+    m_queueNotFull.notify_all();
+  }
+
+  if(loaded && frameNumber < m_endFrame)
+  {
+    // Add the RGB-D image to the frames that are ready to be handed to the consumer.
+    m_readyFrames.insert(std::make_pair(frameNumber, rgbdImage));
+    m_stats.maxQueueOccupancy = std::max(m_stats.maxQueueOccupancy, m_readyFrames.size());
+  }
+  else
+  {
+    // Otherwise, return the RGB-D image to the pool (if there is space).
+    if(m_pool.size() < m_poolCapacity) m_pool.push(rgbdImage);
+  }
+
+  // Inform the consumer that the next frame may now be available (or that the end of the sequence has been found).
+  m_queueNotEmpty.notify_one();
+}
+
+void AsyncImageSourceEngine::run_image_grabber()
+{
+  for(;;)
+  {
+    // Claim the next frame (or terminate if there are no more frames or termination is requested).
+    int frameNumber;
     RGBDImage rgbdImage;
-    if(!m_pool.empty())
     {
-      // If possible, reuse an existing RGB-D image from the pool rather than allocating new memory.
-      rgbdImage = m_pool.front();
-      m_pool.pop();
-
-      // Ensure that the depth and RGB images have the correct size (this is a no-op unless the size of
-      // the images produced by the inner source has changed since we put the RGB-D image in the pool).
-      rgbdImage.rawDepth->ChangeDims(m_innerSource->getDepthImageSize());
-      rgbdImage.rgb->ChangeDims(m_innerSource->getRGBImageSize());
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      if(!claim_frame(lock, frameNumber, rgbdImage)) return;
     }
-    else
+
+    bool loaded = false;
+    boost::chrono::microseconds loadTime(0);
     {
-      // If there was no existing image available from the pool, allocate new memory for the RGB-D image.
-      rgbdImage.rawDepth.reset(new ITMShortImage(m_innerSource->getDepthImageSize(), true, false));
-      rgbdImage.rgb.reset(new ITMUChar4Image(m_innerSource->getRGBImageSize(), true, false));
+      boost::lock_guard<boost::mutex> innerLock(m_innerSourceMutex);
+
+      // Note: The inner source must be asked whether it has more images before each call to getImages (for file readers, this is
+      //       what decodes the frame that getImages then returns). If it has none, the frame is simply marked as not loaded: this
+      //       records the end of the sequence, after which no more frames are claimed, so the inner source is never asked again.
+      if(m_innerSource->hasMoreImages())
+      {
+        if(rgbdImage.rawDepth)
+        {
+          // Ensure that the depth and RGB images have the correct size (this is a no-op unless the size of
+          // the images produced by the inner source has changed since we put the RGB-D image in the pool).
+          rgbdImage.rawDepth->ChangeDims(m_innerSource->getDepthImageSize());
+          rgbdImage.rgb->ChangeDims(m_innerSource->getRGBImageSize());
+        }
+        else
+        {
+          // If there was no existing image available from the pool, allocate new memory for the RGB-D image.
+          rgbdImage.rawDepth.reset(new ITMShortImage(m_innerSource->getDepthImageSize(), true, false));
+          rgbdImage.rgb.reset(new ITMUChar4Image(m_innerSource->getRGBImageSize(), true, false));
+        }
+
+        // Get the calibration for the RGB-D image from the inner source.
+        rgbdImage.calib = m_innerSource->getCalib();
+
+        // Copy the images from the inner source into the RGB-D image.
+        boost::chrono::high_resolution_clock::time_point t0 = boost::chrono::high_resolution_clock::now();
+        m_innerSource->getImages(rgbdImage.rgb.get(), rgbdImage.rawDepth.get());
+        boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
+
+        loadTime = boost::chrono::duration_cast<boost::chrono::microseconds>(t1 - t0);
+        loaded = true;
+      }
     }
 
-    // Get the calibration for the RGB-D image from the inner source.
-    rgbdImage.calib = m_innerSource->getCalib();
+    // Add the RGB-D image to the queue (or record the end of the sequence) and inform the consumer.
+    finish_frame(frameNumber, rgbdImage, loaded, loadTime);
+  }
+}
 
-    // Copy the images from the inner source into the RGB-D image.
-    m_innerSource->getImages(rgbdImage.rgb.get(), rgbdImage.rawDepth.get());
+void AsyncImageSourceEngine::run_worker()
+{
+  for(;;)
+  {
+    // Claim the next frame (or terminate if there are no more frames or termination is requested).
+    int frameNumber;
+    RGBDImage rgbdImage;
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      if(!claim_frame(lock, frameNumber, rgbdImage)) return;
+    }
+
+    {
+      boost::lock_guard<boost::mutex> innerLock(m_innerSourceMutex);
+
+      // If there was no existing image available from the pool, allocate new memory for the RGB-D image.
+      if(!rgbdImage.rawDepth)
+      {
+        rgbdImage.rawDepth.reset(new ITMShortImage(m_innerSource->getDepthImageSize(), true, false));
+        rgbdImage.rgb.reset(new ITMUChar4Image(m_innerSource->getRGBImageSize(), true, false));
+      }
+
+      // Get the calibration for the RGB-D image from the inner source.
+      rgbdImage.calib = m_innerSource->getCalib();
+    }
+
+    // Load the frame into the RGB-D image. This is the expensive part, and is done without holding any locks.
+    boost::chrono::high_resolution_clock::time_point t0 = boost::chrono::high_resolution_clock::now();
+    const bool loaded = m_frameLoader(frameNumber, rgbdImage.rgb.get(), rgbdImage.rawDepth.get());
+    boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
 
-    // Add the RGB-D image to the queue and inform the main thread that images are available.
-    m_queue.push(rgbdImage);
-    m_queueNotEmpty.notify_one();
+    // Add the RGB-D image to the frames that are ready to be handed to the consumer (or record the end of the sequence) and inform the consumer.
+    finish_frame(frameNumber, rgbdImage, loaded, boost::chrono::duration_cast<boost::chrono::microseconds>(t1 - t0));
   }
 }
 
+//#################### STREAM OPERATORS ####################
+
+std::ostream& operator<<(std::ostream& os, const AsyncImageSourceEngine::PrefetchStats& stats)
+{
+  os << "Frames Loaded: " << stats.framesLoaded
+     << ", Average Load Time: " << (stats.framesLoaded > 0 ? stats.totalLoadTime.count() / stats.framesLoaded : 0) << "us"
+     << ", Max Load Time: " << stats.maxLoadTime.count() << "us"
+     << ", Frames Delivered: " << stats.framesDelivered
+     << ", Average Queue Occupancy: " << (stats.framesDelivered > 0 ? static_cast<double>(stats.totalQueueOccupancy) / stats.framesDelivered : 0.0)
+     << ", Max Queue Occupancy: " << stats.maxQueueOccupancy
+     << ", Consumer Stalls: " << stats.consumerStalls << " (" << stats.totalStallTime.count() << "us)";
+  return os;
+}
+
 }
@@ -47,6 +47,25 @@ cv::Mat3b OpenCVUtil::make_rgb_image(const Vector4u *rgbaData, int width, int he
   return result;
 }
 
+cv::Mat3b OpenCVUtil::make_rgb_image(const Vector4u *rgbaData, int width, const cv::Rect& roi)
+{
+  cv::Mat3b result = cv::Mat3b::zeros(roi.height, roi.width);
+  for(int y = 0; y < roi.height; ++y)
+  {
+    const Vector4u *rowData = rgbaData + (roi.y + y) * width + roi.x;
+    for(int x = 0; x < roi.width; ++x)
+    {
+      result(y,x) = cv::Vec3b(
+        static_cast<unsigned char>(rowData->b),
+        static_cast<unsigned char>(rowData->g),
+        static_cast<unsigned char>(rowData->r)
+      );
+      ++rowData;
+    }
+  }
+  return result;
+}
+
 cv::Mat3b OpenCVUtil::pad_image(const cv::Mat3b& image, int paddingSize)
 {
   cv::Mat3b paddedImage = cv::Mat3b::zeros(image.rows + paddingSize * 2, image.cols + paddingSize * 2);
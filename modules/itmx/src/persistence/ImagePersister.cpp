@@ -17,6 +17,38 @@ namespace itmx {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+ITMUChar4Image_Ptr ImagePersister::decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path)
+{
+  // Decode the PNG.
+  std::vector<unsigned char> data;
+  unsigned int width, height;
+  if(lodepng::decode(data, width, height, buffer) != 0)
+  {
+    throw std::runtime_error("Failed to decode PNG from '" + path + "'");
+  }
+
+  // Construct the image.
+  ITMUChar4Image_Ptr image(new ITMUChar4Image(Vector2i(width, height), true, true));
+  const int pixelCount = width * height;
+  const unsigned char *src = &data[0];
+  Vector4u *dest = image->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    Vector4u& pixel = dest[i];
+    int offset = i * 4;
+    pixel.r = src[offset];
+    pixel.g = src[offset + 1];
+    pixel.b = src[offset + 2];
+    pixel.a = src[offset + 3];
+  }
+
+  return image;
+}
+
 ITMUChar4Image_Ptr ImagePersister::load_rgba_image(const std::string& path, ImageFileType fileType)
 {
   // If the image file type wasn't specified, try to deduce it.
@@ -88,38 +120,6 @@ void ImagePersister::save_image(const ITMUChar4Image_CPtr& image, const std::str
 
 //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 
-ITMUChar4Image_Ptr ImagePersister::decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path)
-{
-  // Decode the PNG.
-  std::vector<unsigned char> data;
-  unsigned int width, height;
-  if(lodepng::decode(data, width, height, buffer) != 0)
-  {
-    throw std::runtime_error("Failed to decode PNG from '" + path + "'");
-  }
-
-  // Construct the image.
-  ITMUChar4Image_Ptr image(new ITMUChar4Image(Vector2i(width, height), true, true));
-  const int pixelCount = width * height;
-  const unsigned char *src = &data[0];
-  Vector4u *dest = image->GetData(MEMORYDEVICE_CPU);
-
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < pixelCount; ++i)
-  {
-    Vector4u& pixel = dest[i];
-    int offset = i * 4;
-    pixel.r = src[offset];
-    pixel.g = src[offset + 1];
-    pixel.b = src[offset + 2];
-    pixel.a = src[offset + 3];
-  }
-
-  return image;
-}
-
 ImagePersister::ImageFileType ImagePersister::deduce_image_file_type(const std::string& path)
 {
   boost::filesystem::path bpath(path);
@@ -17,6 +17,29 @@ namespace itmx {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+Matrix4f PosePersister::load_pose(const std::string& path)
+{
+  // Attempt to open the input file.
+  std::ifstream fs(path.c_str());
+  if(!fs) throw std::runtime_error("Could not open input file: " + path);
+
+  // Read the matrix from the file (each line of which contains a single row of the matrix).
+  Matrix4f pose;
+  for(int y = 0; y < 4; ++y)
+  {
+    fs >> pose(0, y) >> pose(1, y) >> pose(2, y) >> pose(3, y);
+  }
+
+  if(!fs) throw std::runtime_error("Could not read a pose from input file: " + path);
+
+  return pose;
+}
+
+Matrix4f PosePersister::load_pose(const bf::path& path)
+{
+  return load_pose(path.string());
+}
+
 void PosePersister::save_pose(const Matrix4f& pose, const std::string& path)
 {
   // Attempt to open the output file.
@@ -41,8 +64,8 @@ void PosePersister::save_pose_on_thread(const Matrix4f& pose, const std::string&
   // Select the save_pose overload that takes a string.
   void (*f)(const Matrix4f&, const std::string&) = &save_pose;
 
-  // Call it on a separate thread.
-  ThreadPool::instance().post_task(boost::bind(f, pose, path));
+  // Call it on a separate thread (in the background lane, so that it does not delay any computation running on the pool).
+  ThreadPool::instance().post_task(boost::bind(f, pose, path), tvgutil::thread_pool::TP_BACKGROUND);
 }
 
 void PosePersister::save_pose_on_thread(const Matrix4f& pose, const bf::path& path)
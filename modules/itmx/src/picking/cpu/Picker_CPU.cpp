@@ -28,6 +28,30 @@ bool Picker_CPU::pick(int x, int y, const ITMLib::ITMRenderState *renderState, O
   );
 }
 
+void Picker_CPU::pick(const ORUtils::MemoryBlock<Vector2i>& pointsMB, const ITMLib::ITMRenderState *renderState,
+                      ORUtils::MemoryBlock<Vector3f>& pickPointsMB, ORUtils::MemoryBlock<bool>& pickPointsValidMB) const
+{
+  if(pickPointsMB.dataSize < pointsMB.dataSize || pickPointsValidMB.dataSize < pointsMB.dataSize)
+  {
+    throw std::runtime_error("Error: The memory blocks into which to write the pick points must be at least as large as the batch of points");
+  }
+
+  const Vector2i *points = pointsMB.GetData(MEMORYDEVICE_CPU);
+  const int pointCount = static_cast<int>(pointsMB.dataSize);
+  const int width = renderState->raycastResult->noDims.x, height = renderState->raycastResult->noDims.y;
+  const Vector4f *pointImage = renderState->raycastResult->GetData(MEMORYDEVICE_CPU);
+  Vector3f *pickPoints = pickPointsMB.GetData(MEMORYDEVICE_CPU);
+  bool *pickPointsValid = pickPointsValidMB.GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < pointCount; ++i)
+  {
+    get_pick_point(i, points, width, height, pointImage, pickPoints, pickPointsValid);
+  }
+}
+
 void Picker_CPU::to_short(const ORUtils::MemoryBlock<Vector3f>& pickPointsFloatMB, ORUtils::MemoryBlock<Vector3s>& pickPointsShortMB) const
 {
   if(pickPointsFloatMB.dataSize != pickPointsShortMB.dataSize)
@@ -18,12 +18,25 @@ __global__ void ck_get_pick_point(int x, int y, int width, const Vector4f *image
   *result = get_pick_point(x, y, width, imageData, *pickPoint);
 }
 
+__global__ void ck_get_pick_points(const Vector2i *points, int pointCount, int width, int height, const Vector4f *imageData,
+                                   Vector3f *pickPoints, bool *pickPointsValid)
+{
+  int tid = threadIdx.x + blockDim.x * blockIdx.x;
+  if(tid < pointCount) get_pick_point(tid, points, width, height, imageData, pickPoints, pickPointsValid);
+}
+
 __global__ void ck_to_short(const Vector3f *pickPointsFloat, Vector3s *pickPointsShort, int pointCount)
 {
   int tid = threadIdx.x + blockDim.x * blockIdx.x;
   if(tid < pointCount) pickPointsShort[tid] = pickPointsFloat[tid].toShortRound();
 }
 
+//#################### CONSTRUCTORS ####################
+
+Picker_CUDA::Picker_CUDA()
+: m_pickPointValidMB(new ORUtils::MemoryBlock<bool>(1, true, true))
+{}
+
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 bool Picker_CUDA::pick(int x, int y, const ITMLib::ITMRenderState *renderState, ORUtils::MemoryBlock<Vector3f>& pickPointsMB, size_t offset) const
@@ -33,16 +46,39 @@ bool Picker_CUDA::pick(int x, int y, const ITMLib::ITMRenderState *renderState,
     throw std::runtime_error("Error: The offset at which to write the pick point is out of range");
   }
 
-  static ORUtils::MemoryBlock<bool> result(1, true, true);
   ck_get_pick_point<<<1,1>>>(
     x, y,
     renderState->raycastResult->noDims.x,
     renderState->raycastResult->GetData(MEMORYDEVICE_CUDA),
     pickPointsMB.GetData(MEMORYDEVICE_CUDA) + offset,
-    result.GetData(MEMORYDEVICE_CUDA)
+    m_pickPointValidMB->GetData(MEMORYDEVICE_CUDA)
+  );
+  m_pickPointValidMB->UpdateHostFromDevice();
+  return *m_pickPointValidMB->GetData(MEMORYDEVICE_CPU);
+}
+
+void Picker_CUDA::pick(const ORUtils::MemoryBlock<Vector2i>& pointsMB, const ITMLib::ITMRenderState *renderState,
+                       ORUtils::MemoryBlock<Vector3f>& pickPointsMB, ORUtils::MemoryBlock<bool>& pickPointsValidMB) const
+{
+  if(pickPointsMB.dataSize < pointsMB.dataSize || pickPointsValidMB.dataSize < pointsMB.dataSize)
+  {
+    throw std::runtime_error("Error: The memory blocks into which to write the pick points must be at least as large as the batch of points");
+  }
+
+  int pointCount = static_cast<int>(pointsMB.dataSize);
+  if(pointCount == 0) return;
+
+  int threadsPerBlock = 256;
+  int numBlocks = (pointCount + threadsPerBlock - 1) / threadsPerBlock;
+  ck_get_pick_points<<<numBlocks,threadsPerBlock>>>(
+    pointsMB.GetData(MEMORYDEVICE_CUDA),
+    pointCount,
+    renderState->raycastResult->noDims.x,
+    renderState->raycastResult->noDims.y,
+    renderState->raycastResult->GetData(MEMORYDEVICE_CUDA),
+    pickPointsMB.GetData(MEMORYDEVICE_CUDA),
+    pickPointsValidMB.GetData(MEMORYDEVICE_CUDA)
   );
-  result.UpdateHostFromDevice();
-  return *result.GetData(MEMORYDEVICE_CPU);
 }
 
 void Picker_CUDA::to_short(const ORUtils::MemoryBlock<Vector3f>& pickPointsFloatMB, ORUtils::MemoryBlock<Vector3s>& pickPointsShortMB) const
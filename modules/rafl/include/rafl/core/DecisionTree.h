@@ -262,7 +262,7 @@ public:
 private:
   typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
   typedef boost::shared_ptr<Node> Node_Ptr;
-  typedef tvgutil::PriorityQueue<int,float,signed char,std::greater<float> > SplittabilityQueue;
+  typedef tvgutil::PriorityQueue<int,float,signed char,std::greater<float>,tvgutil::priority_queue::DenseIndex<int>,4> SplittabilityQueue;
 
   //#################### PRIVATE VARIABLES ####################
 private:
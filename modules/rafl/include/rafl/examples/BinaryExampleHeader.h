@@ -0,0 +1,211 @@
+/**
+ * rafl: BinaryExampleHeader.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
+ */
+
+#ifndef H_RAFL_BINARYEXAMPLEHEADER
+#define H_RAFL_BINARYEXAMPLEHEADER
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_signed.hpp>
+
+namespace rafl {
+
+/**
+ * \brief An instance of this struct represents the header of a binary example file.
+ *
+ * A binary example file consists of a fixed-size header, followed by a row-major block of exampleCount * featureCount
+ * raw floats (the descriptors of the examples), followed by a block of exampleCount raw labels. All values are stored
+ * in the native byte order of the machine that wrote the file. The on-disk layout of the header is:
+ *
+ * - 8 bytes: the magic string "RAFLEXMP"
+ * - 4 bytes: the number of features in each descriptor
+ * - 1 byte:  the kind of label ('i' = signed integer, 'u' = unsigned integer, 'f' = floating point)
+ * - 1 byte:  the size of each label (in bytes)
+ * - 2 bytes: reserved (zero)
+ * - 8 bytes: the number of examples in the file
+ */
+struct BinaryExampleHeader
+{
+  //#################### CONSTANTS ####################
+
+  /** The size of the header on disk (in bytes). */
+  static const size_t SIZE = 24;
+
+  //#################### PUBLIC VARIABLES ####################
+
+  /** The number of examples in the file. */
+  boost::uint64_t exampleCount;
+
+  /** The number of features in each descriptor. */
+  boost::uint32_t featureCount;
+
+  /** The kind of label ('i' = signed integer, 'u' = unsigned integer, 'f' = floating point). */
+  char labelKind;
+
+  /** The size of each label (in bytes). */
+  unsigned char labelSize;
+
+  //#################### CONSTRUCTORS ####################
+
+  /**
+   * \brief Constructs an empty binary example header.
+   */
+  BinaryExampleHeader()
+  : exampleCount(0), featureCount(0), labelKind(0), labelSize(0)
+  {}
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+  /**
+   * \brief Gets the magic string that identifies a binary example file.
+   *
+   * \return  The magic string that identifies a binary example file.
+   */
+  static const char *magic()
+  {
+    return "RAFLEXMP";
+  }
+
+  /**
+   * \brief Makes a header for a file containing examples with the specified type of label.
+   *
+   * \param exampleCount  The number of examples in the file.
+   * \param featureCount  The number of features in each descriptor.
+   * \return              The header.
+   */
+  template <typename Label>
+  static BinaryExampleHeader make(boost::uint64_t exampleCount, boost::uint32_t featureCount)
+  {
+    BinaryExampleHeader header;
+    header.exampleCount = exampleCount;
+    header.featureCount = featureCount;
+    header.labelKind = label_kind<Label>();
+    header.labelSize = static_cast<unsigned char>(sizeof(Label));
+    return header;
+  }
+
+  /**
+   * \brief Parses a header from a buffer containing at least SIZE bytes.
+   *
+   * \param buffer              The buffer.
+   * \return                    The header.
+   * \throws std::runtime_error If the buffer does not contain a valid header.
+   */
+  static BinaryExampleHeader parse(const char *buffer)
+  {
+    if(!has_magic(buffer)) throw std::runtime_error("Error: Not a binary example file");
+
+    BinaryExampleHeader header;
+    memcpy(&header.featureCount, buffer + 8, sizeof(boost::uint32_t));
+    header.labelKind = buffer[12];
+    header.labelSize = static_cast<unsigned char>(buffer[13]);
+    memcpy(&header.exampleCount, buffer + 16, sizeof(boost::uint64_t));
+    return header;
+  }
+
+  /**
+   * \brief Determines whether or not a buffer containing at least 8 bytes starts with the magic string for a binary example file.
+   *
+   * \param buffer  The buffer.
+   * \return        true, if the buffer starts with the magic string, or false otherwise.
+   */
+  static bool has_magic(const char *buffer)
+  {
+    return strncmp(buffer, magic(), 8) == 0;
+  }
+
+  /**
+   * \brief Reads a header from a stream.
+   *
+   * \param is                  The stream.
+   * \return                    The header.
+   * \throws std::runtime_error If a valid header could not be read from the stream.
+   */
+  static BinaryExampleHeader read(std::istream& is)
+  {
+    char buffer[SIZE];
+    if(!is.read(buffer, SIZE)) throw std::runtime_error("Error: Could not read the header of the binary example file");
+    return parse(buffer);
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+
+  /**
+   * \brief Checks that the header is compatible with a particular type of label.
+   *
+   * \throws std::runtime_error If the header is not compatible with the specified type of label.
+   */
+  template <typename Label>
+  void check_label_type() const
+  {
+    if(labelKind != label_kind<Label>() || labelSize != sizeof(Label))
+    {
+      throw std::runtime_error("Error: The labels in the binary example file are not of the expected type");
+    }
+  }
+
+  /**
+   * \brief Gets the offset (in bytes from the start of the file) of the label block.
+   *
+   * \return  The offset of the label block.
+   */
+  boost::uint64_t label_block_offset() const
+  {
+    return SIZE + exampleCount * featureCount * sizeof(float);
+  }
+
+  /**
+   * \brief Gets the total size of a file with this header (in bytes).
+   *
+   * \return  The total size of a file with this header.
+   */
+  boost::uint64_t total_file_size() const
+  {
+    return label_block_offset() + exampleCount * labelSize;
+  }
+
+  /**
+   * \brief Writes the header to a stream.
+   *
+   * \param os  The stream.
+   */
+  void write(std::ostream& os) const
+  {
+    char buffer[SIZE];
+    memset(buffer, 0, SIZE);
+    memcpy(buffer, magic(), 8);
+    memcpy(buffer + 8, &featureCount, sizeof(boost::uint32_t));
+    buffer[12] = labelKind;
+    buffer[13] = static_cast<char>(labelSize);
+    memcpy(buffer + 16, &exampleCount, sizeof(boost::uint64_t));
+    os.write(buffer, SIZE);
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the code used to denote the kind of label of the specified type.
+   *
+   * \return  The code used to denote the kind of label of the specified type.
+   */
+  template <typename Label>
+  static char label_kind()
+  {
+    if(boost::is_floating_point<Label>::value) return 'f';
+    else if(boost::is_integral<Label>::value) return boost::is_signed<Label>::value ? 'i' : 'u';
+    else throw std::runtime_error("Error: Only arithmetic labels can be stored in a binary example file");
+  }
+};
+
+}
+
+#endif
@@ -6,11 +6,19 @@
 #ifndef H_RAFL_EXAMPLEUTIL
 #define H_RAFL_EXAMPLEUTIL
 
+#include <cstring>
 #include <fstream>
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/tokenizer.hpp>
+
 #include <tvgutil/persistence/LineUtil.h>
 #include <tvgutil/statistics/ProbabilityMassFunction.h>
 
+#include "BinaryExampleHeader.h"
 #include "Example.h"
 
 namespace rafl {
@@ -51,13 +59,145 @@ public:
   }
 
   /**
-   * \brief Loads a set of examples from the specified file.
+   * \brief Converts a CSV example file to a binary example file.
+   *
+   * The CSV file is processed one line at a time, and the descriptors are written straight to the output file,
+   * so only the labels need to be held in memory. This makes it possible to convert datasets that are larger
+   * than the available memory.
+   *
+   * \param csvFilename         The name of the CSV file.
+   * \param binaryFilename      The name of the binary file to write.
+   * \return                    The number of examples converted.
+   * \throws std::runtime_error      If either file could not be opened, or the CSV file has lines with different numbers of features.
+   * \throws boost::bad_lexical_cast If the CSV file contains anything that is not a number.
+   */
+  template <typename Label>
+  static size_t convert_csv_to_binary(const std::string& csvFilename, const std::string& binaryFilename)
+  {
+    std::ifstream is(csvFilename.c_str());
+    if(!is) throw std::runtime_error("Error: '" + csvFilename + "' could not be opened");
+
+    std::ofstream os(binaryFilename.c_str(), std::ios_base::binary);
+    if(!os) throw std::runtime_error("Error: '" + binaryFilename + "' could not be opened for writing");
+
+    // Write a placeholder header (we will fill in the real one once we know how many examples there are).
+    BinaryExampleHeader::make<Label>(0, 0).write(os);
+
+    typedef boost::char_separator<char> sep;
+    typedef boost::tokenizer<sep> tokenizer;
+
+    std::vector<float> descriptor;
+    std::vector<Label> labels;
+    std::vector<std::string> words;
+    size_t featureCount = 0;
+    std::string line;
+    while(std::getline(is, line))
+    {
+      // Split the line into words (using the same delimiters as load_csv_examples), skipping blank lines.
+      tokenizer tok(line.begin(), line.end(), sep(", \r"));
+      words.assign(tok.begin(), tok.end());
+      if(words.empty()) continue;
+
+      // Check that the line has the same number of features as the lines before it.
+      if(labels.empty()) featureCount = words.size() - 1;
+      else if(words.size() - 1 != featureCount)
+      {
+        throw std::runtime_error("Error: Example " + boost::lexical_cast<std::string>(labels.size()) + " in '" + csvFilename + "' has the wrong number of features");
+      }
+
+      // Write the descriptor to the file and record the label.
+      descriptor.resize(featureCount);
+      for(size_t j = 0; j < featureCount; ++j)
+      {
+        descriptor[j] = boost::lexical_cast<float>(words[j]);
+      }
+
+      if(!descriptor.empty()) os.write(reinterpret_cast<const char*>(&descriptor[0]), descriptor.size() * sizeof(float));
+      labels.push_back(boost::lexical_cast<Label>(words.back()));
+    }
+
+    // Write the label block, and then go back and fill in the real header.
+    if(!labels.empty()) os.write(reinterpret_cast<const char*>(&labels[0]), labels.size() * sizeof(Label));
+    os.seekp(0);
+    BinaryExampleHeader::make<Label>(labels.size(), static_cast<boost::uint32_t>(featureCount)).write(os);
+
+    if(!os) throw std::runtime_error("Error: Could not write to '" + binaryFilename + "'");
+    return labels.size();
+  }
+
+  /**
+   * \brief Determines whether or not the specified file is a binary example file.
+   *
+   * \param filename  The name of the file.
+   * \return          true, if the file exists and is a binary example file, or false otherwise.
+   */
+  static bool is_binary_example_file(const std::string& filename)
+  {
+    std::ifstream fs(filename.c_str(), std::ios_base::binary);
+    char buffer[8];
+    return fs && fs.read(buffer, sizeof(buffer)) && BinaryExampleHeader::has_magic(buffer);
+  }
+
+  /**
+   * \brief Loads a set of examples from the specified binary example file.
+   *
+   * The file is memory-mapped rather than read into an intermediate buffer, and each example is constructed
+   * directly from its slice of the mapped float block, so the only allocations made are those for the
+   * examples themselves.
+   *
+   * \param filename            The name of the file from which to load the examples.
+   * \return                    The loaded examples.
+   * \throws std::runtime_error If the file could not be opened, or is not a valid binary example file with the right type of label.
+   */
+  template <typename Label>
+  static std::vector<boost::shared_ptr<const Example<Label> > > load_binary_examples(const std::string& filename)
+  {
+    typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+
+    if(!is_binary_example_file(filename)) throw std::runtime_error("Error: '" + filename + "' is not a binary example file");
+
+    boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+    boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+    const char *data = static_cast<const char*>(region.get_address());
+
+    // Make sure that the file is large enough to contain a header before trying to parse one.
+    if(region.get_size() < BinaryExampleHeader::SIZE) throw std::runtime_error("Error: '" + filename + "' is truncated");
+
+    const BinaryExampleHeader header = BinaryExampleHeader::parse(data);
+    header.check_label_type<Label>();
+    if(region.get_size() < header.total_file_size()) throw std::runtime_error("Error: '" + filename + "' is truncated");
+
+    const size_t featureCount = header.featureCount;
+    const float *features = reinterpret_cast<const float*>(data + BinaryExampleHeader::SIZE);
+    const char *labels = data + header.label_block_offset();
+
+    const int exampleCount = static_cast<int>(header.exampleCount);
+    std::vector<Example_CPtr> result(exampleCount);
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel for
+#endif
+    for(int i = 0; i < exampleCount; ++i)
+    {
+      const float *descriptorBegin = features + i * featureCount;
+      Label label;
+      memcpy(&label, labels + i * sizeof(Label), sizeof(Label));
+      result[i] = boost::make_shared<Example<Label> >(boost::make_shared<Descriptor>(descriptorBegin, descriptorBegin + featureCount), label);
+    }
+
+    return result;
+  }
+
+  /**
+   * \brief Loads a set of examples from the specified CSV example file.
+   *
+   * Each line of the file should contain the features of an example, followed by its label, separated by commas and/or spaces.
    *
    * \param filename  The name of the file from which to load the examples.
    * \return          The loaded examples.
    */
   template <typename Label>
-  static std::vector<boost::shared_ptr<const Example<Label> > > load_examples(const std::string& filename)
+  static std::vector<boost::shared_ptr<const Example<Label> > > load_csv_examples(const std::string& filename)
   {
     // FIXME: Make this robust to bad data.
 
@@ -87,6 +227,18 @@ public:
     return result;
   }
 
+  /**
+   * \brief Loads a set of examples from the specified file, which may be either a CSV example file or a binary example file.
+   *
+   * \param filename  The name of the file from which to load the examples.
+   * \return          The loaded examples.
+   */
+  template <typename Label>
+  static std::vector<boost::shared_ptr<const Example<Label> > > load_examples(const std::string& filename)
+  {
+    return is_binary_example_file(filename) ? load_binary_examples<Label>(filename) : load_csv_examples<Label>(filename);
+  }
+
   /**
    * \brief Makes a histogram from the label distribution of a set of examples.
    *
@@ -120,6 +272,41 @@ public:
   {
     return tvgutil::ProbabilityMassFunction<Label>(make_histogram(examples), multipliers);
   }
+
+  /**
+   * \brief Saves a set of examples to the specified binary example file.
+   *
+   * \param examples            The examples to save (these must all have descriptors of the same size).
+   * \param filename            The name of the file to which to save the examples.
+   * \throws std::runtime_error If the file could not be written, or the examples have descriptors of different sizes.
+   */
+  template <typename Label>
+  static void save_binary_examples(const std::vector<boost::shared_ptr<const Example<Label> > >& examples, const std::string& filename)
+  {
+    std::ofstream os(filename.c_str(), std::ios_base::binary);
+    if(!os) throw std::runtime_error("Error: '" + filename + "' could not be opened for writing");
+
+    const size_t exampleCount = examples.size();
+    const size_t featureCount = exampleCount > 0 ? examples[0]->get_descriptor()->size() : 0;
+    BinaryExampleHeader::make<Label>(exampleCount, static_cast<boost::uint32_t>(featureCount)).write(os);
+
+    // Write the descriptor block.
+    for(size_t i = 0; i < exampleCount; ++i)
+    {
+      const Descriptor& descriptor = *examples[i]->get_descriptor();
+      if(descriptor.size() != featureCount) throw std::runtime_error("Error: Cannot save examples with descriptors of different sizes");
+      if(featureCount > 0) os.write(reinterpret_cast<const char*>(&descriptor[0]), featureCount * sizeof(float));
+    }
+
+    // Write the label block.
+    for(size_t i = 0; i < exampleCount; ++i)
+    {
+      const Label& label = examples[i]->get_label();
+      os.write(reinterpret_cast<const char*>(&label), sizeof(Label));
+    }
+
+    if(!os) throw std::runtime_error("Error: Could not write to '" + filename + "'");
+  }
 };
 
 }
@@ -0,0 +1,265 @@
+/**
+ * raflevaluation: RandomForestBatchEvaluator.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
+ */
+
+#ifndef H_RAFLEVALUATION_RANDOMFORESTBATCHEVALUATOR
+#define H_RAFLEVALUATION_RANDOMFORESTBATCHEVALUATOR
+
+#include <algorithm>
+#include <set>
+
+#include <evaluation/core/ParamSetUtil.h>
+#include <evaluation/core/PerformanceMeasureUtil.h>
+#include <evaluation/splitgenerators/SplitGenerator.h>
+#include <evaluation/util/ConfusionMatrixUtil.h>
+
+#include <rafl/core/RandomForest.h>
+
+#include <tvgutil/containers/MapUtil.h>
+
+namespace raflevaluation {
+
+/**
+ * \brief An instance of this class can be used to evaluate a random forest on many different parameter sets at once.
+ *
+ * Unlike RandomForestEvaluator, which evaluates a single parameter set at a time and only parallelises over its splits,
+ * this evaluator prepares the example set once (labels are packed into a contiguous array of dense class indices that is
+ * shared read-only by all of the jobs), and then schedules every (parameter set, split) pair as an independent job. Each
+ * job trains its own forest and accumulates its predictions into per-thread confusion matrices that are merged when the
+ * job finishes, so no critical sections are needed on the per-example path.
+ *
+ * The results are identical to those produced by running a RandomForestEvaluator for each parameter set in turn (with
+ * the same split generator), and can be recorded in a PerformanceTable in exactly the same way.
+ */
+template <typename Label>
+class RandomForestBatchEvaluator
+{
+  //#################### TYPEDEFS ####################
+private:
+  typedef boost::shared_ptr<const rafl::Example<Label> > Example_CPtr;
+  typedef rafl::DecisionTree<Label> DecisionTree;
+  typedef rafl::RandomForest<Label> RandomForest;
+  typedef boost::shared_ptr<RandomForest> RandomForest_Ptr;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents the example set, packed into a form that can be shared by all of the jobs.
+   */
+  struct PackedExampleSet
+  {
+    /** The distinct class labels that occur in the example set, in ascending order. */
+    std::vector<Label> classLabels;
+
+    /** The examples themselves (these are immutable, so the same instances can safely be shared by all of the forests). */
+    const std::vector<Example_CPtr> *examples;
+
+    /** The dense class index (into classLabels) of the label of each example. */
+    std::vector<int> labelIndices;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The generator to use to split the example set. */
+  evaluation::SplitGenerator_Ptr m_splitGenerator;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a batch random forest evaluator.
+   *
+   * \param splitGenerator  The generator to use to split the example set.
+   */
+  explicit RandomForestBatchEvaluator(const evaluation::SplitGenerator_Ptr& splitGenerator)
+  : m_splitGenerator(splitGenerator)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Evaluates the random forest on the specified set of examples for each of the specified parameter sets.
+   *
+   * \param examples  The examples on which to evaluate the random forest.
+   * \param paramSets The parameter sets with which to configure the random forest.
+   * \return          The results of the evaluation process, one per parameter set (in the same order as the parameter sets).
+   */
+  std::vector<evaluation::PerformanceResult> evaluate(const std::vector<Example_CPtr>& examples, const std::vector<evaluation::ParamSet>& paramSets) const
+  {
+    const PackedExampleSet packedExamples = pack_examples(examples);
+    const int classCount = static_cast<int>(packedExamples.classLabels.size());
+
+    // Generate the splits for each parameter set up-front. Note that we must do this sequentially and in parameter set order,
+    // since the split generator's random number generator advances each time it is used. This ensures that each parameter
+    // set is evaluated on exactly the same splits that it would have been if we had evaluated the parameter sets one by one.
+    const size_t paramSetCount = paramSets.size();
+    std::vector<std::vector<evaluation::SplitGenerator::Split> > splits(paramSetCount);
+    std::vector<std::pair<size_t,size_t> > jobs;
+    for(size_t n = 0; n < paramSetCount; ++n)
+    {
+      splits[n] = m_splitGenerator->generate_splits(examples.size());
+      for(size_t s = 0, splitCount = splits[n].size(); s < splitCount; ++s)
+      {
+        jobs.push_back(std::make_pair(n, s));
+      }
+    }
+
+    // Run all of the (parameter set, split) jobs. The jobs vary significantly in cost (e.g. because of differences in tree
+    // height or split budget), so we schedule them dynamically to allow idle threads to pick up whatever work remains.
+    const int jobCount = static_cast<int>(jobs.size());
+    std::vector<float> jobAccuracies(jobCount);
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for(int i = 0; i < jobCount; ++i)
+    {
+      const evaluation::ParamSet& params = paramSets[jobs[i].first];
+      const evaluation::SplitGenerator::Split& split = splits[jobs[i].first][jobs[i].second];
+
+      size_t splitBudget = 0, treeCount = 0;
+      tvgutil::MapUtil::typed_lookup(params, "splitBudget", splitBudget);
+      tvgutil::MapUtil::typed_lookup(params, "treeCount", treeCount);
+
+      // Make a random forest using the specified settings, add the examples in the training set to it and train it.
+      RandomForest_Ptr randomForest(new RandomForest(treeCount, typename DecisionTree::Settings(params)));
+      randomForest->add_examples(examples, split.first);
+      randomForest->train(splitBudget);
+
+      // Evaluate the forest on the validation set.
+      Eigen::MatrixXf confusionMatrix = make_confusion_matrix(randomForest, packedExamples, split.second, classCount);
+      jobAccuracies[i] = evaluation::ConfusionMatrixUtil::calculate_accuracy(evaluation::ConfusionMatrixUtil::normalise_rows_L1(confusionMatrix));
+    }
+
+    // Gather the results of the jobs for each parameter set (in split order), and average them.
+    std::vector<evaluation::PerformanceResult> results(paramSetCount);
+    for(size_t i = 0, n = 0; n < paramSetCount; ++n)
+    {
+      std::vector<evaluation::PerformanceResult> splitResults;
+      for(size_t s = 0, splitCount = splits[n].size(); s < splitCount; ++s, ++i)
+      {
+        evaluation::PerformanceResult splitResult;
+        splitResult.insert(std::make_pair(std::string("Accuracy"), evaluation::PerformanceMeasure(jobAccuracies[i])));
+        splitResults.push_back(splitResult);
+      }
+      results[n] = evaluation::PerformanceMeasureUtil::average_results(splitResults);
+    }
+
+    return results;
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Finds the dense class index of the specified label.
+   *
+   * \param classLabels The distinct class labels that occur in the example set, in ascending order.
+   * \param label       The label.
+   * \return            The index of the label in classLabels, or -1 if it is not one of the class labels (i.e. no class was predicted).
+   */
+  static int find_class_index(const std::vector<Label>& classLabels, const Label& label)
+  {
+    typename std::vector<Label>::const_iterator it = std::lower_bound(classLabels.begin(), classLabels.end(), label);
+    return it != classLabels.end() && !(label < *it) ? static_cast<int>(it - classLabels.begin()) : -1;
+  }
+
+  /**
+   * \brief Makes a confusion matrix for a random forest from its predictions on a subset of a set of examples.
+   *
+   * Each thread accumulates its predictions into its own dense matrix (indexed by the class indices of the packed
+   * example set), and the per-thread matrices are merged once at the end. The merged matrix is then restricted to
+   * the classes that actually occur in the subset, which matches what ConfusionMatrixUtil::make_confusion_matrix
+   * produces for the same predictions (in particular, predictions of classes that do not occur in the subset, and
+   * predictions of labels that are not classes in the example set at all, are counted against the first class that does).
+   * Predictions of the latter kind are first recorded in an extra "no prediction" column of the dense matrix.
+   *
+   * \param randomForest    The random forest.
+   * \param packedExamples  The packed example set.
+   * \param indices         The indices of the subset of examples on which to evaluate the random forest.
+   * \param classCount      The number of distinct classes in the packed example set.
+   * \return                The confusion matrix.
+   */
+  static Eigen::MatrixXf make_confusion_matrix(const RandomForest_Ptr& randomForest, const PackedExampleSet& packedExamples, const std::vector<size_t>& indices, int classCount)
+  {
+    const std::vector<Example_CPtr>& examples = *packedExamples.examples;
+    const int indicesSize = static_cast<int>(indices.size());
+    const int noPredictionIndex = classCount;
+    Eigen::MatrixXf denseMatrix = Eigen::MatrixXf::Zero(classCount, classCount + 1);
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel
+#endif
+    {
+      Eigen::MatrixXf threadMatrix = Eigen::MatrixXf::Zero(classCount, classCount + 1);
+
+#ifdef WITH_OPENMP
+      #pragma omp for
+#endif
+      for(int i = 0; i < indicesSize; ++i)
+      {
+        const size_t exampleIndex = indices[i];
+        const Label predictedLabel = randomForest->predict(examples[exampleIndex]->get_descriptor());
+        const int predictedIndex = find_class_index(packedExamples.classLabels, predictedLabel);
+        ++threadMatrix(packedExamples.labelIndices[exampleIndex], predictedIndex != -1 ? predictedIndex : noPredictionIndex);
+      }
+
+#ifdef WITH_OPENMP
+      #pragma omp critical
+#endif
+      denseMatrix += threadMatrix;
+    }
+
+    // Determine which classes occur in the subset, and assign them consecutive indices in the restricted matrix.
+    std::vector<int> restrictedIndices(classCount, 0);
+    int restrictedCount = 0;
+    for(int j = 0; j < classCount; ++j)
+    {
+      if(denseMatrix.row(j).sum() > 0.0f) restrictedIndices[j] = restrictedCount++;
+    }
+
+    // Fill in the restricted matrix.
+    Eigen::MatrixXf confusionMatrix = Eigen::MatrixXf::Zero(restrictedCount, restrictedCount);
+    for(int j = 0; j < classCount; ++j)
+    {
+      if(denseMatrix.row(j).sum() == 0.0f) continue;
+      for(int k = 0; k < classCount; ++k)
+      {
+        confusionMatrix(restrictedIndices[j], restrictedIndices[k]) += denseMatrix(j, k);
+      }
+      confusionMatrix(restrictedIndices[j], 0) += denseMatrix(j, noPredictionIndex);
+    }
+
+    return confusionMatrix;
+  }
+
+  /**
+   * \brief Packs a set of examples into a form that can be shared by all of the evaluation jobs.
+   *
+   * \param examples  The examples to pack.
+   * \return          The packed example set.
+   */
+  static PackedExampleSet pack_examples(const std::vector<Example_CPtr>& examples)
+  {
+    PackedExampleSet result;
+    result.examples = &examples;
+
+    std::set<Label> classLabels;
+    for(typename std::vector<Example_CPtr>::const_iterator it = examples.begin(), iend = examples.end(); it != iend; ++it)
+    {
+      classLabels.insert((*it)->get_label());
+    }
+    result.classLabels.assign(classLabels.begin(), classLabels.end());
+
+    result.labelIndices.resize(examples.size());
+    for(size_t i = 0, size = examples.size(); i < size; ++i)
+    {
+      result.labelIndices[i] = static_cast<int>(std::lower_bound(result.classLabels.begin(), result.classLabels.end(), examples[i]->get_label()) - result.classLabels.begin());
+    }
+
+    return result;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ * spaint: FeatureCache.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#ifndef H_SPAINT_FEATURECACHE
+#define H_SPAINT_FEATURECACHE
+
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <ITMLib/Utils/ITMMath.h>
+
+#include "../util/VoxelKeyUtil.h"
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class represents a bounded, thread-safe cache of the feature descriptors that have been calculated for voxels in a scene.
+ *
+ * Each descriptor is keyed by the location of its voxel, and stamped with the fusion generation of the scene at the point at which it was
+ * calculated. A lookup only succeeds if the stamp of the cached descriptor is at least a specified minimum generation, which allows callers
+ * to invalidate descriptors that were calculated before the scene was reset, or that have become too old whilst fusion is running.
+ *
+ * The cache is split into a number of independently-locked shards so that it can be accessed from many threads at once. Each shard has a
+ * fixed number of slots (allocated up-front), and evicts descriptors using the CLOCK (second-chance) policy when it is full.
+ */
+class FeatureCache
+{
+  //#################### TYPEDEFS ####################
+private:
+  typedef VoxelKeyUtil::Key Key;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents a shard of the cache.
+   */
+  struct Shard
+  {
+    //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+    /** The position of the "clock hand" used to choose the slot to evict when the shard is full. */
+    size_t clockHand;
+
+    /** The feature descriptors in the slots (packed sequentially). */
+    std::vector<float> features;
+
+    /** The fusion generations at which the descriptors in the slots were calculated. */
+    std::vector<unsigned int> generations;
+
+    /** The number of successful lookups that have been made in the shard. */
+    size_t hitCount;
+
+    /** The keys of the descriptors in the slots. */
+    std::vector<Key> keys;
+
+    /** The number of unsuccessful lookups that have been made in the shard. */
+    size_t missCount;
+
+    /** The mutex used to synchronise access to the shard. */
+    boost::mutex mutex;
+
+    /** The "referenced" bits of the slots (a slot's bit is set whenever its descriptor is looked up, and cleared as the clock hand passes it). */
+    std::vector<unsigned char> referenced;
+
+    /** A map from keys to the slots that contain their descriptors. */
+    std::map<Key,size_t> slots;
+
+    //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+
+    /**
+     * \brief Constructs a shard.
+     *
+     * \param slotCount     The number of slots in the shard.
+     * \param featureCount  The number of features in each descriptor.
+     */
+    Shard(size_t slotCount, size_t featureCount);
+  };
+
+  typedef boost::shared_ptr<Shard> Shard_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of features in each descriptor. */
+  size_t m_featureCount;
+
+  /** The shards of the cache. */
+  std::vector<Shard_Ptr> m_shards;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a feature cache.
+   *
+   * \param capacity      The maximum number of descriptors the cache can contain.
+   * \param featureCount  The number of features in each descriptor.
+   * \param shardCount    The number of independently-locked shards into which to split the cache.
+   */
+  FeatureCache(size_t capacity, size_t featureCount, size_t shardCount = 16);
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  FeatureCache(const FeatureCache&);
+  FeatureCache& operator=(const FeatureCache&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Removes all of the descriptors from the cache.
+   */
+  void clear();
+
+  /**
+   * \brief Gets the number of successful lookups that have been made in the cache.
+   *
+   * \return  The number of successful lookups that have been made in the cache.
+   */
+  size_t get_hit_count() const;
+
+  /**
+   * \brief Gets the number of unsuccessful lookups that have been made in the cache.
+   *
+   * \return  The number of unsuccessful lookups that have been made in the cache.
+   */
+  size_t get_miss_count() const;
+
+  /**
+   * \brief Attempts to look up the descriptor for the voxel at the specified location.
+   *
+   * \param voxelLocation The location of the voxel.
+   * \param minGeneration The minimum fusion generation at which the descriptor must have been calculated for it to be considered valid.
+   * \param features      A pointer to the location into which to copy the descriptor (if it is found).
+   * \return              true, if a valid descriptor was found for the voxel, or false otherwise.
+   */
+  bool lookup(const Vector3s& voxelLocation, unsigned int minGeneration, float *features) const;
+
+  /**
+   * \brief Stores the descriptor for the voxel at the specified location in the cache (replacing any existing descriptor for the voxel).
+   *
+   * \param voxelLocation The location of the voxel.
+   * \param generation    The fusion generation at which the descriptor was calculated.
+   * \param features      A pointer to the descriptor.
+   */
+  void store(const Vector3s& voxelLocation, unsigned int generation, const float *features);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the shard in which the descriptor with the specified key is (or would be) stored.
+   *
+   * \param key The key.
+   * \return    The shard.
+   */
+  Shard& get_shard(Key key) const;
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<FeatureCache> FeatureCache_Ptr;
+
+}
+
+#endif
@@ -6,6 +6,8 @@
 #ifndef H_SPAINT_VOPFEATURECALCULATOR_CPU
 #define H_SPAINT_VOPFEATURECALCULATOR_CPU
 
+#include <boost/cstdint.hpp>
+
 #include "../interface/VOPFeatureCalculator.h"
 
 namespace spaint {
@@ -26,6 +28,18 @@ public:
    */
   VOPFeatureCalculator_CPU(size_t maxVoxelLocationCount, size_t patchSize, float patchSpacing, size_t binCount);
 
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Computes the Morton code (the code obtained by interleaving the bits of the coordinates) for the specified voxel location.
+   *
+   * Sorting voxel locations by their Morton codes yields an order in which nearby voxels tend to be visited consecutively.
+   *
+   * \param voxelLocation  The voxel location.
+   * \return               The Morton code for the voxel location.
+   */
+  static boost::uint64_t make_morton_code(const Vector3s& voxelLocation);
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /** Override */
@@ -174,6 +174,142 @@ inline void generate_coordinate_system(int voxelLocationIndex, const Vector3f *s
   yAxes[voxelLocationIndex] = cross(xAxis, n);
 }
 
+/**
+ * \brief An instance of this struct can be used to look up voxels in a scene by walking the scene's voxel hash for every lookup.
+ */
+struct HashVoxelReader
+{
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+  /** The scene's index data. */
+  const ITMVoxelIndex::IndexData *indexData;
+
+  /** The scene's voxel data. */
+  const SpaintVoxel *voxelData;
+
+  //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+
+  /**
+   * \brief Constructs a hash voxel reader.
+   *
+   * \param voxelData_ The scene's voxel data.
+   * \param indexData_ The scene's index data.
+   */
+  _CPU_AND_GPU_CODE_
+  HashVoxelReader(const SpaintVoxel *voxelData_, const ITMVoxelIndex::IndexData *indexData_)
+  : indexData(indexData_), voxelData(voxelData_)
+  {}
+
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+
+  /**
+   * \brief Looks up the voxel (if any) at the specified location in the scene.
+   *
+   * \param loc  The location.
+   * \return     A pointer to the voxel, if it exists, or NULL otherwise.
+   */
+  _CPU_AND_GPU_CODE_
+  const SpaintVoxel *find(const Vector3i& loc)
+  {
+    bool isFound;
+    int voxelAddress = findVoxel(indexData, loc, isFound);
+    return isFound ? &voxelData[voxelAddress] : NULL;
+  }
+};
+
+/**
+ * \brief An instance of this struct can be used to look up voxels in a scene via a small cache of recently-used voxel blocks.
+ *
+ * Each time a voxel is looked up, we first resolve the voxel block that contains it. The address of each block (or the fact that
+ * it is not allocated) is cached in a direct-mapped table indexed by the low bits of the block's position, so that a block only
+ * needs to be found in the scene's voxel hash the first time it is encountered (or after it has been evicted by another block).
+ * Subsequent voxels in the same block are then read directly from the voxel data. The table is large enough to hold all of the
+ * blocks touched by a typical VOP patch, so when voxels are processed in a spatially coherent order, blocks are also shared
+ * between consecutive patches.
+ *
+ * A cache is only valid for as long as the scene's index does not change, and is not thread-safe: each thread should use its own.
+ */
+struct BlockCachingVoxelReader
+{
+  //~~~~~~~~~~~~~~~~~~~~ ENUMERATIONS ~~~~~~~~~~~~~~~~~~~~
+
+  enum
+  {
+    /** The number of entries in the cache. */
+    ENTRY_COUNT = 64
+  };
+
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+  /** The addresses of the first voxels in the cached blocks within the scene's voxel data (-1 for blocks that are not allocated). */
+  int blockAddresses[ENTRY_COUNT];
+
+  /** The positions of the cached blocks. */
+  Vector3i blockPositions[ENTRY_COUNT];
+
+  /** Whether or not each cache entry contains a block. */
+  bool filled[ENTRY_COUNT];
+
+  /** The scene's index data. */
+  const ITMVoxelIndex::IndexData *indexData;
+
+  /** The scene's voxel data. */
+  const SpaintVoxel *voxelData;
+
+  //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+
+  /**
+   * \brief Constructs an (initially empty) block-caching voxel reader.
+   *
+   * \param voxelData_ The scene's voxel data.
+   * \param indexData_ The scene's index data.
+   */
+  _CPU_AND_GPU_CODE_
+  BlockCachingVoxelReader(const SpaintVoxel *voxelData_, const ITMVoxelIndex::IndexData *indexData_)
+  : indexData(indexData_), voxelData(voxelData_)
+  {
+    for(int i = 0; i < ENTRY_COUNT; ++i) filled[i] = false;
+  }
+
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+
+  /**
+   * \brief Looks up the voxel (if any) at the specified location in the scene.
+   *
+   * \param loc  The location.
+   * \return     A pointer to the voxel, if it exists, or NULL otherwise.
+   */
+  _CPU_AND_GPU_CODE_
+  const SpaintVoxel *find(const Vector3i& loc)
+  {
+    // Compute the position of the block containing the voxel (rounding towards negative infinity, as InfiniTAM does).
+    Vector3i blockPos(
+      (loc.x < 0 ? loc.x - SDF_BLOCK_SIZE + 1 : loc.x) / SDF_BLOCK_SIZE,
+      (loc.y < 0 ? loc.y - SDF_BLOCK_SIZE + 1 : loc.y) / SDF_BLOCK_SIZE,
+      (loc.z < 0 ? loc.z - SDF_BLOCK_SIZE + 1 : loc.z) / SDF_BLOCK_SIZE
+    );
+
+    // If the block is not in the cache, find it in the voxel hash and cache its address. Note that
+    // looking up the first voxel in the block yields the address of the start of the block's voxels.
+    const int entry = (blockPos.x & 3) | ((blockPos.y & 3) << 2) | ((blockPos.z & 3) << 4);
+    if(!filled[entry] || blockPositions[entry] != blockPos)
+    {
+      bool isFound;
+      int blockAddress = findVoxel(indexData, blockPos * SDF_BLOCK_SIZE, isFound);
+      blockAddresses[entry] = isFound ? blockAddress : -1;
+      blockPositions[entry] = blockPos;
+      filled[entry] = true;
+    }
+
+    // Read the voxel directly from the block (if it is allocated).
+    const int blockAddress = blockAddresses[entry];
+    if(blockAddress < 0) return NULL;
+
+    const Vector3i offset = loc - blockPos * SDF_BLOCK_SIZE;
+    return &voxelData[blockAddress + offset.x + (offset.y + offset.z * SDF_BLOCK_SIZE) * SDF_BLOCK_SIZE];
+  }
+};
+
 /**
  * \brief Generates an RGB patch for the specified voxel by sampling from a regularly-spaced grid around it in its tangent plane.
  *
@@ -183,24 +319,22 @@ inline void generate_coordinate_system(int voxelLocationIndex, const Vector3f *s
  * \param voxelLocations      The locations of the voxels for which to generate RGB patches.
  * \param xAxes               The x axes of the coordinate systems in the tangent planes to the surfaces at the voxel locations.
  * \param yAxes               The y axes of the coordinate systems in the tangent planes to the surfaces at the voxel locations.
- * \param voxelData           The scene's voxel data.
- * \param indexData           The scene's index data.
+ * \param voxelReader         The voxel reader to use to look up the voxels in the scene.
  * \param patchSize           The side length of a VOP patch (must be odd).
  * \param patchSpacing        The spacing in the scene (in voxels) between individual pixels in a patch.
  * \param featureCount        The number of features in a feature descriptor for a voxel.
  * \param features            The feature descriptors for the various voxels (stored sequentially).
  */
-_CPU_AND_GPU_CODE_
+template <typename VoxelReader>
+_CPU_AND_GPU_CODE_TEMPLATE_
 inline void generate_rgb_patch(int voxelLocationIndex, const Vector3s *voxelLocations, const Vector3f *xAxes, const Vector3f *yAxes,
-                               const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData, size_t patchSize, float patchSpacing,
-                               size_t featureCount, float *features)
+                               VoxelReader& voxelReader, size_t patchSize, float patchSpacing, size_t featureCount, float *features)
 {
   // Get the location of the voxel at the centre of the patch.
   Vector3f centre = voxelLocations[voxelLocationIndex].toFloat();
 
   // Generate an RGB patch around the voxel on a patchSize * patchSize grid aligned with the voxel's x and y axes.
   int halfPatchSize = static_cast<int>(patchSize - 1) / 2;
-  bool isFound;
   Vector3f xAxis = xAxes[voxelLocationIndex] * patchSpacing;
   Vector3f yAxis = yAxes[voxelLocationIndex] * patchSpacing;
 
@@ -216,8 +350,8 @@ inline void generate_rgb_patch(int voxelLocationIndex, const Vector3s *voxelLoca
 
       // If there is a voxel at that location, get its colour; otherwise, default to magenta.
       Vector3u clr(255, 0, 255);
-      SpaintVoxel voxel = readVoxel(voxelData, indexData, loc, isFound);
-      if(isFound) clr = VoxelColourReader<SpaintVoxel::hasColorInformation>::read(voxel);
+      const SpaintVoxel *voxel = voxelReader.find(loc);
+      if(voxel) clr = VoxelColourReader<SpaintVoxel::hasColorInformation>::read(*voxel);
 
       // Write the colour values into the relevant places in the features array.
       features[offset++] = clr.r;
@@ -227,6 +361,31 @@ inline void generate_rgb_patch(int voxelLocationIndex, const Vector3s *voxelLoca
   }
 }
 
+/**
+ * \brief Generates an RGB patch for the specified voxel by sampling from a regularly-spaced grid around it in its tangent plane.
+ *
+ * Each pixel in the patch is looked up independently in the scene's voxel hash.
+ *
+ * \param voxelLocationIndex  The index of the voxel for which to generate an RGB patch.
+ * \param voxelLocations      The locations of the voxels for which to generate RGB patches.
+ * \param xAxes               The x axes of the coordinate systems in the tangent planes to the surfaces at the voxel locations.
+ * \param yAxes               The y axes of the coordinate systems in the tangent planes to the surfaces at the voxel locations.
+ * \param voxelData           The scene's voxel data.
+ * \param indexData           The scene's index data.
+ * \param patchSize           The side length of a VOP patch (must be odd).
+ * \param patchSpacing        The spacing in the scene (in voxels) between individual pixels in a patch.
+ * \param featureCount        The number of features in a feature descriptor for a voxel.
+ * \param features            The feature descriptors for the various voxels (stored sequentially).
+ */
+_CPU_AND_GPU_CODE_
+inline void generate_rgb_patch(int voxelLocationIndex, const Vector3s *voxelLocations, const Vector3f *xAxes, const Vector3f *yAxes,
+                               const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData, size_t patchSize, float patchSpacing,
+                               size_t featureCount, float *features)
+{
+  HashVoxelReader voxelReader(voxelData, indexData);
+  generate_rgb_patch(voxelLocationIndex, voxelLocations, xAxes, yAxes, voxelReader, patchSize, patchSpacing, featureCount, features);
+}
+
 /**
  * \brief Updates the coordinate system for a voxel to align it with the dominant orientation in the voxel's RGB patch.
  *
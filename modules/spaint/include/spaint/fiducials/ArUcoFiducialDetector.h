@@ -8,8 +8,10 @@
 
 #include <boost/optional.hpp>
 
+#include <opencv2/aruco.hpp>
 #include <opencv2/opencv.hpp>
 
+#include <itmx/base/ITMMemoryBlockPtrTypes.h>
 #include <itmx/picking/interface/Picker.h>
 
 #include "FiducialDetector.h"
@@ -18,17 +20,54 @@ namespace spaint {
 
 /**
  * \brief An instance of this class can be used to detect ArUco fiducials in a 3D scene.
+ *
+ * To keep detection cheap enough to run during live mapping, the detector tracks the fiducials it has found: on most frames,
+ * it only searches for them in small regions around their predicted positions (extrapolated from their last two detections),
+ * and it only searches the whole frame (e.g. to find newly-visible fiducials) at a configurable interval, or when a tracked
+ * fiducial is lost.
  */
 class ArUcoFiducialDetector : public FiducialDetector
 {
+  //#################### TYPEDEFS ####################
+private:
+  typedef std::vector<cv::Point2f> MarkerCorners;
+  typedef std::map<int,MarkerCorners> MarkerCornersMap;
+
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The dictionary of ArUco markers to detect. */
+  cv::aruco::Dictionary m_dictionary;
+
+  /** The number of frames until the next full-frame detection. */
+  mutable int m_framesUntilFullDetection;
+
+  /** The number of frames between full-frame detections (1 disables tracking, i.e. every frame is searched in full). */
+  int m_fullDetectionInterval;
+
+  /** The corners of the markers that were detected in the previous frame (used to extrapolate the corners' motion). */
+  mutable MarkerCornersMap m_previousCorners;
+
+  /** A memory block into which to write the image points to pick when estimating poses from the scene raycast. */
+  ITMInt2MemoryBlock_Ptr m_pickImagePointsMB;
+
   /** The picker used when estimating poses from the scene raycast. */
   mutable itmx::Picker_CPtr m_picker;
 
+  /** A memory block into which to write the scene points picked when estimating poses from the scene raycast. */
+  ITMFloat3MemoryBlock_Ptr m_pickScenePointsMB;
+
+  /** A memory block into which to write whether or not a scene point was picked for each image point when estimating poses from the scene raycast. */
+  ITMBoolMemoryBlock_Ptr m_pickScenePointsValidMB;
+
+  /** The margin to add around the predicted bounding box of a tracked marker to get the region in which to search for it (as a fraction of the box's size). */
+  float m_roiMargin;
+
   /** The settings to use for InfiniTAM. */
   Settings_CPtr m_settings;
 
+  /** The corners of the markers that were detected in the current frame. */
+  mutable MarkerCornersMap m_trackedCorners;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -101,14 +140,35 @@ private:
   boost::optional<Vector3f> pick_corner_from_depth(const cv::Point2f& corner, const View_CPtr& view) const;
 
   /**
-   * \brief Tries to determine the 3D point in world space that corresponds to a fiducial corner in the live colour image
-   *        by looking it up in a raycast of the scene from the pose of the depth camera.
+   * \brief Detects any ArUco markers that are visible in the live colour image, either by searching the whole image,
+   *        or by searching only the regions in which the markers we are tracking are predicted to be.
+   *
+   * \param rgb     The live colour image.
+   * \param ids     A vector into which to write the IDs of the detected markers.
+   * \param corners A vector into which to write the corners of the detected markers.
+   */
+  void detect_markers(const ITMUChar4Image *rgb, std::vector<int>& ids, std::vector<MarkerCorners>& corners) const;
+
+  /**
+   * \brief Tries to determine the 3D points in world space that correspond to the fiducial corners that are used for pose estimation
+   *        (the fourth, third and first corners of each fiducial) by looking them up in a raycast of the scene from the pose of the
+   *        depth camera. All of the corners are picked in a single batch.
    *
-   * \param corner      The fiducial corner in the live colour image.
+   * \param corners     The corners of the fiducials that have been detected in the live colour image.
    * \param renderState The render state containing the scene raycast.
-   * \return            The 3D point in world space corresponding to the fiducial corner (if any), or boost::none otherwise.
+   * \return            The 3D points in world space corresponding to the fiducial corners (boost::none for any corner that could not be picked),
+   *                    in the order (corners[0][3], corners[0][2], corners[0][0], corners[1][3], ...).
+   */
+  std::vector<boost::optional<Vector3f> > pick_corners_from_raycast(const std::vector<MarkerCorners>& corners, const VoxelRenderState_CPtr& renderState) const;
+
+  /**
+   * \brief Predicts the region of the live colour image in which to search for a tracked marker.
+   *
+   * \param id      The ID of the marker.
+   * \param imgSize The size of the live colour image.
+   * \return        The region in which to search for the marker (empty if the marker is predicted to have left the image).
    */
-  boost::optional<Vector3f> pick_corner_from_raycast(const cv::Point2f& corner, const VoxelRenderState_CPtr& renderState) const;
+  cv::Rect predict_roi(int id, const cv::Size& imgSize) const;
 
   //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 private:
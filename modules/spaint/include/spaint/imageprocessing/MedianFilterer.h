@@ -8,33 +8,42 @@
 
 #include <ORUtils/DeviceType.h>
 
-#include "interface/ImageProcessor.h"
+#include <itmx/base/ITMImagePtrTypes.h>
 
 namespace spaint {
 
 /**
  * \brief An instance of this class can be used to perform median filtering on RGBA images.
+ *
+ * The filtering is performed natively on the CPU, directly on the interleaved RGBA layout used by InfiniTAM: each channel
+ * is filtered independently, and pixels outside the image are treated as zero. For the common 3x3 and 5x5 kernels, each
+ * median is computed using a fixed sorting network that is evaluated on 4 pixels (16 channel values) at once using SIMD
+ * min/max instructions, and rows are filtered in parallel. For wider kernels, a constant-time approach based on per-column
+ * histograms is used, and vertical strips of the image are filtered in parallel.
+ *
+ * If the filterer is operating on the GPU, the image is temporarily transferred to the CPU to be filtered.
  */
 class MedianFilterer
 {
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The image processor. */
-  ImageProcessor_CPtr m_imageProcessor;
-
-  /** An intermediate ArrayFire image on which to actually perform the filtering. */
-  mutable boost::shared_ptr<af::array> m_intermediate;
+  /** The device on which the images to be filtered reside. */
+  DeviceType m_deviceType;
 
   /** The kernel width to use for median filtering. */
   unsigned int m_kernelWidth;
 
+  /** A scratch image used to hold a copy of the input image when filtering in place. */
+  mutable ITMUChar4Image_Ptr m_scratch;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Constructs a median filterer.
    *
-   * \param kernelWidth The kernel width to use for median filtering.
-   * \param deviceType  The device on which the filterer should operate.
+   * \param kernelWidth         The kernel width to use for median filtering (must be odd, and at most 255).
+   * \param deviceType          The device on which the images to be filtered reside.
+   * \throws std::runtime_error If the kernel width is even or greater than 255.
    */
   MedianFilterer(unsigned int kernelWidth, DeviceType deviceType);
 
@@ -44,14 +53,25 @@ public:
    * \brief Performs median filtering on an RGBA input image to produce an RGBA output image.
    *
    * The median filtering will be performed using the parameters provided when the filterer was constructed.
-   *
-   * FIXME: Median filtering can occasionally fail due to a possible crash bug in ArrayFire. If this happens,
-   *        we currently avoid throwing and instead treat this function as a no-op.
+   * The input and output images may be the same image, in which case the filtering is performed in place.
    *
    * \param input   The input image.
    * \param output  The output image.
    */
   void operator()(const ITMUChar4Image_CPtr& input, const ITMUChar4Image_Ptr& output) const;
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Performs median filtering on an RGBA image stored in CPU memory.
+   *
+   * \param input       The pixels of the input image (must not overlap the output image).
+   * \param output      The pixels of the output image.
+   * \param width       The width of the images.
+   * \param height      The height of the images.
+   * \param kernelWidth The kernel width to use for median filtering (must be odd, and at most 255).
+   */
+  static void median_filter_cpu(const Vector4u *input, Vector4u *output, int width, int height, unsigned int kernelWidth);
 };
 
 }
@@ -59,6 +59,27 @@ inline void clear_label(SpaintVoxel& voxel, ClearingSettings settings)
   if(shouldClear) packedLabel = SpaintVoxel::PackedLabel();
 }
 
+/**
+ * \brief Marks the voxel at the specified address in the scene's voxel data with a semantic label.
+ *
+ * \param voxelAddress  The address of the voxel in the scene's voxel data.
+ * \param label         The semantic label with which to mark the voxel.
+ * \param oldLabel      An optional location into which to store the old semantic label of the voxel.
+ * \param voxelData     The scene's voxel data.
+ * \param mode          The marking mode.
+ */
+_CPU_AND_GPU_CODE_
+inline void mark_voxel_at(int voxelAddress, SpaintVoxel::PackedLabel label, SpaintVoxel::PackedLabel *oldLabel,
+                          SpaintVoxel *voxelData, MarkingMode mode = NORMAL_MARKING)
+{
+  SpaintVoxel::PackedLabel oldLabelLocal = voxelData[voxelAddress].packedLabel;
+  if(oldLabel) *oldLabel = oldLabelLocal;
+  if(mode == FORCED_MARKING || can_overwrite_label(oldLabelLocal, label))
+  {
+    voxelData[voxelAddress].packedLabel = label;
+  }
+}
+
 /**
  * \brief Marks a voxel in the scene with a semantic label.
  *
@@ -76,15 +97,7 @@ inline void mark_voxel(const Vector3s& loc, SpaintVoxel::PackedLabel label, Spai
 {
   bool isFound;
   int voxelAddress = findVoxel(voxelIndex, loc.toInt(), isFound);
-  if(isFound)
-  {
-    SpaintVoxel::PackedLabel oldLabelLocal = voxelData[voxelAddress].packedLabel;
-    if(oldLabel) *oldLabel = oldLabelLocal;
-    if(mode == FORCED_MARKING || can_overwrite_label(oldLabelLocal, label))
-    {
-      voxelData[voxelAddress].packedLabel = label;
-    }
-  }
+  if(isFound) mark_voxel_at(voxelAddress, label, oldLabel, voxelData, mode);
 }
 
 }
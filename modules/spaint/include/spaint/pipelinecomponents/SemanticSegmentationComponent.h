@@ -9,7 +9,9 @@
 #include <rafl/core/RandomForest.h>
 
 #include "SemanticSegmentationContext.h"
+#include "../features/FeatureCache.h"
 #include "../features/interface/FeatureCalculator.h"
+#include "../sampling/PredictionScheduler.h"
 #include "../sampling/interface/PerLabelVoxelSampler.h"
 #include "../sampling/interface/UniformVoxelSampler.h"
 
@@ -29,30 +31,60 @@ private:
   /** The shared context needed for semantic segmentation. */
   SemanticSegmentationContext_Ptr m_context;
 
+  /** The cache of feature descriptors that have been calculated for voxels in the scene (NULL if feature caching is disabled). */
+  FeatureCache_Ptr m_featureCache;
+
   /** The feature calculator. */
   FeatureCalculator_CPtr m_featureCalculator;
 
   /** The random forest. */
   RandomForest_Ptr m_forest;
 
+  /** The current version of the random forest (incremented whenever the forest is reset or trained). */
+  unsigned int m_forestVersion;
+
+  /** The maximum number of fusion generations for which a cached feature descriptor remains valid whilst the scene is being fused. */
+  unsigned int m_maxFeatureCacheAge;
+
   /** The maximum number of voxels for which to predict labels each frame. */
   size_t m_maxPredictionVoxelCount;
 
   /** The maximum number of voxels per label from which to train each frame. */
   size_t m_maxTrainingVoxelsPerLabel;
 
+  /** A memory block in which to store the feature vectors computed for the voxels that miss the feature cache. */
+  boost::shared_ptr<ORUtils::MemoryBlock<float> > m_missFeaturesMB;
+
+  /** A memory block in which to store the locations of the voxels that miss the feature cache. */
+  Selector::Selection_Ptr m_missVoxelLocationsMB;
+
   /** The side length of a VOP patch (must be odd). */
   size_t m_patchSize;
 
+  /** The path to a file to which to write the coverage history of the prediction scheduler when the component is destroyed (if any). */
+  std::string m_predictionCoverageFile;
+
+  /** The label clear generation of the scene when the prediction scheduler was last used. */
+  unsigned int m_predictionClearGeneration;
+
   /** A memory block in which to store the feature vectors computed for the various voxels during prediction. */
   boost::shared_ptr<ORUtils::MemoryBlock<float> > m_predictionFeaturesMB;
 
   /** A memory block in which to store the labels predicted for the various voxels. */
   boost::shared_ptr<ORUtils::MemoryBlock<SpaintVoxel::PackedLabel> > m_predictionLabelsMB;
 
-  /** The voxel sampler used in prediction mode. */
+  /** The fusion generation at which the scene had last been reset when the prediction scheduler was last used. */
+  unsigned int m_predictionResetGeneration;
+
+  /** The voxel sampler used in prediction mode (if the prediction scheduler is disabled). */
   UniformVoxelSampler_CPtr m_predictionSampler;
 
+  /** The scheduler used to choose the voxels for which to predict labels (NULL if uniform sampling should be used instead). */
+  PredictionScheduler_Ptr m_predictionScheduler;
+
+  /** Whether or not to print the feature cache statistics when the component is destroyed. */
+  bool m_printFeatureCacheStats;
+
   /** A memory block in which to store the locations of the voxels sampled for prediction purposes. */
   Selector::Selection_Ptr m_predictionVoxelLocationsMB;
 
@@ -88,6 +120,13 @@ public:
    */
   SemanticSegmentationComponent(const SemanticSegmentationContext_Ptr& context, const std::string& sceneID, unsigned int seed);
 
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the semantic segmentation component.
+   */
+  ~SemanticSegmentationComponent();
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
@@ -122,6 +161,20 @@ public:
    * \param renderState The render state associated with the camera position from which to sample voxels.
    */
   void run_training(const VoxelRenderState_CPtr& renderState);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Calculates feature descriptors for the specified subset of a set of voxels, using the feature cache where possible.
+   *
+   * The descriptors of voxels that hit the cache are copied out of it; those of the remaining voxels are then calculated
+   * in a single batch and stored in the cache. Descriptors are not calculated for voxels that are not in the subset.
+   *
+   * \param voxelLocationsMB  A memory block containing the locations of the voxels.
+   * \param indices           The indices of the voxels in the subset.
+   * \param featuresMB        A memory block into which to store the feature descriptors (packed sequentially, and indexed as per the voxels).
+   */
+  void calculate_features(const ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB, const std::vector<int>& indices, ORUtils::MemoryBlock<float>& featuresMB);
 };
 
 //#################### TYPEDEFS ####################
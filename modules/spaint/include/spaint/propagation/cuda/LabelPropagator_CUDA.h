@@ -20,20 +20,16 @@ public:
   /**
    * \brief Constructs a CUDA-based label propagator.
    *
-   * \param raycastResultSize                 The size of the raycast result (in pixels).
    * \param maxAngleBetweenNormals            The largest angle allowed between the normals of neighbouring voxels if propagation is to occur.
    * \param maxSquaredDistanceBetweenColours  The maximum squared distance allowed between the colours of neighbouring voxels if propagation is to occur.
    * \param maxSquaredDistanceBetweenVoxels   The maximum squared distance allowed between the positions of neighbouring voxels if propagation is to occur.
    */
-  LabelPropagator_CUDA(size_t raycastResultSize, float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours, float maxSquaredDistanceBetweenVoxels);
-
-  //#################### PRIVATE MEMBER FUNCTIONS ####################
-private:
-  /** Override */
-  virtual void calculate_normals(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene) const;
+  LabelPropagator_CUDA(float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours, float maxSquaredDistanceBetweenVoxels);
 
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
   /** Override */
-  virtual void perform_propagation(SpaintVoxel::Label label, const ITMFloat4Image *raycastResult, SpaintVoxelScene *scene) const;
+  virtual void propagate_label(SpaintVoxel::Label label, const SurfaceGBuffer& gbuffer, SpaintVoxelScene *scene) const;
 };
 
 }
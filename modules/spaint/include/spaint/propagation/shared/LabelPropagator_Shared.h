@@ -22,11 +22,12 @@ namespace spaint {
  * \param label                             The label being propagated.
  * \param loc                               The position of the voxel of interest in the scene.
  * \param normal                            The surface normal of the voxel of interest.
- * \param colour                            The RGB colour of the voxel of interest.
+ * \param labColour                         The colour of the voxel of interest (in CIELab).
  * \param raycastResult                     The raycast result.
- * \param surfaceNormals                    The surface normals for the voxels in the raycast result.
- * \param voxelData                         The scene's voxel data.
- * \param indexData                         The scene's index data.
+ * \param surfaceNormals                    The surface normals of the voxels in the raycast result.
+ * \param surfaceColours                    The colours of the voxels in the raycast result.
+ * \param surfaceLabels                     The packed labels of the voxels in the raycast result.
+ * \param voxelAddresses                    The addresses of the voxels in the raycast result within the scene's voxel data (-1 for pixels without a voxel).
  * \param maxAngleBetweenNormals            The largest angle allowed between the normals of the neighbour and the voxel of interest if propagation is to occur.
  * \param maxSquaredDistanceBetweenColours  The maximum squared distance allowed between the colours of the neighbour and the voxel of interest if propagation is to occur.
  * \param maxSquaredDistanceBetweenVoxels   The maximum squared distance allowed between the positions of the neighbour and the voxel of interest if propagation is to occur.
@@ -34,31 +35,29 @@ namespace spaint {
  */
 _CPU_AND_GPU_CODE_
 inline bool should_propagate_from_neighbour(int neighbourX, int neighbourY, int width, int height, SpaintVoxel::Label label,
-                                            const Vector3f& loc, const Vector3f& normal, const Vector3u& colour,
-                                            const Vector4f *raycastResult, const Vector3f *surfaceNormals,
-                                            const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                            const Vector3f& loc, const Vector3f& normal, const Vector3f& labColour,
+                                            const Vector4f *raycastResult, const Vector3f *surfaceNormals, const Vector3u *surfaceColours,
+                                            const SpaintVoxel::PackedLabel *surfaceLabels, const int *voxelAddresses,
                                             float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours,
                                             float maxSquaredDistanceBetweenVoxels)
 {
   // If the neighbour is outside the raycast result, early out.
   if(neighbourX < 0 || neighbourX >= width || neighbourY < 0 || neighbourY >= height) return false;
 
-  // Look up the position, normal and colour of the neighbouring voxel.
+  // If there is no voxel at the neighbour's position in the raycast result, early out.
   int neighbourVoxelIndex = neighbourY * width + neighbourX;
-  Vector3f neighbourLoc = raycastResult[neighbourVoxelIndex].toVector3();
-
-  bool foundPoint;
-  const SpaintVoxel neighbourVoxel = readVoxel(voxelData, indexData, neighbourLoc.toIntRound(), foundPoint);
-  if(!foundPoint) return false;
+  if(voxelAddresses[neighbourVoxelIndex] < 0) return false;
 
+  // Look up the position, normal and colour of the neighbouring voxel.
+  Vector3f neighbourLoc = raycastResult[neighbourVoxelIndex].toVector3();
   Vector3f neighbourNormal = surfaceNormals[neighbourVoxelIndex];
-  Vector3u neighbourColour = VoxelColourReader<SpaintVoxel::hasColorInformation>::read(neighbourVoxel);
+  Vector3u neighbourColour = surfaceColours[neighbourVoxelIndex];
 
   // Compute the angle between the neighbour's normal and the normal of the voxel of interest.
   float angleBetweenNormals = acosf(dot(normal, neighbourNormal) / (length(normal) * length(neighbourNormal)));
 
   // Compute the distance between the neighbour's colour and the colour of the voxel of interest.
-  Vector3f colourOffset = itmx::convert_rgb_to_lab(neighbourColour.toFloat()) - itmx::convert_rgb_to_lab(colour.toFloat());
+  Vector3f colourOffset = itmx::convert_rgb_to_lab(neighbourColour.toFloat()) - labColour;
   float squaredDistanceBetweenColours = dot(colourOffset, colourOffset);
 
   // Compute the squared distance between the neighbour's position and the position of the voxel of interest.
@@ -67,7 +66,7 @@ inline bool should_propagate_from_neighbour(int neighbourX, int neighbourY, int
   float distanceBetweenVoxels = sqrt(squaredDistanceBetweenVoxels);
 
   // Decide whether or not propagation should occur.
-  return neighbourVoxel.packedLabel.label == label &&
+  return surfaceLabels[neighbourVoxelIndex].label == label &&
          angleBetweenNormals <= maxAngleBetweenNormals * distanceBetweenVoxels &&
          squaredDistanceBetweenColours <= maxSquaredDistanceBetweenColours * distanceBetweenVoxels &&
          squaredDistanceBetweenVoxels <= maxSquaredDistanceBetweenVoxels;
@@ -81,29 +80,30 @@ inline bool should_propagate_from_neighbour(int neighbourX, int neighbourY, int
  * \param height                            The height of the raycast result.
  * \param label                             The label being propagated.
  * \param raycastResult                     The raycast result.
- * \param surfaceNormals                    The surface normals for the voxels in the raycast result.
+ * \param surfaceNormals                    The surface normals of the voxels in the raycast result.
+ * \param surfaceColours                    The colours of the voxels in the raycast result.
+ * \param surfaceLabels                     The packed labels of the voxels in the raycast result.
+ * \param voxelAddresses                    The addresses of the voxels in the raycast result within the scene's voxel data (-1 for pixels without a voxel).
  * \param voxelData                         The scene's voxel data.
- * \param indexData                         The scene's index data.
  * \param maxAngleBetweenNormals            The largest angle allowed between the normals of the neighbour and the voxel of interest if propagation is to occur.
  * \param maxSquaredDistanceBetweenColours  The maximum squared distance allowed between the colours of the neighbour and the voxel of interest if propagation is to occur.
  * \param maxSquaredDistanceBetweenVoxels   The maximum squared distance allowed between the positions of the neighbour and the voxel of interest if propagation is to occur.
  */
 _CPU_AND_GPU_CODE_
 inline void propagate_from_neighbours(int voxelIndex, int width, int height, SpaintVoxel::Label label,
-                                      const Vector4f *raycastResult, const Vector3f *surfaceNormals,
-                                      SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                      const Vector4f *raycastResult, const Vector3f *surfaceNormals, const Vector3u *surfaceColours,
+                                      const SpaintVoxel::PackedLabel *surfaceLabels, const int *voxelAddresses, SpaintVoxel *voxelData,
                                       float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours,
                                       float maxSquaredDistanceBetweenVoxels)
 {
+  // If there is no voxel at the specified position in the raycast result, early out.
+  const int voxelAddress = voxelAddresses[voxelIndex];
+  if(voxelAddress < 0) return;
+
   // Look up the position, normal and colour of the specified voxel.
   Vector3f loc = raycastResult[voxelIndex].toVector3();
   Vector3f normal = surfaceNormals[voxelIndex];
-
-  bool foundPoint;
-  const SpaintVoxel voxel = readVoxel(voxelData, indexData, loc.toIntRound(), foundPoint);
-  if(!foundPoint) return;
-
-  Vector3u colour = VoxelColourReader<SpaintVoxel::hasColorInformation>::read(voxel);
+  Vector3f labColour = itmx::convert_rgb_to_lab(surfaceColours[voxelIndex].toFloat());
 
   // Based on these properties and the properties of the neighbouring voxels, decide whether or not
   // the specified voxel should be marked with the label being propagated, and mark it if so.
@@ -111,8 +111,8 @@ inline void propagate_from_neighbours(int voxelIndex, int width, int height, Spa
   int y = voxelIndex / width;
 
 #define SPFN(nx,ny) should_propagate_from_neighbour( \
-  nx, ny, width, height, label, loc, normal, colour, \
-  raycastResult, surfaceNormals, voxelData, indexData, \
+  nx, ny, width, height, label, loc, normal, labColour, \
+  raycastResult, surfaceNormals, surfaceColours, surfaceLabels, voxelAddresses, \
   maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, \
   maxSquaredDistanceBetweenVoxels)
 
@@ -121,37 +121,12 @@ inline void propagate_from_neighbours(int voxelIndex, int width, int height, Spa
      (SPFN(x, y - 2) && SPFN(x, y - 5)) ||
      (SPFN(x, y + 2) && SPFN(x, y + 5)))
   {
-    mark_voxel(loc.toShortRound(), SpaintVoxel::PackedLabel(label, SpaintVoxel::LG_PROPAGATED), NULL, voxelData, indexData);
+    mark_voxel_at(voxelAddress, SpaintVoxel::PackedLabel(label, SpaintVoxel::LG_PROPAGATED), NULL, voxelData);
   }
 
 #undef SPFN
 }
 
-/**
- * \brief Calculates the normal of the specified voxel in the raycast result and writes it into the surface normals array.
- *
- * \param voxelIndex      The index of the voxel whose normal is to be calculated.
- * \param raycastResult   The raycast result.
- * \param voxelData       The scene's voxel data.
- * \param indexData       The scene's index data.
- * \param surfaceNormals  The array into which to write the calculated surface normal.
- */
-_CPU_AND_GPU_CODE_
-inline void write_surface_normal(int voxelIndex, const Vector4f *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData, Vector3f *surfaceNormals)
-{
-  Vector4f loc = raycastResult[voxelIndex];
-
-  // If the voxel is valid, compute its actual surface normal; otherwise, use a default.
-  Vector3f n(0.0f, 0.0f, 0.0f);
-  if(loc.w > 0)
-  {
-    n = computeSingleNormalFromSDF(voxelData, indexData, loc.toVector3());
-  }
-
-  // Write the normal into the surface normals array.
-  surfaceNormals[voxelIndex] = n;
-}
-
 }
 
 #endif
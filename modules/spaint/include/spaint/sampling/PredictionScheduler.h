@@ -0,0 +1,138 @@
+/**
+ * spaint: PredictionScheduler.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#ifndef H_SPAINT_PREDICTIONSCHEDULER
+#define H_SPAINT_PREDICTIONSCHEDULER
+
+#include <map>
+
+#include <boost/chrono/chrono.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ITMLib/Utils/ITMImageTypes.h>
+
+#include "../util/VoxelKeyUtil.h"
+
+namespace tvgutil {
+
+//#################### FORWARD DECLARATIONS ####################
+
+class RandomNumberGenerator;
+
+}
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class can be used to decide which of the voxels that are visible in a raycast result should have their labels predicted.
+ *
+ * Rather than uniformly sampling pixels from the raycast result (which wastes feature evaluations on invalid pixels, on
+ * pixels that are sampled more than once, and on voxels whose predicted labels could not have changed), the scheduler
+ * keeps a record of the forest version with which each voxel was last predicted. Each frame, it examines a stratified
+ * set of candidate pixels, discards those that are invalid or that map to the same voxel as another candidate, and then
+ * schedules the remaining voxels in priority order: voxels that have never been predicted (e.g. because they have just
+ * become visible) come first, followed by voxels that were last predicted with an older version of the forest (oldest
+ * first). Voxels that have already been predicted with the current version of the forest are not scheduled at all.
+ *
+ * The scheduler also records how the coverage of the visible scene (the fraction of candidate voxels that are up to date
+ * with respect to the current forest) evolves over time and with the number of voxels predicted. Only the most recent
+ * frames are kept, so that the memory used by the record stays bounded however long the scheduler is used.
+ */
+class PredictionScheduler
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct records the state of the prediction process at the end of a frame.
+   */
+  struct CoverageSample
+  {
+    /** The fraction of the candidate voxels examined during the frame that are up to date with respect to the current forest. */
+    float coverage;
+
+    /** The time that has elapsed since the first frame was scheduled (in seconds). */
+    double elapsedSeconds;
+
+    /** The total number of voxels that have been scheduled for prediction so far. */
+    size_t predictedVoxelCount;
+  };
+
+  //#################### TYPEDEFS ####################
+private:
+  typedef VoxelKeyUtil::Key Key;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of candidate pixels to examine for each voxel that can be scheduled. */
+  size_t m_candidateFactor;
+
+  /** The state of the prediction process at the end of each of the most recent frames (oldest first). */
+  boost::circular_buffer<CoverageSample> m_coverageHistory;
+
+  /** The maximum number of voxels whose forest versions will be tracked. */
+  size_t m_maxTrackedVoxelCount;
+
+  /** The total number of voxels that have been scheduled for prediction so far. */
+  size_t m_predictedVoxelCount;
+
+  /** The forest versions with which the tracked voxels were last predicted. */
+  std::map<Key,unsigned int> m_predictionVersions;
+
+  /** A random number generator. */
+  boost::shared_ptr<tvgutil::RandomNumberGenerator> m_rng;
+
+  /** The time at which the first frame was scheduled (if any). */
+  boost::optional<boost::chrono::steady_clock::time_point> m_startTime;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a prediction scheduler.
+   *
+   * \param seed                  The seed for the random number generator.
+   * \param maxTrackedVoxelCount  The maximum number of voxels whose forest versions will be tracked.
+   * \param candidateFactor       The number of candidate pixels to examine for each voxel that can be scheduled.
+   * \param maxCoverageHistory    The maximum number of frames for which to keep a record of the state of the prediction process.
+   */
+  explicit PredictionScheduler(unsigned int seed, size_t maxTrackedVoxelCount = 1 << 20, size_t candidateFactor = 4, size_t maxCoverageHistory = 1 << 16);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the state of the prediction process at the end of each of the most recent frames that have been scheduled since the scheduler was last reset.
+   *
+   * \return  The state of the prediction process at the end of each of the most recent frames (oldest first).
+   */
+  const boost::circular_buffer<CoverageSample>& get_coverage_history() const;
+
+  /**
+   * \brief Forgets all of the voxels that have been predicted (e.g. because the scene has been reset).
+   */
+  void reset();
+
+  /**
+   * \brief Schedules up to the specified number of voxels from the raycast result for prediction.
+   *
+   * The scheduled voxels are assumed to be predicted using the specified version of the forest.
+   *
+   * \param raycastResult     The current raycast result.
+   * \param maxVoxelCount     The maximum number of voxels to schedule.
+   * \param forestVersion     The current version of the forest.
+   * \param voxelLocationsMB  A memory block into which to write the locations of the scheduled voxels (this must have been allocated
+   *                          with space for at least maxVoxelCount voxels; its size will be set to the number of voxels scheduled).
+   * \return                  The number of voxels that were scheduled.
+   */
+  size_t schedule_voxels(const ITMFloat4Image *raycastResult, size_t maxVoxelCount, unsigned int forestVersion, ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<PredictionScheduler> PredictionScheduler_Ptr;
+
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <tvgutil/timing/AverageTimer.h>
+
 #include "ColourAppearanceModel.h"
 #include "Segmenter.h"
 #include "../touch/TouchDetector.h"
@@ -22,11 +24,36 @@ namespace spaint {
  */
 class BackgroundSubtractingObjectSegmenter : public Segmenter
 {
+  //#################### TYPEDEFS ####################
+private:
+  typedef tvgutil::AverageTimer<boost::chrono::microseconds> AverageTimer;
+
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** A mask of any changes in the scene with respect to the reconstructed model (reused from frame to frame). */
+  ITMUCharImage_Ptr m_changeMask;
+
   /** The colour appearance model to use to separate the user's hand from any object it's holding. */
   ColourAppearanceModel_Ptr m_handAppearanceModel;
 
+  /** A mask denoting the location of the user's hand (reused from frame to frame). */
+  mutable cv::Mat1b m_handMask;
+
+  /** Whether or not to print the timers for each stage of the segmentation when the segmenter is destroyed. */
+  bool m_printTimers;
+
+  /** A timer that measures how long it takes to make the change mask. */
+  mutable AverageTimer m_timerChangeMask;
+
+  /** A timer that measures how long it takes to remove small components from the hand and object masks. */
+  mutable AverageTimer m_timerComponentFiltering;
+
+  /** A timer that measures how long it takes to make the hand and object masks from the change mask. */
+  mutable AverageTimer m_timerHandObjectMasks;
+
+  /** A timer that measures how long the whole segmentation takes. */
+  mutable AverageTimer m_timerTotal;
+
   /** The touch detector to use to make the change and hand masks. */
   mutable TouchDetector_Ptr m_touchDetector;
 
@@ -41,6 +68,13 @@ public:
    */
   BackgroundSubtractingObjectSegmenter(const View_CPtr& view, const Settings_CPtr& itmSettings, const TouchSettings_Ptr& touchSettings);
 
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the segmenter, printing its timers if desired.
+   */
+  ~BackgroundSubtractingObjectSegmenter();
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /** Override */
@@ -74,9 +108,18 @@ private:
 
   //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Prints a timer.
+   *
+   * \param timer The timer to print.
+   */
+  static void print_timer(const AverageTimer& timer);
+
   /**
    * \brief Updates a mask to retain only connected components over a certain size.
    *
+   * The mask is updated in place, and may wrap memory that is owned by another image.
+   *
    * \param mask                  The mask to update.
    * \param minimumComponentSize  The minimum size of component to retain.
    */
@@ -6,7 +6,10 @@
 #ifndef H_SPAINT_COLOURAPPEARANCEMODEL
 #define H_SPAINT_COLOURAPPEARANCEMODEL
 
+#include <vector>
+
 #include <itmx/base/ITMImagePtrTypes.h>
+#include <itmx/util/ColourConversion_Shared.h>
 
 #include <tvgutil/statistics/ProbabilityMassFunction.h>
 
@@ -15,7 +18,11 @@ namespace spaint {
 /**
  * \brief An instance of this class can be used to represent a pixel-wise colour appearance model for an object.
  *
- * We base our model on a chroma-based 2D histogram over colours in the YCbCr colour space.
+ * We base our model on a chroma-based 2D histogram over colours in the YCbCr colour space. Since the posterior
+ * probability only depends on the histogram bin into which a colour falls, we cache it in a dense per-bin table
+ * that is recomputed whenever the model is trained. This makes evaluating the model for a pixel a branch-free
+ * colour conversion followed by a single array lookup, which matters because it is evaluated for every pixel
+ * of every frame during segmentation.
  */
 class ColourAppearanceModel
 {
@@ -43,6 +50,9 @@ private:
   // A (linearised) 2D probability mass function representing P(Colour | !object).
   PMF_Ptr m_pmfColourGivenNotObject;
 
+  // A (linearised) 2D table containing P(object | colour) for each histogram bin.
+  std::vector<float> m_posteriorTable;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -61,7 +71,10 @@ public:
    * \param rgbColour The RGB colour of the pixel.
    * \return          The posterior probability of the pixel being part of the object given its colour.
    */
-  float compute_posterior_probability(const Vector3u& rgbColour) const;
+  float compute_posterior_probability(const Vector3u& rgbColour) const
+  {
+    return m_posteriorTable[compute_bin(rgbColour)];
+  }
 
   /**
    * \brief Trains the colour appearance model for the object.
@@ -79,7 +92,20 @@ private:
    * \param rgbColour An RGB colour.
    * \return          The 2D histogram bin index for the colour.
    */
-  int compute_bin(const Vector3u& rgbColour) const;
+  int compute_bin(const Vector3u& rgbColour) const
+  {
+    Vector3f yccColour = itmx::convert_rgb_to_ycbcr(rgbColour);
+    float cbFrac = yccColour.y / 255.0f;
+    float crFrac = yccColour.z / 255.0f;
+    int x = (int)CLAMP(ROUND(cbFrac * (m_binsCb - 1)), 0, m_binsCb - 1);
+    int y = (int)CLAMP(ROUND(crFrac * (m_binsCr - 1)), 0, m_binsCr - 1);
+    return y * m_binsCb + x;
+  }
+
+  /**
+   * \brief Recomputes the per-bin posterior probability table from the current likelihood PMFs.
+   */
+  void update_posterior_table();
 };
 
 //#################### TYPEDEFS ####################
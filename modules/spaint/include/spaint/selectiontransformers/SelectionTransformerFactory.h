@@ -29,9 +29,10 @@ public:
    *
    * \param radius      The (Manhattan) radius (in voxels) to select around each initial voxel.
    * \param deviceType  The device on which the transformer should operate.
+   * \param deduplicate Whether or not the transformer should deduplicate (and sort) its output selection.
    * \return            The selection transformer.
    */
-  static SelectionTransformer_Ptr make_voxel_to_cube(int radius, DeviceType deviceType);
+  static SelectionTransformer_Ptr make_voxel_to_cube(int radius, DeviceType deviceType, bool deduplicate = false);
 };
 
 }
@@ -6,6 +6,8 @@
 #ifndef H_SPAINT_VOXELTOCUBESELECTIONTRANSFORMER_CPU
 #define H_SPAINT_VOXELTOCUBESELECTIONTRANSFORMER_CPU
 
+#include <vector>
+
 #include "../interface/VoxelToCubeSelectionTransformer.h"
 
 namespace spaint {
@@ -15,19 +17,35 @@ namespace spaint {
  */
 class VoxelToCubeSelectionTransformer_CPU : public VoxelToCubeSelectionTransformer
 {
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** An occupancy grid over the bounding box of the output selection, used when deduplicating the output selection (reused between calls to avoid reallocation). */
+  mutable std::vector<unsigned char> m_occupancy;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Constructs a voxel to cube selection transformer that uses the CPU.
    *
-   * \param radius  The (Manhattan) radius (in voxels) to select around each initial voxel.
+   * \param radius      The (Manhattan) radius (in voxels) to select around each initial voxel.
+   * \param deduplicate Whether or not to deduplicate (and sort) the output selection.
    */
-  explicit VoxelToCubeSelectionTransformer_CPU(int radius);
+  explicit VoxelToCubeSelectionTransformer_CPU(int radius, bool deduplicate = false);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /** Override */
   virtual void transform_selection(const Selection& inputSelectionMB, Selection& outputSelectionMB) const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Expands the input selection into a deduplicated, sorted output selection.
+   *
+   * \param inputSelectionMB  A memory block containing the input selection of voxels.
+   * \param outputSelectionMB A memory block into which to store the output selection of voxels.
+   */
+  void transform_selection_deduplicated(const Selection& inputSelectionMB, Selection& outputSelectionMB) const;
 };
 
 }
@@ -20,9 +20,10 @@ public:
   /**
    * \brief Constructs a voxel to cube selection transformer that uses CUDA.
    *
-   * \param radius  The (Manhattan) radius (in voxels) to select around each initial voxel.
+   * \param radius      The (Manhattan) radius (in voxels) to select around each initial voxel.
+   * \param deduplicate Whether or not to deduplicate (and sort) the output selection.
    */
-  explicit VoxelToCubeSelectionTransformer_CUDA(int radius);
+  explicit VoxelToCubeSelectionTransformer_CUDA(int radius, bool deduplicate = false);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
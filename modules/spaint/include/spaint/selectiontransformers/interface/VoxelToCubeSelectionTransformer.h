@@ -12,11 +12,21 @@ namespace spaint {
 
 /**
  * \brief An instance of this class can be used to expand a selection of individual voxels into a selection of voxel cubes around the initial voxels.
+ *
+ * By default, the output selection contains one cube of voxels for each initial voxel, so if the cubes around nearby initial voxels overlap,
+ * some voxels will appear in the output selection more than once. Optionally, the transformer can instead deduplicate the output selection,
+ * in which case each voxel appears exactly once, and the voxels are sorted (in z, y, x order) so that nearby voxels are adjacent. This makes
+ * the cost of any subsequent processing of the selection (e.g. marking the voxels) scale with the number of distinct voxels selected, rather
+ * than with the number of initial voxels multiplied by the cube size. In that case, the output selection's dataSize is reduced to the number
+ * of distinct voxels when the selection is transformed (the memory block itself retains the size given by compute_output_selection_size).
  */
 class VoxelToCubeSelectionTransformer : public SelectionTransformer
 {
   //#################### PROTECTED VARIABLES ####################
 protected:
+  /** Whether or not to deduplicate (and sort) the output selection. */
+  bool m_deduplicate;
+
   /** The (Manhattan) radius (in voxels) to select around each initial voxel. */
   int m_radius;
 
@@ -27,8 +37,9 @@ protected:
    *
    * \param radius      The initial (Manhattan) radius (in voxels) to select around each initial voxel.
    * \param deviceType  The device on which the transformer is operating.
+   * \param deduplicate Whether or not to deduplicate (and sort) the output selection.
    */
-  VoxelToCubeSelectionTransformer(int radius, DeviceType deviceType);
+  VoxelToCubeSelectionTransformer(int radius, DeviceType deviceType, bool deduplicate);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -38,6 +49,13 @@ public:
   /** Override */
   virtual size_t compute_output_selection_size(const Selection& inputSelectionMB) const;
 
+  /**
+   * \brief Gets whether or not the transformer deduplicates (and sorts) the output selection.
+   *
+   * \return  true, if the transformer deduplicates the output selection, or false otherwise.
+   */
+  bool get_deduplicate() const;
+
   /**
    * \brief Gets the (Manhattan) radius (in voxels) to select around each initial voxel.
    *
@@ -10,6 +10,32 @@
 
 namespace spaint {
 
+/**
+ * \brief An instance of this struct can be used to compare voxels in a selection for equality.
+ */
+struct SelectionVoxelEqual
+{
+  _CPU_AND_GPU_CODE_
+  bool operator()(const Vector3s& lhs, const Vector3s& rhs) const
+  {
+    return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+  }
+};
+
+/**
+ * \brief An instance of this struct can be used to sort the voxels in a selection (in z, y, x order).
+ */
+struct SelectionVoxelLess
+{
+  _CPU_AND_GPU_CODE_
+  bool operator()(const Vector3s& lhs, const Vector3s& rhs) const
+  {
+    if(lhs.z != rhs.z) return lhs.z < rhs.z;
+    if(lhs.y != rhs.y) return lhs.y < rhs.y;
+    return lhs.x < rhs.x;
+  }
+};
+
 /**
  * \brief Writes a voxel to the output selection.
  *
@@ -46,6 +46,15 @@ private:
   /** The touch detector. */
   TouchDetector_Ptr m_touchDetector;
 
+  /** A memory block into which to write the scene points (if any) picked for the touch points detected in the most recent update. */
+  boost::shared_ptr<ORUtils::MemoryBlock<Vector3f> > m_touchPickPointsMB;
+
+  /** A memory block into which to write whether or not a scene point was picked for each touch point detected in the most recent update. */
+  boost::shared_ptr<ORUtils::MemoryBlock<bool> > m_touchPickPointsValidMB;
+
+  /** A memory block into which to copy the touch points detected in the most recent update (in image coordinates). */
+  boost::shared_ptr<ORUtils::MemoryBlock<Vector2i> > m_touchPointsMB;
+
   //#################### CONSTRUCTORS ####################
 public:
   /*
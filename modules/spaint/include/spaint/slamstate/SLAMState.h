@@ -8,10 +8,15 @@
 
 #include <map>
 
+#include <boost/optional.hpp>
+
+#include <ORUtils/DeviceType.h>
+
 #include <itmx/base/ITMImagePtrTypes.h>
 #include <itmx/base/ITMObjectPtrTypes.h>
 
 #include "../fiducials/Fiducial.h"
+#include "../surfaces/interface/SurfaceGBuffer.h"
 #include "../util/SpaintSurfelScene.h"
 #include "../util/SpaintVoxelScene.h"
 
@@ -27,6 +32,9 @@ private:
   /** The fiducials (if any) that have been detected in the 3D scene. */
   std::map<std::string,Fiducial_Ptr> m_fiducials;
 
+  /** A counter that is incremented whenever the contents of the voxel scene are changed by fusion (or the scene is reset). */
+  unsigned int m_fusionGeneration;
+
   /** The mask to apply to the input images during tracking. */
   ITMUCharImage_Ptr m_inputMask;
 
@@ -36,15 +44,39 @@ private:
   /** The image into which RGB input is read each frame. */
   ITMUChar4Image_Ptr m_inputRGBImage;
 
+  /** A counter that is incremented whenever some or all of the semantic labels of the voxels in the voxel scene are cleared. */
+  unsigned int m_labelClearGeneration;
+
+  /** A counter that is incremented whenever the semantic labels of the voxels in the voxel scene are changed. */
+  unsigned int m_labelGeneration;
+
+  /** A counter that is incremented whenever the scene is raycast from the live camera pose into the live voxel render state. */
+  unsigned int m_liveRaycastGeneration;
+
   /** The surfel render state corresponding to the live camera pose. */
   SurfelRenderState_Ptr m_liveSurfelRenderState;
 
   /** The voxel render state corresponding to the live camera pose. */
   VoxelRenderState_Ptr m_liveVoxelRenderState;
 
+  /** The fusion generation at which the voxel scene was last reset. */
+  unsigned int m_resetGeneration;
+
   /** The current reconstructed surfel scene. */
   SpaintSurfelScene_Ptr m_surfelScene;
 
+  /** The surface G-buffer shared by the pipeline components (e.g. propagation and smoothing) that read the attributes of the voxels in a raycast result. */
+  SurfaceGBuffer_Ptr m_surfaceGBuffer;
+
+  /** The fusion generation at which the surface G-buffer was last fully updated. */
+  unsigned int m_surfaceGBufferFusionGeneration;
+
+  /** The label generation at which the labels in the surface G-buffer were last updated. */
+  unsigned int m_surfaceGBufferLabelGeneration;
+
+  /** The live raycast generation at which the surface G-buffer was last fully updated (if it was last updated from the live voxel render state). */
+  boost::optional<unsigned int> m_surfaceGBufferLiveRaycastGeneration;
+
   /** The current tracking state (containing the camera pose and additional tracking information used by InfiniTAM). */
   TrackingState_Ptr m_trackingState;
 
@@ -54,6 +86,13 @@ private:
   /** The current reconstructed voxel scene. */
   SpaintVoxelScene_Ptr m_voxelScene;
 
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty SLAM state.
+   */
+  SLAMState();
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
@@ -70,6 +109,17 @@ public:
    */
   const std::map<std::string,Fiducial_Ptr>& get_fiducials() const;
 
+  /**
+   * \brief Gets the current fusion generation of the voxel scene.
+   *
+   * The fusion generation is incremented whenever the contents of the voxel scene are changed by fusion (or the scene is reset).
+   * It can be used to determine whether or not information that has been derived from the scene (e.g. feature descriptors) is
+   * likely to be out of date.
+   *
+   * \return  The current fusion generation of the voxel scene.
+   */
+  unsigned int get_fusion_generation() const;
+
   /**
    * \brief Gets the mask to apply to the input images during tracking.
    *
@@ -112,6 +162,28 @@ public:
    */
   const ITMLib::ITMIntrinsics& get_intrinsics() const;
 
+  /**
+   * \brief Gets the current label clear generation of the voxel scene.
+   *
+   * The label clear generation is incremented whenever some or all of the semantic labels of the voxels in the voxel scene
+   * are cleared. Unlike the label generation, it is not incremented when labels are merely written, so it can be used to
+   * determine whether or not labels that were previously written to the scene (e.g. by prediction) may since have been removed.
+   *
+   * \return  The current label clear generation of the voxel scene.
+   */
+  unsigned int get_label_clear_generation() const;
+
+  /**
+   * \brief Gets the current label generation of the voxel scene.
+   *
+   * The label generation is incremented whenever the semantic labels of the voxels in the voxel scene are changed
+   * (e.g. by marking, propagation or smoothing). Together with the fusion generation, it can be used to determine
+   * whether or not a rendering of the scene is likely to be out of date.
+   *
+   * \return  The current label generation of the voxel scene.
+   */
+  unsigned int get_label_generation() const;
+
   /**
    * \brief Gets the surfel render state corresponding to the live camera pose for the scene.
    *
@@ -133,6 +205,15 @@ public:
    */
   const ORUtils::SE3Pose& get_pose() const;
 
+  /**
+   * \brief Gets the fusion generation at which the voxel scene was last reset.
+   *
+   * Any information that was derived from the scene prior to this generation is no longer valid.
+   *
+   * \return  The fusion generation at which the voxel scene was last reset.
+   */
+  unsigned int get_reset_generation() const;
+
   /**
    * \brief Gets the dimensions of the RGB images from which the scene is being reconstructed.
    *
@@ -154,6 +235,23 @@ public:
    */
   SpaintSurfelScene_CPtr get_surfel_scene() const;
 
+  /**
+   * \brief Gets an up-to-date surface G-buffer for the raycast result in the specified voxel render state.
+   *
+   * The G-buffer is shared by all of the pipeline components that read the attributes of the voxels in a raycast result, and
+   * is created the first time it is requested. It is only fully recomputed when the raycast result may have changed since it
+   * was last updated: if only the labels of the voxels have changed since then, they are simply re-read from the scene.
+   *
+   * Note that we only know when the live voxel render state is raycast (see record_live_raycast). Other render states
+   * (e.g. those of free camera views) are raycast by the renderer, so the G-buffer is always recomputed for them.
+   *
+   * \param renderState         The voxel render state whose raycast result the G-buffer should describe.
+   * \param optionalAttributes  The optional attributes the G-buffer must contain (a combination of SurfaceGBuffer::OptionalAttribute flags).
+   * \param deviceType          The device on which the G-buffer should be computed (only used when it is first created).
+   * \return                    The up-to-date surface G-buffer.
+   */
+  SurfaceGBuffer_CPtr get_surface_gbuffer(const VoxelRenderState_CPtr& renderState, int optionalAttributes, DeviceType deviceType);
+
   /**
    * \brief Gets the current tracking state for the scene.
    *
@@ -196,6 +294,31 @@ public:
    */
   SpaintVoxelScene_CPtr get_voxel_scene() const;
 
+  /**
+   * \brief Records the fact that the semantic labels of the voxels in the voxel scene have been changed.
+   */
+  void record_labels_changed();
+
+  /**
+   * \brief Records the fact that some or all of the semantic labels of the voxels in the voxel scene have been cleared.
+   */
+  void record_labels_cleared();
+
+  /**
+   * \brief Records the fact that the scene has been raycast from the live camera pose into the live voxel render state.
+   */
+  void record_live_raycast();
+
+  /**
+   * \brief Records the fact that the contents of the voxel scene have been changed by fusion.
+   */
+  void record_scene_fused();
+
+  /**
+   * \brief Records the fact that the voxel scene has been reset.
+   */
+  void record_scene_reset();
+
   /**
    * \brief Sets the mask to apply to the input images during tracking.
    *
@@ -30,10 +30,10 @@ public:
   /**
    * \brief Smooths the labelling of voxels in the scene, filling in the labels of voxels based on their neighbours.
    *
-   * \param raycastResult The raycast result.
-   * \param scene         The scene.
+   * \param gbuffer A surface G-buffer that has been updated from the raycast result from which to smooth.
+   * \param scene   The scene.
    */
-  virtual void smooth_labels(const ITMFloat4Image *raycastResult, SpaintVoxelScene *scene) const;
+  virtual void smooth_labels(const SurfaceGBuffer& gbuffer, SpaintVoxelScene *scene) const;
 };
 
 }
@@ -6,9 +6,7 @@
 #ifndef H_SPAINT_LABELSMOOTHER
 #define H_SPAINT_LABELSMOOTHER
 
-#include <ITMLib/Utils/ITMImageTypes.h>
-
-#include "../../util/SpaintVoxelScene.h"
+#include "../../surfaces/interface/SurfaceGBuffer.h"
 
 namespace spaint {
 
@@ -47,10 +45,12 @@ public:
   /**
    * \brief Smooths the labelling of voxels in the scene, filling in the labels of voxels based on their neighbours.
    *
-   * \param raycastResult The raycast result.
-   * \param scene         The scene.
+   * Note that the labels of the neighbours are those they had when the surface G-buffer was last updated.
+   *
+   * \param gbuffer A surface G-buffer that has been updated from the raycast result from which to smooth.
+   * \param scene   The scene.
    */
-  virtual void smooth_labels(const ITMFloat4Image *raycastResult, SpaintVoxelScene *scene) const = 0;
+  virtual void smooth_labels(const SurfaceGBuffer& gbuffer, SpaintVoxelScene *scene) const = 0;
 };
 
 //#################### TYPEDEFS ####################
@@ -18,15 +18,20 @@ namespace spaint {
  * \param height                          The height of the raycast result.
  * \param maxLabelCount                   The maximum number of labels that can be in use.
  * \param raycastResult                   The raycast result.
+ * \param surfaceLabels                   The packed labels of the voxels in the raycast result.
+ * \param voxelAddresses                  The addresses of the voxels in the raycast result within the scene's voxel data (-1 for pixels without a voxel).
  * \param voxelData                       The scene's voxel data.
- * \param indexData                       The scene's index data.
  * \param maxSquaredDistanceBetweenVoxels The maximum squared distance allowed between the positions of the neighbour and the voxel of interest if smoothing is to occur.
  */
 _CPU_AND_GPU_CODE_
 inline void smooth_from_neighbours(int voxelIndex, int width, int height, int maxLabelCount, const Vector4f *raycastResult,
-                                   SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                   const SpaintVoxel::PackedLabel *surfaceLabels, const int *voxelAddresses, SpaintVoxel *voxelData,
                                    float maxSquaredDistanceBetweenVoxels)
 {
+  // If there is no voxel at the specified position in the raycast result, early out.
+  const int voxelAddress = voxelAddresses[voxelIndex];
+  if(voxelAddress < 0) return;
+
   // Note: We declare the label count array with a fixed maximum size here for simplicity.
   //       The size will need to be changed if we ever want to use more than 32 labels.
   unsigned char labelCounts[32] = {0,};
@@ -36,8 +41,6 @@ inline void smooth_from_neighbours(int voxelIndex, int width, int height, int ma
   int x = voxelIndex % width;
   int y = voxelIndex / width;
 
-  bool foundPoint;
-
   // For each neighbouring voxel:
   for(int dx = -1; dx <= 1; ++dx)
   {
@@ -49,18 +52,19 @@ inline void smooth_from_neighbours(int voxelIndex, int width, int height, int ma
       int neighbourX = x + dx, neighbourY = y + dy;
       if(neighbourX < 0 || neighbourX >= width || neighbourY < 0 || neighbourY >= height) continue;
 
-      // Look up the position and properties of the neighbouring voxel.
+      // Check that there is a voxel at the neighbour's position in the raycast result.
       int neighbourVoxelIndex = neighbourY * width + neighbourX;
+      if(voxelAddresses[neighbourVoxelIndex] < 0) continue;
+
+      // Look up the position of the neighbouring voxel.
       Vector3f neighbourLoc = raycastResult[neighbourVoxelIndex].toVector3();
-      const SpaintVoxel neighbourVoxel = readVoxel(voxelData, indexData, neighbourLoc.toIntRound(), foundPoint);
-      if(!foundPoint) continue;
 
       // If the neighbouring voxel is near enough to the target voxel:
       Vector3f posOffset = neighbourLoc - loc;
       if(dot(posOffset, posOffset) <= maxSquaredDistanceBetweenVoxels)
       {
         // Increment the count for its label.
-        ++labelCounts[neighbourVoxel.packedLabel.label];
+        ++labelCounts[surfaceLabels[neighbourVoxelIndex].label];
       }
     }
   }
@@ -82,7 +86,7 @@ inline void smooth_from_neighbours(int voxelIndex, int width, int height, int ma
   const int bestLabelThreshold = 6;
   if(bestLabel != 0 && bestLabelCount >= bestLabelThreshold)
   {
-    mark_voxel(loc.toShortRound(), SpaintVoxel::PackedLabel(bestLabel, SpaintVoxel::LG_PROPAGATED), NULL, voxelData, indexData);
+    mark_voxel_at(voxelAddress, SpaintVoxel::PackedLabel(bestLabel, SpaintVoxel::LG_PROPAGATED), NULL, voxelData);
   }
 }
 
@@ -0,0 +1,33 @@
+/**
+ * spaint: SurfaceGBufferFactory.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#ifndef H_SPAINT_SURFACEGBUFFERFACTORY
+#define H_SPAINT_SURFACEGBUFFERFACTORY
+
+#include <ORUtils/DeviceType.h>
+
+#include "interface/SurfaceGBuffer.h"
+
+namespace spaint {
+
+/**
+ * \brief This struct can be used to construct surface G-buffers.
+ */
+struct SurfaceGBufferFactory
+{
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+  /**
+   * \brief Makes a surface G-buffer.
+   *
+   * \param deviceType  The device on which the G-buffer should be computed.
+   * \return            The surface G-buffer.
+   */
+  static SurfaceGBuffer_Ptr make_surface_gbuffer(DeviceType deviceType);
+};
+
+}
+
+#endif
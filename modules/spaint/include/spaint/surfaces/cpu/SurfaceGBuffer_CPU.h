@@ -0,0 +1,36 @@
+/**
+ * spaint: SurfaceGBuffer_CPU.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#ifndef H_SPAINT_SURFACEGBUFFER_CPU
+#define H_SPAINT_SURFACEGBUFFER_CPU
+
+#include "../interface/SurfaceGBuffer.h"
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class represents a surface G-buffer that is computed using the CPU.
+ */
+class SurfaceGBuffer_CPU : public SurfaceGBuffer
+{
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a CPU-based surface G-buffer.
+   */
+  SurfaceGBuffer_CPU();
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /** Override */
+  virtual void compute(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene, int optionalAttributes);
+
+  /** Override */
+  virtual void compute_labels(const SpaintVoxelScene *scene);
+};
+
+}
+
+#endif
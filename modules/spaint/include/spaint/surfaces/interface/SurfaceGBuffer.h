@@ -0,0 +1,187 @@
+/**
+ * spaint: SurfaceGBuffer.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#ifndef H_SPAINT_SURFACEGBUFFER
+#define H_SPAINT_SURFACEGBUFFER
+
+#include <ITMLib/Utils/ITMImageTypes.h>
+
+#include "../../util/SpaintVoxelScene.h"
+
+namespace spaint {
+
+/**
+ * \brief An instance of a class deriving from this one represents a "surface G-buffer" for a raycast result, i.e. a set of
+ *        per-pixel images containing the attributes of the voxels that are visible in the raycast.
+ *
+ * The G-buffer is stored in structure-of-arrays form (one image per attribute). It is computed once per raycast
+ * by a single pass over the pixels that looks up each visible voxel in the scene's hash table exactly once. Stages that
+ * need the attributes of a pixel's neighbours (e.g. label propagation and smoothing) can then read them directly from
+ * the G-buffer, rather than each performing their own hash table lookups for every neighbour of every pixel.
+ *
+ * The positions of the voxels are not duplicated in the G-buffer: they can be read from the raycast result itself.
+ * A pixel is valid iff its voxel address is non-negative. The packed labels and voxel addresses are always computed;
+ * the colours and surface normals are optional, and are only computed when a consumer asks for them (computing
+ * the normals in particular requires several further hash table lookups per pixel).
+ *
+ * The packed labels can also be refreshed on their own, by reading them directly from the voxel addresses. This avoids
+ * any hash table lookups, and is sufficient when the labels in the scene have changed but the raycast result has not.
+ */
+class SurfaceGBuffer
+{
+  //#################### ENUMERATIONS ####################
+public:
+  /**
+   * \brief The values of this enumeration denote the optional attributes that can be stored in the G-buffer.
+   *
+   * They are bit flags, and can be combined to request several attributes at once.
+   */
+  enum OptionalAttribute
+  {
+    /** The colours of the voxels in the raycast result. */
+    SGA_COLOURS = 1,
+
+    /** The surface normals of the voxels in the raycast result. */
+    SGA_NORMALS = 2
+  };
+
+  //#################### TYPEDEFS ####################
+protected:
+  typedef boost::shared_ptr<ORUtils::Image<Vector3u> > Vector3uImage_Ptr;
+  typedef boost::shared_ptr<ORUtils::Image<Vector3f> > Vector3fImage_Ptr;
+  typedef boost::shared_ptr<ORUtils::Image<int> > IntImage_Ptr;
+  typedef boost::shared_ptr<ORUtils::Image<SpaintVoxel::PackedLabel> > PackedLabelImage_Ptr;
+
+  //#################### PROTECTED VARIABLES ####################
+protected:
+  /** An image containing the colours of the voxels in the raycast result. */
+  Vector3uImage_Ptr m_colours;
+
+  /** The optional attributes that were computed when the G-buffer was last updated. */
+  int m_optionalAttributes;
+
+  /** An image containing the surface normals of the voxels in the raycast result. */
+  Vector3fImage_Ptr m_normals;
+
+  /** An image containing the packed labels of the voxels in the raycast result (as they were when the G-buffer was last updated). */
+  PackedLabelImage_Ptr m_packedLabels;
+
+  /** The raycast result from which the G-buffer was last updated (if any). */
+  const ITMFloat4Image *m_raycastResult;
+
+  /** An image containing the addresses of the voxels in the raycast result within the scene's voxel data (-1 for pixels without a voxel). */
+  IntImage_Ptr m_voxelAddresses;
+
+  //#################### CONSTRUCTORS ####################
+protected:
+  /**
+   * \brief Constructs a surface G-buffer.
+   *
+   * The images in the G-buffer are resized as necessary to match the raycast result each time the G-buffer is updated.
+   */
+  SurfaceGBuffer();
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the surface G-buffer.
+   */
+  virtual ~SurfaceGBuffer();
+
+  //#################### PRIVATE ABSTRACT MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Computes the contents of the G-buffer from a raycast result in a device-specific way.
+   *
+   * \param raycastResult       The raycast result.
+   * \param scene               The scene.
+   * \param optionalAttributes  The optional attributes to compute (a combination of OptionalAttribute flags).
+   */
+  virtual void compute(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene, int optionalAttributes) = 0;
+
+  /**
+   * \brief Re-reads the packed labels of the voxels in the G-buffer from the scene in a device-specific way.
+   *
+   * \param scene The scene.
+   */
+  virtual void compute_labels(const SpaintVoxelScene *scene) = 0;
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets an image containing the colours of the voxels in the raycast result.
+   *
+   * \return                    An image containing the colours of the voxels in the raycast result.
+   * \throws std::runtime_error If the colours were not computed when the G-buffer was last updated.
+   */
+  const ORUtils::Image<Vector3u>& get_colours() const;
+
+  /**
+   * \brief Gets an image containing the surface normals of the voxels in the raycast result.
+   *
+   * \return                    An image containing the surface normals of the voxels in the raycast result.
+   * \throws std::runtime_error If the normals were not computed when the G-buffer was last updated.
+   */
+  const ORUtils::Image<Vector3f>& get_normals() const;
+
+  /**
+   * \brief Gets the optional attributes that were computed when the G-buffer was last updated.
+   *
+   * \return The optional attributes that were computed when the G-buffer was last updated (a combination of OptionalAttribute flags).
+   */
+  int get_optional_attributes() const;
+
+  /**
+   * \brief Gets an image containing the packed labels of the voxels in the raycast result.
+   *
+   * Note that these are the labels the voxels had when the G-buffer was last updated.
+   *
+   * \return  An image containing the packed labels of the voxels in the raycast result.
+   */
+  const ORUtils::Image<SpaintVoxel::PackedLabel>& get_packed_labels() const;
+
+  /**
+   * \brief Gets the raycast result from which the G-buffer was last updated.
+   *
+   * \return                    The raycast result from which the G-buffer was last updated.
+   * \throws std::runtime_error If the G-buffer has not yet been updated.
+   */
+  const ITMFloat4Image *get_raycast_result() const;
+
+  /**
+   * \brief Gets an image containing the addresses of the voxels in the raycast result within the scene's voxel data.
+   *
+   * \return  An image containing the addresses of the voxels in the raycast result (-1 for pixels without a voxel).
+   */
+  const ORUtils::Image<int>& get_voxel_addresses() const;
+
+  /**
+   * \brief Updates the G-buffer from the specified raycast result.
+   *
+   * \param raycastResult       The raycast result.
+   * \param scene               The scene.
+   * \param optionalAttributes  The optional attributes to compute (a combination of OptionalAttribute flags).
+   */
+  void update(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene, int optionalAttributes = 0);
+
+  /**
+   * \brief Updates the packed labels in the G-buffer (and nothing else) from the scene.
+   *
+   * This is only valid if the raycast result from which the G-buffer was last updated has not changed since.
+   *
+   * \param scene                The scene.
+   * \throws std::runtime_error  If the G-buffer has not yet been updated.
+   */
+  void update_labels(const SpaintVoxelScene *scene);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<SurfaceGBuffer> SurfaceGBuffer_Ptr;
+typedef boost::shared_ptr<const SurfaceGBuffer> SurfaceGBuffer_CPtr;
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * spaint: SurfaceGBuffer_Shared.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#ifndef H_SPAINT_SURFACEGBUFFER_SHARED
+#define H_SPAINT_SURFACEGBUFFER_SHARED
+
+#include <ITMLib/Objects/Scene/ITMRepresentationAccess.h>
+
+#include "../../util/SpaintVoxel.h"
+
+namespace spaint {
+
+/**
+ * \brief Re-reads the packed label of the voxel (if any) at the specified pixel in the G-buffer from the scene's voxel data.
+ *
+ * \param pixelIndex      The index of the pixel in the G-buffer.
+ * \param voxelAddresses  The addresses of the voxels in the G-buffer (-1 for pixels without a voxel).
+ * \param voxelData       The scene's voxel data.
+ * \param packedLabels    The array into which to write the packed label of the voxel.
+ */
+_CPU_AND_GPU_CODE_
+inline void update_surface_gbuffer_label(int pixelIndex, const int *voxelAddresses, const SpaintVoxel *voxelData, SpaintVoxel::PackedLabel *packedLabels)
+{
+  const int voxelAddress = voxelAddresses[pixelIndex];
+  packedLabels[pixelIndex] = voxelAddress >= 0 ? voxelData[voxelAddress].packedLabel : SpaintVoxel::PackedLabel();
+}
+
+/**
+ * \brief Writes the surface attributes of the voxel (if any) at the specified pixel in the raycast result into the G-buffer.
+ *
+ * \param pixelIndex      The index of the pixel in the raycast result.
+ * \param raycastResult   The raycast result.
+ * \param voxelData       The scene's voxel data.
+ * \param indexData       The scene's index data.
+ * \param normals         The array into which to write the surface normal of the voxel (NULL if normals are not needed).
+ * \param colours         The array into which to write the colour of the voxel (NULL if colours are not needed).
+ * \param packedLabels    The array into which to write the packed label of the voxel.
+ * \param voxelAddresses  The array into which to write the address of the voxel in the voxel data (or -1 if there is no voxel).
+ */
+_CPU_AND_GPU_CODE_
+inline void write_surface_gbuffer_entry(int pixelIndex, const Vector4f *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                        Vector3f *normals, Vector3u *colours, SpaintVoxel::PackedLabel *packedLabels, int *voxelAddresses)
+{
+  Vector4f loc = raycastResult[pixelIndex];
+
+  // Look up the voxel at the pixel's position in the scene (if any).
+  bool isFound;
+  int voxelAddress = findVoxel(indexData, loc.toVector3().toIntRound(), isFound);
+  if(isFound)
+  {
+    const SpaintVoxel& voxel = voxelData[voxelAddress];
+    if(colours) colours[pixelIndex] = VoxelColourReader<SpaintVoxel::hasColorInformation>::read(voxel);
+    packedLabels[pixelIndex] = voxel.packedLabel;
+    voxelAddresses[pixelIndex] = voxelAddress;
+  }
+  else
+  {
+    if(colours) colours[pixelIndex] = Vector3u((uchar)0);
+    packedLabels[pixelIndex] = SpaintVoxel::PackedLabel();
+    voxelAddresses[pixelIndex] = -1;
+  }
+
+  // If the normals are not needed, early out.
+  if(!normals) return;
+
+  // If the raycast hit a surface at the pixel, compute the surface normal there; otherwise, use a default.
+  Vector3f n(0.0f, 0.0f, 0.0f);
+  if(loc.w > 0)
+  {
+    n = computeSingleNormalFromSDF(voxelData, indexData, loc.toVector3());
+  }
+
+  normals[pixelIndex] = n;
+}
+
+}
+
+#endif
@@ -74,6 +74,8 @@ public:
    * \brief Loads a random forest from the file specified by the forest path.
    *
    * The loading is done in TouchSettings rather than TouchDetector to work around a weird compiler bug.
+   * Forests whose files have a .rfb extension are assumed to have been saved using a binary archive;
+   * all other forests are assumed to have been saved using a text archive.
    *
    * \return  The random forest that has been loaded.
    */
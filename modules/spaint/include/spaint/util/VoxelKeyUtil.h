@@ -0,0 +1,44 @@
+/**
+ * spaint: VoxelKeyUtil.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#ifndef H_SPAINT_VOXELKEYUTIL
+#define H_SPAINT_VOXELKEYUTIL
+
+#include <boost/cstdint.hpp>
+
+#include <ITMLib/Utils/ITMMath.h>
+
+namespace spaint {
+
+/**
+ * \brief This struct provides utility functions for keying per-voxel data (e.g. in caches) by the locations of the voxels.
+ */
+struct VoxelKeyUtil
+{
+  //#################### TYPEDEFS ####################
+
+  typedef boost::uint64_t Key;
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+  /**
+   * \brief Makes the key for the voxel at the specified location.
+   *
+   * The key packs the three (16-bit) coordinates of the voxel into a single integer, so distinct voxels always have distinct keys.
+   *
+   * \param voxelLocation The location of the voxel.
+   * \return              The key.
+   */
+  static Key make_key(const Vector3s& voxelLocation)
+  {
+    return (static_cast<Key>(static_cast<unsigned short>(voxelLocation.x)) << 32) |
+           (static_cast<Key>(static_cast<unsigned short>(voxelLocation.y)) << 16) |
+            static_cast<Key>(static_cast<unsigned short>(voxelLocation.z));
+  }
+};
+
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include <itmx/base/ITMObjectPtrTypes.h>
 #include <itmx/visualisation/interface/DepthVisualiser.h>
 
+#include "VoxelRenderCache.h"
 #include "interface/SemanticVisualiser.h"
 #include "../util/SpaintSurfelScene.h"
 
@@ -127,20 +128,26 @@ public:
    * \param intrinsics          The camera intrinsics to use when visualising the scene.
    * \param renderState         The render state to use for intermediate storage (can be null, in which case a new one will be created).
    * \param visualisationType   The type of visualisation to generate.
-   * \param postprocessor       An optional function with which to postprocess the visualisation before returning it.
+   * \param postprocessor       An optional function with which to postprocess the visualisation (on the CPU) before returning it.
+   * \param renderCache         An optional cache with which to avoid re-raycasting the scene when neither it nor the camera have changed
+   *                            (if specified, it must always be used with the same render state).
+   * \param fusionGeneration    The current fusion generation of the scene (only used if a render cache is specified).
+   * \param labelGeneration     The current label generation of the scene (only used if a render cache is specified).
    *
    * \throws std::runtime_error If supports_semantics() is false and we try to generate a semantic visualisation of the scene.
    */
   void generate_voxel_visualisation(const ITMUChar4Image_Ptr& output, const SpaintVoxelScene_CPtr& scene, const ORUtils::SE3Pose& pose,
                                     const ITMLib::ITMIntrinsics& intrinsics, VoxelRenderState_Ptr& renderState, VisualisationType visualisationType,
-                                    const boost::optional<Postprocessor>& postprocessor = boost::none) const;
+                                    const boost::optional<Postprocessor>& postprocessor = boost::none,
+                                    const VoxelRenderCache_Ptr& renderCache = VoxelRenderCache_Ptr(),
+                                    unsigned int fusionGeneration = 0, unsigned int labelGeneration = 0) const;
 
   /**
    * \brief Gets a Lambertian raycast of a voxel scene from the default pose (the current camera pose).
    *
    * \param output          The location into which to put the output image.
    * \param liveRenderState The render state corresponding to the live camera pose for the voxel scene.
-   * \param postprocessor   An optional function with which to postprocess the raycast before returning it.
+   * \param postprocessor   An optional function with which to postprocess the raycast (on the CPU) before returning it.
    */
   void get_default_raycast(const ITMUChar4Image_Ptr& output, const VoxelRenderState_CPtr& liveRenderState, const boost::optional<Postprocessor>& postprocessor = boost::none) const;
 
@@ -170,10 +177,12 @@ public:
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Makes a copy of an input raycast, optionally post-processes it and then ensures that it is accessible on the CPU.
+   * \brief Makes a CPU copy of an input raycast and optionally post-processes it.
+   *
+   * The post-processing is performed in place on the CPU copy, so that the raycast only ever needs to be transferred once.
    *
    * \param inputRaycast  The input raycast.
-   * \param postprocessor An optional function with which to postprocess the output raycast.
+   * \param postprocessor An optional function with which to postprocess the output raycast (on the CPU).
    * \param outputRaycast The output raycast (guaranteed to be accessible on the CPU).
    */
   void make_postprocessed_cpu_copy(const ITMUChar4Image *inputRaycast, const boost::optional<Postprocessor>& postprocessor, const ITMUChar4Image_Ptr& outputRaycast) const;
@@ -185,6 +194,78 @@ private:
    * \param output  The output image to which the visualisation image will be copied.
    */
   void prepare_to_copy_visualisation(const Vector2i& inputSize, const ITMUChar4Image_Ptr& output) const;
+
+  /**
+   * \brief Renders a visualisation of a voxel scene into the raycast image of the specified render state by raycasting the scene.
+   *
+   * \param scene             The scene to visualise.
+   * \param pose              The pose from which to visualise the scene.
+   * \param intrinsics        The camera intrinsics to use when visualising the scene.
+   * \param renderState       The render state into which to render the visualisation.
+   * \param visualisationType The type of visualisation to generate.
+   * \param cacheKey          The render cache key of the visualisation (if known), under which the semantic visualiser may retain the surface points.
+   */
+  void raycast_voxel_visualisation(const SpaintVoxelScene_CPtr& scene, const ORUtils::SE3Pose& pose, const ITMLib::ITMIntrinsics& intrinsics,
+                                   const VoxelRenderState_Ptr& renderState, VisualisationType visualisationType,
+                                   const boost::optional<VoxelRenderCache::Key>& cacheKey) const;
+
+  /**
+   * \brief Renders a visualisation of a voxel scene into the raycast image of the specified render state by forward-projecting
+   *        the surface points from the render state's most recent raycast into the new view and raycasting only the holes.
+   *
+   * \param scene             The scene to visualise.
+   * \param pose              The pose from which to visualise the scene.
+   * \param intrinsics        The camera intrinsics to use when visualising the scene.
+   * \param renderState       The render state into which to render the visualisation.
+   * \param visualisationType The type of visualisation to generate (must not be a semantic one).
+   * \param renderCache       The render cache paired with the render state.
+   */
+  void reproject_voxel_visualisation(const SpaintVoxelScene_CPtr& scene, const ORUtils::SE3Pose& pose, const ITMLib::ITMIntrinsics& intrinsics,
+                                     const VoxelRenderState_Ptr& renderState, VisualisationType visualisationType, VoxelRenderCache& renderCache) const;
+
+  /**
+   * \brief Renders a semantic visualisation of a voxel scene into the raycast image of the specified render state by reshading
+   *        the surface points that the semantic visualiser retained when it last rendered the same view.
+   *
+   * \param renderState       The render state into which to render the visualisation.
+   * \param visualisationType The type of visualisation to generate (must be a semantic one).
+   * \param cacheKey          The render cache key of the visualisation.
+   */
+  void reshade_voxel_visualisation(const VoxelRenderState_Ptr& renderState, VisualisationType visualisationType, const VoxelRenderCache::Key& cacheKey) const;
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Determines whether or not the specified type of visualisation shows the semantic labels of the voxels.
+   *
+   * \param visualisationType The type of visualisation.
+   * \return                  true, if the type of visualisation shows the semantic labels of the voxels, or false otherwise.
+   */
+  static bool is_semantic(VisualisationType visualisationType);
+
+  /**
+   * \brief Gets the proportion of the pixel colours in the specified (semantic) type of visualisation that should be based on the voxels' labels.
+   *
+   * \param visualisationType The type of visualisation.
+   * \return                  The proportion (in the range [0,1]) of the pixel colours that should be based on the voxels' semantic labels rather than their scene colours.
+   */
+  static float to_label_alpha(VisualisationType visualisationType);
+
+  /**
+   * \brief Gets the type of lighting that should be used to generate the specified (semantic) type of visualisation.
+   *
+   * \param visualisationType The type of visualisation.
+   * \return                  The type of lighting that should be used.
+   */
+  static LightingType to_lighting_type(VisualisationType visualisationType);
+
+  /**
+   * \brief Gets the type of InfiniTAM image that should be rendered to generate the specified (non-semantic) type of visualisation.
+   *
+   * \param visualisationType The type of visualisation.
+   * \return                  The type of InfiniTAM image that should be rendered.
+   */
+  static ITMLib::IITMVisualisationEngine::RenderImageType to_render_image_type(VisualisationType visualisationType);
 };
 
 //#################### TYPEDEFS ####################
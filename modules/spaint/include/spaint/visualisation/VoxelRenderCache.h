@@ -0,0 +1,294 @@
+/**
+ * spaint: VoxelRenderCache.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_SPAINT_VOXELRENDERCACHE
+#define H_SPAINT_VOXELRENDERCACHE
+
+#include <boost/optional.hpp>
+
+#include <ITMLib/Objects/Camera/ITMIntrinsics.h>
+
+#include <itmx/base/ITMObjectPtrTypes.h>
+
+#include <tvgutil/timing/AverageTimer.h>
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class can be used to avoid re-raycasting a voxel scene when neither the scene nor the camera have changed.
+ *
+ * A cache is intended to be paired with the render state of a single view (e.g. a free camera view of a sub-window). It remembers
+ * which image is currently stored in the render state, and which raycast (i.e. which set of surface points) that image was based on.
+ * When the view is next rendered, the visualisation generator asks the cache whether:
+ *
+ * - Nothing relevant has changed, in which case the image in the render state can simply be reused (a hit).
+ * - The scene is unchanged and the camera has moved only slightly, in which case the surface points from the last full raycast can
+ *   be forward-projected into the new view and only the resulting holes need to be raycast (a reprojection). This is opt-in, since
+ *   it leaves the render state's raycast result corresponding to the original pose rather than the current one.
+ * - The surface points for exactly this view were retained by whoever last rendered it (e.g. the semantic visualiser, when another
+ *   sub-window has already rendered a semantic view from the same pose), in which case only a shading pass is needed (a reshade).
+ *   Whoever retained the surface points also retains the raycast result from which they were extracted, and a reshade copies it
+ *   into the render state along with the image, so a reshade is keyed only on the view, not on which render state it is for.
+ * - A full raycast is needed (a miss).
+ */
+class VoxelRenderCache
+{
+  //#################### ENUMERATIONS ####################
+public:
+  /**
+   * \brief The values of this enumeration denote the different ways in which a render request can be satisfied.
+   */
+  enum LookupResult
+  {
+    /** The image currently stored in the render state can be reused as-is. */
+    LR_HIT,
+
+    /** A full raycast of the scene is needed. */
+    LR_MISS,
+
+    /** The image can be generated by forward-projecting the surface points from the last full raycast. */
+    LR_REPROJECT,
+
+    /** The image can be generated by reshading surface points that were retained when the same view was last rendered (this is never returned by lookup). */
+    LR_RESHADE
+  };
+
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct identifies a rendering of a voxel scene.
+   */
+  struct Key
+  {
+    /** The fusion generation of the scene at the time of rendering. */
+    unsigned int fusionGeneration;
+
+    /** The size of the rendered image. */
+    Vector2i imgSize;
+
+    /** The camera intrinsics used for rendering. */
+    ITMLib::ITMIntrinsics intrinsics;
+
+    /** The label generation of the scene at the time of rendering (only relevant for visualisations that show the labels). */
+    unsigned int labelGeneration;
+
+    /** The pose from which the scene was rendered. */
+    ORUtils::SE3Pose pose;
+
+    /** The scene that was rendered. */
+    const void *scene;
+
+    /** The type of visualisation that was rendered. */
+    int visualisationType;
+
+    Key(const void *scene_, unsigned int fusionGeneration_, unsigned int labelGeneration_, const ORUtils::SE3Pose& pose_,
+        const ITMLib::ITMIntrinsics& intrinsics_, const Vector2i& imgSize_, int visualisationType_);
+  };
+
+  /**
+   * \brief An instance of this struct contains statistics about the effectiveness of a render cache.
+   */
+  struct Statistics
+  {
+    /** The average time taken to satisfy a render request that was a hit. */
+    boost::chrono::microseconds averageHitTime;
+
+    /** The average time taken to satisfy a render request that needed a full raycast. */
+    boost::chrono::microseconds averageMissTime;
+
+    /** The average time taken to satisfy a render request by reprojection. */
+    boost::chrono::microseconds averageReprojectionTime;
+
+    /** The average time taken to satisfy a render request by reshading retained surface points. */
+    boost::chrono::microseconds averageReshadeTime;
+
+    /** The number of render requests that were hits. */
+    size_t hitCount;
+
+    /** The number of render requests that needed a full raycast. */
+    size_t missCount;
+
+    /** The number of render requests that were satisfied by reprojection. */
+    size_t reprojectionCount;
+
+    /** The number of render requests that were satisfied by reshading retained surface points. */
+    size_t reshadeCount;
+
+    /**
+     * \brief Estimates the total time saved by the cache, by assuming that every render request that was satisfied
+     *        without a full raycast would otherwise have taken the average time of one that needed one.
+     *
+     * \return  The estimated total time saved by the cache.
+     */
+    boost::chrono::microseconds estimated_saved_time() const;
+
+    /**
+     * \brief Calculates the fraction of render requests that were satisfied by reusing the image in the render state as-is.
+     *
+     * \return  The fraction of render requests that were hits (0 if there have been no render requests).
+     */
+    double hit_rate() const;
+  };
+
+  //#################### TYPEDEFS ####################
+private:
+  typedef tvgutil::AverageTimer<boost::chrono::microseconds> AverageTimer;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A timer recording the time taken by render requests that were hits. */
+  AverageTimer m_hitTimer;
+
+  /** The key of the image currently stored in the render state (if any). */
+  boost::optional<Key> m_lastKey;
+
+  /** The maximum angle (in radians) between the current pose and the pose of the last full raycast for reprojection to be used. */
+  double m_maxReprojectionRotation;
+
+  /** The maximum distance (in metres) between the current pose and the pose of the last full raycast for reprojection to be used. */
+  float m_maxReprojectionTranslation;
+
+  /** A timer recording the time taken by render requests that needed a full raycast. */
+  AverageTimer m_missTimer;
+
+  /** The key of the view whose raycast result is currently stored in the render state (if any), i.e. that of the last full raycast or reshade. */
+  boost::optional<Key> m_referenceKey;
+
+  /** The render state with which the cache is currently paired (used only to detect when the render state is replaced). */
+  const ITMLib::ITMRenderState *m_renderState;
+
+  /** Whether or not reprojection is enabled. */
+  bool m_reprojectionEnabled;
+
+  /** A timer recording the time taken by render requests that were satisfied by reprojection. */
+  AverageTimer m_reprojectionTimer;
+
+  /** A timer recording the time taken by render requests that were satisfied by reshading retained surface points. */
+  AverageTimer m_reshadeTimer;
+
+  /** The tracking state used to pass the current pose to InfiniTAM when reprojecting. */
+  TrackingState_Ptr m_reprojectionTrackingState;
+
+  /** The view used to pass the current intrinsics and image size to InfiniTAM when reprojecting. */
+  View_Ptr m_reprojectionView;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a render cache.
+   *
+   * \param reprojectionEnabled         Whether or not to allow render requests to be satisfied by reprojection.
+   * \param maxReprojectionRotation     The maximum angle (in radians) between the current pose and the pose of the last full raycast for reprojection to be used.
+   * \param maxReprojectionTranslation  The maximum distance (in metres) between the current pose and the pose of the last full raycast for reprojection to be used.
+   */
+  explicit VoxelRenderCache(bool reprojectionEnabled = false, double maxReprojectionRotation = 2 * M_PI / 180, float maxReprojectionTranslation = 0.02f);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the tracking state used to pass the current pose to InfiniTAM when reprojecting.
+   *
+   * \return  The tracking state used to pass the current pose to InfiniTAM when reprojecting (can be null, in which case the caller should create it).
+   */
+  TrackingState_Ptr& get_reprojection_tracking_state();
+
+  /**
+   * \brief Gets the view used to pass the current intrinsics and image size to InfiniTAM when reprojecting.
+   *
+   * \return  The view used to pass the current intrinsics and image size to InfiniTAM when reprojecting (can be null, in which case the caller should create it).
+   */
+  View_Ptr& get_reprojection_view();
+
+  /**
+   * \brief Gets statistics about the effectiveness of the cache.
+   *
+   * \return  Statistics about the effectiveness of the cache.
+   */
+  Statistics get_statistics() const;
+
+  /**
+   * \brief Forgets the contents of the render state, so that the next render request will need a full raycast.
+   */
+  void invalidate();
+
+  /**
+   * \brief Gets whether or not reprojection is enabled.
+   *
+   * \return  true, if reprojection is enabled, or false otherwise.
+   */
+  bool is_reprojection_enabled() const;
+
+  /**
+   * \brief Determines how a render request can be satisfied.
+   *
+   * \param key           The key of the requested rendering.
+   * \param renderState   The render state that will be used for the rendering.
+   * \param canReproject  Whether or not the requested type of visualisation can be generated from forward-projected surface points.
+   * \return              How the render request can be satisfied.
+   */
+  LookupResult lookup(const Key& key, const ITMLib::ITMRenderState *renderState, bool canReproject) const;
+
+  /**
+   * \brief Records the fact that a render request has been satisfied (and stops timing it).
+   *
+   * \param key         The key of the rendering.
+   * \param result      How the render request was satisfied.
+   * \param renderState The render state that was used for the rendering.
+   */
+  void record_render(const Key& key, LookupResult result, const ITMLib::ITMRenderState *renderState);
+
+  /**
+   * \brief Sets whether or not reprojection is enabled.
+   *
+   * \param reprojectionEnabled Whether or not reprojection is enabled.
+   */
+  void set_reprojection_enabled(bool reprojectionEnabled);
+
+  /**
+   * \brief Starts timing a render request.
+   *
+   * \param result  How the render request is going to be satisfied.
+   */
+  void start_timing(LookupResult result);
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Determines whether or not two poses are exactly the same.
+   *
+   * \param lhs The first pose.
+   * \param rhs The second pose.
+   * \return    true, if the poses are exactly the same, or false otherwise.
+   */
+  static bool same_pose(const ORUtils::SE3Pose& lhs, const ORUtils::SE3Pose& rhs);
+
+  /**
+   * \brief Determines whether or not two renderings show the same state of the same scene, using the same camera intrinsics and image size.
+   *
+   * \param lhs The key of the first rendering.
+   * \param rhs The key of the second rendering.
+   * \return    true, if the renderings show the same state of the same scene using the same intrinsics and image size, or false otherwise.
+   */
+  static bool same_scene_and_camera(const Key& lhs, const Key& rhs);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the timer used to record the time taken by render requests that were satisfied in the specified way.
+   *
+   * \param result  The way in which the render requests were satisfied.
+   * \return        The corresponding timer.
+   */
+  AverageTimer& get_timer(LookupResult result);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<VoxelRenderCache> VoxelRenderCache_Ptr;
+typedef boost::shared_ptr<const VoxelRenderCache> VoxelRenderCache_CPtr;
+
+}
+
+#endif
@@ -6,29 +6,119 @@
 #ifndef H_SPAINT_SEMANTICVISUALISER_CPU
 #define H_SPAINT_SEMANTICVISUALISER_CPU
 
+#include <vector>
+
+#include <itmx/base/ITMImagePtrTypes.h>
+
 #include "../interface/SemanticVisualiser.h"
+#include "../shared/SemanticVisualiser_Shared.h"
+#include "../../surfaces/interface/SurfaceGBuffer.h"
 
 namespace spaint {
 
 /**
  * \brief An instance of this class can be used to render a semantic visualisation of an InfiniTAM scene using the CPU.
+ *
+ * When the key of the view being rendered is known, a copy of the raycast result and a surface G-buffer computed from it (containing
+ * the colours, normals and labels of the voxels) are retained in one of a small number of slots, so that subsequent semantic views of
+ * the same state of the scene from the same pose only need a shading pass. Since the visualiser is shared by all of the sub-windows,
+ * this also avoids repeated work when several sub-windows show semantic views from the same pose.
  */
 class SemanticVisualiser_CPU : public SemanticVisualiser
 {
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the surface retained when rendering a particular view of the scene.
+   */
+  struct RetainedSurface
+  {
+    /** The surface G-buffer computed from the retained raycast result (including the colours and normals of the voxels). */
+    SurfaceGBuffer_Ptr gbuffer;
+
+    /** The key of the view from which the surface was retained (if any). */
+    boost::optional<VoxelRenderCache::Key> key;
+
+    /** The value of the visualiser's use count when the surface was last used. */
+    size_t lastUsed;
+
+    /** The position of the light source that was illuminating the scene when the view was rendered (in voxel coordinates). */
+    Vector3f lightPos;
+
+    /** A copy of the raycast result for the view. */
+    ITMFloat4Image_Ptr raycastResult;
+
+    /** The position of the viewer when the view was rendered (in voxel coordinates). */
+    Vector3f viewerPos;
+
+    RetainedSurface();
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /**
+   * A table containing the (premultiplied) contribution of each label's colour to the colour of a pixel showing a voxel with that label,
+   * given the current label alpha. The fourth component of each entry is unused, and is only present to allow the entries to be loaded
+   * directly into SIMD registers.
+   */
+  mutable std::vector<Vector4f> m_labelColourTable;
+
+  /** The retained surfaces (the least recently used of which is overwritten when a new view needs to be retained). */
+  mutable std::vector<RetainedSurface> m_retainedSurfaces;
+
+  /** The number of times the retained surfaces have been used (used to determine which of them was least recently used). */
+  mutable size_t m_useCount;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Constructs a CPU-based semantic visualiser.
    *
-   * \param maxLabelCount The maximum number of labels that can be in use.
+   * \param maxLabelCount         The maximum number of labels that can be in use.
+   * \param retainedSurfaceCount  The maximum number of views whose surfaces can be retained at any one time.
    */
-  explicit SemanticVisualiser_CPU(size_t maxLabelCount);
+  explicit SemanticVisualiser_CPU(size_t maxLabelCount, size_t retainedSurfaceCount = 4);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual bool has_surface(const VoxelRenderCache::Key& surfaceKey) const;
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Finds the retained surface (if any) for the view identified by the specified key.
+   *
+   * \param surfaceKey  The key identifying the view.
+   * \return            The retained surface for the view, if any, or NULL otherwise.
+   */
+  RetainedSurface *find_retained_surface(const VoxelRenderCache::Key& surfaceKey) const;
+
   /** Override */
   virtual void render_internal(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
-                               LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const;
+                               LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage,
+                               const boost::optional<VoxelRenderCache::Key>& surfaceKey) const;
+
+  /** Override */
+  virtual void reshade_internal(const VoxelRenderCache::Key& surfaceKey, LightingType lightingType, float labelAlpha, ITMLib::ITMRenderState *renderState) const;
+
+  /**
+   * \brief Renders a semantic view of the scene by shading a retained surface.
+   *
+   * \param surface       The retained surface.
+   * \param lightingType  The type of lighting to use.
+   * \param labelAlpha    The proportion (in the range [0,1]) of the final pixel colours that should be based on the voxels' semantic labels rather than their scene colours.
+   * \param outputImage   The image into which to write the semantic visualisation of the scene.
+   */
+  void shade_retained_surface(const RetainedSurface& surface, LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const;
+
+  /**
+   * \brief Fills in the label colour table for the specified label alpha, based on the current label colours.
+   *
+   * \param labelAlpha  The proportion (in the range [0,1]) of the final pixel colours that should be based on the voxels' semantic labels rather than their scene colours.
+   * \return            The weight with which the voxels' scene colours contribute to the final pixel colours.
+   */
+  float update_label_colour_table(float labelAlpha) const;
 };
 
 }
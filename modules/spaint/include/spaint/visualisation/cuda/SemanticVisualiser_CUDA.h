@@ -24,11 +24,20 @@ public:
    */
   explicit SemanticVisualiser_CUDA(size_t maxLabelCount);
 
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual bool has_surface(const VoxelRenderCache::Key& surfaceKey) const;
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /** Override */
   virtual void render_internal(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
-                               LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const;
+                               LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage,
+                               const boost::optional<VoxelRenderCache::Key>& surfaceKey) const;
+
+  /** Override */
+  virtual void reshade_internal(const VoxelRenderCache::Key& surfaceKey, LightingType lightingType, float labelAlpha, ITMLib::ITMRenderState *renderState) const;
 };
 
 }
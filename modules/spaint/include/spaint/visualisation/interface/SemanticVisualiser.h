@@ -12,6 +12,7 @@
 
 #include <ORUtils/SE3Pose.h>
 
+#include "../VoxelRenderCache.h"
 #include "../shared/SemanticVisualiser_Settings.h"
 #include "../../util/LabelManager.h"
 #include "../../util/SpaintVoxelScene.h"
@@ -22,6 +23,11 @@ namespace spaint {
  * \brief An instance of a class deriving from this one can be used to render a semantic visualisation of an InfiniTAM scene.
  *
  * By "semantic visualisation", we mean an image showing the voxels of the scene labelled with various different classes, e.g. floor, table, etc.
+ *
+ * A visualiser may retain the surface points it extracts when rendering a view whose key is known (together with the raycast result
+ * from which it extracted them), so that further semantic views of the same state of the scene from the same pose (e.g. in other
+ * sub-windows, or with a different lighting type) can be produced by reshading them, without needing to raycast the scene or look
+ * up any voxels.
  */
 class SemanticVisualiser
 {
@@ -58,9 +64,31 @@ private:
    * \param lightingType  The type of lighting to use.
    * \param labelAlpha    The proportion (in the range [0,1]) of the final pixel colours that should be based on the voxels' semantic labels rather than their scene colours.
    * \param outputImage   The image into which to write the semantic visualisation of the scene.
+   * \param surfaceKey    An optional key identifying the view being rendered, under which the visualiser may retain the surface points it extracts.
    */
   virtual void render_internal(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
-                               LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const = 0;
+                               LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage,
+                               const boost::optional<VoxelRenderCache::Key>& surfaceKey) const = 0;
+
+  /**
+   * \brief Renders a semantic view of the scene by reshading the surface points that were retained under the specified key.
+   *
+   * \param surfaceKey    The key identifying the view to render.
+   * \param lightingType  The type of lighting to use.
+   * \param labelAlpha    The proportion (in the range [0,1]) of the final pixel colours that should be based on the voxels' semantic labels rather than their scene colours.
+   * \param renderState   The render state into which to copy the retained raycast result, and into whose raycast image to write the semantic visualisation of the scene.
+   */
+  virtual void reshade_internal(const VoxelRenderCache::Key& surfaceKey, LightingType lightingType, float labelAlpha, ITMLib::ITMRenderState *renderState) const = 0;
+
+  //#################### PUBLIC ABSTRACT MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Determines whether or not the visualiser has retained the surface points for the view identified by the specified key.
+   *
+   * \param surfaceKey  The key identifying the view.
+   * \return            true, if the view can be rendered by calling reshade, or false otherwise.
+   */
+  virtual bool has_surface(const VoxelRenderCache::Key& surfaceKey) const = 0;
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -75,9 +103,37 @@ public:
    * \param lightingType  The type of lighting to use.
    * \param labelAlpha    The proportion (in the range [0,1]) of the final pixel colours that should be based on the voxels' semantic labels rather than their scene colours.
    * \param outputImage   The image into which to write the semantic visualisation of the scene.
+   * \param surfaceKey    An optional key identifying the view being rendered (if specified, the surface points may be retained for later reshading).
    */
   void render(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
-              const std::vector<Vector3u>& labelColours, LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const;
+              const std::vector<Vector3u>& labelColours, LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage,
+              const boost::optional<VoxelRenderCache::Key>& surfaceKey = boost::none) const;
+
+  /**
+   * \brief Renders a semantic view of the scene by reshading the surface points that were retained for it by an earlier call to render.
+   *
+   * The raycast result from which the surface points were extracted is copied into the render state, so that the render state is
+   * left exactly as if the view had been raycast into it, whichever render state the view was originally rendered into.
+   *
+   * \param surfaceKey    The key identifying the view to render.
+   * \param labelColours  The colours to use for the semantic labels.
+   * \param lightingType  The type of lighting to use.
+   * \param labelAlpha    The proportion (in the range [0,1]) of the final pixel colours that should be based on the voxels' semantic labels rather than their scene colours.
+   * \param renderState   The render state into which to copy the retained raycast result, and into whose raycast image to write the semantic visualisation of the scene.
+   *
+   * \throws std::runtime_error If the visualiser has not retained the surface points for the specified view.
+   */
+  void reshade(const VoxelRenderCache::Key& surfaceKey, const std::vector<Vector3u>& labelColours, LightingType lightingType, float labelAlpha,
+               ITMLib::ITMRenderState *renderState) const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Copies the specified label colours into the memory block used to store them (and onto the device, if necessary).
+   *
+   * \param labelColours  The colours to use for the semantic labels.
+   */
+  void update_label_colours(const std::vector<Vector3u>& labelColours) const;
 };
 
 //#################### TYPEDEFS ####################
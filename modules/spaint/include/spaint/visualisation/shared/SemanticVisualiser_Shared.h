@@ -14,72 +14,151 @@
 
 namespace spaint {
 
+//#################### TYPES ####################
+
+/**
+ * \brief An instance of this struct holds the information needed to shade a pixel in a semantic visualisation of the scene.
+ *
+ * Extracting this information requires a hash lookup and a normal computation, but the pixel can then be shaded with any
+ * combination of label colours, lighting type and label alpha without touching the scene again.
+ */
+struct SemanticSurfacePoint
+{
+  /** The intensity of the pixel under Lambertian lighting. */
+  float lambertianIntensity;
+
+  /** The intensity of the pixel under Phong lighting. */
+  float phongIntensity;
+
+  /** The scene colour of the voxel that was hit (black if the voxels have no colour information). */
+  Vector3u sceneColour;
+
+  /** The semantic label of the voxel that was hit. */
+  SpaintVoxel::Label label;
+
+  /** Whether or not any point was actually hit by the ray passing through the pixel. */
+  bool valid;
+};
+
 //#################### SHARED HELPER FUNCTIONS ####################
 
 /**
- * \brief Computes the colour for a pixel in a semantic visualisation of the scene.
+ * \brief Computes the intensities with which to shade a surface point in a semantic visualisation of the scene under each type of lighting that depends on the surface.
  *
- * This function is roughly analogous to a pixel shader.
+ * \param dest        The surface point whose intensities should be computed.
+ * \param point       The location of the surface point (in voxel coordinates).
+ * \param foundVoxel  Whether or not there is a voxel at the surface point (if not, the surface normal is ignored and treated as zero).
+ * \param N           The (unnormalised) surface normal at the surface point.
+ * \param viewerPos   The position of the viewer (in voxel coordinates).
+ * \param lightPos    The position of the light source that is illuminating the scene (in voxel coordinates).
+ */
+_CPU_AND_GPU_CODE_
+inline void compute_semantic_intensities(SemanticSurfacePoint& dest, const Vector3f& point, bool foundVoxel, Vector3f N,
+                                         const Vector3f& viewerPos, const Vector3f& lightPos)
+{
+  const float phongCoefficient = 0.35f;
+  const float phongExponent = 20.0f;
+
+  // Calculate the Lambertian lighting term.
+  Vector3f L = normalize(lightPos - point);
+  float NdotL = 0.0f;
+  if(foundVoxel)
+  {
+    N *= 1.0f / sqrt(N.x * N.x + N.y * N.y + N.z * N.z);
+    NdotL = dot(N, L);
+  }
+  else N = Vector3f(0.0f, 0.0f, 0.0f);
+  float lambertian = CLAMP(NdotL, 0.0f, 1.0f);
+
+  // Calculate the Phong lighting term.
+  Vector3f R = 2.0f * N * NdotL - L;
+  Vector3f V = normalize(viewerPos - point);
+  float phong = pow(CLAMP(dot(R,V), 0.0f, 1.0f), phongExponent);
+
+  // Determine the intensity of the pixel under each type of lighting that depends on the surface.
+  dest.lambertianIntensity = 0.2f + 0.8f * lambertian;
+  dest.phongIntensity = 0.3f + 0.35f * lambertian;
+  dest.phongIntensity += phongCoefficient * phong;
+}
+
+/**
+ * \brief Extracts the information needed to shade a pixel in a semantic visualisation of the scene.
+ *
+ * \param dest        A location into which to write the extracted surface point.
+ * \param point       The location of the point (if any) on the scene surface that was hit by a ray passing from the camera through the pixel.
+ * \param foundPoint  A flag indicating whether or not any point was actually hit by the ray (true if yes; false if no).
+ * \param voxelData   The scene's voxel data.
+ * \param voxelIndex  The scene's voxel index.
+ * \param viewerPos   The position of the viewer (in voxel coordinates).
+ * \param lightPos    The position of the light source that is illuminating the scene (in voxel coordinates).
+ */
+_CPU_AND_GPU_CODE_
+inline void extract_semantic_surface_point(SemanticSurfacePoint& dest, const Vector3f& point, bool foundPoint,
+                                           const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *voxelIndex,
+                                           const Vector3f& viewerPos, const Vector3f& lightPos)
+{
+  dest.valid = foundPoint;
+  if(!foundPoint) return;
+
+  // Look up the semantic label and scene colour (if available) of the voxel we hit.
+  const SpaintVoxel voxel = readVoxel(voxelData, voxelIndex, point.toIntRound(), foundPoint);
+  dest.label = voxel.packedLabel.label;
+  dest.sceneColour = SpaintVoxel::hasColorInformation ? VoxelColourReader<SpaintVoxel::hasColorInformation>::read(voxel) : Vector3u((uchar)0);
+
+  // Compute the intensities of the pixel from the surface normal at the point (if we found a voxel there).
+  const Vector3f N = foundPoint ? computeSingleNormalFromSDF(voxelData, voxelIndex, point) : Vector3f(0.0f, 0.0f, 0.0f);
+  compute_semantic_intensities(dest, point, foundPoint, N, viewerPos, lightPos);
+}
+
+/**
+ * \brief Gets the intensity with which to shade a surface point in a semantic visualisation of the scene.
+ *
+ * \param surfacePoint  The surface point.
+ * \param lightingType  The type of lighting to use.
+ * \return              The intensity with which to shade the surface point.
+ */
+_CPU_AND_GPU_CODE_
+inline float semantic_intensity(const SemanticSurfacePoint& surfacePoint, LightingType lightingType)
+{
+  switch(lightingType)
+  {
+    case LT_LAMBERTIAN:
+      return surfacePoint.lambertianIntensity;
+    case LT_PHONG:
+      return surfacePoint.phongIntensity;
+    case LT_FLAT:
+    default:
+      return 1.0f;
+  }
+}
+
+/**
+ * \brief Computes the colour for a pixel in a semantic visualisation of the scene from a previously-extracted surface point.
  *
  * \param dest          A location into which to write the computed colour.
- * \param point         The location of the point (if any) on the scene surface that was hit by a ray passing from the camera through the pixel.
- * \param foundPoint    A flag indicating whether or not any point was actually hit by the ray (true if yes; false if no).
- * \param voxelData     The scene's voxel data.
- * \param voxelIndex    The scene's voxel index.
+ * \param surfacePoint  The surface point extracted for the pixel.
  * \param labelColours  The colour map for the semantic labels.
- * \param viewerPos     The position of the viewer (in voxel coordinates).
- * \param lightPos      The position of the light source that is illuminating the scene (in voxel coordinates).
  * \param lightingType  The type of lighting to use.
  * \param labelAlpha    The proportion (in the range [0,1]) of the final pixel colour that should be based on the voxel's semantic label rather than its scene colour.
  */
 _CPU_AND_GPU_CODE_
-inline void shade_pixel_semantic(Vector4u& dest, const Vector3f& point, bool foundPoint,
-                                 const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *voxelIndex,
-                                 const Vector3u *labelColours, const Vector3f& viewerPos, const Vector3f& lightPos,
-                                 LightingType lightingType, const float labelAlpha)
+inline void shade_semantic_surface_point(Vector4u& dest, const SemanticSurfacePoint& surfacePoint, const Vector3u *labelColours,
+                                         LightingType lightingType, const float labelAlpha)
 {
-  const float ambient = lightingType == LT_PHONG ? 0.3f : 0.2f;
-  const float lambertianCoefficient = lightingType == LT_PHONG ? 0.35f : 0.8f;
-  const float phongCoefficient = 0.35f;
-  const float phongExponent = 20.0f;
-
   dest = Vector4u((uchar)0);
-  if(foundPoint)
+  if(surfacePoint.valid)
   {
     // Determine the base colour to use for the pixel based on the semantic label of the voxel we hit and its scene colour (if available).
-    const SpaintVoxel voxel = readVoxel(voxelData, voxelIndex, point.toIntRound(), foundPoint);
-    const Vector3u labelColour = labelColours[voxel.packedLabel.label];
+    const Vector3u labelColour = labelColours[surfacePoint.label];
     Vector3u colour;
     if(SpaintVoxel::hasColorInformation)
     {
-      const Vector3u sceneColour = VoxelColourReader<SpaintVoxel::hasColorInformation>::read(voxel);
-      colour = (labelAlpha * labelColour.toFloat() + (1.0f - labelAlpha) * sceneColour.toFloat()).toUChar();
+      colour = (labelAlpha * labelColour.toFloat() + (1.0f - labelAlpha) * surfacePoint.sceneColour.toFloat()).toUChar();
     }
     else colour = labelColour;
 
-    // Calculate the Lambertian lighting term.
-    Vector3f L = normalize(lightPos - point);
-    Vector3f N(0.0f, 0.0f, 0.0f);
-    float NdotL = 0.0f;
-    computeNormalAndAngle<SpaintVoxel,ITMVoxelIndex>(foundPoint, point, voxelData, voxelIndex, L, N, NdotL);
-    float lambertian = CLAMP(NdotL, 0.0f, 1.0f);
-
-    // Determine the intensity of the pixel using the Lambertian lighting equation.
-    float intensity = lightingType != LT_FLAT ? ambient + lambertianCoefficient * lambertian : 1.0f;
-
-    // If we're using Phong lighting:
-    if(lightingType == LT_PHONG)
-    {
-      // Calculate the Phong lighting term.
-      Vector3f R = 2.0f * N * NdotL - L;
-      Vector3f V = normalize(viewerPos - point);
-      float phong = pow(CLAMP(dot(R,V), 0.0f, 1.0f), phongExponent);
-
-      // Add the Phong lighting term to the intensity.
-      intensity += phongCoefficient * phong;
-    }
-
     // Fill in the final colour for the pixel by scaling the base colour by the intensity.
+    const float intensity = semantic_intensity(surfacePoint, lightingType);
     dest.x = (uchar)(intensity * colour.r);
     dest.y = (uchar)(intensity * colour.g);
     dest.z = (uchar)(intensity * colour.b);
@@ -87,6 +166,33 @@ inline void shade_pixel_semantic(Vector4u& dest, const Vector3f& point, bool fou
   }
 }
 
+/**
+ * \brief Computes the colour for a pixel in a semantic visualisation of the scene.
+ *
+ * This function is roughly analogous to a pixel shader.
+ *
+ * \param dest          A location into which to write the computed colour.
+ * \param point         The location of the point (if any) on the scene surface that was hit by a ray passing from the camera through the pixel.
+ * \param foundPoint    A flag indicating whether or not any point was actually hit by the ray (true if yes; false if no).
+ * \param voxelData     The scene's voxel data.
+ * \param voxelIndex    The scene's voxel index.
+ * \param labelColours  The colour map for the semantic labels.
+ * \param viewerPos     The position of the viewer (in voxel coordinates).
+ * \param lightPos      The position of the light source that is illuminating the scene (in voxel coordinates).
+ * \param lightingType  The type of lighting to use.
+ * \param labelAlpha    The proportion (in the range [0,1]) of the final pixel colour that should be based on the voxel's semantic label rather than its scene colour.
+ */
+_CPU_AND_GPU_CODE_
+inline void shade_pixel_semantic(Vector4u& dest, const Vector3f& point, bool foundPoint,
+                                 const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *voxelIndex,
+                                 const Vector3u *labelColours, const Vector3f& viewerPos, const Vector3f& lightPos,
+                                 LightingType lightingType, const float labelAlpha)
+{
+  SemanticSurfacePoint surfacePoint;
+  extract_semantic_surface_point(surfacePoint, point, foundPoint, voxelData, voxelIndex, viewerPos, lightPos);
+  shade_semantic_surface_point(dest, surfacePoint, labelColours, lightingType, labelAlpha);
+}
+
 }
 
 #endif
@@ -0,0 +1,142 @@
+/**
+ * spaint: FeatureCache.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#include "features/FeatureCache.h"
+
+#include <algorithm>
+
+namespace spaint {
+
+//#################### CONSTRUCTORS ####################
+
+FeatureCache::FeatureCache(size_t capacity, size_t featureCount, size_t shardCount)
+: m_featureCount(featureCount)
+{
+  shardCount = std::max<size_t>(shardCount, 1);
+  const size_t slotsPerShard = std::max<size_t>((capacity + shardCount - 1) / shardCount, 1);
+  for(size_t i = 0; i < shardCount; ++i)
+  {
+    m_shards.push_back(Shard_Ptr(new Shard(slotsPerShard, featureCount)));
+  }
+}
+
+FeatureCache::Shard::Shard(size_t slotCount, size_t featureCount)
+: clockHand(0), features(slotCount * featureCount), generations(slotCount), hitCount(0), keys(slotCount), missCount(0), referenced(slotCount, 0)
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void FeatureCache::clear()
+{
+  for(size_t i = 0, size = m_shards.size(); i < size; ++i)
+  {
+    Shard& shard = *m_shards[i];
+    boost::lock_guard<boost::mutex> lock(shard.mutex);
+    shard.slots.clear();
+    shard.clockHand = 0;
+    std::fill(shard.referenced.begin(), shard.referenced.end(), 0);
+  }
+}
+
+size_t FeatureCache::get_hit_count() const
+{
+  size_t hitCount = 0;
+  for(size_t i = 0, size = m_shards.size(); i < size; ++i)
+  {
+    Shard& shard = *m_shards[i];
+    boost::lock_guard<boost::mutex> lock(shard.mutex);
+    hitCount += shard.hitCount;
+  }
+  return hitCount;
+}
+
+size_t FeatureCache::get_miss_count() const
+{
+  size_t missCount = 0;
+  for(size_t i = 0, size = m_shards.size(); i < size; ++i)
+  {
+    Shard& shard = *m_shards[i];
+    boost::lock_guard<boost::mutex> lock(shard.mutex);
+    missCount += shard.missCount;
+  }
+  return missCount;
+}
+
+bool FeatureCache::lookup(const Vector3s& voxelLocation, unsigned int minGeneration, float *features) const
+{
+  const Key key = VoxelKeyUtil::make_key(voxelLocation);
+  Shard& shard = get_shard(key);
+  boost::lock_guard<boost::mutex> lock(shard.mutex);
+
+  // If there is no descriptor for the voxel, or the descriptor is too old to be valid, signal a miss.
+  std::map<Key,size_t>::const_iterator it = shard.slots.find(key);
+  if(it == shard.slots.end() || shard.generations[it->second] < minGeneration)
+  {
+    ++shard.missCount;
+    return false;
+  }
+
+  // Otherwise, copy out the descriptor and mark its slot as having been referenced.
+  const size_t slot = it->second;
+  const float *cachedFeatures = &shard.features[slot * m_featureCount];
+  std::copy(cachedFeatures, cachedFeatures + m_featureCount, features);
+  shard.referenced[slot] = 1;
+  ++shard.hitCount;
+  return true;
+}
+
+void FeatureCache::store(const Vector3s& voxelLocation, unsigned int generation, const float *features)
+{
+  const Key key = VoxelKeyUtil::make_key(voxelLocation);
+  Shard& shard = get_shard(key);
+  boost::lock_guard<boost::mutex> lock(shard.mutex);
+
+  size_t slot;
+  std::map<Key,size_t>::const_iterator it = shard.slots.find(key);
+  if(it != shard.slots.end())
+  {
+    // If there is already a descriptor for the voxel, overwrite it in place.
+    slot = it->second;
+  }
+  else if(shard.slots.size() < shard.keys.size())
+  {
+    // Otherwise, if the shard still has free slots, use the next one.
+    slot = shard.slots.size();
+    shard.slots.insert(std::make_pair(key, slot));
+  }
+  else
+  {
+    // Otherwise, advance the clock hand until we find a slot that has not been referenced since the hand last passed it,
+    // clearing the referenced bits of the slots we skip over, and then evict the descriptor in that slot.
+    while(shard.referenced[shard.clockHand])
+    {
+      shard.referenced[shard.clockHand] = 0;
+      shard.clockHand = (shard.clockHand + 1) % shard.keys.size();
+    }
+
+    slot = shard.clockHand;
+    shard.clockHand = (shard.clockHand + 1) % shard.keys.size();
+    shard.slots.erase(shard.keys[slot]);
+    shard.slots.insert(std::make_pair(key, slot));
+  }
+
+  std::copy(features, features + m_featureCount, &shard.features[slot * m_featureCount]);
+  shard.generations[slot] = generation;
+  shard.keys[slot] = key;
+  shard.referenced[slot] = 0;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+FeatureCache::Shard& FeatureCache::get_shard(Key key) const
+{
+  // Mix the bits of the key so that neighbouring voxels are spread across the shards.
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return *m_shards[static_cast<size_t>(key % m_shards.size())];
+}
+
+}
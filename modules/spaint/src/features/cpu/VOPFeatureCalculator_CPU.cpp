@@ -5,8 +5,12 @@
 
 #include "features/cpu/VOPFeatureCalculator_CPU.h"
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
+#include <boost/cstdint.hpp>
+
 #include <ITMLib/Objects/Scene/ITMRepresentationAccess.h>
 
 #include "features/shared/VOPFeatureCalculator_Shared.h"
@@ -19,6 +23,26 @@ VOPFeatureCalculator_CPU::VOPFeatureCalculator_CPU(size_t maxVoxelLocationCount,
 : VOPFeatureCalculator(maxVoxelLocationCount, patchSize, patchSpacing, binCount)
 {}
 
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+boost::uint64_t VOPFeatureCalculator_CPU::make_morton_code(const Vector3s& voxelLocation)
+{
+  // Offset each coordinate so that it is non-negative, and then interleave the bits of the three coordinates.
+  boost::uint64_t x = static_cast<boost::uint64_t>(voxelLocation.x + 32768);
+  boost::uint64_t y = static_cast<boost::uint64_t>(voxelLocation.y + 32768);
+  boost::uint64_t z = static_cast<boost::uint64_t>(voxelLocation.z + 32768);
+
+  boost::uint64_t code = 0;
+  for(int i = 0; i < 16; ++i)
+  {
+    code |= ((x >> i) & 1) << (3 * i + 2);
+    code |= ((y >> i) & 1) << (3 * i + 1);
+    code |= ((z >> i) & 1) << (3 * i);
+  }
+
+  return code;
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
 void VOPFeatureCalculator_CPU::calculate_surface_normals(const ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB,
@@ -96,12 +120,30 @@ void VOPFeatureCalculator_CPU::generate_rgb_patches(const ORUtils::MemoryBlock<V
   const Vector3s *voxelLocations = voxelLocationsMB.GetData(MEMORYDEVICE_CPU);
   const int voxelLocationCount = static_cast<int>(voxelLocationsMB.dataSize);
 
+  // Visit the voxels in Morton order, so that the voxels processed consecutively by each thread are close together
+  // in the scene and their patches can share the voxel blocks in the thread's block cache. Each patch is still written
+  // into the slot for its voxel in the features array, so the order in which the voxels are visited does not affect
+  // the resulting descriptors.
+  std::vector<std::pair<boost::uint64_t,int> > visitOrder(voxelLocationCount);
+  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
+  {
+    visitOrder[voxelLocationIndex] = std::make_pair(make_morton_code(voxelLocations[voxelLocationIndex]), voxelLocationIndex);
+  }
+  std::sort(visitOrder.begin(), visitOrder.end());
+
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+  #pragma omp parallel
 #endif
-  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
   {
-    generate_rgb_patch(voxelLocationIndex, voxelLocations, xAxes, yAxes, voxelData, indexData, m_patchSize, m_patchSpacing, featureCount, features);
+    BlockCachingVoxelReader voxelReader(voxelData, indexData);
+
+#ifdef WITH_OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for(int i = 0; i < voxelLocationCount; ++i)
+    {
+      generate_rgb_patch(visitOrder[i].second, voxelLocations, xAxes, yAxes, voxelReader, m_patchSize, m_patchSpacing, featureCount, features);
+    }
   }
 }
 
@@ -5,12 +5,13 @@
 
 #include "fiducials/ArUcoFiducialDetector.h"
 
+#include <algorithm>
 #include <cmath>
+#include <set>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
 
-#include <opencv2/aruco.hpp>
 #include <opencv2/calib3d.hpp>
 
 #include <ITMLib/Objects/Camera/ITMIntrinsics.h>
@@ -29,8 +30,21 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 ArUcoFiducialDetector::ArUcoFiducialDetector(const Settings_CPtr& settings)
-: m_settings(settings)
-{}
+: m_dictionary(cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250)),
+  m_framesUntilFullDetection(0),
+  m_settings(settings)
+{
+  const static std::string settingsNamespace = "ArUcoFiducialDetector.";
+  m_fullDetectionInterval = std::max(settings->get_first_value<int>(settingsNamespace + "fullDetectionInterval", 10), 1);
+  m_roiMargin = settings->get_first_value<float>(settingsNamespace + "roiMargin", 0.5f);
+
+  // Allocate memory blocks that are large enough to pick the pose estimation corners of every marker in the dictionary at once.
+  const size_t maxPickPointCount = 3 * m_dictionary.bytesList.rows;
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  m_pickImagePointsMB = mbf.make_block<Vector2i>(maxPickPointCount);
+  m_pickScenePointsMB = mbf.make_block<Vector3f>(maxPickPointCount);
+  m_pickScenePointsValidMB = mbf.make_block<bool>(maxPickPointCount);
+}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
@@ -39,23 +53,10 @@ std::map<std::string,FiducialMeasurement> ArUcoFiducialDetector::detect_fiducial
 {
   std::map<std::string,FiducialMeasurement> result;
 
-  // Convert the current colour input image to OpenCV format.
-  const ITMUChar4Image *rgb = view->rgb;
-  rgb->UpdateHostFromDevice();
-  cv::Mat3b rgbImage = OpenCVUtil::make_rgb_image(rgb->GetData(MEMORYDEVICE_CPU), rgb->noDims.x, rgb->noDims.y);
-
   // Detect any ArUco fiducials that are visible.
-  cv::aruco::Dictionary dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250);
   std::vector<std::vector<cv::Point2f> > corners;
   std::vector<int> ids;
-  cv::aruco::detectMarkers(rgbImage, dictionary, corners, ids);
-
-#if 0
-  // Visualise the detected fiducials for debugging purposes.
-  cv::Mat3b markerImage = rgbImage.clone();
-  cv::aruco::drawDetectedMarkers(markerImage, corners, ids);
-  cv::imshow("Detected Markers", markerImage);
-#endif
+  detect_markers(view->rgb, ids, corners);
 
   // Construct the fiducial measurements.
   std::vector<boost::optional<FiducialMeasurement> > measurements;
@@ -166,13 +167,11 @@ ArUcoFiducialDetector::construct_measurements_from_raycast(const std::vector<int
 {
   std::vector<boost::optional<FiducialMeasurement> > measurements;
 
+  const std::vector<boost::optional<Vector3f> > cornerPoints = pick_corners_from_raycast(corners, renderState);
+
   for(size_t i = 0, size = corners.size(); i < size; ++i)
   {
-    boost::optional<ORUtils::SE3Pose> fiducialPoseWorld = make_pose_from_corners(
-      pick_corner_from_raycast(corners[i][3], renderState),
-      pick_corner_from_raycast(corners[i][2], renderState),
-      pick_corner_from_raycast(corners[i][0], renderState)
-    );
+    boost::optional<ORUtils::SE3Pose> fiducialPoseWorld = make_pose_from_corners(cornerPoints[i * 3], cornerPoints[i * 3 + 1], cornerPoints[i * 3 + 2]);
 
     boost::optional<ORUtils::SE3Pose> fiducialPoseEye;
     if(fiducialPoseWorld) fiducialPoseEye.reset(fiducialPoseWorld->GetM() * pose.GetInvM());
@@ -199,19 +198,158 @@ boost::optional<Vector3f> ArUcoFiducialDetector::pick_corner_from_depth(const cv
   else return boost::none;
 }
 
-boost::optional<Vector3f> ArUcoFiducialDetector::pick_corner_from_raycast(const cv::Point2f& corner, const VoxelRenderState_CPtr& renderState) const
+void ArUcoFiducialDetector::detect_markers(const ITMUChar4Image *rgb, std::vector<int>& ids, std::vector<MarkerCorners>& corners) const
+{
+  rgb->UpdateHostFromDevice();
+  const Vector4u *rgbData = rgb->GetData(MEMORYDEVICE_CPU);
+  const cv::Size imgSize(rgb->noDims.x, rgb->noDims.y);
+
+  // Decide whether to search the whole image or only the regions around the markers we are tracking. We search the whole image
+  // if we are not tracking any markers, if any of the markers we were tracking were lost in the previous frame, or if it is time
+  // for a periodic full-frame search (to pick up any markers that have become visible since the last one).
+  const bool fullDetection = m_trackedCorners.empty() || m_framesUntilFullDetection <= 0;
+
+  if(fullDetection)
+  {
+    // Convert the whole of the current colour input image to OpenCV format and search it for ArUco markers.
+    cv::Mat3b rgbImage = OpenCVUtil::make_rgb_image(rgbData, imgSize.width, imgSize.height);
+    cv::aruco::detectMarkers(rgbImage, m_dictionary, corners, ids);
+
+#if 0
+    // Visualise the detected fiducials for debugging purposes.
+    cv::Mat3b markerImage = rgbImage.clone();
+    cv::aruco::drawDetectedMarkers(markerImage, corners, ids);
+    cv::imshow("Detected Markers", markerImage);
+#endif
+
+    m_framesUntilFullDetection = m_fullDetectionInterval - 1;
+  }
+  else
+  {
+    std::set<int> foundIDs;
+
+    for(MarkerCornersMap::const_iterator it = m_trackedCorners.begin(), iend = m_trackedCorners.end(); it != iend; ++it)
+    {
+      // If the marker has already been found in the region predicted for another marker, there is no need to look for it again.
+      if(foundIDs.find(it->first) != foundIDs.end()) continue;
+
+      // Predict the region of the image in which the marker will be found (if any).
+      const cv::Rect roi = predict_roi(it->first, imgSize);
+      if(roi.area() == 0) continue;
+
+      // Convert the region to OpenCV format and search it for ArUco markers. Note that any other markers that happen to be in the
+      // region will also be found: we keep them, provided we have not already found them in the region of some other marker.
+      cv::Mat3b roiImage = OpenCVUtil::make_rgb_image(rgbData, imgSize.width, roi);
+      std::vector<MarkerCorners> roiCorners;
+      std::vector<int> roiIDs;
+      cv::aruco::detectMarkers(roiImage, m_dictionary, roiCorners, roiIDs);
+
+      for(size_t i = 0, size = roiIDs.size(); i < size; ++i)
+      {
+        if(!foundIDs.insert(roiIDs[i]).second) continue;
+
+        // Convert the marker's corners from region coordinates to image coordinates.
+        for(size_t j = 0, cornerCount = roiCorners[i].size(); j < cornerCount; ++j)
+        {
+          roiCorners[i][j].x += roi.x;
+          roiCorners[i][j].y += roi.y;
+        }
+
+        ids.push_back(roiIDs[i]);
+        corners.push_back(roiCorners[i]);
+      }
+    }
+
+    // If any of the markers we were tracking have been lost, search the whole of the next frame.
+    --m_framesUntilFullDetection;
+    for(MarkerCornersMap::const_iterator it = m_trackedCorners.begin(), iend = m_trackedCorners.end(); it != iend; ++it)
+    {
+      if(foundIDs.find(it->first) == foundIDs.end())
+      {
+        m_framesUntilFullDetection = 0;
+        break;
+      }
+    }
+  }
+
+  // Update the markers we are tracking.
+  m_previousCorners.swap(m_trackedCorners);
+  m_trackedCorners.clear();
+  for(size_t i = 0, size = ids.size(); i < size; ++i)
+  {
+    m_trackedCorners[ids[i]] = corners[i];
+  }
+}
+
+std::vector<boost::optional<Vector3f> > ArUcoFiducialDetector::pick_corners_from_raycast(const std::vector<MarkerCorners>& corners, const VoxelRenderState_CPtr& renderState) const
 {
   // FIXME: I'm currently assuming that there is an identity mapping between the depth and colour cameras - in general, this won't be the case.
   const int width = renderState->raycastResult->noDims.x, height = renderState->raycastResult->noDims.y;
-  Vector2i p((int)CLAMP(ROUND(corner.x), 0, width - 1), (int)CLAMP(ROUND(corner.y), 0, height - 1));
+
+  // Copy the corners we need into the image points memory block, so that they can all be picked at once. Any markers that do
+  // not fit in the memory block (which can only happen if the same marker is detected multiple times) are ignored.
+  const size_t maxPickPointCount = 3 * static_cast<size_t>(m_dictionary.bytesList.rows);
+  const size_t pickPointCount = std::min(corners.size() * 3, maxPickPointCount);
+  std::vector<boost::optional<Vector3f> > result(corners.size() * 3);
+  if(pickPointCount == 0) return result;
+
+  const int cornerIndices[] = { 3, 2, 0 };
+  Vector2i *imagePoints = m_pickImagePointsMB->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < pickPointCount; ++i)
+  {
+    const cv::Point2f& corner = corners[i / 3][cornerIndices[i % 3]];
+    imagePoints[i] = Vector2i((int)CLAMP(ROUND(corner.x), 0, width - 1), (int)CLAMP(ROUND(corner.y), 0, height - 1));
+  }
+
+  m_pickImagePointsMB->dataSize = pickPointCount;
+  m_pickImagePointsMB->UpdateDeviceFromHost();
+  m_pickScenePointsMB->dataSize = pickPointCount;
+  m_pickScenePointsValidMB->dataSize = pickPointCount;
 
   if(!m_picker) m_picker = PickerFactory::make_picker(m_settings->deviceType);
 
-  static boost::shared_ptr<ORUtils::MemoryBlock<Vector3f> > pickPointFloatMB = MemoryBlockFactory::instance().make_block<Vector3f>(1);
-  bool pickPointFound = m_picker->pick(p.x, p.y, renderState.get(), *pickPointFloatMB);
-  if(!pickPointFound) return boost::none;
+  // Pick all of the corners in a single batch, and keep the scene points for those corners whose rays hit the scene.
+  m_picker->pick(*m_pickImagePointsMB, renderState.get(), *m_pickScenePointsMB, *m_pickScenePointsValidMB);
+  m_pickScenePointsValidMB->UpdateHostFromDevice();
+
+  const bool *hits = m_pickScenePointsValidMB->GetData(MEMORYDEVICE_CPU);
+  const std::vector<Vector3f> scenePoints = Picker::get_positions<Vector3f>(*m_pickScenePointsMB, m_settings->sceneParams.voxelSize);
+  for(size_t i = 0; i < pickPointCount; ++i)
+  {
+    if(hits[i]) result[i] = scenePoints[i];
+  }
+
+  return result;
+}
+
+cv::Rect ArUcoFiducialDetector::predict_roi(int id, const cv::Size& imgSize) const
+{
+  const MarkerCorners& currentCorners = m_trackedCorners.find(id)->second;
+
+  // Predict where the marker's corners will be in the next frame by assuming that they will continue to move with constant velocity
+  // (if the marker was also detected in the previous frame), or that they will stay where they are (otherwise).
+  MarkerCorners predictedCorners = currentCorners;
+  MarkerCornersMap::const_iterator it = m_previousCorners.find(id);
+  if(it != m_previousCorners.end())
+  {
+    for(size_t i = 0, size = predictedCorners.size(); i < size; ++i)
+    {
+      predictedCorners[i] += currentCorners[i] - it->second[i];
+    }
+  }
 
-  return Picker::get_positions<Vector3f>(*pickPointFloatMB, m_settings->sceneParams.voxelSize)[0];
+  // Compute a box that bounds both the current and predicted corners, to allow for the prediction being wrong.
+  std::vector<cv::Point2f> points(currentCorners);
+  points.insert(points.end(), predictedCorners.begin(), predictedCorners.end());
+  cv::Rect box = cv::boundingRect(points);
+
+  // Expand the box by the margin (ArUco needs a quiet zone around each marker in order to detect it), and clip it to the image.
+  const int margin = static_cast<int>(ceil(m_roiMargin * std::max(box.width, box.height)));
+  box.x -= margin;
+  box.y -= margin;
+  box.width += 2 * margin;
+  box.height += 2 * margin;
+  return box & cv::Rect(0, 0, imgSize.width, imgSize.height);
 }
 
 //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
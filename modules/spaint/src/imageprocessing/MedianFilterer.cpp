@@ -5,35 +5,440 @@
 
 #include "imageprocessing/MedianFilterer.h"
 
-#include "imageprocessing/ImageProcessorFactory.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SPAINT_MEDIAN_USE_SSE2 1
+#else
+  #define SPAINT_MEDIAN_USE_SSE2 0
+#endif
 
 namespace spaint {
 
+//#################### LOCAL TYPES ####################
+
+/**
+ * \brief An instance of this struct holds 16 consecutive channel values (i.e. 4 RGBA pixels), on which min/max can be computed lane-wise.
+ */
+#if SPAINT_MEDIAN_USE_SSE2
+struct Lanes16
+{
+  __m128i v;
+
+  static Lanes16 load(const unsigned char *p) { Lanes16 l; l.v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); return l; }
+  static Lanes16 zero() { Lanes16 l; l.v = _mm_setzero_si128(); return l; }
+  void store(unsigned char *p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+};
+
+inline Lanes16 lane_min(const Lanes16& a, const Lanes16& b) { Lanes16 l; l.v = _mm_min_epu8(a.v, b.v); return l; }
+inline Lanes16 lane_max(const Lanes16& a, const Lanes16& b) { Lanes16 l; l.v = _mm_max_epu8(a.v, b.v); return l; }
+#else
+struct Lanes16
+{
+  unsigned char v[16];
+
+  static Lanes16 load(const unsigned char *p) { Lanes16 l; memcpy(l.v, p, 16); return l; }
+  static Lanes16 zero() { Lanes16 l; memset(l.v, 0, 16); return l; }
+  void store(unsigned char *p) const { memcpy(p, v, 16); }
+};
+
+inline Lanes16 lane_min(const Lanes16& a, const Lanes16& b) { Lanes16 l; for(int i = 0; i < 16; ++i) l.v[i] = std::min(a.v[i], b.v[i]); return l; }
+inline Lanes16 lane_max(const Lanes16& a, const Lanes16& b) { Lanes16 l; for(int i = 0; i < 16; ++i) l.v[i] = std::max(a.v[i], b.v[i]); return l; }
+#endif
+
+inline unsigned char lane_min(unsigned char a, unsigned char b) { return a < b ? a : b; }
+inline unsigned char lane_max(unsigned char a, unsigned char b) { return a < b ? b : a; }
+
+//#################### LOCAL FUNCTIONS ####################
+
+/**
+ * \brief Orders two values (lane-wise) so that the first is no greater than the second.
+ */
+template <typename T>
+inline void sort2(T& a, T& b)
+{
+  const T lo = lane_min(a, b);
+  b = lane_max(a, b);
+  a = lo;
+}
+
+/**
+ * \brief Computes the median of 9 values (lane-wise) using a 19-exchange selection network.
+ *
+ * See: N. Devillard, "Fast median search: an ANSI C implementation", 1998.
+ *
+ * \param p The values (these will be partially reordered).
+ * \return  The median.
+ */
+template <typename T>
+inline T median9(T *p)
+{
+  sort2(p[1], p[2]); sort2(p[4], p[5]); sort2(p[7], p[8]);
+  sort2(p[0], p[1]); sort2(p[3], p[4]); sort2(p[6], p[7]);
+  sort2(p[1], p[2]); sort2(p[4], p[5]); sort2(p[7], p[8]);
+  sort2(p[0], p[3]); sort2(p[5], p[8]); sort2(p[4], p[7]);
+  sort2(p[3], p[6]); sort2(p[1], p[4]); sort2(p[2], p[5]);
+  sort2(p[4], p[7]); sort2(p[4], p[2]); sort2(p[6], p[4]);
+  sort2(p[4], p[2]);
+  return p[4];
+}
+
+/**
+ * \brief Computes the median of 25 values (lane-wise) using a 99-exchange selection network.
+ *
+ * See: N. Devillard, "Fast median search: an ANSI C implementation", 1998.
+ *
+ * \param p The values (these will be partially reordered).
+ * \return  The median.
+ */
+template <typename T>
+inline T median25(T *p)
+{
+  sort2(p[0], p[1]);   sort2(p[3], p[4]);   sort2(p[2], p[4]);   sort2(p[2], p[3]);   sort2(p[6], p[7]);
+  sort2(p[5], p[7]);   sort2(p[5], p[6]);   sort2(p[9], p[10]);  sort2(p[8], p[10]);  sort2(p[8], p[9]);
+  sort2(p[12], p[13]); sort2(p[11], p[13]); sort2(p[11], p[12]); sort2(p[15], p[16]); sort2(p[14], p[16]);
+  sort2(p[14], p[15]); sort2(p[18], p[19]); sort2(p[17], p[19]); sort2(p[17], p[18]); sort2(p[21], p[22]);
+  sort2(p[20], p[22]); sort2(p[20], p[21]); sort2(p[23], p[24]); sort2(p[2], p[5]);   sort2(p[3], p[6]);
+  sort2(p[0], p[6]);   sort2(p[0], p[3]);   sort2(p[4], p[7]);   sort2(p[1], p[7]);   sort2(p[1], p[4]);
+  sort2(p[11], p[14]); sort2(p[8], p[14]);  sort2(p[8], p[11]);  sort2(p[12], p[15]); sort2(p[9], p[15]);
+  sort2(p[9], p[12]);  sort2(p[13], p[16]); sort2(p[10], p[16]); sort2(p[10], p[13]); sort2(p[20], p[23]);
+  sort2(p[17], p[23]); sort2(p[17], p[20]); sort2(p[21], p[24]); sort2(p[18], p[24]); sort2(p[18], p[21]);
+  sort2(p[19], p[22]); sort2(p[8], p[17]);  sort2(p[9], p[18]);  sort2(p[0], p[18]);  sort2(p[0], p[9]);
+  sort2(p[10], p[19]); sort2(p[1], p[19]);  sort2(p[1], p[10]);  sort2(p[11], p[20]); sort2(p[2], p[20]);
+  sort2(p[2], p[11]);  sort2(p[12], p[21]); sort2(p[3], p[21]);  sort2(p[3], p[12]);  sort2(p[13], p[22]);
+  sort2(p[4], p[22]);  sort2(p[4], p[13]);  sort2(p[14], p[23]); sort2(p[5], p[23]);  sort2(p[5], p[14]);
+  sort2(p[15], p[24]); sort2(p[6], p[24]);  sort2(p[6], p[15]);  sort2(p[7], p[16]);  sort2(p[7], p[19]);
+  sort2(p[13], p[21]); sort2(p[15], p[23]); sort2(p[7], p[13]);  sort2(p[7], p[15]);  sort2(p[1], p[9]);
+  sort2(p[3], p[11]);  sort2(p[5], p[17]);  sort2(p[11], p[17]); sort2(p[9], p[17]);  sort2(p[4], p[10]);
+  sort2(p[6], p[12]);  sort2(p[7], p[14]);  sort2(p[4], p[6]);   sort2(p[4], p[7]);   sort2(p[12], p[14]);
+  sort2(p[10], p[14]); sort2(p[6], p[7]);   sort2(p[10], p[12]); sort2(p[6], p[10]);  sort2(p[6], p[17]);
+  sort2(p[12], p[17]); sort2(p[7], p[17]);  sort2(p[7], p[10]);  sort2(p[12], p[18]); sort2(p[7], p[12]);
+  sort2(p[10], p[18]); sort2(p[12], p[20]); sort2(p[10], p[20]); sort2(p[10], p[12]);
+  return p[12];
+}
+
+/**
+ * \brief Computes the median of K*K values (lane-wise) using the appropriate selection network.
+ */
+template <int K> struct WindowMedian;
+template <> struct WindowMedian<3> { template <typename T> static T compute(T *p) { return median9(p); } };
+template <> struct WindowMedian<5> { template <typename T> static T compute(T *p) { return median25(p); } };
+
+/**
+ * \brief Median filters a single row of an RGBA image using a selection network (for a 3x3 or 5x5 kernel).
+ *
+ * Pixels whose neighbourhoods lie entirely within the image width are processed 4 at a time using SIMD; the remainder
+ * (near the left and right edges) are processed one channel at a time. Pixels outside the image are treated as zero.
+ *
+ * \param src     The channel values of the input image.
+ * \param dst     The channel values of the output image.
+ * \param width   The width of the image.
+ * \param height  The height of the image.
+ * \param y       The row to filter.
+ */
+template <int K>
+void median_filter_row_network(const unsigned char *src, unsigned char *dst, int width, int height, int y)
+{
+  const int r = K / 2;
+  const int rowStride = width * 4;
+
+  // Look up the source rows of the window (a null pointer indicates a row outside the image).
+  const unsigned char *rows[K];
+  for(int dy = -r; dy <= r; ++dy)
+  {
+    const int sy = y + dy;
+    rows[dy + r] = sy >= 0 && sy < height ? src + sy * rowStride : NULL;
+  }
+
+  unsigned char *out = dst + y * rowStride;
+
+  // Process the pixels whose neighbourhoods lie entirely within the image width, 4 at a time.
+  int x = r;
+  Lanes16 window[K * K];
+  for(; x + 4 + r <= width; x += 4)
+  {
+    for(int dy = 0; dy < K; ++dy)
+    {
+      for(int dx = -r; dx <= r; ++dx)
+      {
+        window[dy * K + dx + r] = rows[dy] ? Lanes16::load(rows[dy] + (x + dx) * 4) : Lanes16::zero();
+      }
+    }
+
+    WindowMedian<K>::compute(window).store(out + x * 4);
+  }
+
+  // Process the remaining pixels one channel at a time.
+  unsigned char values[K * K];
+  for(int px = 0; px < width; ++px)
+  {
+    if(px == r && r < x)
+    {
+      // Skip the pixels that have already been processed.
+      px = x - 1;
+      continue;
+    }
+
+    for(int c = 0; c < 4; ++c)
+    {
+      for(int dy = 0; dy < K; ++dy)
+      {
+        for(int dx = -r; dx <= r; ++dx)
+        {
+          const int sx = px + dx;
+          values[dy * K + dx + r] = rows[dy] && sx >= 0 && sx < width ? rows[dy][sx * 4 + c] : 0;
+        }
+      }
+
+      out[px * 4 + c] = WindowMedian<K>::compute(values);
+    }
+  }
+}
+
+/**
+ * \brief Gets the value of the specified channel of the specified pixel in an RGBA image (pixels outside the image are treated as zero).
+ *
+ * \param src     The channel values of the image.
+ * \param width   The width of the image.
+ * \param height  The height of the image.
+ * \param x       The x coordinate of the pixel.
+ * \param y       The y coordinate of the pixel.
+ * \param c       The channel.
+ * \return        The value of the channel.
+ */
+inline int channel_value(const unsigned char *src, int width, int height, int x, int y, int c)
+{
+  return x >= 0 && x < width && y >= 0 && y < height ? src[(y * width + x) * 4 + c] : 0;
+}
+
+/**
+ * \brief Median filters one channel of a vertical strip of an RGBA image using per-column histograms (for an arbitrary odd kernel width).
+ *
+ * A histogram of the values in each column of the kernel is maintained as the strip is processed from top to bottom, so that
+ * moving down a row only requires one value to be removed from and one value to be added to each column histogram. The kernel
+ * histogram for each pixel is then obtained from that of the previous pixel by adding the histogram of the column entering the
+ * kernel and subtracting that of the column leaving it. To avoid doing this for all 256 bins, each histogram is split into 16
+ * coarse bins of 16 fine bins each: the coarse kernel histogram is updated for every pixel, but the fine bins within a coarse
+ * bin are only brought up to date when the median is found to lie within it. The cost per pixel is thus independent of the
+ * kernel width. Pixels outside the image are treated as zero.
+ *
+ * See: S. Perreault and P. Hebert, "Median Filtering in Constant Time", IEEE TIP, 2007.
+ *
+ * \param src           The channel values of the input image.
+ * \param dst           The channel values of the output image.
+ * \param width         The width of the image.
+ * \param height        The height of the image.
+ * \param kernelWidth   The kernel width (at most 255, so that the counts in the kernel histogram fit in 16 bits).
+ * \param x0            The first column of the strip.
+ * \param x1            One past the last column of the strip.
+ * \param c             The channel to filter.
+ * \param columnCoarse  A scratch vector in which to store the coarse column histograms.
+ * \param columnFine    A scratch vector in which to store the fine column histograms.
+ */
+void median_filter_strip_histogram(const unsigned char *src, unsigned char *dst, int width, int height, int kernelWidth, int x0, int x1, int c,
+                                   std::vector<unsigned short>& columnCoarse, std::vector<unsigned short>& columnFine)
+{
+  const int r = kernelWidth / 2;
+  const int halfCount = kernelWidth * kernelWidth / 2;
+
+  // Compute the histograms of the columns overlapped by the kernels of the pixels in the first row of the strip (columns x0 - r to x1 + r - 1).
+  const int columnCount = x1 - x0 + 2 * r;
+  columnCoarse.assign(columnCount * 16, 0);
+  columnFine.assign(columnCount * 256, 0);
+  for(int i = 0; i < columnCount; ++i)
+  {
+    for(int sy = -r; sy <= r; ++sy)
+    {
+      const int value = channel_value(src, width, height, x0 - r + i, sy, c);
+      ++columnCoarse[i * 16 + (value >> 4)];
+      ++columnFine[i * 256 + value];
+    }
+  }
+
+  // Note: The kernel histograms use 16-bit counts (like the column histograms) so that they can be updated using fewer, wider operations.
+  unsigned short kernelCoarse[16];
+  unsigned short kernelFine[256];
+  int lastUpdated[16];
+
+  for(int y = 0; y < height; ++y)
+  {
+    // Move the histograms of the columns within the image down to the current row.
+    if(y > 0)
+    {
+      for(int i = std::max(0, r - x0), iend = std::min(columnCount, width - x0 + r); i < iend; ++i)
+      {
+        const int oldValue = channel_value(src, width, height, x0 - r + i, y - r - 1, c);
+        const int newValue = channel_value(src, width, height, x0 - r + i, y + r, c);
+        --columnCoarse[i * 16 + (oldValue >> 4)];
+        --columnFine[i * 256 + oldValue];
+        ++columnCoarse[i * 16 + (newValue >> 4)];
+        ++columnFine[i * 256 + newValue];
+      }
+    }
+
+    // Compute the coarse kernel histogram for the first pixel in the row of the strip, and mark all of the fine bins as out of date.
+    memset(kernelCoarse, 0, sizeof(kernelCoarse));
+    for(int i = 0; i <= 2 * r; ++i)
+    {
+      for(int b = 0; b < 16; ++b) kernelCoarse[b] += columnCoarse[i * 16 + b];
+    }
+
+    for(int b = 0; b < 16; ++b) lastUpdated[b] = x0 - 2 * r - 1;
+
+    unsigned char *out = dst + y * width * 4 + c;
+    for(int x = x0; x < x1; ++x)
+    {
+      // Slide the coarse kernel histogram one column to the right (the kernel covers columns first to first + 2r in the column histograms).
+      const int first = x - x0;
+      if(x > x0)
+      {
+        const unsigned short *entering = &columnCoarse[(first + 2 * r) * 16];
+        const unsigned short *leaving = &columnCoarse[(first - 1) * 16];
+        for(int b = 0; b < 16; ++b) kernelCoarse[b] += entering[b] - leaving[b];
+      }
+
+      // Find the coarse bin that contains the median, and the number of values in the kernel that are in earlier bins.
+      int b = 0, lessThan = 0;
+      while(lessThan + kernelCoarse[b] <= halfCount) lessThan += kernelCoarse[b++];
+
+      // Bring the fine bins within that coarse bin up to date, either by applying the changes since they were last updated,
+      // or (if the kernel has moved too far since then for that to be worthwhile) by recomputing them from scratch.
+      unsigned short *fine = kernelFine + b * 16;
+      if(x - lastUpdated[b] > 2 * r)
+      {
+        memset(fine, 0, 16 * sizeof(unsigned short));
+        for(int i = first; i <= first + 2 * r; ++i)
+        {
+          const unsigned short *column = &columnFine[i * 256 + b * 16];
+          for(int j = 0; j < 16; ++j) fine[j] += column[j];
+        }
+      }
+      else
+      {
+        for(int i = lastUpdated[b] + 1 - x0; i <= first; ++i)
+        {
+          const unsigned short *entering = &columnFine[(i + 2 * r) * 256 + b * 16];
+          const unsigned short *leaving = &columnFine[(i - 1) * 256 + b * 16];
+          for(int j = 0; j < 16; ++j) fine[j] += entering[j] - leaving[j];
+        }
+      }
+
+      lastUpdated[b] = x;
+
+      // Find the median within the coarse bin.
+      int m = 0;
+      while(lessThan + fine[m] <= halfCount) lessThan += fine[m++];
+      out[x * 4] = static_cast<unsigned char>(b * 16 + m);
+    }
+  }
+}
+
+/**
+ * \brief Median filters an RGBA image using per-column histograms (for an arbitrary odd kernel width).
+ *
+ * The image is divided into vertical strips, which are filtered in parallel. Pixels outside the image are treated as zero.
+ *
+ * \param src         The channel values of the input image.
+ * \param dst         The channel values of the output image.
+ * \param width       The width of the image.
+ * \param height      The height of the image.
+ * \param kernelWidth The kernel width.
+ */
+void median_filter_histogram(const unsigned char *src, unsigned char *dst, int width, int height, int kernelWidth)
+{
+  const int stripWidth = 32;
+  const int stripCount = (width + stripWidth - 1) / stripWidth;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector<unsigned short> columnCoarse, columnFine;
+
+#ifdef WITH_OPENMP
+    #pragma omp for schedule(dynamic)
+#endif
+    for(int strip = 0; strip < stripCount; ++strip)
+    {
+      const int x0 = strip * stripWidth, x1 = std::min(x0 + stripWidth, width);
+      for(int c = 0; c < 4; ++c)
+      {
+        median_filter_strip_histogram(src, dst, width, height, kernelWidth, x0, x1, c, columnCoarse, columnFine);
+      }
+    }
+  }
+}
+
 //#################### CONSTRUCTORS ####################
 
 MedianFilterer::MedianFilterer(unsigned int kernelWidth, DeviceType deviceType)
-: m_imageProcessor(ImageProcessorFactory::make_image_processor(deviceType)),
-  m_kernelWidth(kernelWidth)
-{}
+: m_deviceType(deviceType), m_kernelWidth(kernelWidth)
+{
+  if(kernelWidth % 2 == 0) throw std::runtime_error("Error: The kernel width for median filtering must be odd");
+  if(kernelWidth > 255) throw std::runtime_error("Error: The kernel width for median filtering must be at most 255");
+}
 
 //#################### PUBLIC OPERATORS ####################
 
 void MedianFilterer::operator()(const ITMUChar4Image_CPtr& input, const ITMUChar4Image_Ptr& output) const
-try
 {
-  if(!m_intermediate || ImageProcessor::image_size(input) != ImageProcessor::image_size(m_intermediate))
+  // If the images are on the GPU, make sure that the input image is available on the CPU.
+  if(m_deviceType == DEVICE_CUDA) input->UpdateHostFromDevice();
+
+  // If we're filtering in place, copy the input image into a scratch image so that its pixels are not overwritten whilst they are still needed.
+  const Vector4u *inputPixels = input->GetData(MEMORYDEVICE_CPU);
+  if(input.get() == output.get())
   {
-    m_intermediate.reset(new af::array(input->noDims.y, input->noDims.x, 4, u8));
+    if(!m_scratch) m_scratch.reset(new ITMUChar4Image(input->noDims, true, false));
+    m_scratch->ChangeDims(input->noDims);
+    m_scratch->SetFrom(input.get(), ORUtils::MemoryBlock<Vector4u>::CPU_TO_CPU);
+    inputPixels = m_scratch->GetData(MEMORYDEVICE_CPU);
   }
+  else output->ChangeDims(input->noDims);
+
+  median_filter_cpu(inputPixels, output->GetData(MEMORYDEVICE_CPU), input->noDims.x, input->noDims.y, m_kernelWidth);
 
-  m_imageProcessor->copy_itm_to_af(input, m_intermediate);
-  *m_intermediate = af::medfilt(*m_intermediate, m_kernelWidth, m_kernelWidth);
-  m_imageProcessor->copy_af_to_itm(m_intermediate, output);
+  // If the images are on the GPU, copy the filtered image back to it.
+  if(m_deviceType == DEVICE_CUDA) output->UpdateDeviceFromHost();
 }
-catch(af::exception&)
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+void MedianFilterer::median_filter_cpu(const Vector4u *input, Vector4u *output, int width, int height, unsigned int kernelWidth)
 {
-  // FIXME: Median filtering can occasionally fail due to a possible crash bug in ArrayFire. If this happens,
-  //        we currently avoid throwing and instead treat this function as a no-op.
+  const unsigned char *src = reinterpret_cast<const unsigned char*>(input);
+  unsigned char *dst = reinterpret_cast<unsigned char*>(output);
+  const int k = static_cast<int>(kernelWidth);
+
+  // Kernels wider than 5x5 are handled by the histogram-based filter, which parallelises over strips of columns rather than rows.
+  if(k > 5)
+  {
+    median_filter_histogram(src, dst, width, height, k);
+    return;
+  }
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < height; ++y)
+  {
+    switch(k)
+    {
+      case 1:
+        memcpy(dst + y * width * 4, src + y * width * 4, width * 4);
+        break;
+      case 3:
+        median_filter_row_network<3>(src, dst, width, height, y);
+        break;
+      default:
+        median_filter_row_network<5>(src, dst, width, height, y);
+        break;
+    }
+  }
 }
 
 }
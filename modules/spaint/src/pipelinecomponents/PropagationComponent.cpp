@@ -14,21 +14,24 @@ namespace spaint {
 PropagationComponent::PropagationComponent(const PropagationContext_Ptr& context, const std::string& sceneID)
 : m_context(context), m_sceneID(sceneID)
 {
-  const Vector2i& depthImageSize = context->get_slam_state(sceneID)->get_depth_image_size();
-  const int raycastResultSize = depthImageSize.width * depthImageSize.height;
-  reset_label_propagator(raycastResultSize);
+  const DeviceType deviceType = context->get_settings()->deviceType;
+  m_labelPropagator = LabelPropagatorFactory::make_label_propagator(deviceType);
 }
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-void PropagationComponent::reset_label_propagator(int raycastResultSize)
-{
-  m_labelPropagator = LabelPropagatorFactory::make_label_propagator(raycastResultSize, m_context->get_settings()->deviceType);
-}
-
 void PropagationComponent::run(const VoxelRenderState_CPtr& renderState)
 {
-  m_labelPropagator->propagate_label(m_context->get_semantic_label(), renderState->raycastResult, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get());
+  const SLAMState_Ptr& slamState = m_context->get_slam_state(m_sceneID);
+  SpaintVoxelScene *scene = slamState->get_voxel_scene().get();
+
+  // Get an up-to-date surface G-buffer for the raycast result (the label propagator needs the colours and normals of the voxels as well as their labels).
+  SurfaceGBuffer_CPtr surfaceGBuffer = slamState->get_surface_gbuffer(
+    renderState, SurfaceGBuffer::SGA_COLOURS | SurfaceGBuffer::SGA_NORMALS, m_context->get_settings()->deviceType
+  );
+
+  m_labelPropagator->propagate_label(m_context->get_semantic_label(), *surfaceGBuffer, scene);
+  slamState->record_labels_changed();
 }
 
 }
@@ -132,6 +132,7 @@ void SLAMComponent::load_models(const std::string& inputDir)
   // InfiniTAM's loading function to load the files from *inside* the specified folder.
   const SLAMState_Ptr& slamState = m_context->get_slam_state(m_sceneID);
   slamState->get_voxel_scene()->LoadFromDirectory(inputDir + "/");
+  slamState->record_scene_fused();
 
   // TODO: If we support surfel model loading at some point in the future, the surfel model should be loaded here as well.
 
@@ -280,6 +281,7 @@ bool SLAMComponent::process_frame()
     }
 
     ++m_fusedFramesCount;
+    slamState->record_scene_fused();
   }
   else if(trackingState->trackerResult != ITMTrackingState::TRACKING_FAILED)
   {
@@ -325,6 +327,9 @@ void SLAMComponent::reset_scene()
     slamState->get_surfel_scene()->Reset();
   }
 
+  // Record the fact that the scene has been reset, so that any information derived from it can be invalidated.
+  slamState->record_scene_reset();
+
   // Reset the tracking state.
   slamState->get_tracking_state()->Reset();
 
@@ -428,6 +433,7 @@ void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
       const SpaintVoxelScene_Ptr& voxelScene = slamState->get_voxel_scene();
       const VoxelRenderState_Ptr& liveVoxelRenderState = slamState->get_live_voxel_render_state();
       m_trackingController->Prepare(trackingState.get(), voxelScene.get(), view.get(), m_context->get_voxel_visualisation_engine().get(), liveVoxelRenderState.get());
+      slamState->record_live_raycast();
       break;
     }
   }
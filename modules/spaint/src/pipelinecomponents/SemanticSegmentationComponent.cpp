@@ -5,6 +5,10 @@
 
 #include "pipelinecomponents/SemanticSegmentationComponent.h"
 
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
 #include <itmx/base/MemoryBlockFactory.h>
 #ifdef WITH_OPENCV
 #include <itmx/ocv/OpenCVUtil.h>
@@ -26,7 +30,7 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegmentationContext_Ptr& context, const std::string& sceneID, unsigned int seed)
-: m_context(context), m_sceneID(sceneID), m_seed(seed)
+: m_context(context), m_forestVersion(0), m_predictionClearGeneration(0), m_predictionResetGeneration(0), m_sceneID(sceneID), m_seed(seed)
 {
   // Set the maximum numbers of voxels to use for training and prediction.
   // FIXME: These values shouldn't be hard-coded here ultimately.
@@ -57,9 +61,34 @@ SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegme
     m_patchSize, patchSpacing, binCount, settings->deviceType
   );
 
+  // Set up the feature cache (if it's enabled). Since the features of a voxel depend on the colours of the voxels around it, they can
+  // change whenever the scene is fused. However, fusion only changes the colours of voxels gradually (they are running averages),
+  // so by default we reuse cached features for up to 30 fusion generations (about a second of live fusion). Whilst fusion is running,
+  // the forest changes after every training step, so most visible voxels are re-predicted within that window and most lookups hit
+  // (without any allowance for age, reuse would be limited to a single frame, and the cache would almost never hit). When fusion is disabled
+  // (e.g. once a scene has been reconstructed), cached features remain valid until the scene is reset. Setting maxFeatureCacheAge to 0
+  // only reuses features calculated since the scene was last fused, i.e. exactly the features that would have been calculated.
+  static const std::string settingsNamespace = "SemanticSegmentationComponent.";
+  const size_t featureCacheCapacity = settings->get_first_value<size_t>(settingsNamespace + "featureCacheCapacity", 32768);
+  m_maxFeatureCacheAge = settings->get_first_value<unsigned int>(settingsNamespace + "maxFeatureCacheAge", 30);
+  m_printFeatureCacheStats = settings->get_first_value<bool>(settingsNamespace + "printFeatureCacheStats", false);
+
+  const size_t featureCount = m_featureCalculator->get_feature_count();
+  if(featureCacheCapacity > 0) m_featureCache.reset(new FeatureCache(featureCacheCapacity, featureCount));
+
+  // Set up the prediction scheduler (if it's enabled).
+  if(settings->get_first_value<bool>(settingsNamespace + "usePredictionScheduler", true))
+  {
+    m_predictionScheduler.reset(new PredictionScheduler(seed));
+  }
+
+  m_predictionCoverageFile = settings->get_first_value<std::string>(settingsNamespace + "predictionCoverageFile", "");
+
   // Set up the memory blocks needed for prediction and training.
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
-  const size_t featureCount = m_featureCalculator->get_feature_count();
+  const size_t maxVoxelCount = std::max(m_maxPredictionVoxelCount, maxTrainingVoxelCount);
+  m_missFeaturesMB = mbf.make_block<float>(maxVoxelCount * featureCount);
+  m_missVoxelLocationsMB = mbf.make_block<Vector3s>(maxVoxelCount);
   m_predictionFeaturesMB = mbf.make_block<float>(m_maxPredictionVoxelCount * featureCount);
   m_predictionLabelsMB = mbf.make_block<SpaintVoxel::PackedLabel>(m_maxPredictionVoxelCount);
   m_predictionVoxelLocationsMB = mbf.make_block<Vector3s>(m_maxPredictionVoxelCount);
@@ -78,6 +107,31 @@ SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegme
   reset_forest();
 }
 
+//#################### DESTRUCTOR ####################
+
+SemanticSegmentationComponent::~SemanticSegmentationComponent()
+{
+  if(m_featureCache && m_printFeatureCacheStats)
+  {
+    const size_t hitCount = m_featureCache->get_hit_count(), missCount = m_featureCache->get_miss_count();
+    const size_t lookupCount = hitCount + missCount;
+    std::cout << "Feature cache: " << hitCount << " hits, " << missCount << " misses";
+    if(lookupCount > 0) std::cout << " (hit rate: " << 100.0 * hitCount / lookupCount << "%)";
+    std::cout << '\n';
+  }
+
+  if(m_predictionScheduler && m_predictionCoverageFile != "")
+  {
+    // Write the coverage history of the prediction scheduler to the specified file (one line per recorded frame).
+    std::ofstream fs(m_predictionCoverageFile.c_str());
+    const boost::circular_buffer<PredictionScheduler::CoverageSample>& coverageHistory = m_predictionScheduler->get_coverage_history();
+    for(size_t i = 0, size = coverageHistory.size(); i < size; ++i)
+    {
+      fs << coverageHistory[i].elapsedSeconds << ' ' << coverageHistory[i].predictedVoxelCount << ' ' << coverageHistory[i].coverage << '\n';
+    }
+  }
+}
+
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 void SemanticSegmentationComponent::reset_forest()
@@ -85,6 +139,7 @@ void SemanticSegmentationComponent::reset_forest()
   const size_t treeCount = 5;
   DecisionTree<SpaintVoxel::Label>::Settings dtSettings(m_context->get_resources_dir() + "/RaflSettings.xml");
   m_forest.reset(new RandomForest<SpaintVoxel::Label>(treeCount, dtSettings));
+  ++m_forestVersion;
 }
 
 void SemanticSegmentationComponent::reset_voxel_samplers(int raycastResultSize)
@@ -131,12 +186,48 @@ void SemanticSegmentationComponent::run_prediction(const VoxelRenderState_CPtr&
   // If the random forest is not yet valid, early out.
   if(!m_forest->is_valid()) return;
 
-  // Sample some voxels for which to predict labels.
-  m_predictionSampler->sample_voxels(renderState->raycastResult, m_maxPredictionVoxelCount, *m_predictionVoxelLocationsMB);
+  // Restore the prediction memory blocks to their full capacity (their sizes are reduced to the number of voxels chosen on each frame).
+  m_predictionVoxelLocationsMB->dataSize = m_maxPredictionVoxelCount;
+  m_predictionLabelsMB->dataSize = m_maxPredictionVoxelCount;
+
+  // Choose some voxels for which to predict labels. If the prediction scheduler is enabled, we use it to choose the voxels
+  // whose labels most need to be predicted (there may be none of these if the visible scene is up to date with the forest).
+  // Otherwise, we uniformly sample voxels from the raycast result.
+  size_t predictionVoxelCount = m_maxPredictionVoxelCount;
+  if(m_predictionScheduler)
+  {
+    // If the scene has been reset, or any of its labels have been cleared, since the scheduler was last used, make it forget
+    // the voxels it has scheduled (the labels that were predicted for them may no longer be in the scene, in which case they
+    // must be predicted again, even though the forest has not changed).
+    const SLAMState_CPtr slamState = m_context->get_slam_state(m_sceneID);
+    const unsigned int clearGeneration = slamState->get_label_clear_generation();
+    const unsigned int resetGeneration = slamState->get_reset_generation();
+    if(clearGeneration != m_predictionClearGeneration || resetGeneration != m_predictionResetGeneration)
+    {
+      m_predictionScheduler->reset();
+      m_predictionClearGeneration = clearGeneration;
+      m_predictionResetGeneration = resetGeneration;
+    }
+
+    predictionVoxelCount = m_predictionScheduler->schedule_voxels(renderState->raycastResult, m_maxPredictionVoxelCount, m_forestVersion, *m_predictionVoxelLocationsMB);
+    if(predictionVoxelCount == 0) return;
+  }
+  else
+  {
+    m_predictionSampler->sample_voxels(renderState->raycastResult, m_maxPredictionVoxelCount, *m_predictionVoxelLocationsMB);
+  }
+
+  m_predictionVoxelLocationsMB->dataSize = predictionVoxelCount;
+  m_predictionLabelsMB->dataSize = predictionVoxelCount;
 
-  // Calculate feature descriptors for the sampled voxels.
-  m_featureCalculator->calculate_features(*m_predictionVoxelLocationsMB, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *m_predictionFeaturesMB);
-  std::vector<Descriptor_CPtr> descriptors = ForestUtil::make_descriptors(*m_predictionFeaturesMB, m_maxPredictionVoxelCount, m_featureCalculator->get_feature_count());
+  // Calculate feature descriptors for the chosen voxels.
+  std::vector<int> indices(predictionVoxelCount);
+  for(size_t i = 0; i < predictionVoxelCount; ++i)
+  {
+    indices[i] = static_cast<int>(i);
+  }
+  calculate_features(*m_predictionVoxelLocationsMB, indices, *m_predictionFeaturesMB);
+  std::vector<Descriptor_CPtr> descriptors = ForestUtil::make_descriptors(*m_predictionFeaturesMB, predictionVoxelCount, m_featureCalculator->get_feature_count());
 
   // Predict labels for the voxels based on the feature descriptors.
   SpaintVoxel::PackedLabel *labels = m_predictionLabelsMB->GetData(MEMORYDEVICE_CPU);
@@ -144,7 +235,7 @@ void SemanticSegmentationComponent::run_prediction(const VoxelRenderState_CPtr&
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
-  for(int i = 0; i < static_cast<int>(m_maxPredictionVoxelCount); ++i)
+  for(int i = 0; i < static_cast<int>(predictionVoxelCount); ++i)
   {
     labels[i] = SpaintVoxel::PackedLabel(m_forest->predict(descriptors[i]), SpaintVoxel::LG_FOREST);
   }
@@ -190,8 +281,19 @@ void SemanticSegmentationComponent::run_training(const VoxelRenderState_CPtr& re
   m_trainingVoxelLocationsMB->UpdateHostFromDevice();
 #endif
 
-  // Compute feature vectors for the sampled voxels.
-  m_featureCalculator->calculate_features(*m_trainingVoxelLocationsMB, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *m_trainingFeaturesMB);
+  // Compute feature vectors for the sampled voxels. Note that only the first few slots in each label's segment of the
+  // memory block of voxel locations are valid, so we avoid calculating (or caching) features for the remaining slots.
+  m_trainingVoxelCountsMB->UpdateHostFromDevice();
+  const unsigned int *voxelCounts = m_trainingVoxelCountsMB->GetData(MEMORYDEVICE_CPU);
+  std::vector<int> indices;
+  for(size_t i = 0; i < maxLabelCount; ++i)
+  {
+    for(size_t j = 0; j < voxelCounts[i]; ++j)
+    {
+      indices.push_back(static_cast<int>(i * m_maxTrainingVoxelsPerLabel + j));
+    }
+  }
+  calculate_features(*m_trainingVoxelLocationsMB, indices, *m_trainingFeaturesMB);
 
   // Make the training examples.
   typedef boost::shared_ptr<const Example<SpaintVoxel::Label> > Example_CPtr;
@@ -207,6 +309,81 @@ void SemanticSegmentationComponent::run_training(const VoxelRenderState_CPtr& re
   const size_t splitBudget = 20;
   m_forest->add_examples(examples);
   m_forest->train(splitBudget);
+  ++m_forestVersion;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SemanticSegmentationComponent::calculate_features(const ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB, const std::vector<int>& indices, ORUtils::MemoryBlock<float>& featuresMB)
+{
+  const SLAMState_CPtr slamState = m_context->get_slam_state(m_sceneID);
+  const SpaintVoxelScene *scene = slamState->get_voxel_scene().get();
+
+  // If feature caching is disabled, simply calculate features for all of the voxels.
+  if(!m_featureCache)
+  {
+    m_featureCalculator->calculate_features(voxelLocationsMB, scene, featuresMB);
+    return;
+  }
+
+  // Determine the oldest fusion generation from which cached features can be used. Cached features from before
+  // the scene was last reset are never valid; otherwise, we allow features to be at most m_maxFeatureCacheAge
+  // generations old.
+  const unsigned int fusionGeneration = slamState->get_fusion_generation();
+  const unsigned int minGeneration = std::max(slamState->get_reset_generation(), fusionGeneration > m_maxFeatureCacheAge ? fusionGeneration - m_maxFeatureCacheAge : 0U);
+
+  // Try to look up the features for each voxel in the subset in the cache, and make a note of the voxels that miss.
+  voxelLocationsMB.UpdateHostFromDevice();
+  const Vector3s *voxelLocations = voxelLocationsMB.GetData(MEMORYDEVICE_CPU);
+  float *features = featuresMB.GetData(MEMORYDEVICE_CPU);
+  const size_t featureCount = m_featureCalculator->get_feature_count();
+  const int indexCount = static_cast<int>(indices.size());
+  std::vector<unsigned char> hits(indexCount);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < indexCount; ++i)
+  {
+    hits[i] = m_featureCache->lookup(voxelLocations[indices[i]], minGeneration, features + indices[i] * featureCount) ? 1 : 0;
+  }
+
+  std::vector<int> missIndices;
+  for(int i = 0; i < indexCount; ++i)
+  {
+    if(!hits[i]) missIndices.push_back(indices[i]);
+  }
+
+  // If there were any misses, calculate features for the voxels concerned in a single batch, and then both copy
+  // them into the output memory block and store them in the cache.
+  const int missCount = static_cast<int>(missIndices.size());
+  if(missCount > 0)
+  {
+    Vector3s *missVoxelLocations = m_missVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+    for(int i = 0; i < missCount; ++i)
+    {
+      missVoxelLocations[i] = voxelLocations[missIndices[i]];
+    }
+
+    m_missVoxelLocationsMB->dataSize = static_cast<size_t>(missCount);
+    m_missVoxelLocationsMB->UpdateDeviceFromHost();
+    m_featureCalculator->calculate_features(*m_missVoxelLocationsMB, scene, *m_missFeaturesMB);
+    m_missFeaturesMB->UpdateHostFromDevice();
+
+    const float *missFeatures = m_missFeaturesMB->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel for
+#endif
+    for(int i = 0; i < missCount; ++i)
+    {
+      const float *missFeaturesForVoxel = missFeatures + i * featureCount;
+      std::copy(missFeaturesForVoxel, missFeaturesForVoxel + featureCount, features + missIndices[i] * featureCount);
+      m_featureCache->store(missVoxelLocations[i], fusionGeneration, missFeaturesForVoxel);
+    }
+  }
+
+  featuresMB.UpdateDeviceFromHost();
 }
 
 }
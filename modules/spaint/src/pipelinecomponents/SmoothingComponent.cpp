@@ -22,7 +22,14 @@ SmoothingComponent::SmoothingComponent(const SmoothingContext_Ptr& context, cons
 
 void SmoothingComponent::run(const VoxelRenderState_CPtr& renderState)
 {
-  m_labelSmoother->smooth_labels(renderState->raycastResult, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get());
+  const SLAMState_Ptr& slamState = m_context->get_slam_state(m_sceneID);
+  SpaintVoxelScene *scene = slamState->get_voxel_scene().get();
+
+  // Get an up-to-date surface G-buffer for the raycast result (the label smoother only needs the labels and addresses of the voxels, so no optional attributes are requested).
+  SurfaceGBuffer_CPtr surfaceGBuffer = slamState->get_surface_gbuffer(renderState, 0, m_context->get_settings()->deviceType);
+
+  m_labelSmoother->smooth_labels(*surfaceGBuffer, scene);
+  slamState->record_labels_changed();
 }
 
 }
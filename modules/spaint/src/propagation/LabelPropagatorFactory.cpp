@@ -16,7 +16,7 @@ namespace spaint {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
-LabelPropagator_CPtr LabelPropagatorFactory::make_label_propagator(size_t raycastResultSize, DeviceType deviceType,
+LabelPropagator_CPtr LabelPropagatorFactory::make_label_propagator(DeviceType deviceType,
                                                                    float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours,
                                                                    float maxSquaredDistanceBetweenVoxels)
 {
@@ -25,7 +25,7 @@ LabelPropagator_CPtr LabelPropagatorFactory::make_label_propagator(size_t raycas
   if(deviceType == DEVICE_CUDA)
   {
 #ifdef WITH_CUDA
-    propagator.reset(new LabelPropagator_CUDA(raycastResultSize, maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels));
+    propagator.reset(new LabelPropagator_CUDA(maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels));
 #else
     // This should never happen as things stand - we set deviceType to DEVICE_CPU if CUDA support isn't available.
     throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
@@ -33,7 +33,7 @@ LabelPropagator_CPtr LabelPropagatorFactory::make_label_propagator(size_t raycas
   }
   else
   {
-    propagator.reset(new LabelPropagator_CPU(raycastResultSize, maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels));
+    propagator.reset(new LabelPropagator_CPU(maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels));
   }
 
   return propagator;
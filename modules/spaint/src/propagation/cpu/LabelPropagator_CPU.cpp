@@ -11,36 +11,22 @@ namespace spaint {
 
 //#################### CONSTRUCTORS ####################
 
-LabelPropagator_CPU::LabelPropagator_CPU(size_t raycastResultSize, float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours, float maxSquaredDistanceBetweenVoxels)
-: LabelPropagator(raycastResultSize, maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels)
+LabelPropagator_CPU::LabelPropagator_CPU(float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours, float maxSquaredDistanceBetweenVoxels)
+: LabelPropagator(maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels)
 {}
 
-//#################### PRIVATE MEMBER FUNCTIONS ####################
+//#################### PUBLIC MEMBER FUNCTIONS ####################
 
-void LabelPropagator_CPU::calculate_normals(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene) const
-{
-  const ITMVoxelIndex::IndexData *indexData = scene->index.getIndexData();
-  const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
-  const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
-  Vector3f *surfaceNormals = m_surfaceNormalsMB->GetData(MEMORYDEVICE_CPU);
-  const SpaintVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
-
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int voxelIndex = 0; voxelIndex < raycastResultSize; ++voxelIndex)
-  {
-    write_surface_normal(voxelIndex, raycastResultData, voxelData, indexData, surfaceNormals);
-  }
-}
-
-void LabelPropagator_CPU::perform_propagation(SpaintVoxel::Label label, const ITMFloat4Image *raycastResult, SpaintVoxelScene *scene) const
+void LabelPropagator_CPU::propagate_label(SpaintVoxel::Label label, const SurfaceGBuffer& gbuffer, SpaintVoxelScene *scene) const
 {
+  const ITMFloat4Image *raycastResult = gbuffer.get_raycast_result();
   const int height = raycastResult->noDims.y;
-  const ITMVoxelIndex::IndexData *indexData = scene->index.getIndexData();
   const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
   const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
-  const Vector3f *surfaceNormals = m_surfaceNormalsMB->GetData(MEMORYDEVICE_CPU);
+  const Vector3u *surfaceColours = gbuffer.get_colours().GetData(MEMORYDEVICE_CPU);
+  const SpaintVoxel::PackedLabel *surfaceLabels = gbuffer.get_packed_labels().GetData(MEMORYDEVICE_CPU);
+  const Vector3f *surfaceNormals = gbuffer.get_normals().GetData(MEMORYDEVICE_CPU);
+  const int *voxelAddresses = gbuffer.get_voxel_addresses().GetData(MEMORYDEVICE_CPU);
   SpaintVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
   const int width = raycastResult->noDims.x;
 
@@ -50,7 +36,7 @@ void LabelPropagator_CPU::perform_propagation(SpaintVoxel::Label label, const IT
   for(int voxelIndex = 0; voxelIndex < raycastResultSize; ++voxelIndex)
   {
     propagate_from_neighbours(
-      voxelIndex, width, height, label, raycastResultData, surfaceNormals, voxelData, indexData,
+      voxelIndex, width, height, label, raycastResultData, surfaceNormals, surfaceColours, surfaceLabels, voxelAddresses, voxelData,
       m_maxAngleBetweenNormals, m_maxSquaredDistanceBetweenColours, m_maxSquaredDistanceBetweenVoxels
     );
   }
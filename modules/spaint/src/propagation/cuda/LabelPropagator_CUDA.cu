@@ -7,32 +7,20 @@
 
 #include "propagation/shared/LabelPropagator_Shared.h"
 
-#define DEBUGGING 0
-
 namespace spaint {
 
 //#################### CUDA KERNELS ####################
 
-__global__ void ck_calculate_normals(const Vector4f *raycastResultData, int raycastResultSize,
-                                     const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
-                                     Vector3f *surfaceNormals)
-{
-  int voxelIndex = threadIdx.x + blockDim.x * blockIdx.x;
-  if(voxelIndex < raycastResultSize)
-  {
-    write_surface_normal(voxelIndex, raycastResultData, voxelData, indexData, surfaceNormals);
-  }
-}
-
 __global__ void ck_perform_propagation(SpaintVoxel::Label label, const Vector4f *raycastResultData, int raycastResultSize, int width, int height,
-                                       const Vector3f *surfaceNormals, SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                       const Vector3f *surfaceNormals, const Vector3u *surfaceColours, const SpaintVoxel::PackedLabel *surfaceLabels,
+                                       const int *voxelAddresses, SpaintVoxel *voxelData,
                                        float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours, float maxSquaredDistanceBetweenVoxels)
 {
   int voxelIndex = threadIdx.x + blockDim.x * blockIdx.x;
   if(voxelIndex < raycastResultSize)
   {
     propagate_from_neighbours(
-      voxelIndex, width, height, label, raycastResultData, surfaceNormals, voxelData, indexData,
+      voxelIndex, width, height, label, raycastResultData, surfaceNormals, surfaceColours, surfaceLabels, voxelAddresses, voxelData,
       maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels
     );
   }
@@ -40,34 +28,15 @@ __global__ void ck_perform_propagation(SpaintVoxel::Label label, const Vector4f
 
 //#################### CONSTRUCTORS ####################
 
-LabelPropagator_CUDA::LabelPropagator_CUDA(size_t raycastResultSize, float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours, float maxSquaredDistanceBetweenVoxels)
-: LabelPropagator(raycastResultSize, maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels)
+LabelPropagator_CUDA::LabelPropagator_CUDA(float maxAngleBetweenNormals, float maxSquaredDistanceBetweenColours, float maxSquaredDistanceBetweenVoxels)
+: LabelPropagator(maxAngleBetweenNormals, maxSquaredDistanceBetweenColours, maxSquaredDistanceBetweenVoxels)
 {}
 
-//#################### PRIVATE MEMBER FUNCTIONS ####################
-
-void LabelPropagator_CUDA::calculate_normals(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene) const
-{
-  const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
-
-  int threadsPerBlock = 256;
-  int numBlocks = (raycastResultSize + threadsPerBlock - 1) / threadsPerBlock;
-
-  ck_calculate_normals<<<numBlocks,threadsPerBlock>>>(
-    raycastResult->GetData(MEMORYDEVICE_CUDA),
-    raycastResultSize,
-    scene->localVBA.GetVoxelBlocks(),
-    scene->index.getIndexData(),
-    m_surfaceNormalsMB->GetData(MEMORYDEVICE_CUDA)
-  );
-
-#if DEBUGGING
-  m_surfaceNormalsMB->UpdateHostFromDevice();
-#endif
-}
+//#################### PUBLIC MEMBER FUNCTIONS ####################
 
-void LabelPropagator_CUDA::perform_propagation(SpaintVoxel::Label label, const ITMFloat4Image *raycastResult, SpaintVoxelScene *scene) const
+void LabelPropagator_CUDA::propagate_label(SpaintVoxel::Label label, const SurfaceGBuffer& gbuffer, SpaintVoxelScene *scene) const
 {
+  const ITMFloat4Image *raycastResult = gbuffer.get_raycast_result();
   const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
 
   int threadsPerBlock = 256;
@@ -79,9 +48,11 @@ void LabelPropagator_CUDA::perform_propagation(SpaintVoxel::Label label, const I
     raycastResultSize,
     raycastResult->noDims.x,
     raycastResult->noDims.y,
-    m_surfaceNormalsMB->GetData(MEMORYDEVICE_CUDA),
+    gbuffer.get_normals().GetData(MEMORYDEVICE_CUDA),
+    gbuffer.get_colours().GetData(MEMORYDEVICE_CUDA),
+    gbuffer.get_packed_labels().GetData(MEMORYDEVICE_CUDA),
+    gbuffer.get_voxel_addresses().GetData(MEMORYDEVICE_CUDA),
     scene->localVBA.GetVoxelBlocks(),
-    scene->index.getIndexData(),
     m_maxAngleBetweenNormals,
     m_maxSquaredDistanceBetweenColours,
     m_maxSquaredDistanceBetweenVoxels
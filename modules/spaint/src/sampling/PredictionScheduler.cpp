@@ -0,0 +1,162 @@
+/**
+ * spaint: PredictionScheduler.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#include "sampling/PredictionScheduler.h"
+
+#include <algorithm>
+#include <climits>
+#include <set>
+#include <vector>
+
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+
+namespace spaint {
+
+//#################### LOCAL TYPES ####################
+
+/**
+ * \brief An instance of this struct represents a voxel that could be scheduled for prediction.
+ */
+struct PredictionCandidate
+{
+  /** The key of the voxel. */
+  VoxelKeyUtil::Key key;
+
+  /** The location of the voxel. */
+  Vector3s location;
+
+  /** The priority of the voxel (lower values are scheduled first). */
+  unsigned int priority;
+
+  /** A random value used to break ties between voxels with the same priority. */
+  int tieBreaker;
+
+  /**
+   * \brief Determines whether or not this candidate should be scheduled before another one.
+   *
+   * \param rhs The other candidate.
+   * \return    true, if this candidate should be scheduled before the other one, or false otherwise.
+   */
+  bool operator<(const PredictionCandidate& rhs) const
+  {
+    return priority < rhs.priority || (priority == rhs.priority && tieBreaker < rhs.tieBreaker);
+  }
+};
+
+//#################### CONSTRUCTORS ####################
+
+PredictionScheduler::PredictionScheduler(unsigned int seed, size_t maxTrackedVoxelCount, size_t candidateFactor, size_t maxCoverageHistory)
+: m_candidateFactor(std::max<size_t>(candidateFactor, 1)),
+  m_coverageHistory(std::max<size_t>(maxCoverageHistory, 1)),
+  m_maxTrackedVoxelCount(maxTrackedVoxelCount),
+  m_predictedVoxelCount(0),
+  m_rng(new tvgutil::RandomNumberGenerator(seed))
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const boost::circular_buffer<PredictionScheduler::CoverageSample>& PredictionScheduler::get_coverage_history() const
+{
+  return m_coverageHistory;
+}
+
+void PredictionScheduler::reset()
+{
+  m_coverageHistory.clear();
+  m_predictedVoxelCount = 0;
+  m_predictionVersions.clear();
+  m_startTime.reset();
+}
+
+size_t PredictionScheduler::schedule_voxels(const ITMFloat4Image *raycastResult, size_t maxVoxelCount, unsigned int forestVersion, ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB)
+{
+  if(!m_startTime) m_startTime = boost::chrono::steady_clock::now();
+
+  // Choose a stratified set of candidate pixels from the raycast result: we take every stride-th pixel, starting from a
+  // random offset, so that over a number of frames every pixel will be considered.
+  raycastResult->UpdateHostFromDevice();
+  const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
+  const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
+  const int stride = std::max(1, static_cast<int>(raycastResultSize / std::max<size_t>(maxVoxelCount * m_candidateFactor, 1)));
+  const int offset = m_rng->generate_int_from_uniform(0, stride - 1);
+
+  // Determine the voxels to which the valid candidate pixels correspond (ignoring any duplicates), and prioritise them.
+  std::set<Key> candidateKeys;
+  std::vector<PredictionCandidate> candidates;
+  size_t upToDateCount = 0;
+  for(int i = offset; i < raycastResultSize; i += stride)
+  {
+    const Vector4f& loc = raycastResultData[i];
+    if(loc.w <= 0) continue;
+
+    PredictionCandidate candidate;
+    candidate.location = loc.toVector3().toShortRound();
+    candidate.key = VoxelKeyUtil::make_key(candidate.location);
+    if(!candidateKeys.insert(candidate.key).second) continue;
+
+    std::map<Key,unsigned int>::const_iterator it = m_predictionVersions.find(candidate.key);
+    if(it == m_predictionVersions.end())
+    {
+      // The voxel has never been predicted, so give it the highest priority.
+      candidate.priority = 0;
+    }
+    else if(it->second != forestVersion)
+    {
+      // The voxel was predicted with an older version of the forest, so prioritise it based on how old that version was.
+      candidate.priority = 1 + it->second;
+    }
+    else
+    {
+      // The voxel is up to date, so there is no need to predict it again.
+      ++upToDateCount;
+      continue;
+    }
+
+    candidate.tieBreaker = m_rng->generate_int_from_uniform(0, INT_MAX - 1);
+    candidates.push_back(candidate);
+  }
+
+  // Schedule the highest-priority candidates.
+  const size_t scheduledCount = std::min(maxVoxelCount, candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + scheduledCount, candidates.end());
+
+  Vector3s *voxelLocations = voxelLocationsMB.GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < scheduledCount; ++i)
+  {
+    voxelLocations[i] = candidates[i].location;
+    m_predictionVersions[candidates[i].key] = forestVersion;
+  }
+
+  // Set the size of the memory block to the number of scheduled voxels before uploading it, so that all of them (and only them)
+  // reach the device, however many voxels were scheduled on previous frames.
+  voxelLocationsMB.dataSize = scheduledCount;
+  voxelLocationsMB.UpdateDeviceFromHost();
+
+  // If we're now tracking too many voxels, forget the ones whose predictions are out of date (or, failing that, all of them).
+  if(m_predictionVersions.size() > m_maxTrackedVoxelCount)
+  {
+    for(std::map<Key,unsigned int>::iterator it = m_predictionVersions.begin(), iend = m_predictionVersions.end(); it != iend;)
+    {
+      if(it->second != forestVersion) m_predictionVersions.erase(it++);
+      else ++it;
+    }
+
+    if(m_predictionVersions.size() > m_maxTrackedVoxelCount) m_predictionVersions.clear();
+  }
+
+  // Record the state of the prediction process at the end of the frame (overwriting the oldest record if the history is full).
+  m_predictedVoxelCount += scheduledCount;
+  upToDateCount += scheduledCount;
+
+  CoverageSample sample;
+  sample.coverage = candidateKeys.empty() ? 1.0f : static_cast<float>(upToDateCount) / candidateKeys.size();
+  sample.elapsedSeconds = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - *m_startTime).count();
+  sample.predictedVoxelCount = m_predictedVoxelCount;
+  m_coverageHistory.push_back(sample);
+
+  return scheduledCount;
+}
+
+}
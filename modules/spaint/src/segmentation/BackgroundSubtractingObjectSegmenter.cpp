@@ -6,6 +6,7 @@
 #include "segmentation/BackgroundSubtractingObjectSegmenter.h"
 
 #include <cmath>
+#include <iostream>
 
 #include <boost/serialization/shared_ptr.hpp>
 
@@ -20,8 +21,30 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 BackgroundSubtractingObjectSegmenter::BackgroundSubtractingObjectSegmenter(const View_CPtr& view, const Settings_CPtr& itmSettings, const TouchSettings_Ptr& touchSettings)
-: Segmenter(view), m_touchDetector(new TouchDetector(view->depth->noDims, itmSettings, touchSettings))
-{}
+: Segmenter(view),
+  m_changeMask(new ITMUCharImage(view->depth->noDims, true, true)),
+  m_handMask(cv::Mat1b::zeros(view->rgb->noDims.y, view->rgb->noDims.x)),
+  m_timerChangeMask("Change Mask"),
+  m_timerComponentFiltering("Component Filtering"),
+  m_timerHandObjectMasks("Hand/Object Masks"),
+  m_timerTotal("Total Segmentation"),
+  m_touchDetector(new TouchDetector(view->depth->noDims, itmSettings, touchSettings))
+{
+  m_printTimers = itmSettings->get_first_value<bool>("BackgroundSubtractingObjectSegmenter.printTimers", false);
+}
+
+//#################### DESTRUCTOR ####################
+
+BackgroundSubtractingObjectSegmenter::~BackgroundSubtractingObjectSegmenter()
+{
+  if(m_printTimers)
+  {
+    print_timer(m_timerTotal);
+    print_timer(m_timerChangeMask);
+    print_timer(m_timerHandObjectMasks);
+    print_timer(m_timerComponentFiltering);
+  }
+}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
@@ -53,6 +76,8 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::segment(const ORUtils::
   }
 #endif
 
+  m_timerTotal.start();
+
   // Copy the current colour and depth input images across to the CPU.
   ITMUChar4Image_CPtr rgbInput(m_view->rgb, boost::serialization::null_deleter());
   rgbInput->UpdateHostFromDevice();
@@ -61,67 +86,73 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::segment(const ORUtils::
   depthInput->UpdateHostFromDevice();
 
   // Make the change mask.
+  m_timerChangeMask.start();
   ITMUCharImage_CPtr changeMask = make_change_mask(depthInput, pose, renderState);
+  m_timerChangeMask.stop();
+
+  // Make the hand and object masks. The object mask is written directly into the target mask, which we wrap
+  // in an OpenCV image header (rather than copying it) so that its small components can be removed in place.
+  m_timerHandObjectMasks.start();
 
-  // Make the hand mask.
-  static cv::Mat1b handMask = cv::Mat1b::zeros(m_view->rgb->noDims.y, m_view->rgb->noDims.x);
   const Vector4u *rgbPtr = rgbInput->GetData(MEMORYDEVICE_CPU);
   const uchar *changeMaskPtr = changeMask->GetData(MEMORYDEVICE_CPU);
+  uchar *handMaskPtr = m_handMask.data;
+  uchar *objectMaskPtr = m_targetMask->GetData(MEMORYDEVICE_CPU);
+  cv::Mat1b objectMask(m_targetMask->noDims.y, m_targetMask->noDims.x, objectMaskPtr);
+  const ColourAppearanceModel *handAppearanceModel = m_handAppearanceModel.get();
+  const float handProbThreshold = (100 - objectProbThreshold) / 100.0f;
   const int pixelCount = static_cast<int>(rgbInput->dataSize);
 
-  // For each pixel in the current colour input image:
+  // For each pixel in the current colour input image, determine in a single pass whether it is part of the hand,
+  // and whether it is a candidate for being part of the object (i.e. it has changed, but is not part of the hand).
 #if WITH_OPENMP
   #pragma omp parallel for
 #endif
   for(int i = 0; i < pixelCount; ++i)
   {
-    // Update the hand mask based on whether the pixel is part of the hand.
-    unsigned char value = 0;
+    uchar handValue = 0;
     if(changeMaskPtr[i])
     {
-      float handProb = m_handAppearanceModel ? m_handAppearanceModel->compute_posterior_probability(rgbPtr[i].toVector3()) : 0.0f;
-      int handProbThreshold = 100 - objectProbThreshold;
-
-#if 1
-      if(handProb >= handProbThreshold / 100.0f) value = 255;
-#else
-      // For debugging purposes
-      if(handProb >= handProbThreshold / 100.0f) value = (uchar)(handProb * 255);
-#endif
+      float handProb = handAppearanceModel ? handAppearanceModel->compute_posterior_probability(rgbPtr[i].toVector3()) : 0.0f;
+      if(handProb >= handProbThreshold) handValue = 255;
     }
 
-    handMask.data[i] = value;
+    handMaskPtr[i] = handValue;
+    objectMaskPtr[i] = changeMaskPtr[i] && !handValue ? 255 : 0;
   }
 
-  // If desired, update the hand mask to only contain components over a certain size.
+  m_timerHandObjectMasks.stop();
+
+  m_timerComponentFiltering.start();
+
+  // If desired, update the hand mask to only contain components over a certain size. Since this can turn hand pixels
+  // back into object candidates, we then need to recompute the object mask from the change mask and the hand mask.
   if(removeSmallHandComponents)
   {
-    remove_small_components(handMask, handComponentSizeThreshold);
-  }
+    remove_small_components(m_handMask, handComponentSizeThreshold);
 
-  // Make the object mask.
-  static cv::Mat1b objectMask = cv::Mat1b::zeros(m_view->rgb->noDims.y, m_view->rgb->noDims.x);
-
-  // Set the object mask to the difference between the change mask and the hand mask.
 #if WITH_OPENMP
-  #pragma omp parallel for
+    #pragma omp parallel for
 #endif
-  for(int i = 0; i < pixelCount; ++i)
-  {
-    objectMask.data[i] = changeMaskPtr[i] && !handMask.data[i] ? 255 : 0;
+    for(int i = 0; i < pixelCount; ++i)
+    {
+      objectMaskPtr[i] = changeMaskPtr[i] && !handMaskPtr[i] ? 255 : 0;
+    }
   }
 
   // Update the object mask to only contain components over a certain size.
   remove_small_components(objectMask, objectComponentSizeThreshold);
 
+  m_timerComponentFiltering.stop();
+
 #if DEBUGGING
   // Show the debugging window for the object mask.
   cv::imshow(debugWindowName, objectMask);
   cv::waitKey(10);
 #endif
 
-  // Convert the object mask to InfiniTAM format and return it.
-  std::copy(objectMask.data, objectMask.data + m_view->rgb->dataSize, m_targetMask->GetData(MEMORYDEVICE_CPU));
+  m_timerTotal.stop();
+
   return m_targetMask;
 }
 
@@ -214,10 +245,9 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::make_change_mask(const
   const float *diffRawRaycastPtr = diffRawRaycast->GetData(MEMORYDEVICE_CPU);
 
   // Make an initial change mask, starting from the whole image and filtering out pixels based on some simple criteria.
-  static ITMUCharImage_Ptr changeMask(new ITMUCharImage(Vector2i(width, height), true, true));
-  uchar *changeMaskPtr = changeMask->GetData(MEMORYDEVICE_CPU);
+  uchar *changeMaskPtr = m_changeMask->GetData(MEMORYDEVICE_CPU);
   const double halfWidth = width / 2.0, halfHeight = height / 2.0;
-  const int pixelCount = static_cast<int>(changeMask->dataSize);
+  const int pixelCount = static_cast<int>(m_changeMask->dataSize);
 
 #if WITH_OPENMP
   #pragma omp parallel for
@@ -281,37 +311,11 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::make_change_mask(const
     }
   }
 
-  // Copy the change mask across to an OpenCV image.
-  static cv::Mat1b cvChangeMask = cv::Mat1b::zeros(height, width);
-
-#if WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < pixelCount; ++i)
-  {
-    cvChangeMask.data[i] = changeMaskPtr[i];
-  }
-
-  // Find the connected components of the change mask.
-  cv::Mat1i ccsImage, stats;
-  cv::Mat1d centroids;
-  cv::connectedComponentsWithStats(cvChangeMask, ccsImage, stats, centroids);
+  // Wrap the change mask in an OpenCV image header (this shares the change mask's memory rather than copying it).
+  cv::Mat1b cvChangeMask(height, width, changeMaskPtr);
 
   // Update the change mask to only contain components over a certain size.
-  const int *ccsData = reinterpret_cast<int*>(ccsImage.data);
-
-#if WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < pixelCount; ++i)
-  {
-    int componentSize = stats(ccsData[i], cv::CC_STAT_AREA);
-    if(componentSize < minComponentSize)
-    {
-      cvChangeMask.data[i] = 0;
-      changeMaskPtr[i] = 0;
-    }
-  }
+  remove_small_components(cvChangeMask, minComponentSize);
 
   // Find the contours in the change mask.
   std::vector<std::vector<cv::Point> > contours;
@@ -399,11 +403,7 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::make_change_mask(const
 #endif
   for(int i = 0; i < pixelCount; ++i)
   {
-    if(badContourMask.data[i])
-    {
-      cvChangeMask.data[i] = 0;
-      changeMaskPtr[i] = 0;
-    }
+    if(badContourMask.data[i]) changeMaskPtr[i] = 0;
   }
 
   // Cluster the pixels in the change mask by depth, and discard clusters that are below a certain size.
@@ -439,7 +439,6 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::make_change_mask(const
     {
       for(size_t j = 0; j < clusterSize; ++j)
       {
-        cvChangeMask.data[cluster[j]] = 0;
         changeMaskPtr[cluster[j]] = 0;
       }
     }
@@ -447,10 +446,10 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::make_change_mask(const
 
 #if DEBUGGING
   // Show the debugging window for the change mask.
-  OpenCVUtil::show_greyscale_figure(debugWindowName, changeMask->GetData(MEMORYDEVICE_CPU), width, height, OpenCVUtil::ROW_MAJOR);
+  OpenCVUtil::show_greyscale_figure(debugWindowName, changeMaskPtr, width, height, OpenCVUtil::ROW_MAJOR);
 #endif
 
-  return changeMask;
+  return m_changeMask;
 }
 
 ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::make_hand_mask(const ITMFloatImage_CPtr& depthInput, const ORUtils::SE3Pose& pose, const RenderState_CPtr& renderState) const
@@ -462,6 +461,11 @@ ITMUCharImage_CPtr BackgroundSubtractingObjectSegmenter::make_hand_mask(const IT
 
 //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 
+void BackgroundSubtractingObjectSegmenter::print_timer(const AverageTimer& timer)
+{
+  std::cout << timer.name() << ": " << timer.count() << " times, avg: " << timer.average_duration() << ".\n";
+}
+
 void BackgroundSubtractingObjectSegmenter::remove_small_components(cv::Mat1b& mask, int minimumComponentSize)
 {
   // Find the connected components of the mask.
@@ -469,6 +473,14 @@ void BackgroundSubtractingObjectSegmenter::remove_small_components(cv::Mat1b& ma
   cv::Mat1d centroids;
   cv::connectedComponentsWithStats(mask, ccsImage, stats, centroids);
 
+  // Decide once per component (rather than once per pixel) whether or not it should be retained.
+  const int componentCount = stats.rows;
+  std::vector<uchar> keepMask(componentCount);
+  for(int j = 0; j < componentCount; ++j)
+  {
+    keepMask[j] = stats(j, cv::CC_STAT_AREA) >= minimumComponentSize ? 255 : 0;
+  }
+
   // Update the mask to only contain components over a certain size.
   const int *ccsData = reinterpret_cast<int*>(ccsImage.data);
   const int pixelCount = mask.rows * mask.cols;
@@ -478,11 +490,7 @@ void BackgroundSubtractingObjectSegmenter::remove_small_components(cv::Mat1b& ma
 #endif
   for(int i = 0; i < pixelCount; ++i)
   {
-    int componentSize = stats(ccsData[i], cv::CC_STAT_AREA);
-    if(componentSize < minimumComponentSize)
-    {
-      mask.data[i] = 0;
-    }
+    mask.data[i] &= keepMask[ccsData[i]];
   }
 }
 
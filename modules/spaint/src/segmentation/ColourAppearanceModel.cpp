@@ -5,9 +5,6 @@
 
 #include "segmentation/ColourAppearanceModel.h"
 
-#include <itmx/util/ColourConversion_Shared.h>
-using namespace itmx;
-
 #include <tvgutil/containers/MapUtil.h>
 using namespace tvgutil;
 
@@ -16,34 +13,11 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 ColourAppearanceModel::ColourAppearanceModel(int binsCb, int binsCr)
-: m_binsCb(binsCb), m_binsCr(binsCr)
+: m_binsCb(binsCb), m_binsCr(binsCr), m_posteriorTable(binsCb * binsCr, 0.5f)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-float ColourAppearanceModel::compute_posterior_probability(const Vector3u& rgbColour) const
-{
-  // If we haven't yet seen enough training data to successfully build our appearance model, early out.
-  if(!m_pmfColourGivenObject || !m_pmfColourGivenNotObject) return 0.5f;
-
-  /*
-  P(object | colour) =                   P(colour | object) * P(object)
-                       -----------------------------------------------------------------
-                       P(colour | object) * P(object) + P(colour | !object) * P(!object)
-
-  For simplicity, assume that P(object) = P(!object) = 0.5. Then:
-
-  P(object | colour) =            P(colour | object)
-                       ----------------------------------------
-                       P(colour | object) + P(colour | !object)
-  */
-  int bin = compute_bin(rgbColour);
-  float colourGivenObject = MapUtil::lookup(m_pmfColourGivenObject->get_masses(), bin, 0.0f);
-  float colourGivenNotObject = MapUtil::lookup(m_pmfColourGivenNotObject->get_masses(), bin, 0.0f);
-  float denom = colourGivenObject + colourGivenNotObject;
-  return denom > 0.0f ? colourGivenObject / denom : 0.5f;
-}
-
 void ColourAppearanceModel::train(const ITMUChar4Image_CPtr& image, const ITMUCharImage_CPtr& objectMask)
 {
   // Update the likelihood histograms based on the colour image and object mask.
@@ -58,18 +32,38 @@ void ColourAppearanceModel::train(const ITMUChar4Image_CPtr& image, const ITMUCh
   // Update the likelihood PMFs from the histograms.
   if(m_histColourGivenObject.get_count() > 0) m_pmfColourGivenObject.reset(new ProbabilityMassFunction<int>(m_histColourGivenObject));
   if(m_histColourGivenNotObject.get_count() > 0) m_pmfColourGivenNotObject.reset(new ProbabilityMassFunction<int>(m_histColourGivenNotObject));
+
+  // Update the posterior probability table from the PMFs.
+  update_posterior_table();
 }
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-int ColourAppearanceModel::compute_bin(const Vector3u& rgbColour) const
+void ColourAppearanceModel::update_posterior_table()
 {
-  Vector3f yccColour = convert_rgb_to_ycbcr(rgbColour);
-  float cbFrac = yccColour.y / 255.0f;
-  float crFrac = yccColour.z / 255.0f;
-  int x = (int)CLAMP(ROUND(cbFrac * (m_binsCb - 1)), 0, m_binsCb - 1);
-  int y = (int)CLAMP(ROUND(crFrac * (m_binsCr - 1)), 0, m_binsCr - 1);
-  return y * m_binsCb + x;
+  // If we haven't yet seen enough training data to successfully build our appearance model, early out.
+  if(!m_pmfColourGivenObject || !m_pmfColourGivenNotObject) return;
+
+  /*
+  P(object | colour) =                   P(colour | object) * P(object)
+                       -----------------------------------------------------------------
+                       P(colour | object) * P(object) + P(colour | !object) * P(!object)
+
+  For simplicity, assume that P(object) = P(!object) = 0.5. Then:
+
+  P(object | colour) =            P(colour | object)
+                       ----------------------------------------
+                       P(colour | object) + P(colour | !object)
+  */
+  const std::map<int,float>& massesGivenObject = m_pmfColourGivenObject->get_masses();
+  const std::map<int,float>& massesGivenNotObject = m_pmfColourGivenNotObject->get_masses();
+  for(int bin = 0, binCount = static_cast<int>(m_posteriorTable.size()); bin < binCount; ++bin)
+  {
+    float colourGivenObject = MapUtil::lookup(massesGivenObject, bin, 0.0f);
+    float colourGivenNotObject = MapUtil::lookup(massesGivenNotObject, bin, 0.0f);
+    float denom = colourGivenObject + colourGivenNotObject;
+    m_posteriorTable[bin] = denom > 0.0f ? colourGivenObject / denom : 0.5f;
+  }
 }
 
 }
@@ -16,14 +16,14 @@ namespace spaint {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
-SelectionTransformer_Ptr SelectionTransformerFactory::make_voxel_to_cube(int radius, DeviceType deviceType)
+SelectionTransformer_Ptr SelectionTransformerFactory::make_voxel_to_cube(int radius, DeviceType deviceType, bool deduplicate)
 {
   SelectionTransformer_Ptr transformer;
 
   if(deviceType == DEVICE_CUDA)
   {
 #ifdef WITH_CUDA
-    transformer.reset(new VoxelToCubeSelectionTransformer_CUDA(radius));
+    transformer.reset(new VoxelToCubeSelectionTransformer_CUDA(radius, deduplicate));
 #else
     // This should never happen as things stand - we set deviceType to DEVICE_CPU to false if CUDA support isn't available.
     throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
@@ -31,7 +31,7 @@ SelectionTransformer_Ptr SelectionTransformerFactory::make_voxel_to_cube(int rad
   }
   else
   {
-    transformer.reset(new VoxelToCubeSelectionTransformer_CPU(radius));
+    transformer.reset(new VoxelToCubeSelectionTransformer_CPU(radius, deduplicate));
   }
 
   return transformer;
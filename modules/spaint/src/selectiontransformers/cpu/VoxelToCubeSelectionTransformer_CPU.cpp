@@ -6,20 +6,28 @@
 #include "selectiontransformers/cpu/VoxelToCubeSelectionTransformer_CPU.h"
 using namespace ITMLib;
 
+#include <algorithm>
+
 #include "selectiontransformers/shared/VoxelToCubeSelectionTransformer_Shared.h"
 
 namespace spaint {
 
 //#################### CONSTRUCTORS ####################
 
-VoxelToCubeSelectionTransformer_CPU::VoxelToCubeSelectionTransformer_CPU(int radius)
-: VoxelToCubeSelectionTransformer(radius, DEVICE_CPU)
+VoxelToCubeSelectionTransformer_CPU::VoxelToCubeSelectionTransformer_CPU(int radius, bool deduplicate)
+: VoxelToCubeSelectionTransformer(radius, DEVICE_CPU, deduplicate)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 void VoxelToCubeSelectionTransformer_CPU::transform_selection(const Selection& inputSelectionMB, Selection& outputSelectionMB) const
 {
+  if(m_deduplicate)
+  {
+    transform_selection_deduplicated(inputSelectionMB, outputSelectionMB);
+    return;
+  }
+
   const int cubeSideLength = cube_side_length();
   const int cubeSize = cube_size();
   const Vector3s *inputSelection = inputSelectionMB.GetData(MEMORYDEVICE_CPU);
@@ -35,4 +43,93 @@ void VoxelToCubeSelectionTransformer_CPU::transform_selection(const Selection& i
   }
 }
 
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void VoxelToCubeSelectionTransformer_CPU::transform_selection_deduplicated(const Selection& inputSelectionMB, Selection& outputSelectionMB) const
+{
+  const Vector3s *inputSelection = inputSelectionMB.GetData(MEMORYDEVICE_CPU);
+  Vector3s *outputSelection = outputSelectionMB.GetData(MEMORYDEVICE_CPU);
+  const int inputVoxelCount = static_cast<int>(inputSelectionMB.dataSize);
+
+  if(inputVoxelCount == 0)
+  {
+    outputSelectionMB.dataSize = 0;
+    return;
+  }
+
+  // Compute the bounding box of the output selection.
+  Vector3i mins(inputSelection[0].x, inputSelection[0].y, inputSelection[0].z), maxs = mins;
+  for(int i = 1; i < inputVoxelCount; ++i)
+  {
+    const Vector3s& v = inputSelection[i];
+    mins.x = std::min<int>(mins.x, v.x); mins.y = std::min<int>(mins.y, v.y); mins.z = std::min<int>(mins.z, v.z);
+    maxs.x = std::max<int>(maxs.x, v.x); maxs.y = std::max<int>(maxs.y, v.y); maxs.z = std::max<int>(maxs.z, v.z);
+  }
+
+  mins -= Vector3i(m_radius);
+  maxs += Vector3i(m_radius);
+  const Vector3i extent = maxs - mins + Vector3i(1);
+  const size_t boxVolume = static_cast<size_t>(extent.x) * extent.y * extent.z;
+
+  // If the bounding box is reasonably compact relative to the number of voxels in the cubes, mark the voxels in the
+  // cubes in an occupancy grid over the bounding box, and then scan the grid to produce the output selection (this
+  // naturally deduplicates the voxels and sorts them in z, y, x order).
+  const size_t cubeVoxelCount = static_cast<size_t>(inputVoxelCount) * cube_size();
+  const size_t maxBoxVolume = 1 << 22;
+  if(boxVolume <= maxBoxVolume && boxVolume <= 8 * cubeVoxelCount)
+  {
+    m_occupancy.assign(boxVolume, 0);
+
+    const int cubeSideLength = cube_side_length();
+    for(int i = 0; i < inputVoxelCount; ++i)
+    {
+      const Vector3i cubeMin = Vector3i(inputSelection[i].x, inputSelection[i].y, inputSelection[i].z) - Vector3i(m_radius) - mins;
+      for(int z = cubeMin.z, zEnd = cubeMin.z + cubeSideLength; z < zEnd; ++z)
+      {
+        for(int y = cubeMin.y, yEnd = cubeMin.y + cubeSideLength; y < yEnd; ++y)
+        {
+          unsigned char *row = &m_occupancy[(static_cast<size_t>(z) * extent.y + y) * extent.x + cubeMin.x];
+          std::fill(row, row + cubeSideLength, 1);
+        }
+      }
+    }
+
+    size_t outputVoxelCount = 0;
+    const unsigned char *occupancy = &m_occupancy[0];
+    for(int z = 0; z < extent.z; ++z)
+    {
+      for(int y = 0; y < extent.y; ++y)
+      {
+        for(int x = 0; x < extent.x; ++x, ++occupancy)
+        {
+          if(*occupancy) outputSelection[outputVoxelCount++] = Vector3s(mins.x + x, mins.y + y, mins.z + z);
+        }
+      }
+    }
+
+    outputSelectionMB.dataSize = outputVoxelCount;
+  }
+  else
+  {
+    // Otherwise, the initial voxels are too spread out for an occupancy grid to be worthwhile, so write out all of the
+    // cubes in full, and then sort the output selection and remove the duplicate voxels.
+    const int cubeSideLength = cube_side_length();
+    const int cubeSize = cube_size();
+    const int fullVoxelCount = static_cast<int>(cubeVoxelCount);
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel for
+#endif
+    for(int outputVoxelIndex = 0; outputVoxelIndex < fullVoxelCount; ++outputVoxelIndex)
+    {
+      write_voxel_to_output_selection(outputVoxelIndex, cubeSideLength, cubeSize, m_radius, inputSelection, outputSelection);
+    }
+
+    Vector3s *begin = outputSelection, *end = outputSelection + fullVoxelCount;
+    std::sort(begin, end, SelectionVoxelLess());
+    end = std::unique(begin, end, SelectionVoxelEqual());
+    outputSelectionMB.dataSize = end - begin;
+  }
+}
+
 }
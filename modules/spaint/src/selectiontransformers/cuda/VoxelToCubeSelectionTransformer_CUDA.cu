@@ -6,6 +6,10 @@
 #include "selectiontransformers/cuda/VoxelToCubeSelectionTransformer_CUDA.h"
 using namespace ITMLib;
 
+#include <thrust/device_ptr.h>
+#include <thrust/sort.h>
+#include <thrust/unique.h>
+
 #include "selectiontransformers/shared/VoxelToCubeSelectionTransformer_Shared.h"
 
 namespace spaint {
@@ -20,8 +24,8 @@ __global__ void ck_transform_selection(int cubeSideLength, int cubeSize, int rad
 
 //#################### CONSTRUCTORS ####################
 
-VoxelToCubeSelectionTransformer_CUDA::VoxelToCubeSelectionTransformer_CUDA(int radius)
-: VoxelToCubeSelectionTransformer(radius, DEVICE_CUDA)
+VoxelToCubeSelectionTransformer_CUDA::VoxelToCubeSelectionTransformer_CUDA(int radius, bool deduplicate)
+: VoxelToCubeSelectionTransformer(radius, DEVICE_CUDA, deduplicate)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -41,6 +45,16 @@ void VoxelToCubeSelectionTransformer_CUDA::transform_selection(const Selection&
     outputSelectionMB.GetData(MEMORYDEVICE_CUDA),
     outputVoxelCount
   );
+
+  // If we're deduplicating the output selection, sort it and remove the duplicate voxels.
+  if(m_deduplicate)
+  {
+    thrust::device_ptr<Vector3s> begin(outputSelectionMB.GetData(MEMORYDEVICE_CUDA));
+    thrust::device_ptr<Vector3s> end = begin + outputVoxelCount;
+    thrust::sort(begin, end, SelectionVoxelLess());
+    end = thrust::unique(begin, end, SelectionVoxelEqual());
+    outputSelectionMB.dataSize = end - begin;
+  }
 }
 
 }
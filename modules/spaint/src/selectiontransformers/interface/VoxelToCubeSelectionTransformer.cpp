@@ -10,8 +10,9 @@ namespace spaint {
 
 //#################### CONSTRUCTORS ####################
 
-VoxelToCubeSelectionTransformer::VoxelToCubeSelectionTransformer(int radius, DeviceType deviceType)
+VoxelToCubeSelectionTransformer::VoxelToCubeSelectionTransformer(int radius, DeviceType deviceType, bool deduplicate)
 : SelectionTransformer(deviceType),
+  m_deduplicate(deduplicate),
   m_radius(radius)
 {}
 
@@ -24,10 +25,15 @@ void VoxelToCubeSelectionTransformer::accept(const SelectionTransformerVisitor&
 
 size_t VoxelToCubeSelectionTransformer::compute_output_selection_size(const Selection& inputSelectionMB) const
 {
-  // We create one cube for each initial voxel.
+  // We create one cube for each initial voxel. (If we are deduplicating the output selection, this is an upper bound on its size.)
   return inputSelectionMB.dataSize * cube_size();
 }
 
+bool VoxelToCubeSelectionTransformer::get_deduplicate() const
+{
+  return m_deduplicate;
+}
+
 int VoxelToCubeSelectionTransformer::get_radius() const
 {
   return m_radius;
@@ -34,7 +34,10 @@ TouchSelector::TouchSelector(const Settings_CPtr& itmSettings, const TouchSettin
   m_keptTouchPointsFloatMB(new ORUtils::MemoryBlock<Vector3f>(maxKeptTouchPoints, true, true)),
   m_keptTouchPointsShortMB(new ORUtils::MemoryBlock<Vector3s>(maxKeptTouchPoints, true, true)),
   m_maxKeptTouchPoints(maxKeptTouchPoints),
-  m_touchDetector(new TouchDetector(touchImageSize, itmSettings, touchSettings))
+  m_touchDetector(new TouchDetector(touchImageSize, itmSettings, touchSettings)),
+  m_touchPickPointsMB(new ORUtils::MemoryBlock<Vector3f>(touchImageSize.x * touchImageSize.y, true, true)),
+  m_touchPickPointsValidMB(new ORUtils::MemoryBlock<bool>(touchImageSize.x * touchImageSize.y, true, true)),
+  m_touchPointsMB(new ORUtils::MemoryBlock<Vector2i>(touchImageSize.x * touchImageSize.y, true, true))
 {
   m_isActive = true;
 
@@ -90,18 +93,38 @@ void TouchSelector::update(const InputState& inputState, const SLAMState_CPtr& s
   std::cout << runningTouchDetectorOnFrame << '\n';
 #endif
 
+  // Copy the touch points into a memory block so that they can all be picked at once. Note that the touch points
+  // are distinct pixels in the touch image, so the memory blocks (which are the size of the image) cannot overflow.
+  const size_t touchPointCount = touchPoints.size();
+  Vector2i *touchPointsPtr = m_touchPointsMB->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < touchPointCount; ++i)
+  {
+    touchPointsPtr[i] = Vector2i(touchPoints[i][0], touchPoints[i][1]);
+  }
+  m_touchPointsMB->dataSize = touchPointCount;
+  m_touchPointsMB->UpdateDeviceFromHost();
+
+  // Pick all of the touch points at once. We shrink the output memory blocks to the number of touch points first,
+  // so that only the results for the touch points we actually have are copied back across from the GPU.
+  m_touchPickPointsMB->dataSize = touchPointCount;
+  m_touchPickPointsValidMB->dataSize = touchPointCount;
+  m_picker->pick(*m_touchPointsMB, renderState.get(), *m_touchPickPointsMB, *m_touchPickPointsValidMB);
+  m_touchPickPointsMB->UpdateHostFromDevice();
+  m_touchPickPointsValidMB->UpdateHostFromDevice();
+
   // Determine which of the touch points are valid (i.e. are ones that we want to keep) and copy them into a memory block.
   // Note that we limit the overall number of points we keep for performance reasons, so not all of the valid touch points
   // may end up being retained.
+  const Vector3f *touchPickPoints = m_touchPickPointsMB->GetData(MEMORYDEVICE_CPU);
+  const bool *touchPickPointsValid = m_touchPickPointsValidMB->GetData(MEMORYDEVICE_CPU);
   m_keptTouchPointsFloatMB->Clear();
+  Vector3f *keptTouchPoints = m_keptTouchPointsFloatMB->GetData(MEMORYDEVICE_CPU);
   m_keptTouchPointCount = 0;
-  for(size_t i = 0, touchPointCount = touchPoints.size(); i < touchPointCount && m_keptTouchPointCount < m_maxKeptTouchPoints; ++i)
+  for(size_t i = 0; i < touchPointCount && m_keptTouchPointCount < m_maxKeptTouchPoints; ++i)
   {
-    if(m_picker->pick(touchPoints[i][0], touchPoints[i][1], renderState.get(), *m_keptTouchPointsFloatMB, m_keptTouchPointCount))
-    {
-      ++m_keptTouchPointCount;
-    }
+    if(touchPickPointsValid[i]) keptTouchPoints[m_keptTouchPointCount++] = touchPickPoints[i];
   }
+  m_keptTouchPointsFloatMB->UpdateDeviceFromHost();
 
   // Convert the touch points we kept to Vector3s format.
   if(m_keptTouchPointCount > 0)
@@ -6,11 +6,19 @@
 #include "slamstate/SLAMState.h"
 
 #include "fiducials/AveragingFiducial.h"
+#include "surfaces/SurfaceGBufferFactory.h"
 using namespace ITMLib;
 using namespace ORUtils;
 
 namespace spaint {
 
+//#################### CONSTRUCTORS ####################
+
+SLAMState::SLAMState()
+: m_fusionGeneration(0), m_labelClearGeneration(0), m_labelGeneration(0), m_liveRaycastGeneration(0), m_resetGeneration(0),
+  m_surfaceGBufferFusionGeneration(0), m_surfaceGBufferLabelGeneration(0)
+{}
+
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 const Vector2i& SLAMState::get_depth_image_size() const
@@ -23,6 +31,11 @@ const std::map<std::string,Fiducial_Ptr>& SLAMState::get_fiducials() const
   return m_fiducials;
 }
 
+unsigned int SLAMState::get_fusion_generation() const
+{
+  return m_fusionGeneration;
+}
+
 ITMUCharImage_CPtr SLAMState::get_input_mask() const
 {
   return m_inputMask;
@@ -57,6 +70,16 @@ const ITMIntrinsics& SLAMState::get_intrinsics() const
   return m_view->calib.intrinsics_d;
 }
 
+unsigned int SLAMState::get_label_clear_generation() const
+{
+  return m_labelClearGeneration;
+}
+
+unsigned int SLAMState::get_label_generation() const
+{
+  return m_labelGeneration;
+}
+
 const SurfelRenderState_Ptr& SLAMState::get_live_surfel_render_state()
 {
   return m_liveSurfelRenderState;
@@ -72,6 +95,11 @@ const SE3Pose& SLAMState::get_pose() const
   return *m_trackingState->pose_d;
 }
 
+unsigned int SLAMState::get_reset_generation() const
+{
+  return m_resetGeneration;
+}
+
 const Vector2i& SLAMState::get_rgb_image_size() const
 {
   return m_inputRGBImage->noDims;
@@ -87,6 +115,38 @@ SpaintSurfelScene_CPtr SLAMState::get_surfel_scene() const
   return m_surfelScene;
 }
 
+SurfaceGBuffer_CPtr SLAMState::get_surface_gbuffer(const VoxelRenderState_CPtr& renderState, int optionalAttributes, DeviceType deviceType)
+{
+  // If the G-buffer has not yet been created, create it.
+  if(!m_surfaceGBuffer) m_surfaceGBuffer = SurfaceGBufferFactory::make_surface_gbuffer(deviceType);
+
+  // Determine whether or not the raycast result in the render state is known to be unchanged since the G-buffer was last fully updated
+  // (we can only know this for the live render state), and whether or not the G-buffer already contains all of the requested attributes.
+  boost::optional<unsigned int> liveRaycastGeneration;
+  if(renderState == m_liveVoxelRenderState) liveRaycastGeneration = m_liveRaycastGeneration;
+
+  const bool raycastUnchanged = liveRaycastGeneration && liveRaycastGeneration == m_surfaceGBufferLiveRaycastGeneration &&
+                                m_surfaceGBufferFusionGeneration == m_fusionGeneration && m_surfaceGBuffer->get_raycast_result() == renderState->raycastResult;
+  const bool hasAttributes = (optionalAttributes & ~m_surfaceGBuffer->get_optional_attributes()) == 0;
+
+  if(raycastUnchanged && hasAttributes)
+  {
+    // If the raycast result is unchanged, only the labels of the voxels can be out of date, and they can be re-read without any hash table lookups.
+    if(m_surfaceGBufferLabelGeneration != m_labelGeneration) m_surfaceGBuffer->update_labels(m_voxelScene.get());
+  }
+  else
+  {
+    // Otherwise, fully recompute the G-buffer, keeping any optional attributes that it already contains if the raycast result is unchanged.
+    if(raycastUnchanged) optionalAttributes |= m_surfaceGBuffer->get_optional_attributes();
+    m_surfaceGBuffer->update(renderState->raycastResult, m_voxelScene.get(), optionalAttributes);
+    m_surfaceGBufferFusionGeneration = m_fusionGeneration;
+    m_surfaceGBufferLiveRaycastGeneration = liveRaycastGeneration;
+  }
+
+  m_surfaceGBufferLabelGeneration = m_labelGeneration;
+  return m_surfaceGBuffer;
+}
+
 const TrackingState_Ptr& SLAMState::get_tracking_state()
 {
   return m_trackingState;
@@ -117,6 +177,32 @@ SpaintVoxelScene_CPtr SLAMState::get_voxel_scene() const
   return m_voxelScene;
 }
 
+void SLAMState::record_labels_changed()
+{
+  ++m_labelGeneration;
+}
+
+void SLAMState::record_labels_cleared()
+{
+  ++m_labelClearGeneration;
+  ++m_labelGeneration;
+}
+
+void SLAMState::record_live_raycast()
+{
+  ++m_liveRaycastGeneration;
+}
+
+void SLAMState::record_scene_fused()
+{
+  ++m_fusionGeneration;
+}
+
+void SLAMState::record_scene_reset()
+{
+  m_resetGeneration = ++m_fusionGeneration;
+}
+
 void SLAMState::set_input_mask(const ITMUCharImage_Ptr& inputMask)
 {
   m_inputMask = inputMask;
@@ -17,12 +17,14 @@ LabelSmoother_CPU::LabelSmoother_CPU(size_t maxLabelCount, float maxSquaredDista
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-void LabelSmoother_CPU::smooth_labels(const ITMFloat4Image *raycastResult, SpaintVoxelScene *scene) const
+void LabelSmoother_CPU::smooth_labels(const SurfaceGBuffer& gbuffer, SpaintVoxelScene *scene) const
 {
+  const ITMFloat4Image *raycastResult = gbuffer.get_raycast_result();
   const int height = raycastResult->noDims.y;
-  const ITMVoxelIndex::IndexData *indexData = scene->index.getIndexData();
   const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
   const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
+  const SpaintVoxel::PackedLabel *surfaceLabels = gbuffer.get_packed_labels().GetData(MEMORYDEVICE_CPU);
+  const int *voxelAddresses = gbuffer.get_voxel_addresses().GetData(MEMORYDEVICE_CPU);
   SpaintVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
   const int width = raycastResult->noDims.x;
 
@@ -31,7 +33,7 @@ void LabelSmoother_CPU::smooth_labels(const ITMFloat4Image *raycastResult, Spain
 #endif
   for(int voxelIndex = 0; voxelIndex < raycastResultSize; ++voxelIndex)
   {
-    smooth_from_neighbours(voxelIndex, width, height, static_cast<int>(m_maxLabelCount), raycastResultData, voxelData, indexData, m_maxSquaredDistanceBetweenVoxels);
+    smooth_from_neighbours(voxelIndex, width, height, static_cast<int>(m_maxLabelCount), raycastResultData, surfaceLabels, voxelAddresses, voxelData, m_maxSquaredDistanceBetweenVoxels);
   }
 }
 
@@ -14,12 +14,13 @@ namespace spaint {
 //#################### CUDA KERNELS ####################
 
 __global__ void ck_smooth_from_neighbours(const Vector4f *raycastResultData, int raycastResultSize, int width, int height, int maxLabelCount,
-                                          SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData, float maxSquaredDistanceBetweenVoxels)
+                                          const SpaintVoxel::PackedLabel *surfaceLabels, const int *voxelAddresses, SpaintVoxel *voxelData,
+                                          float maxSquaredDistanceBetweenVoxels)
 {
   int voxelIndex = threadIdx.x + blockDim.x * blockIdx.x;
   if(voxelIndex < raycastResultSize)
   {
-    smooth_from_neighbours(voxelIndex, width, height, maxLabelCount, raycastResultData, voxelData, indexData, maxSquaredDistanceBetweenVoxels);
+    smooth_from_neighbours(voxelIndex, width, height, maxLabelCount, raycastResultData, surfaceLabels, voxelAddresses, voxelData, maxSquaredDistanceBetweenVoxels);
   }
 }
 
@@ -31,8 +32,9 @@ LabelSmoother_CUDA::LabelSmoother_CUDA(size_t maxLabelCount, float maxSquaredDis
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-void LabelSmoother_CUDA::smooth_labels(const ITMFloat4Image *raycastResult, SpaintVoxelScene *scene) const
+void LabelSmoother_CUDA::smooth_labels(const SurfaceGBuffer& gbuffer, SpaintVoxelScene *scene) const
 {
+  const ITMFloat4Image *raycastResult = gbuffer.get_raycast_result();
   const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
 
   int threadsPerBlock = 256;
@@ -44,8 +46,9 @@ void LabelSmoother_CUDA::smooth_labels(const ITMFloat4Image *raycastResult, Spai
     raycastResult->noDims.x,
     raycastResult->noDims.y,
     static_cast<int>(m_maxLabelCount),
+    gbuffer.get_packed_labels().GetData(MEMORYDEVICE_CUDA),
+    gbuffer.get_voxel_addresses().GetData(MEMORYDEVICE_CUDA),
     scene->localVBA.GetVoxelBlocks(),
-    scene->index.getIndexData(),
     m_maxSquaredDistanceBetweenVoxels
   );
 }
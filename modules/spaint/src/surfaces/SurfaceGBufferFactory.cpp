@@ -0,0 +1,40 @@
+/**
+ * spaint: SurfaceGBufferFactory.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#include "surfaces/SurfaceGBufferFactory.h"
+using namespace ITMLib;
+
+#include "surfaces/cpu/SurfaceGBuffer_CPU.h"
+
+#ifdef WITH_CUDA
+#include "surfaces/cuda/SurfaceGBuffer_CUDA.h"
+#endif
+
+namespace spaint {
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+SurfaceGBuffer_Ptr SurfaceGBufferFactory::make_surface_gbuffer(DeviceType deviceType)
+{
+  SurfaceGBuffer_Ptr gbuffer;
+
+  if(deviceType == DEVICE_CUDA)
+  {
+#ifdef WITH_CUDA
+    gbuffer.reset(new SurfaceGBuffer_CUDA());
+#else
+    // This should never happen as things stand - we set deviceType to DEVICE_CPU if CUDA support isn't available.
+    throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
+#endif
+  }
+  else
+  {
+    gbuffer.reset(new SurfaceGBuffer_CPU());
+  }
+
+  return gbuffer;
+}
+
+}
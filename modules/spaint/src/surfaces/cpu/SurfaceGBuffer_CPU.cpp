@@ -0,0 +1,56 @@
+/**
+ * spaint: SurfaceGBuffer_CPU.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#include "surfaces/cpu/SurfaceGBuffer_CPU.h"
+
+#include "surfaces/shared/SurfaceGBuffer_Shared.h"
+
+namespace spaint {
+
+//#################### CONSTRUCTORS ####################
+
+SurfaceGBuffer_CPU::SurfaceGBuffer_CPU()
+{}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SurfaceGBuffer_CPU::compute(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene, int optionalAttributes)
+{
+  const ITMVoxelIndex::IndexData *indexData = scene->index.getIndexData();
+  const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
+  const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
+  const SpaintVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
+
+  Vector3u *colours = optionalAttributes & SGA_COLOURS ? m_colours->GetData(MEMORYDEVICE_CPU) : NULL;
+  Vector3f *normals = optionalAttributes & SGA_NORMALS ? m_normals->GetData(MEMORYDEVICE_CPU) : NULL;
+  SpaintVoxel::PackedLabel *packedLabels = m_packedLabels->GetData(MEMORYDEVICE_CPU);
+  int *voxelAddresses = m_voxelAddresses->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int pixelIndex = 0; pixelIndex < raycastResultSize; ++pixelIndex)
+  {
+    write_surface_gbuffer_entry(pixelIndex, raycastResultData, voxelData, indexData, normals, colours, packedLabels, voxelAddresses);
+  }
+}
+
+void SurfaceGBuffer_CPU::compute_labels(const SpaintVoxelScene *scene)
+{
+  const int pixelCount = static_cast<int>(m_voxelAddresses->dataSize);
+  SpaintVoxel::PackedLabel *packedLabels = m_packedLabels->GetData(MEMORYDEVICE_CPU);
+  const int *voxelAddresses = m_voxelAddresses->GetData(MEMORYDEVICE_CPU);
+  const SpaintVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int pixelIndex = 0; pixelIndex < pixelCount; ++pixelIndex)
+  {
+    update_surface_gbuffer_label(pixelIndex, voxelAddresses, voxelData, packedLabels);
+  }
+}
+
+}
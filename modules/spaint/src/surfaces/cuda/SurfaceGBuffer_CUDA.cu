@@ -0,0 +1,75 @@
+/**
+ * spaint: SurfaceGBuffer_CUDA.cu
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#include "surfaces/cuda/SurfaceGBuffer_CUDA.h"
+
+#include "surfaces/shared/SurfaceGBuffer_Shared.h"
+
+namespace spaint {
+
+//#################### CUDA KERNELS ####################
+
+__global__ void ck_write_surface_gbuffer_entries(const Vector4f *raycastResultData, int raycastResultSize,
+                                                 const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                                 Vector3f *normals, Vector3u *colours, SpaintVoxel::PackedLabel *packedLabels, int *voxelAddresses)
+{
+  int pixelIndex = threadIdx.x + blockDim.x * blockIdx.x;
+  if(pixelIndex < raycastResultSize)
+  {
+    write_surface_gbuffer_entry(pixelIndex, raycastResultData, voxelData, indexData, normals, colours, packedLabels, voxelAddresses);
+  }
+}
+
+__global__ void ck_update_surface_gbuffer_labels(const int *voxelAddresses, int pixelCount, const SpaintVoxel *voxelData, SpaintVoxel::PackedLabel *packedLabels)
+{
+  int pixelIndex = threadIdx.x + blockDim.x * blockIdx.x;
+  if(pixelIndex < pixelCount)
+  {
+    update_surface_gbuffer_label(pixelIndex, voxelAddresses, voxelData, packedLabels);
+  }
+}
+
+//#################### CONSTRUCTORS ####################
+
+SurfaceGBuffer_CUDA::SurfaceGBuffer_CUDA()
+{}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SurfaceGBuffer_CUDA::compute(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene, int optionalAttributes)
+{
+  const int raycastResultSize = static_cast<int>(raycastResult->dataSize);
+
+  int threadsPerBlock = 256;
+  int numBlocks = (raycastResultSize + threadsPerBlock - 1) / threadsPerBlock;
+
+  ck_write_surface_gbuffer_entries<<<numBlocks,threadsPerBlock>>>(
+    raycastResult->GetData(MEMORYDEVICE_CUDA),
+    raycastResultSize,
+    scene->localVBA.GetVoxelBlocks(),
+    scene->index.getIndexData(),
+    optionalAttributes & SGA_NORMALS ? m_normals->GetData(MEMORYDEVICE_CUDA) : NULL,
+    optionalAttributes & SGA_COLOURS ? m_colours->GetData(MEMORYDEVICE_CUDA) : NULL,
+    m_packedLabels->GetData(MEMORYDEVICE_CUDA),
+    m_voxelAddresses->GetData(MEMORYDEVICE_CUDA)
+  );
+}
+
+void SurfaceGBuffer_CUDA::compute_labels(const SpaintVoxelScene *scene)
+{
+  const int pixelCount = static_cast<int>(m_voxelAddresses->dataSize);
+
+  int threadsPerBlock = 256;
+  int numBlocks = (pixelCount + threadsPerBlock - 1) / threadsPerBlock;
+
+  ck_update_surface_gbuffer_labels<<<numBlocks,threadsPerBlock>>>(
+    m_voxelAddresses->GetData(MEMORYDEVICE_CUDA),
+    pixelCount,
+    scene->localVBA.GetVoxelBlocks(),
+    m_packedLabels->GetData(MEMORYDEVICE_CUDA)
+  );
+}
+
+}
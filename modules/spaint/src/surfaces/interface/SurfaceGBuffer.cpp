@@ -0,0 +1,87 @@
+/**
+ * spaint: SurfaceGBuffer.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2016. All rights reserved.
+ */
+
+#include "surfaces/interface/SurfaceGBuffer.h"
+
+#include <stdexcept>
+
+#include <itmx/base/MemoryBlockFactory.h>
+using itmx::MemoryBlockFactory;
+
+namespace spaint {
+
+//#################### CONSTRUCTORS ####################
+
+SurfaceGBuffer::SurfaceGBuffer()
+: m_optionalAttributes(0), m_raycastResult(NULL)
+{
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  m_colours = mbf.make_image<Vector3u>();
+  m_normals = mbf.make_image<Vector3f>();
+  m_packedLabels = mbf.make_image<SpaintVoxel::PackedLabel>();
+  m_voxelAddresses = mbf.make_image<int>();
+}
+
+//#################### DESTRUCTOR ####################
+
+SurfaceGBuffer::~SurfaceGBuffer() {}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const ORUtils::Image<Vector3u>& SurfaceGBuffer::get_colours() const
+{
+  if(!(m_optionalAttributes & SGA_COLOURS)) throw std::runtime_error("Error: The colours were not computed when the surface G-buffer was last updated");
+  return *m_colours;
+}
+
+const ORUtils::Image<Vector3f>& SurfaceGBuffer::get_normals() const
+{
+  if(!(m_optionalAttributes & SGA_NORMALS)) throw std::runtime_error("Error: The normals were not computed when the surface G-buffer was last updated");
+  return *m_normals;
+}
+
+int SurfaceGBuffer::get_optional_attributes() const
+{
+  return m_optionalAttributes;
+}
+
+const ORUtils::Image<SpaintVoxel::PackedLabel>& SurfaceGBuffer::get_packed_labels() const
+{
+  return *m_packedLabels;
+}
+
+const ITMFloat4Image *SurfaceGBuffer::get_raycast_result() const
+{
+  if(!m_raycastResult) throw std::runtime_error("Error: The surface G-buffer has not yet been updated");
+  return m_raycastResult;
+}
+
+const ORUtils::Image<int>& SurfaceGBuffer::get_voxel_addresses() const
+{
+  return *m_voxelAddresses;
+}
+
+void SurfaceGBuffer::update(const ITMFloat4Image *raycastResult, const SpaintVoxelScene *scene, int optionalAttributes)
+{
+  // Make sure that the images in the G-buffer that are going to be written are the same size as the raycast result
+  // (this is a no-op if they already are). The images for any optional attributes that are not needed are left alone.
+  const Vector2i& imgSize = raycastResult->noDims;
+  if(optionalAttributes & SGA_COLOURS) m_colours->ChangeDims(imgSize);
+  if(optionalAttributes & SGA_NORMALS) m_normals->ChangeDims(imgSize);
+  m_packedLabels->ChangeDims(imgSize);
+  m_voxelAddresses->ChangeDims(imgSize);
+
+  compute(raycastResult, scene, optionalAttributes);
+  m_optionalAttributes = optionalAttributes;
+  m_raycastResult = raycastResult;
+}
+
+void SurfaceGBuffer::update_labels(const SpaintVoxelScene *scene)
+{
+  if(!m_raycastResult) throw std::runtime_error("Error: The surface G-buffer has not yet been updated");
+  compute_labels(scene);
+}
+
+}
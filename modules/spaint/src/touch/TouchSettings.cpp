@@ -68,8 +68,10 @@ TouchSettings::RF_Ptr TouchSettings::load_forest() const
   // Register the relevant decision function generators with the factory.
   rafl::DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
 
-  // Load the forest.
-  RF_Ptr forest = SerializationUtil::load_text(fullForestPath.string(), forest);
+  // Load the forest (forests with a .rfb extension are stored using a binary archive, which is much faster to load than a text one).
+  RF_Ptr forest;
+  if(fullForestPath.extension() == ".rfb") forest = SerializationUtil::load_binary(fullForestPath.string(), forest);
+  else forest = SerializationUtil::load_text(fullForestPath.string(), forest);
 
   return forest;
 }
@@ -117,7 +117,8 @@ void VisualisationGenerator::generate_surfel_visualisation(const ITMUChar4Image_
 
 void VisualisationGenerator::generate_voxel_visualisation(const ITMUChar4Image_Ptr& output, const SpaintVoxelScene_CPtr& scene, const ORUtils::SE3Pose& pose,
                                                           const ITMIntrinsics& intrinsics, VoxelRenderState_Ptr& renderState, VisualisationType visualisationType,
-                                                          const boost::optional<Postprocessor>& postprocessor) const
+                                                          const boost::optional<Postprocessor>& postprocessor, const VoxelRenderCache_Ptr& renderCache,
+                                                          unsigned int fusionGeneration, unsigned int labelGeneration) const
 {
   if(!scene)
   {
@@ -127,51 +128,48 @@ void VisualisationGenerator::generate_voxel_visualisation(const ITMUChar4Image_P
 
   if(!renderState) renderState.reset(ITMRenderStateFactory<ITMVoxelIndex>::CreateRenderState(output->noDims, scene->sceneParams, m_settings->GetMemoryType()));
 
-  m_voxelVisualisationEngine->FindVisibleBlocks(scene.get(), &pose, &intrinsics, renderState.get());
-  m_voxelVisualisationEngine->CreateExpectedDepths(scene.get(), &pose, &intrinsics, renderState.get());
-
-  switch(visualisationType)
+  // If a render cache has been specified, use it to determine whether or not we actually need to raycast the scene.
+  // Note that the label generation is only relevant for visualisations that show the labels.
+  const bool semantic = is_semantic(visualisationType);
+  boost::optional<VoxelRenderCache::Key> cacheKey;
+  VoxelRenderCache::LookupResult lookupResult = VoxelRenderCache::LR_MISS;
+  if(renderCache)
   {
-    case VT_SCENE_COLOUR:
-    {
-      m_voxelVisualisationEngine->RenderImage(scene.get(), &pose, &intrinsics, renderState.get(), renderState->raycastImage,
-                                              ITMLib::IITMVisualisationEngine::RENDER_COLOUR_FROM_VOLUME);
-      break;
-    }
-    case VT_SCENE_NORMAL:
+    cacheKey = VoxelRenderCache::Key(scene.get(), fusionGeneration, semantic ? labelGeneration : 0, pose, intrinsics, output->noDims, visualisationType);
+    lookupResult = renderCache->lookup(*cacheKey, renderState.get(), !semantic);
+
+    // Even if the render state's image can't be reused, a semantic visualisation may still be able to be generated without raycasting
+    // by reshading the surface points that the (shared) semantic visualiser retained when it last rendered this view, e.g. for another
+    // sub-window with the same pose or for this one with a different type of semantic visualisation. Reshading also copies the retained
+    // raycast result into the render state, so the raycast result that other components (e.g. the selectors) read matches the image.
+    if(lookupResult == VoxelRenderCache::LR_MISS && semantic && m_semanticVisualiser && m_semanticVisualiser->has_surface(*cacheKey))
     {
-      m_voxelVisualisationEngine->RenderImage(scene.get(), &pose, &intrinsics, renderState.get(), renderState->raycastImage,
-                                              ITMLib::IITMVisualisationEngine::RENDER_COLOUR_FROM_NORMAL);
-      break;
+      lookupResult = VoxelRenderCache::LR_RESHADE;
     }
-    case VT_SCENE_SEMANTICCOLOUR:
-    case VT_SCENE_SEMANTICFLAT:
-    case VT_SCENE_SEMANTICLAMBERTIAN:
-    case VT_SCENE_SEMANTICPHONG:
-    {
-      if(!m_semanticVisualiser) throw std::runtime_error("Error: This visualisation generator does not support semantic visualisations");
 
-      const std::vector<Vector3u>& labelColours = m_labelManager->get_label_colours();
-
-      LightingType lightingType = LT_LAMBERTIAN;
-      if(visualisationType == VT_SCENE_SEMANTICFLAT) lightingType = LT_FLAT;
-      else if(visualisationType == VT_SCENE_SEMANTICPHONG) lightingType = LT_PHONG;
+    renderCache->start_timing(lookupResult);
+  }
 
-      float labelAlpha = visualisationType == VT_SCENE_SEMANTICCOLOUR ? 0.4f : 1.0f;
-      m_voxelVisualisationEngine->FindSurface(scene.get(), &pose, &intrinsics, renderState.get());
-      m_semanticVisualiser->render(scene.get(), &pose, &intrinsics, renderState.get(), labelColours, lightingType, labelAlpha, renderState->raycastImage);
+  switch(lookupResult)
+  {
+    case VoxelRenderCache::LR_HIT:
+      // The raycast image of the render state already contains the requested visualisation.
       break;
-    }
-    case VT_SCENE_LAMBERTIAN:
+    case VoxelRenderCache::LR_REPROJECT:
+      reproject_voxel_visualisation(scene, pose, intrinsics, renderState, visualisationType, *renderCache);
+      break;
+    case VoxelRenderCache::LR_RESHADE:
+      reshade_voxel_visualisation(renderState, visualisationType, *cacheKey);
+      break;
+    case VoxelRenderCache::LR_MISS:
     default:
-    {
-      m_voxelVisualisationEngine->RenderImage(scene.get(), &pose, &intrinsics, renderState.get(), renderState->raycastImage,
-                                              ITMLib::IITMVisualisationEngine::RENDER_SHADED_GREYSCALE);
+      raycast_voxel_visualisation(scene, pose, intrinsics, renderState, visualisationType, cacheKey);
       break;
-    }
   }
 
   make_postprocessed_cpu_copy(renderState->raycastImage, postprocessor, output);
+
+  if(renderCache) renderCache->record_render(*cacheKey, lookupResult, renderState.get());
 }
 
 void VisualisationGenerator::get_default_raycast(const ITMUChar4Image_Ptr& output, const VoxelRenderState_CPtr& liveRenderState, const boost::optional<Postprocessor>& postprocessor) const
@@ -206,34 +204,131 @@ void VisualisationGenerator::make_postprocessed_cpu_copy(const ITMUChar4Image *i
   // Make sure that the output raycast is of the right size.
   prepare_to_copy_visualisation(inputRaycast->noDims, outputRaycast);
 
-  if(postprocessor)
+  // Copy the input raycast directly into the CPU memory of the output raycast (if we're in CUDA mode, this is the only transfer needed).
+  outputRaycast->SetFrom(
+    inputRaycast,
+    m_settings->deviceType == DEVICE_CUDA ? ORUtils::MemoryBlock<Vector4u>::CUDA_TO_CPU : ORUtils::MemoryBlock<Vector4u>::CPU_TO_CPU
+  );
+
+  // If required, post-process the output raycast in place on the CPU.
+  if(postprocessor) (*postprocessor)(outputRaycast, outputRaycast);
+}
+
+void VisualisationGenerator::prepare_to_copy_visualisation(const Vector2i& inputSize, const ITMUChar4Image_Ptr& output) const
+{
+  output->Clear();
+  output->ChangeDims(inputSize);
+}
+
+void VisualisationGenerator::raycast_voxel_visualisation(const SpaintVoxelScene_CPtr& scene, const ORUtils::SE3Pose& pose, const ITMIntrinsics& intrinsics,
+                                                         const VoxelRenderState_Ptr& renderState, VisualisationType visualisationType,
+                                                         const boost::optional<VoxelRenderCache::Key>& cacheKey) const
+{
+  m_voxelVisualisationEngine->FindVisibleBlocks(scene.get(), &pose, &intrinsics, renderState.get());
+  m_voxelVisualisationEngine->CreateExpectedDepths(scene.get(), &pose, &intrinsics, renderState.get());
+
+  if(is_semantic(visualisationType))
   {
-    // Copy the input raycast to the output raycast on the relevant device (e.g. on the GPU, if that's where the input currently resides).
-    outputRaycast->SetFrom(
-      inputRaycast,
-      m_settings->deviceType == DEVICE_CUDA ? ORUtils::MemoryBlock<Vector4u>::CUDA_TO_CUDA : ORUtils::MemoryBlock<Vector4u>::CPU_TO_CPU
+    if(!m_semanticVisualiser) throw std::runtime_error("Error: This visualisation generator does not support semantic visualisations");
+
+    const std::vector<Vector3u>& labelColours = m_labelManager->get_label_colours();
+    m_voxelVisualisationEngine->FindSurface(scene.get(), &pose, &intrinsics, renderState.get());
+    m_semanticVisualiser->render(
+      scene.get(), &pose, &intrinsics, renderState.get(), labelColours, to_lighting_type(visualisationType), to_label_alpha(visualisationType),
+      renderState->raycastImage, cacheKey
     );
+  }
+  else
+  {
+    m_voxelVisualisationEngine->RenderImage(scene.get(), &pose, &intrinsics, renderState.get(), renderState->raycastImage, to_render_image_type(visualisationType));
+  }
+}
 
-    // Post-process the output raycast.
-    (*postprocessor)(outputRaycast, outputRaycast);
+void VisualisationGenerator::reproject_voxel_visualisation(const SpaintVoxelScene_CPtr& scene, const ORUtils::SE3Pose& pose, const ITMIntrinsics& intrinsics,
+                                                           const VoxelRenderState_Ptr& renderState, VisualisationType visualisationType,
+                                                           VoxelRenderCache& renderCache) const
+{
+  // InfiniTAM's forward projection takes the camera pose from a tracking state and the intrinsics and image size from a view,
+  // so make sure that we have a (suitably-sized) view and tracking state with which to pass them in. Note that the depth image
+  // of the view is left empty, so that every pixel to which no surface point is projected will be raycast.
+  const Vector2i& imgSize = renderState->raycastImage->noDims;
+  View_Ptr& view = renderCache.get_reprojection_view();
+  TrackingState_Ptr& trackingState = renderCache.get_reprojection_tracking_state();
+  if(!view || view->depth->noDims != imgSize)
+  {
+    view.reset(new ITMView(ITMRGBDCalib(), imgSize, imgSize, m_settings->deviceType == DEVICE_CUDA));
+    view->depth->Clear();
+    trackingState.reset(new ITMTrackingState(imgSize, m_settings->GetMemoryType()));
+  }
+
+  view->calib.intrinsics_d = intrinsics;
+  *trackingState->pose_d = pose;
+
+  // Determine the rendering range for the new pose, then forward-project the surface points from the most recent raycast into
+  // the new view and raycast any pixels that are left uncovered.
+  m_voxelVisualisationEngine->FindVisibleBlocks(scene.get(), &pose, &intrinsics, renderState.get());
+  m_voxelVisualisationEngine->CreateExpectedDepths(scene.get(), &pose, &intrinsics, renderState.get());
+  m_voxelVisualisationEngine->ForwardRender(scene.get(), view.get(), trackingState.get(), renderState.get());
+
+  // Shade the forward-projected points to produce the visualisation.
+  m_voxelVisualisationEngine->RenderImage(scene.get(), &pose, &intrinsics, renderState.get(), renderState->raycastImage,
+                                          to_render_image_type(visualisationType), IITMVisualisationEngine::RENDER_FROM_OLD_FORWARDPROJ);
+}
+
+void VisualisationGenerator::reshade_voxel_visualisation(const VoxelRenderState_Ptr& renderState, VisualisationType visualisationType,
+                                                         const VoxelRenderCache::Key& cacheKey) const
+{
+  const std::vector<Vector3u>& labelColours = m_labelManager->get_label_colours();
+  m_semanticVisualiser->reshade(cacheKey, labelColours, to_lighting_type(visualisationType), to_label_alpha(visualisationType), renderState.get());
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 
-    // Transfer the output raycast to the CPU if necessary (if we're in CPU mode, this is a no-op).
-    outputRaycast->UpdateHostFromDevice();
+bool VisualisationGenerator::is_semantic(VisualisationType visualisationType)
+{
+  switch(visualisationType)
+  {
+    case VT_SCENE_SEMANTICCOLOUR:
+    case VT_SCENE_SEMANTICFLAT:
+    case VT_SCENE_SEMANTICLAMBERTIAN:
+    case VT_SCENE_SEMANTICPHONG:
+      return true;
+    default:
+      return false;
   }
-  else
+}
+
+float VisualisationGenerator::to_label_alpha(VisualisationType visualisationType)
+{
+  return visualisationType == VT_SCENE_SEMANTICCOLOUR ? 0.4f : 1.0f;
+}
+
+LightingType VisualisationGenerator::to_lighting_type(VisualisationType visualisationType)
+{
+  switch(visualisationType)
   {
-    // If there is no post-processing to be done, copy the input raycast directly into the CPU memory of the output raycast.
-    outputRaycast->SetFrom(
-      inputRaycast,
-      m_settings->deviceType == DEVICE_CUDA ? ORUtils::MemoryBlock<Vector4u>::CUDA_TO_CPU : ORUtils::MemoryBlock<Vector4u>::CPU_TO_CPU
-    );
+    case VT_SCENE_SEMANTICFLAT:
+      return LT_FLAT;
+    case VT_SCENE_SEMANTICPHONG:
+      return LT_PHONG;
+    case VT_SCENE_SEMANTICLAMBERTIAN:
+    default:
+      return LT_LAMBERTIAN;
   }
 }
 
-void VisualisationGenerator::prepare_to_copy_visualisation(const Vector2i& inputSize, const ITMUChar4Image_Ptr& output) const
+IITMVisualisationEngine::RenderImageType VisualisationGenerator::to_render_image_type(VisualisationType visualisationType)
 {
-  output->Clear();
-  output->ChangeDims(inputSize);
+  switch(visualisationType)
+  {
+    case VT_SCENE_COLOUR:
+      return IITMVisualisationEngine::RENDER_COLOUR_FROM_VOLUME;
+    case VT_SCENE_NORMAL:
+      return IITMVisualisationEngine::RENDER_COLOUR_FROM_NORMAL;
+    case VT_SCENE_LAMBERTIAN:
+    default:
+      return IITMVisualisationEngine::RENDER_SHADED_GREYSCALE;
+  }
 }
 
 }
@@ -0,0 +1,172 @@
+/**
+ * spaint: VoxelRenderCache.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "visualisation/VoxelRenderCache.h"
+
+#include <itmx/geometry/GeometryUtil.h>
+using namespace itmx;
+
+namespace spaint {
+
+//#################### CONSTRUCTORS ####################
+
+VoxelRenderCache::Key::Key(const void *scene_, unsigned int fusionGeneration_, unsigned int labelGeneration_, const ORUtils::SE3Pose& pose_,
+                           const ITMLib::ITMIntrinsics& intrinsics_, const Vector2i& imgSize_, int visualisationType_)
+: fusionGeneration(fusionGeneration_), imgSize(imgSize_), intrinsics(intrinsics_), labelGeneration(labelGeneration_),
+  pose(pose_), scene(scene_), visualisationType(visualisationType_)
+{}
+
+VoxelRenderCache::VoxelRenderCache(bool reprojectionEnabled, double maxReprojectionRotation, float maxReprojectionTranslation)
+: m_hitTimer("Hit"),
+  m_maxReprojectionRotation(maxReprojectionRotation),
+  m_maxReprojectionTranslation(maxReprojectionTranslation),
+  m_missTimer("Miss"),
+  m_renderState(NULL),
+  m_reprojectionEnabled(reprojectionEnabled),
+  m_reprojectionTimer("Reprojection"),
+  m_reshadeTimer("Reshade")
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+boost::chrono::microseconds VoxelRenderCache::Statistics::estimated_saved_time() const
+{
+  // If there have been no full raycasts, we have no basis on which to estimate the time saved.
+  if(missCount == 0) return boost::chrono::microseconds(0);
+
+  typedef boost::chrono::microseconds::rep Rep;
+  boost::chrono::microseconds savedTime = static_cast<Rep>(hitCount) * (averageMissTime - averageHitTime) + static_cast<Rep>(reprojectionCount) * (averageMissTime - averageReprojectionTime) +
+                                              static_cast<Rep>(reshadeCount) * (averageMissTime - averageReshadeTime);
+  return savedTime > boost::chrono::microseconds(0) ? savedTime : boost::chrono::microseconds(0);
+}
+
+double VoxelRenderCache::Statistics::hit_rate() const
+{
+  const size_t requestCount = hitCount + missCount + reprojectionCount + reshadeCount;
+  return requestCount > 0 ? static_cast<double>(hitCount) / requestCount : 0.0;
+}
+
+TrackingState_Ptr& VoxelRenderCache::get_reprojection_tracking_state()
+{
+  return m_reprojectionTrackingState;
+}
+
+View_Ptr& VoxelRenderCache::get_reprojection_view()
+{
+  return m_reprojectionView;
+}
+
+VoxelRenderCache::Statistics VoxelRenderCache::get_statistics() const
+{
+  Statistics stats;
+  stats.averageHitTime = m_hitTimer.count() > 0 ? m_hitTimer.average_duration() : boost::chrono::microseconds(0);
+  stats.averageMissTime = m_missTimer.count() > 0 ? m_missTimer.average_duration() : boost::chrono::microseconds(0);
+  stats.averageReprojectionTime = m_reprojectionTimer.count() > 0 ? m_reprojectionTimer.average_duration() : boost::chrono::microseconds(0);
+  stats.averageReshadeTime = m_reshadeTimer.count() > 0 ? m_reshadeTimer.average_duration() : boost::chrono::microseconds(0);
+  stats.hitCount = m_hitTimer.count();
+  stats.missCount = m_missTimer.count();
+  stats.reprojectionCount = m_reprojectionTimer.count();
+  stats.reshadeCount = m_reshadeTimer.count();
+  return stats;
+}
+
+void VoxelRenderCache::invalidate()
+{
+  m_lastKey.reset();
+  m_referenceKey.reset();
+}
+
+bool VoxelRenderCache::is_reprojection_enabled() const
+{
+  return m_reprojectionEnabled;
+}
+
+VoxelRenderCache::LookupResult VoxelRenderCache::lookup(const Key& key, const ITMLib::ITMRenderState *renderState, bool canReproject) const
+{
+  // If the render state has been replaced since we last used it, its contents are unknown.
+  if(renderState != m_renderState) return LR_MISS;
+
+  // If the image currently stored in the render state is exactly the one requested, it can be reused.
+  if(m_lastKey && same_scene_and_camera(key, *m_lastKey) && key.visualisationType == m_lastKey->visualisationType && same_pose(key.pose, m_lastKey->pose))
+  {
+    return LR_HIT;
+  }
+
+  // Otherwise, if the pose is sufficiently close to that of the last full raycast, and nothing else has changed,
+  // the surface points from that raycast can be forward-projected into the new view.
+  if(m_reprojectionEnabled && canReproject && m_referenceKey && same_scene_and_camera(key, *m_referenceKey) &&
+     GeometryUtil::poses_are_similar(key.pose, m_referenceKey->pose, m_maxReprojectionRotation, m_maxReprojectionTranslation))
+  {
+    return LR_REPROJECT;
+  }
+
+  return LR_MISS;
+}
+
+void VoxelRenderCache::record_render(const Key& key, LookupResult result, const ITMLib::ITMRenderState *renderState)
+{
+  get_timer(result).stop();
+
+  m_lastKey = key;
+  m_renderState = renderState;
+
+  // Note: Reprojection leaves the render state's raycast result untouched, so only a full raycast or a reshade (which copies in the
+  //       raycast result from which the retained surface points were extracted) changes the reference.
+  if(result == LR_MISS || result == LR_RESHADE) m_referenceKey = key;
+}
+
+void VoxelRenderCache::set_reprojection_enabled(bool reprojectionEnabled)
+{
+  m_reprojectionEnabled = reprojectionEnabled;
+}
+
+void VoxelRenderCache::start_timing(LookupResult result)
+{
+  get_timer(result).start();
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+bool VoxelRenderCache::same_pose(const ORUtils::SE3Pose& lhs, const ORUtils::SE3Pose& rhs)
+{
+  const Matrix4f& lhsM = lhs.GetM();
+  const Matrix4f& rhsM = rhs.GetM();
+  for(int i = 0; i < 16; ++i)
+  {
+    if(lhsM.m[i] != rhsM.m[i]) return false;
+  }
+  return true;
+}
+
+bool VoxelRenderCache::same_scene_and_camera(const Key& lhs, const Key& rhs)
+{
+  const Vector4f& lhsParams = lhs.intrinsics.projectionParamsSimple.all;
+  const Vector4f& rhsParams = rhs.intrinsics.projectionParamsSimple.all;
+  return lhs.scene == rhs.scene &&
+         lhs.fusionGeneration == rhs.fusionGeneration &&
+         lhs.labelGeneration == rhs.labelGeneration &&
+         lhs.imgSize == rhs.imgSize &&
+         lhsParams.x == rhsParams.x && lhsParams.y == rhsParams.y && lhsParams.z == rhsParams.z && lhsParams.w == rhsParams.w;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+VoxelRenderCache::AverageTimer& VoxelRenderCache::get_timer(LookupResult result)
+{
+  switch(result)
+  {
+    case LR_HIT:
+      return m_hitTimer;
+    case LR_REPROJECT:
+      return m_reprojectionTimer;
+    case LR_RESHADE:
+      return m_reshadeTimer;
+    case LR_MISS:
+    default:
+      return m_missTimer;
+  }
+}
+
+}
@@ -5,33 +5,152 @@
 
 #include "visualisation/cpu/SemanticVisualiser_CPU.h"
 
-#include "visualisation/shared/SemanticVisualiser_Shared.h"
+#include "surfaces/cpu/SurfaceGBuffer_CPU.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SPAINT_SEMANTIC_USE_SSE2 1
+#else
+  #define SPAINT_SEMANTIC_USE_SSE2 0
+#endif
 
 namespace spaint {
 
+//#################### LOCAL FUNCTIONS ####################
+
+/**
+ * \brief Computes the colour for a pixel in a semantic visualisation of the scene from a previously-extracted surface point,
+ *        using a table of premultiplied label colours.
+ *
+ * This produces the same result as shade_semantic_surface_point: the blended colour is rounded to the nearest integer (as
+ * toUChar does), and the shaded colour is then truncated.
+ *
+ * \param dest              A location into which to write the computed colour.
+ * \param surfacePoint      The surface point extracted for the pixel.
+ * \param labelColourTable  The table of premultiplied label colours.
+ * \param sceneWeight       The weight with which the voxel's scene colour contributes to the colour of the pixel.
+ * \param lightingType      The type of lighting to use.
+ */
+inline void shade_semantic_surface_point_from_table(Vector4u& dest, const SemanticSurfacePoint& surfacePoint, const Vector4f *labelColourTable,
+                                                    float sceneWeight, LightingType lightingType)
+{
+  if(!surfacePoint.valid)
+  {
+    dest = Vector4u((uchar)0);
+    return;
+  }
+
+  const float intensity = semantic_intensity(surfacePoint, lightingType);
+  const Vector4f& labelColour = labelColourTable[surfacePoint.label];
+  const Vector3u& sceneColour = surfacePoint.sceneColour;
+
+#if SPAINT_SEMANTIC_USE_SSE2
+  // Blend the label and scene colours and round the result, then scale it by the intensity and truncate, all four channels at once.
+  __m128 colour = _mm_add_ps(_mm_loadu_ps(labelColour.v), _mm_mul_ps(_mm_set1_ps(sceneWeight), _mm_setr_ps(sceneColour.x, sceneColour.y, sceneColour.z, 0.0f)));
+  colour = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(colour, _mm_set1_ps(0.5f))));
+  __m128i shaded = _mm_cvttps_epi32(_mm_mul_ps(_mm_set1_ps(intensity), colour));
+
+  // Pack the channels into bytes and make the pixel opaque.
+  shaded = _mm_packs_epi32(shaded, shaded);
+  shaded = _mm_packus_epi16(shaded, shaded);
+  const int rgba = _mm_cvtsi128_si32(shaded) | static_cast<int>(0xFF000000);
+  memcpy(&dest, &rgba, sizeof(int));
+#else
+  for(int i = 0; i < 3; ++i)
+  {
+    const int colour = static_cast<int>(labelColour.v[i] + sceneWeight * sceneColour.v[i] + 0.5f);
+    dest.v[i] = (uchar)(intensity * colour);
+  }
+  dest.w = 255;
+#endif
+}
+
 //#################### CONSTRUCTORS ####################
 
-SemanticVisualiser_CPU::SemanticVisualiser_CPU(size_t maxLabelCount)
-: SemanticVisualiser(maxLabelCount)
+SemanticVisualiser_CPU::RetainedSurface::RetainedSurface()
+: lastUsed(0)
+{}
+
+SemanticVisualiser_CPU::SemanticVisualiser_CPU(size_t maxLabelCount, size_t retainedSurfaceCount)
+: SemanticVisualiser(maxLabelCount), m_labelColourTable(maxLabelCount), m_retainedSurfaces(retainedSurfaceCount), m_useCount(0)
 {}
 
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+bool SemanticVisualiser_CPU::has_surface(const VoxelRenderCache::Key& surfaceKey) const
+{
+  return find_retained_surface(surfaceKey) != NULL;
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+SemanticVisualiser_CPU::RetainedSurface *SemanticVisualiser_CPU::find_retained_surface(const VoxelRenderCache::Key& surfaceKey) const
+{
+  // Note: The visualisation type is deliberately ignored, since the surface can be used for any type of semantic visualisation.
+  for(size_t i = 0, size = m_retainedSurfaces.size(); i < size; ++i)
+  {
+    const boost::optional<VoxelRenderCache::Key>& key = m_retainedSurfaces[i].key;
+    if(key && VoxelRenderCache::same_scene_and_camera(surfaceKey, *key) && VoxelRenderCache::same_pose(surfaceKey.pose, key->pose))
+    {
+      return &m_retainedSurfaces[i];
+    }
+  }
+
+  return NULL;
+}
+
 void SemanticVisualiser_CPU::render_internal(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
-                                             LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const
+                                             LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage,
+                                             const boost::optional<VoxelRenderCache::Key>& surfaceKey) const
 {
   // Calculate the light and viewer positions in voxel coordinates (the same coordinate space as the raycast results).
   const float voxelSize = scene->sceneParams->voxelSize;
   Vector3f lightPos = Vector3f(0.0f, -10.0f, -10.0f) / voxelSize;
   Vector3f viewerPos = Vector3f(pose->GetInvM().getColumn(3)) / voxelSize;
 
-  // Shade all of the pixels in the image.
+  // If the key of the view is known, retain its surface (overwriting either the surface that already corresponds to this view,
+  // or failing that the least recently used one), and then shade the retained surface to produce the visualisation.
+  if(surfaceKey && !m_retainedSurfaces.empty())
+  {
+    RetainedSurface *surface = find_retained_surface(*surfaceKey);
+    if(!surface)
+    {
+      surface = &m_retainedSurfaces[0];
+      for(size_t i = 1, size = m_retainedSurfaces.size(); i < size; ++i)
+      {
+        if(m_retainedSurfaces[i].lastUsed < surface->lastUsed) surface = &m_retainedSurfaces[i];
+      }
+    }
+
+    surface->key = *surfaceKey;
+    surface->lastUsed = ++m_useCount;
+    surface->lightPos = lightPos;
+    surface->viewerPos = viewerPos;
+
+    // Copy the raycast result, since the render state's raycast result will be overwritten the next time it is used to render another view.
+    const ITMFloat4Image *raycastResult = renderState->raycastResult;
+    if(!surface->raycastResult) surface->raycastResult.reset(new ITMFloat4Image(raycastResult->noDims, true, false));
+    else surface->raycastResult->ChangeDims(raycastResult->noDims);
+    surface->raycastResult->SetFrom(raycastResult, ORUtils::MemoryBlock<Vector4f>::CPU_TO_CPU);
+
+    // Look up the attributes of the voxels in the raycast result.
+    if(!surface->gbuffer) surface->gbuffer.reset(new SurfaceGBuffer_CPU);
+    surface->gbuffer->update(surface->raycastResult.get(), scene, SurfaceGBuffer::SGA_COLOURS | SurfaceGBuffer::SGA_NORMALS);
+
+    shade_retained_surface(*surface, lightingType, labelAlpha, outputImage);
+    return;
+  }
+
+  // Otherwise, extract the surface point for each pixel in the image and shade it, in a single pass.
   int imgSize = outputImage->noDims.x * outputImage->noDims.y;
+  const float sceneWeight = update_label_colour_table(labelAlpha);
+  const Vector4f *labelColourTable = &m_labelColourTable[0];
   Vector4u *outRendering = outputImage->GetData(MEMORYDEVICE_CPU);
   const Vector4f *pointsRay = renderState->raycastResult->GetData(MEMORYDEVICE_CPU);
   const SpaintVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
   const ITMVoxelIndex::IndexData *voxelIndex = scene->index.getIndexData();
-  const Vector3u *labelColours = m_labelColoursMB->GetData(MEMORYDEVICE_CPU);
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
@@ -39,8 +158,72 @@ void SemanticVisualiser_CPU::render_internal(const SpaintVoxelScene *scene, cons
   for (int locId = 0; locId < imgSize; ++locId)
   {
     Vector4f ptRay = pointsRay[locId];
-    shade_pixel_semantic(outRendering[locId], ptRay.toVector3(), ptRay.w > 0, voxelData, voxelIndex, labelColours, viewerPos, lightPos, lightingType, labelAlpha);
+    SemanticSurfacePoint surfacePoint;
+    extract_semantic_surface_point(surfacePoint, ptRay.toVector3(), ptRay.w > 0, voxelData, voxelIndex, viewerPos, lightPos);
+    shade_semantic_surface_point_from_table(outRendering[locId], surfacePoint, labelColourTable, sceneWeight, lightingType);
   }
 }
 
+void SemanticVisualiser_CPU::reshade_internal(const VoxelRenderCache::Key& surfaceKey, LightingType lightingType, float labelAlpha, ITMLib::ITMRenderState *renderState) const
+{
+  RetainedSurface *surface = find_retained_surface(surfaceKey);
+  surface->lastUsed = ++m_useCount;
+
+  // Copy the retained raycast result into the render state, so that its raycast result corresponds to the image we are about to render.
+  renderState->raycastResult->ChangeDims(surface->raycastResult->noDims);
+  renderState->raycastResult->SetFrom(surface->raycastResult.get(), ORUtils::MemoryBlock<Vector4f>::CPU_TO_CPU);
+
+  shade_retained_surface(*surface, lightingType, labelAlpha, renderState->raycastImage);
+}
+
+void SemanticVisualiser_CPU::shade_retained_surface(const RetainedSurface& surface, LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const
+{
+  const float sceneWeight = update_label_colour_table(labelAlpha);
+  const Vector4f *labelColourTable = &m_labelColourTable[0];
+  const Vector3u *colours = surface.gbuffer->get_colours().GetData(MEMORYDEVICE_CPU);
+  const Vector3f *normals = surface.gbuffer->get_normals().GetData(MEMORYDEVICE_CPU);
+  const SpaintVoxel::PackedLabel *packedLabels = surface.gbuffer->get_packed_labels().GetData(MEMORYDEVICE_CPU);
+  const Vector4f *pointsRay = surface.raycastResult->GetData(MEMORYDEVICE_CPU);
+  const int *voxelAddresses = surface.gbuffer->get_voxel_addresses().GetData(MEMORYDEVICE_CPU);
+  Vector4u *outRendering = outputImage->GetData(MEMORYDEVICE_CPU);
+  const int imgSize = static_cast<int>(surface.raycastResult->dataSize);
+
+  // Shade the surface point for each pixel in the image (the intensities are only needed if the lighting depends on the surface).
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for (int locId = 0; locId < imgSize; ++locId)
+  {
+    const Vector4f& ptRay = pointsRay[locId];
+    SemanticSurfacePoint surfacePoint;
+    surfacePoint.valid = ptRay.w > 0;
+    if(surfacePoint.valid)
+    {
+      surfacePoint.label = packedLabels[locId].label;
+      surfacePoint.sceneColour = SpaintVoxel::hasColorInformation ? colours[locId] : Vector3u((uchar)0);
+      if(lightingType != LT_FLAT)
+      {
+        compute_semantic_intensities(surfacePoint, ptRay.toVector3(), voxelAddresses[locId] >= 0, normals[locId], surface.viewerPos, surface.lightPos);
+      }
+    }
+
+    shade_semantic_surface_point_from_table(outRendering[locId], surfacePoint, labelColourTable, sceneWeight, lightingType);
+  }
+}
+
+float SemanticVisualiser_CPU::update_label_colour_table(float labelAlpha) const
+{
+  // If the voxels have no colour information, the pixel colours are based solely on the labels.
+  if(!SpaintVoxel::hasColorInformation) labelAlpha = 1.0f;
+
+  const Vector3u *labelColours = m_labelColoursMB->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0, size = m_labelColourTable.size(); i < size; ++i)
+  {
+    const Vector3f labelColour = labelAlpha * labelColours[i].toFloat();
+    m_labelColourTable[i] = Vector4f(labelColour.x, labelColour.y, labelColour.z, 0.0f);
+  }
+
+  return 1.0f - labelAlpha;
+}
+
 }
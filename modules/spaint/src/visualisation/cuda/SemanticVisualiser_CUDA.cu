@@ -5,6 +5,8 @@
 
 #include "visualisation/cuda/SemanticVisualiser_CUDA.h"
 
+#include <stdexcept>
+
 #include "visualisation/shared/SemanticVisualiser_Shared.h"
 
 namespace spaint {
@@ -28,10 +30,19 @@ SemanticVisualiser_CUDA::SemanticVisualiser_CUDA(size_t maxLabelCount)
 : SemanticVisualiser(maxLabelCount)
 {}
 
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+bool SemanticVisualiser_CUDA::has_surface(const VoxelRenderCache::Key& surfaceKey) const
+{
+  // The CUDA implementation shades each pixel directly from the raycast result and does not retain any surface points.
+  return false;
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
 void SemanticVisualiser_CUDA::render_internal(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
-                                              LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const
+                                              LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage,
+                                              const boost::optional<VoxelRenderCache::Key>& surfaceKey) const
 {
   // Calculate the light and viewer positions in voxel coordinates (the same coordinate space as the raycast results).
   const float voxelSize = scene->sceneParams->voxelSize;
@@ -58,4 +69,10 @@ void SemanticVisualiser_CUDA::render_internal(const SpaintVoxelScene *scene, con
   );
 }
 
+void SemanticVisualiser_CUDA::reshade_internal(const VoxelRenderCache::Key& surfaceKey, LightingType lightingType, float labelAlpha, ITMLib::ITMRenderState *renderState) const
+{
+  // This can never be called, since has_surface always returns false.
+  throw std::runtime_error("Error: The CUDA semantic visualiser does not retain surface points");
+}
+
 }
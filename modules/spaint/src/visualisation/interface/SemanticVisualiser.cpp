@@ -5,6 +5,8 @@
 
 #include "visualisation/interface/SemanticVisualiser.h"
 
+#include <stdexcept>
+
 #include <itmx/base/MemoryBlockFactory.h>
 using itmx::MemoryBlockFactory;
 
@@ -23,18 +25,34 @@ SemanticVisualiser::~SemanticVisualiser() {}
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 void SemanticVisualiser::render(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
-                                const std::vector<Vector3u>& labelColours, LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage) const
+                                const std::vector<Vector3u>& labelColours, LightingType lightingType, float labelAlpha, ITMUChar4Image *outputImage,
+                                const boost::optional<VoxelRenderCache::Key>& surfaceKey) const
+{
+  // Render using the new label colours.
+  update_label_colours(labelColours);
+  render_internal(scene, pose, intrinsics, renderState, lightingType, labelAlpha, outputImage, surfaceKey);
+}
+
+void SemanticVisualiser::reshade(const VoxelRenderCache::Key& surfaceKey, const std::vector<Vector3u>& labelColours, LightingType lightingType, float labelAlpha,
+                                 ITMLib::ITMRenderState *renderState) const
+{
+  if(!has_surface(surfaceKey)) throw std::runtime_error("Error: Cannot reshade a view whose surface points have not been retained");
+
+  // Reshade using the new label colours.
+  update_label_colours(labelColours);
+  reshade_internal(surfaceKey, lightingType, labelAlpha, renderState);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SemanticVisualiser::update_label_colours(const std::vector<Vector3u>& labelColours) const
 {
-  // Update the label colours in the memory block.
   Vector3u *labelColoursData = m_labelColoursMB->GetData(MEMORYDEVICE_CPU);
   for(size_t i = 0, size = std::min(m_labelColoursMB->dataSize, labelColours.size()); i < size; ++i)
   {
     labelColoursData[i] = labelColours[i];
   }
   m_labelColoursMB->UpdateDeviceFromHost();
-
-  // Render using the new label colours.
-  render_internal(scene, pose, intrinsics, renderState, lightingType, labelAlpha, outputImage);
 }
 
 }
@@ -58,6 +58,16 @@ public:
    * \return  A short description of what the command does.
    */
   const std::string& get_description() const;
+
+  /**
+   * \brief Gets the amount of memory (in bytes) used by the command to store the state it needs to be undone/redone.
+   *
+   * This is used by the command manager to keep the command history within a memory budget. Commands whose state is
+   * trivially small can rely on the default implementation, which returns 0.
+   *
+   * \return The amount of memory used by the command to store its undo/redo state.
+   */
+  virtual size_t get_memory_usage() const;
 };
 
 //#################### TYPEDEFS ####################
@@ -8,6 +8,7 @@
 
 #include <climits>
 #include <deque>
+#include <limits>
 #include <map>
 
 #include "Command.h"
@@ -24,6 +25,9 @@ private:
   /** A stack containing commands that have been executed and not undone. */
   std::deque<Command_CPtr> m_executed;
 
+  /** The maximum amount of memory (in bytes) that the commands in the command history may use to store their undo/redo state. */
+  size_t m_maxHistoryMemoryUsage;
+
   /** The maximum size of the command history (the maximum combined size of the two command stacks). */
   size_t m_maxHistorySize;
 
@@ -35,9 +39,15 @@ public:
   /**
    * \brief Constructs a command manager.
    *
-   * \param maxHistorySize  The maximum size of the command history (the maximum combined size of the two command stacks).
+   * The command history is limited both by the number of commands it contains and by the amount of memory those commands
+   * use to store their undo/redo state (see Command::get_memory_usage). Whenever executing a command would exceed either
+   * limit, the oldest commands are discarded to make room. The most recently executed command is always retained, even
+   * if it exceeds the memory budget on its own, so that it is always possible to undo the last thing that was done.
+   *
+   * \param maxHistorySize         The maximum size of the command history (the maximum combined size of the two command stacks).
+   * \param maxHistoryMemoryUsage  The maximum amount of memory (in bytes) that the commands in the command history may use.
    */
-  explicit CommandManager(size_t maxHistorySize = INT_MAX);
+  explicit CommandManager(size_t maxHistorySize = INT_MAX, size_t maxHistoryMemoryUsage = std::numeric_limits<size_t>::max());
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -85,6 +95,13 @@ public:
    */
   size_t executed_count() const;
 
+  /**
+   * \brief Gets the amount of memory (in bytes) currently used by the commands in the command history.
+   *
+   * \return  The amount of memory currently used by the commands in the command history.
+   */
+  size_t history_memory_usage() const;
+
   /**
    * \brief Redoes the last command undone, if any.
    */
@@ -109,6 +126,11 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Discards the oldest executed commands as necessary to bring the command history back within its memory budget.
+   */
+  void enforce_memory_budget();
+
   /**
    * \brief Makes space for a new command if the command history is full.
    */
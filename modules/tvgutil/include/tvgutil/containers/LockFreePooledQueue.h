@@ -0,0 +1,724 @@
+/**
+ * tvgutil: LockFreePooledQueue.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_LOCKFREEPOOLEDQUEUE
+#define H_TVGUTIL_LOCKFREEPOOLEDQUEUE
+
+#include <algorithm>
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/functional/value_factory.hpp>
+#include <boost/optional.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "PooledQueue.h"
+#include "../misc/EventCount.h"
+
+namespace tvgutil {
+
+namespace pooled_queue {
+
+/**
+ * \brief The values of this enumeration can be used to specify how many threads may push elements onto a lock-free pooled queue at once.
+ */
+enum ProducerMode
+{
+  /** Only a single thread will ever push elements onto the queue. */
+  PM_SINGLE,
+
+  /** Multiple threads may push elements onto the queue concurrently. */
+  PM_MULTIPLE
+};
+
+}
+
+/**
+ * \brief An instance of an instantiation of this class template represents a lock-free queue that is backed by a fixed-capacity pool of reusable elements.
+ *
+ * This has the same interface (and supports the same pool empty strategies) as PooledQueue, but rather than guarding a list and a pool with a single
+ * mutex, it stores both the queue and the pool in fixed-capacity ring buffers that are accessed using atomic operations. The queue supports a single
+ * consumer (i.e. only one thread may call peek and pop), together with either a single producer or multiple producers (as specified by the template
+ * argument). Threads that need to block (the consumer waiting for the queue to become non-empty, or producers waiting for the pool to become non-empty
+ * when using the 'wait' strategy) spin briefly and then sleep on an event count (a futex on Linux), so no mutex is ever involved in a hand-off.
+ *
+ * Random replacement is O(1): a producer that finds the pool empty claims a random element in the queue by atomically marking its slot as stolen.
+ * The consumer pins the element at the front of the queue when it peeks at it, so that element can never be stolen. Stolen slots continue to occupy
+ * space in the queue's ring buffer until the front of the queue advances past them (which both the consumer and producers do whenever they find
+ * stolen slots at the front of the queue). If the ring buffer fills up with stolen slots (which can only happen if the consumer makes no progress
+ * for a while), a producer replaces the element at the front of the queue instead of a random one, since this allows the front of the queue to
+ * advance. If that element has been pinned by the consumer, the new element is discarded.
+ *
+ * Since the pool has a fixed capacity, the 'grow' strategy can only grow the pool up to a maximum capacity that is specified when the queue is
+ * initialised. Once that capacity has been reached, it behaves like the 'wait' strategy.
+ */
+template <typename T, pooled_queue::ProducerMode Mode = pooled_queue::PM_SINGLE>
+class LockFreePooledQueue
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this class can be used to handle the process of pushing an element onto the queue.
+   */
+  class PushHandler
+  {
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /** A pointer to the pooled queue on which push was called. */
+    LockFreePooledQueue<T,Mode> *m_base;
+
+    /** The element that is to be pushed onto the queue (if any). */
+    boost::optional<T> m_elt;
+
+    //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Constructs a push handler.
+     *
+     * \param base  A pointer to the pooled queue on which push was called.
+     * \param elt   The element that is to be pushed onto the queue (if any).
+     */
+    PushHandler(LockFreePooledQueue<T,Mode> *base, const boost::optional<T>& elt)
+    : m_base(base), m_elt(elt)
+    {}
+
+    //~~~~~~~~~~~~~~~~~~~~ DESTRUCTOR ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Completes the push by pushing the element (if any) onto the queue.
+     */
+    ~PushHandler()
+    {
+      if(m_elt) m_base->end_push(*m_elt);
+    }
+
+    //~~~~~~~~~~~~~~~~~~~~ COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ~~~~~~~~~~~~~~~~~~~~
+  private:
+    // Deliberately private and unimplemented.
+    PushHandler(const PushHandler&);
+    PushHandler& operator=(const PushHandler&);
+
+    //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Gets a reference to the element that is to be pushed onto the queue (if any).
+     *
+     * \return  A reference to the element that is to be pushed onto the queue (if any).
+     */
+    boost::optional<T&> get()
+    {
+      return m_elt ? boost::optional<T&>(*m_elt) : boost::none;
+    }
+  };
+
+private:
+  /**
+   * \brief The values of this enumeration denote the possible states of a slot in the queue's ring buffer.
+   */
+  enum SlotState
+  {
+    /** The slot does not contain an element. */
+    SS_EMPTY,
+
+    /** The slot contains an element that can be popped or stolen. */
+    SS_READY,
+
+    /** The slot contains the element at the front of the queue, which the consumer has pinned. */
+    SS_PINNED,
+
+    /** The element in the slot is in the process of being stolen by a producer. */
+    SS_STEALING,
+
+    /** The element in the slot has been stolen by a producer, and the consumer should skip the slot. */
+    SS_STOLEN
+  };
+
+  /**
+   * \brief An instance of this struct represents a slot in a ring buffer.
+   */
+  struct Slot
+  {
+    /** The element in the slot. */
+    T elt;
+
+    /** The sequence number of the slot (used to determine whether the slot is ready to be written or read at a given position). */
+    boost::atomic<size_t> sequence;
+
+    /** The state of the slot (only used for the queue's ring buffer). */
+    boost::atomic<int> state;
+  };
+
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::shared_ptr<PushHandler> PushHandler_Ptr;
+
+  //#################### CONSTANTS ####################
+private:
+  /** The size of a cache line (used to prevent the producer and consumer positions from sharing a cache line). */
+  enum { CACHE_LINE_SIZE = 64 };
+
+  /** The number of random slots to try when attempting to steal an element from the queue. */
+  enum { MAX_STEAL_ATTEMPTS = 4 };
+
+  /** The number of times to poll before going to sleep when blocking. */
+  enum { SPIN_COUNT = 256 };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of elements that currently exist (in the pool, the queue or in the hands of producers). */
+  boost::atomic<size_t> m_elementCount;
+
+  /** A function that can be used to construct new elements (by default, the default constructor for the element type). */
+  boost::function<T()> m_maker;
+
+  /** The maximum number of elements that can exist at any one time. */
+  size_t m_maxElementCount;
+
+  /** The pool's ring buffer. */
+  boost::scoped_array<Slot> m_pool;
+
+  /** A strategy specifying what should happen when a push is attempted while the pool is empty. */
+  pooled_queue::PoolEmptyStrategy m_poolEmptyStrategy;
+
+  /** A mask used to map positions in the pool to slots in the pool's ring buffer. */
+  size_t m_poolMask;
+
+  /** An event count used to wait for the pool to become non-empty. */
+  EventCount m_poolNonEmpty;
+
+  /** The queue's ring buffer. */
+  boost::scoped_array<Slot> m_queue;
+
+  /** A mask used to map positions in the queue to slots in the queue's ring buffer. */
+  size_t m_queueMask;
+
+  /** An event count used to wait for the queue to become non-empty. */
+  mutable EventCount m_queueNonEmpty;
+
+  /** The number of elements in the queue (this can transiently be negative whilst elements are being pushed and stolen). */
+  boost::atomic<long> m_queueSize;
+
+  /** A counter used to generate the random positions of the elements to steal from the queue. */
+  boost::atomic<size_t> m_stealCounter;
+
+  char m_padding1[CACHE_LINE_SIZE];
+
+  /** The position in the pool from which the next element will be taken. */
+  boost::atomic<size_t> m_poolHead;
+
+  char m_padding2[CACHE_LINE_SIZE];
+
+  /** The position in the pool at which the next element will be returned. */
+  boost::atomic<size_t> m_poolTail;
+
+  char m_padding3[CACHE_LINE_SIZE];
+
+  /** The position in the queue of the element at the front of the queue (only ever modified by the consumer, but read by producers). */
+  mutable boost::atomic<size_t> m_queueHead;
+
+  /** Whether or not the consumer has pinned the element at the front of the queue. */
+  mutable bool m_queueHeadPinned;
+
+  char m_padding4[CACHE_LINE_SIZE];
+
+  /** The position in the queue at which the next element will be pushed. */
+  boost::atomic<size_t> m_queueTail;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a lock-free pooled queue.
+   *
+   * \param poolEmptyStrategy A strategy specifying what should happen when a push is attempted while the pool is empty.
+   */
+  explicit LockFreePooledQueue(pooled_queue::PoolEmptyStrategy poolEmptyStrategy = pooled_queue::PES_GROW)
+  : m_elementCount(0),
+    m_maxElementCount(0),
+    m_poolEmptyStrategy(poolEmptyStrategy),
+    m_poolMask(0),
+    m_queueMask(0),
+    m_queueSize(0),
+    m_stealCounter(0),
+    m_poolHead(0),
+    m_poolTail(0),
+    m_queueHead(0),
+    m_queueHeadPinned(false),
+    m_queueTail(0)
+  {}
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  LockFreePooledQueue(const LockFreePooledQueue&);
+  LockFreePooledQueue& operator=(const LockFreePooledQueue&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Starts a push operation.
+   *
+   * See PooledQueue::begin_push for details. If multiple producers are not enabled, this must only be called from a single thread.
+   *
+   * \return  A push handler that will handle the process of pushing an element onto the queue.
+   */
+  PushHandler_Ptr begin_push()
+  {
+    using namespace pooled_queue;
+
+    // Try to take an element from the pool. If the pool is empty, we decide what to do based on the pool empty strategy.
+    T elt;
+    if(!try_take_from_pool(elt))
+    {
+      switch(m_poolEmptyStrategy)
+      {
+        case PES_DISCARD:
+        {
+          return PushHandler_Ptr(new PushHandler(this, boost::none));
+        }
+        case PES_GROW:
+        {
+          if(!try_grow_pool(elt)) wait_for_pool(elt);
+          break;
+        }
+        case PES_REPLACE_RANDOM:
+        {
+          if(!try_steal_from_queue(elt) && !try_take_from_pool(elt))
+          {
+            return PushHandler_Ptr(new PushHandler(this, boost::none));
+          }
+          break;
+        }
+        case PES_WAIT:
+        {
+          wait_for_pool(elt);
+          break;
+        }
+      }
+    }
+
+    return PushHandler_Ptr(new PushHandler(this, elt));
+  }
+
+  /**
+   * \brief Gets whether or not the queue is empty.
+   *
+   * \return  true, if the queue is empty, or false otherwise.
+   */
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  /**
+   * \brief Initialises the pool backing the queue.
+   *
+   * Note: This must be called exactly once, before the queue is used by any other thread.
+   *
+   * \param capacity    The initial capacity of the pool.
+   * \param maker       A function that can be used to construct new elements (by default, the default constructor for the element type).
+   * \param maxCapacity The maximum capacity to which the pool can grow if we're using the 'grow' strategy (if 0, four times the initial capacity).
+   */
+  void initialise(size_t capacity, const boost::function<T()>& maker = boost::value_factory<T>(), size_t maxCapacity = 0)
+  {
+    m_maker = maker;
+    m_maxElementCount = capacity;
+    if(m_poolEmptyStrategy == pooled_queue::PES_GROW) m_maxElementCount = std::max(capacity, maxCapacity > 0 ? maxCapacity : 4 * capacity);
+    m_maxElementCount = std::max<size_t>(m_maxElementCount, 1);
+
+    // The pool only ever needs to hold all of the elements. The queue needs additional space for stolen slots that the consumer has yet to skip.
+    const size_t poolSlotCount = round_up_to_power_of_two(m_maxElementCount);
+    const size_t queueSlotCount = round_up_to_power_of_two(2 * m_maxElementCount);
+    m_pool.reset(new Slot[poolSlotCount]);
+    m_poolMask = poolSlotCount - 1;
+    m_queue.reset(new Slot[queueSlotCount]);
+    m_queueMask = queueSlotCount - 1;
+
+    for(size_t i = 0; i < poolSlotCount; ++i) m_pool[i].sequence.store(i, boost::memory_order_relaxed);
+    for(size_t i = 0; i < queueSlotCount; ++i)
+    {
+      m_queue[i].sequence.store(i, boost::memory_order_relaxed);
+      m_queue[i].state.store(SS_EMPTY, boost::memory_order_relaxed);
+    }
+
+    for(size_t i = 0; i < capacity; ++i)
+    {
+      try_return_to_pool(maker());
+    }
+    m_elementCount.store(capacity, boost::memory_order_release);
+  }
+
+  /**
+   * \brief Gets a reference to the first element in the queue.
+   *
+   * Note: This will block until the queue is non-empty. It must only be called from the consumer thread.
+   *
+   * \return  A reference to the first element in the queue.
+   */
+  T& peek()
+  {
+    return wait_for_queue_head()->elt;
+  }
+
+  /**
+   * \brief Gets a reference to the first element in the queue.
+   *
+   * Note: This will block until the queue is non-empty. It must only be called from the consumer thread.
+   *
+   * \return  A reference to the first element in the queue.
+   */
+  const T& peek() const
+  {
+    return wait_for_queue_head()->elt;
+  }
+
+  /**
+   * \brief Pops the first element from the queue and returns it to the pool.
+   *
+   * Note: This will block until the queue is non-empty. It must only be called from the consumer thread.
+   */
+  void pop()
+  {
+    Slot *slot = wait_for_queue_head();
+    T elt = slot->elt;
+    release_queue_head();
+    m_queueSize.fetch_sub(1, boost::memory_order_relaxed);
+
+    try_return_to_pool(elt);
+    m_poolNonEmpty.notify_all();
+  }
+
+  /**
+   * \brief Gets the size of the queue.
+   *
+   * \return  The size of the queue.
+   */
+  size_t size() const
+  {
+    const long queueSize = m_queueSize.load(boost::memory_order_acquire);
+    return queueSize > 0 ? static_cast<size_t>(queueSize) : 0;
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Rounds the specified number up to the nearest power of two.
+   *
+   * \param n The number.
+   * \return  The smallest power of two that is greater than or equal to the number.
+   */
+  static size_t round_up_to_power_of_two(size_t n)
+  {
+    size_t result = 1;
+    while(result < n) result <<= 1;
+    return result;
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Completes a push operation by pushing the specified element onto the queue.
+   *
+   * Note: This is called automatically when the push handler associated with the push is destroyed.
+   *
+   * \param elt The element to be pushed onto the queue.
+   */
+  void end_push(const T& elt)
+  {
+    if(try_push_onto_queue(elt))
+    {
+      m_queueSize.fetch_add(1, boost::memory_order_release);
+      m_queueNonEmpty.notify_all();
+    }
+    else
+    {
+      // The queue's ring buffer is full of stolen slots that have yet to be skipped (this can only happen if several producers
+      // steal elements at once), so discard the element.
+      try_return_to_pool(elt);
+      m_poolNonEmpty.notify_all();
+    }
+  }
+
+  /**
+   * \brief Releases the slot at the front of the queue (after the consumer has popped its element) and advances the front of the queue.
+   *
+   * Note: This is only called by the consumer. Producers can never advance the front of the queue past a pinned slot, so there is no need for a CAS here.
+   */
+  void release_queue_head() const
+  {
+    const size_t head = m_queueHead.load(boost::memory_order_relaxed);
+    Slot& slot = m_queue[head & m_queueMask];
+    slot.state.store(SS_EMPTY, boost::memory_order_relaxed);
+    slot.sequence.store(head + m_queueMask + 1, boost::memory_order_release);
+    m_queueHead.store(head + 1, boost::memory_order_release);
+    m_queueHeadPinned = false;
+  }
+
+  /**
+   * \brief Advances the front of the queue past any stolen slots.
+   *
+   * Note: This can be called by both the consumer and producers.
+   */
+  void skip_stolen_slots() const
+  {
+    for(;;)
+    {
+      size_t head = m_queueHead.load(boost::memory_order_acquire);
+      Slot& slot = m_queue[head & m_queueMask];
+      if(slot.sequence.load(boost::memory_order_acquire) != head + 1 || slot.state.load(boost::memory_order_acquire) != SS_STOLEN) return;
+
+      // Only the thread that succeeds in advancing the front of the queue may release the slot.
+      if(m_queueHead.compare_exchange_strong(head, head + 1, boost::memory_order_acq_rel))
+      {
+        slot.state.store(SS_EMPTY, boost::memory_order_relaxed);
+        slot.sequence.store(head + m_queueMask + 1, boost::memory_order_release);
+      }
+    }
+  }
+
+  /**
+   * \brief Attempts to grow the pool by making a new element.
+   *
+   * \param elt A place into which to write the new element (if any).
+   * \return    true, if a new element was made, or false if the pool has already reached its maximum capacity.
+   */
+  bool try_grow_pool(T& elt)
+  {
+    size_t elementCount = m_elementCount.load(boost::memory_order_relaxed);
+    do
+    {
+      if(elementCount >= m_maxElementCount) return false;
+    }
+    while(!m_elementCount.compare_exchange_weak(elementCount, elementCount + 1, boost::memory_order_relaxed));
+
+    elt = m_maker();
+    return true;
+  }
+
+  /**
+   * \brief Attempts to pin the element at the front of the queue (skipping over any stolen slots).
+   *
+   * Note: This is only called by the consumer.
+   *
+   * \return  The slot containing the element at the front of the queue, if the queue is non-empty, or NULL otherwise.
+   */
+  Slot *try_pin_queue_head() const
+  {
+    for(;;)
+    {
+      const size_t head = m_queueHead.load(boost::memory_order_relaxed);
+      Slot& slot = m_queue[head & m_queueMask];
+      if(m_queueHeadPinned) return &slot;
+
+      // If the slot has not yet been filled, the queue is empty.
+      if(slot.sequence.load(boost::memory_order_acquire) != head + 1) return NULL;
+
+      // Otherwise, try to pin the element in the slot so that it can no longer be stolen.
+      int expected = SS_READY;
+      if(slot.state.compare_exchange_strong(expected, SS_PINNED, boost::memory_order_acquire))
+      {
+        m_queueHeadPinned = true;
+        return &slot;
+      }
+
+      // If that fails, the element has been (or is being) stolen, so wait for the steal to finish and skip the slot.
+      while(slot.state.load(boost::memory_order_acquire) != SS_STOLEN) boost::this_thread::yield();
+      skip_stolen_slots();
+    }
+  }
+
+  /**
+   * \brief Attempts to push an element onto the queue.
+   *
+   * \param elt The element to push.
+   * \return    true, if the element was successfully pushed, or false if the queue's ring buffer was full.
+   */
+  bool try_push_onto_queue(const T& elt)
+  {
+    size_t tail = m_queueTail.load(boost::memory_order_relaxed);
+    Slot *slot;
+    for(;;)
+    {
+      slot = &m_queue[tail & m_queueMask];
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(slot->sequence.load(boost::memory_order_acquire)) - static_cast<std::ptrdiff_t>(tail);
+      if(diff == 0)
+      {
+        // The slot is free. If there's only a single producer, it's ours; otherwise, we need to claim it.
+        if(Mode == pooled_queue::PM_SINGLE)
+        {
+          m_queueTail.store(tail + 1, boost::memory_order_relaxed);
+          break;
+        }
+        else if(m_queueTail.compare_exchange_weak(tail, tail + 1, boost::memory_order_relaxed)) break;
+      }
+      else if(diff < 0) return false;
+      else tail = m_queueTail.load(boost::memory_order_relaxed);
+    }
+
+    // Write the element into the slot, make it available for stealing, and then publish it to the consumer.
+    slot->elt = elt;
+    slot->state.store(SS_READY, boost::memory_order_release);
+    slot->sequence.store(tail + 1, boost::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Attempts to return an element to the pool.
+   *
+   * \param elt The element to return.
+   * \return    true, if the element was successfully returned, or false if the pool's ring buffer was full (this should never happen).
+   */
+  bool try_return_to_pool(const T& elt)
+  {
+    size_t tail = m_poolTail.load(boost::memory_order_relaxed);
+    Slot *slot;
+    for(;;)
+    {
+      slot = &m_pool[tail & m_poolMask];
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(slot->sequence.load(boost::memory_order_acquire)) - static_cast<std::ptrdiff_t>(tail);
+      if(diff == 0)
+      {
+        if(m_poolTail.compare_exchange_weak(tail, tail + 1, boost::memory_order_relaxed)) break;
+      }
+      else if(diff < 0) return false;
+      else tail = m_poolTail.load(boost::memory_order_relaxed);
+    }
+
+    slot->elt = elt;
+    slot->sequence.store(tail + 1, boost::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Attempts to steal a random element from the queue.
+   *
+   * \param elt A place into which to write the stolen element (if any).
+   * \return    true, if an element was stolen, or false otherwise.
+   */
+  bool try_steal_from_queue(T& elt)
+  {
+    skip_stolen_slots();
+
+    for(int attempt = 0; attempt < MAX_STEAL_ATTEMPTS; ++attempt)
+    {
+      // Read the positions of the front and back of the queue. Note that we read the front first, so that the back is guaranteed
+      // to be no earlier than the front.
+      const size_t head = m_queueHead.load(boost::memory_order_acquire);
+      const size_t tail = m_queueTail.load(boost::memory_order_acquire);
+      if(tail <= head) return false;
+
+      // If the ring buffer is full (of elements and stolen slots), target the element at the front of the queue, since stealing it
+      // will allow the front of the queue to advance; otherwise, pick a random position between the front and back of the queue.
+      size_t pos = head;
+      if(tail - head <= m_queueMask)
+      {
+        boost::uint64_t r = m_stealCounter.fetch_add(1, boost::memory_order_relaxed) + 1;
+        r = (r ^ (r >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        r = (r ^ (r >> 27)) * 0x94d049bb133111ebULL;
+        r ^= r >> 31;
+        pos += static_cast<size_t>(r % (tail - head));
+      }
+
+      // Try to claim the element in the slot at that position. This can only succeed if the slot contains a fully-written element that has
+      // not been pinned by the consumer or claimed by another producer. (If the slot has been recycled since we read the positions, we may
+      // end up stealing a more recent element than the one we picked, but that element is equally valid to steal.)
+      Slot& slot = m_queue[pos & m_queueMask];
+      int expected = SS_READY;
+      if(slot.state.compare_exchange_strong(expected, SS_STEALING, boost::memory_order_acquire))
+      {
+        elt = slot.elt;
+        slot.state.store(SS_STOLEN, boost::memory_order_release);
+        m_queueSize.fetch_sub(1, boost::memory_order_relaxed);
+        skip_stolen_slots();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * \brief Attempts to take an element from the pool.
+   *
+   * \param elt A place into which to write the element (if any).
+   * \return    true, if an element was taken, or false if the pool was empty.
+   */
+  bool try_take_from_pool(T& elt)
+  {
+    size_t head = m_poolHead.load(boost::memory_order_relaxed);
+    Slot *slot;
+    for(;;)
+    {
+      slot = &m_pool[head & m_poolMask];
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(slot->sequence.load(boost::memory_order_acquire)) - static_cast<std::ptrdiff_t>(head + 1);
+      if(diff == 0)
+      {
+        if(m_poolHead.compare_exchange_weak(head, head + 1, boost::memory_order_relaxed)) break;
+      }
+      else if(diff < 0) return false;
+      else head = m_poolHead.load(boost::memory_order_relaxed);
+    }
+
+    elt = slot->elt;
+    slot->sequence.store(head + m_poolMask + 1, boost::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Blocks until an element can be taken from the pool, and then takes it.
+   *
+   * \param elt A place into which to write the element.
+   */
+  void wait_for_pool(T& elt)
+  {
+    for(int i = 0; i < SPIN_COUNT; ++i)
+    {
+      if(try_take_from_pool(elt)) return;
+    }
+
+    for(;;)
+    {
+      const int key = m_poolNonEmpty.prepare_wait();
+      if(try_take_from_pool(elt))
+      {
+        m_poolNonEmpty.cancel_wait();
+        return;
+      }
+      m_poolNonEmpty.commit_wait(key);
+    }
+  }
+
+  /**
+   * \brief Blocks until the queue is non-empty, and then pins the element at the front of the queue.
+   *
+   * \return  The slot containing the element at the front of the queue.
+   */
+  Slot *wait_for_queue_head() const
+  {
+    Slot *slot;
+    for(int i = 0; i < SPIN_COUNT; ++i)
+    {
+      if((slot = try_pin_queue_head()) != NULL) return slot;
+    }
+
+    for(;;)
+    {
+      const int key = m_queueNonEmpty.prepare_wait();
+      if((slot = try_pin_queue_head()) != NULL)
+      {
+        m_queueNonEmpty.cancel_wait();
+        return slot;
+      }
+      m_queueNonEmpty.commit_wait(key);
+    }
+  }
+};
+
+}
+
+#endif
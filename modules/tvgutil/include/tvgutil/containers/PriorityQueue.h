@@ -6,14 +6,108 @@
 #ifndef H_TVGUTIL_PRIORITYQUEUE
 #define H_TVGUTIL_PRIORITYQUEUE
 
+#include <algorithm>
+#include <functional>
 #include <map>
 #include <stdexcept>
 #include <vector>
 
+#include <boost/serialization/map.hpp>
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/static_assert.hpp>
 
 namespace tvgutil {
 
+namespace priority_queue {
+
+/**
+ * \brief An instance of an instantiation of this class template maps arbitrary element IDs to the positions of their elements in a priority queue's heap.
+ *
+ * \tparam ID  The element ID type
+ */
+template <typename ID>
+class MapIndex
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  std::map<ID,size_t> m_positions;
+
+  //#################### PUBLIC METHODS ####################
+public:
+  void clear()                            { m_positions.clear(); }
+  bool contains(const ID& id) const       { return m_positions.find(id) != m_positions.end(); }
+  void erase(const ID& id)                { m_positions.erase(id); }
+  size_t get(const ID& id) const          { return m_positions.find(id)->second; }
+  void set(const ID& id, size_t position) { m_positions[id] = position; }
+  size_t size() const                     { return m_positions.size(); }
+};
+
+/**
+ * \brief An instance of an instantiation of this class template maps dense, non-negative integer element IDs to the positions of their
+ *        elements in a priority queue's heap.
+ *
+ * The positions are stored in a flat table indexed by ID, so lookups and updates are O(1) and never allocate (except when the table
+ * needs to grow to accommodate a larger ID than has been seen before). The memory used is proportional to the largest ID seen.
+ *
+ * \tparam ID  The element ID type (must be an integer type)
+ */
+template <typename ID>
+class DenseIndex
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The heap positions of the elements, indexed by ID (-1 denotes an element that is not in the queue). */
+  std::vector<int> m_positions;
+
+  /** The number of elements that are in the queue. */
+  size_t m_size;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  DenseIndex() : m_size(0) {}
+
+  //#################### PUBLIC METHODS ####################
+public:
+  void clear()
+  {
+    std::vector<int>().swap(m_positions);
+    m_size = 0;
+  }
+
+  bool contains(const ID& id) const
+  {
+    return id >= 0 && static_cast<size_t>(id) < m_positions.size() && m_positions[id] >= 0;
+  }
+
+  void erase(const ID& id)
+  {
+    m_positions[id] = -1;
+    --m_size;
+  }
+
+  size_t get(const ID& id) const
+  {
+    return static_cast<size_t>(m_positions[id]);
+  }
+
+  void set(const ID& id, size_t position)
+  {
+    if(id < 0) throw std::runtime_error("A dense priority queue index cannot store negative IDs");
+    if(static_cast<size_t>(id) >= m_positions.size()) m_positions.resize(std::max(static_cast<size_t>(id) + 1, 2 * m_positions.size()), -1);
+    if(m_positions[id] < 0) ++m_size;
+    m_positions[id] = static_cast<int>(position);
+  }
+
+  size_t size() const
+  {
+    return m_size;
+  }
+};
+
+}
+
 /**
  * \brief This is an implementation of priority queues that allows the keys of queue elements to be updated in-place.
  *
@@ -25,15 +119,28 @@ namespace tvgutil {
  * may want to use the standard implementation instead of this one, since it is wasteful to maintain the dictionary
  * for no reason.
  *
- * \tparam ID   The element ID type (used for the lookup)
- * \tparam Key  The key type (the type of the priority values used to determine the element order)
- * \tparam Data The auxiliary data type (any information clients might wish to store with each element)
- * \tparam Comp A predicate specifying how the keys should be compared (the default predicate is std::less<Key>,
- *              which specifies that elements with smaller keys will be extracted first)
+ * The dictionary can be either a tree-based map (the default, which supports arbitrary IDs) or a flat table (which is much
+ * cheaper to maintain, but requires the IDs to be dense, non-negative integers). The heap can also be given an arity other
+ * than 2: a 4-ary heap, for example, is shallower than a binary heap and keeps the children of each element adjacent in
+ * memory, which tends to improve cache behaviour for large queues. Neither choice affects the serialized format, which is
+ * always a map from IDs to positions in a binary heap, so queues can be saved and loaded with any combination of the two.
+ *
+ * Elements with equal keys are extracted in ascending order of their IDs. As a result, the order in which elements are
+ * extracted depends only on their keys and IDs, and not on the arity of the heap or the order in which they were inserted.
+ *
+ * \tparam ID     The element ID type (used for the lookup, and to order elements with equal keys)
+ * \tparam Key    The key type (the type of the priority values used to determine the element order)
+ * \tparam Data   The auxiliary data type (any information clients might wish to store with each element)
+ * \tparam Comp   A predicate specifying how the keys should be compared (the default predicate is std::less<Key>,
+ *                which specifies that elements with smaller keys will be extracted first)
+ * \tparam Index  The type of dictionary used to map IDs to heap positions (priority_queue::MapIndex<ID> or priority_queue::DenseIndex<ID>)
+ * \tparam Arity  The number of children of each node in the heap
  */
-template <typename ID, typename Key, typename Data, typename Comp = std::less<Key> >
+template <typename ID, typename Key, typename Data, typename Comp = std::less<Key>, typename Index = priority_queue::MapIndex<ID>, size_t Arity = 2>
 class PriorityQueue
 {
+  BOOST_STATIC_ASSERT(Arity >= 2);
+
   //#################### NESTED CLASSES ####################
 public:
   /**
@@ -61,7 +168,7 @@ public:
     //~~~~~~~~~~~~~~~~~~~~ SERIALIZATION ~~~~~~~~~~~~~~~~~~~~
 
     template <typename Archive>
-    void serialize(Archive& ar, const unsigned int version)
+    void serialize(Archive& ar, const unsigned int)
     {
       ar & m_id;
       ar & m_key;
@@ -73,9 +180,19 @@ public:
 
   //#################### TYPEDEFS ####################
 private:
-  typedef std::map<ID,size_t> Dictionary; // maps IDs to their current position in the heap
+  typedef Index Dictionary; // maps IDs to their current position in the heap
   typedef std::vector<Element> Heap;
 
+  //#################### NESTED CLASSES ####################
+private:
+  /**
+   * \brief A predicate that orders elements so that the ones that would be extracted first come first.
+   */
+  struct ElementOrder
+  {
+    bool operator()(const Element& lhs, const Element& rhs) const { return comes_before(lhs, rhs); }
+  };
+
   //#################### PRIVATE VARIABLES ####################
 private:
   // Datatype Invariant: m_dictionary.size() == m_heap.size()
@@ -103,7 +220,7 @@ public:
    */
   bool contains(ID id) const
   {
-    return m_dictionary.find(id) != m_dictionary.end();
+    return m_dictionary.contains(id);
   }
 
   /**
@@ -116,7 +233,7 @@ public:
    */
   Element& element(ID id)
   {
-    return m_heap[m_dictionary[id]];
+    return m_heap[m_dictionary.get(id)];
   }
 
   /**
@@ -126,7 +243,7 @@ public:
    */
   bool empty() const
   {
-    return m_dictionary.empty();
+    return m_dictionary.size() == 0;
   }
 
   /**
@@ -140,15 +257,16 @@ public:
    */
   void erase(ID id)
   {
-    size_t i = m_dictionary[id];
+    size_t i = m_dictionary.get(id);
     m_dictionary.erase(id);
-    m_heap[i] = m_heap[m_heap.size()-1];
-    if(m_heap[i].id() != id)	// assuming the element we were erasing wasn't the last one in the heap, update the dictionary
+    if(i != m_heap.size()-1)	// assuming the element we were erasing wasn't the last one in the heap, move the last one into its place
     {
-      m_dictionary[m_heap[i].id()] = i;
+      Element last = m_heap.back();
+      m_heap.pop_back();
+      if(i > 0 && comes_before(last, m_heap[parent(i)])) sift_up(i, last);
+      else sift_down(i, last);
     }
-    m_heap.pop_back();
-    heapify(i);
+    else m_heap.pop_back();
 
     ensure_invariant();
   }
@@ -169,15 +287,7 @@ public:
 
     size_t i = m_heap.size();
     m_heap.resize(i+1);
-    while(i > 0 && Comp()(key, m_heap[parent(i)].key()))
-    {
-      size_t p = parent(i);
-      m_heap[i] = m_heap[p];
-      m_dictionary[m_heap[i].id()] = i;
-      i = p;
-    }
-    m_heap[i] = Element(id, key, data);
-    m_dictionary[id] = i;
+    sift_up(i, Element(id, key, data));
 
     ensure_invariant();
   }
@@ -226,7 +336,7 @@ public:
    */
   void update_key(ID id, const Key& key)
   {
-    size_t i = m_dictionary[id];
+    size_t i = m_dictionary.get(id);
     update_key_at(i, key);
 
     ensure_invariant();
@@ -234,6 +344,22 @@ public:
 
   //#################### PRIVATE METHODS ####################
 private:
+  /**
+   * \brief Determines whether or not one element should be extracted from the priority queue before another.
+   *
+   * Elements are ordered by their keys, and then (to make the order deterministic) by their IDs.
+   *
+   * \param[in] lhs  The first element
+   * \param[in] rhs  The second element
+   * \return         true, if lhs should be extracted before rhs, or false otherwise
+   */
+  inline static bool comes_before(const Element& lhs, const Element& rhs)
+  {
+    if(Comp()(lhs.key(), rhs.key())) return true;
+    if(Comp()(rhs.key(), lhs.key())) return false;
+    return lhs.id() < rhs.id();
+  }
+
   void ensure_invariant()
   {
     if(m_dictionary.size() != m_heap.size())
@@ -242,77 +368,130 @@ private:
     }
   }
 
-  void heapify(size_t i)
+  inline static size_t first_child(size_t i) { return Arity*i + 1; }
+  inline static size_t parent(size_t i)      { return (i-1)/Arity; }
+
+  /**
+   * \brief Moves the specified element down the heap from the specified (vacant) position until the heap property is restored.
+   *
+   * \param[in] i   The vacant position
+   * \param[in] elt The element to place
+   */
+  void sift_down(size_t i, const Element& elt)
   {
-    bool done = false;
-    while(!done)
+    const size_t n = m_heap.size();
+    for(;;)
     {
-      size_t L = left(i), R = right(i);
-      size_t largest = i;
-      if(L < m_heap.size() && Comp()(m_heap[L].key(), m_heap[largest].key()))
-        largest = L;
-      if(R < m_heap.size() && Comp()(m_heap[R].key(), m_heap[largest].key()))
-        largest = R;
-      if(largest != i)
+      // Find the child (if any) that should come first.
+      size_t best = first_child(i);
+      if(best >= n) break;
+      for(size_t c = best + 1, cend = std::min(best + Arity, n); c < cend; ++c)
       {
-        std::swap(m_heap[i], m_heap[largest]);
-        m_dictionary[m_heap[i].id()] = i;
-        m_dictionary[m_heap[largest].id()] = largest;
-        i = largest;
+        if(comes_before(m_heap[c], m_heap[best])) best = c;
       }
-      else done = true;
+
+      // If it should come before the element we're placing, move it up into the vacant position.
+      if(!comes_before(m_heap[best], elt)) break;
+      m_heap[i] = m_heap[best];
+      m_dictionary.set(m_heap[i].id(), i);
+      i = best;
     }
-  }
 
-  inline static size_t left(size_t i)   { return 2*i + 1; }
-  inline static size_t parent(size_t i) { return (i+1)/2 - 1; }
+    m_heap[i] = elt;
+    m_dictionary.set(elt.id(), i);
+  }
 
-  void percolate(size_t i)
+  /**
+   * \brief Moves the specified element up the heap from the specified (vacant) position until the heap property is restored.
+   *
+   * \param[in] i   The vacant position
+   * \param[in] elt The element to place
+   */
+  void sift_up(size_t i, const Element& elt)
   {
-    while(i > 0 && Comp()(m_heap[i].key(), m_heap[parent(i)].key()))
+    while(i > 0 && comes_before(elt, m_heap[parent(i)]))
     {
       size_t p = parent(i);
-      std::swap(m_heap[i], m_heap[p]);
-      m_dictionary[m_heap[i].id()] = i;
-      m_dictionary[m_heap[p].id()] = p;
+      m_heap[i] = m_heap[p];
+      m_dictionary.set(m_heap[i].id(), i);
       i = p;
     }
-  }
 
-  inline static size_t right(size_t i) { return 2*i + 2; }
+    m_heap[i] = elt;
+    m_dictionary.set(elt.id(), i);
+  }
 
   void update_key_at(size_t i, const Key& key)
   {
-    if(Comp()(key, m_heap[i].key()))
-    {
-      // The key has increased.
-      m_heap[i].m_key = key;
-      percolate(i);
-    }
-    else if(Comp()(m_heap[i].key(), key))
-    {
-      // The key has decreased.
-      m_heap[i].m_key = key;
-      heapify(i);
-    }
+    Element elt = m_heap[i];
+    elt.m_key = key;
+
+    // If the element should now come before its parent, move it up the heap; otherwise, move it down the heap as necessary.
+    if(i > 0 && comes_before(elt, m_heap[parent(i)])) sift_up(i, elt);
+    else sift_down(i, elt);
   }
 
 
   //#################### SERIALIZATION #################### 
 private:
   /**
-   * \brief Serializes the priority queue to/from an archive.
+   * \brief Loads the priority queue from an archive.
    *
-   * \param ar      The archive.
-   * \param version The file format version number.
+   * \param ar  The archive.
    */
   template <typename Archive>
-  void serialize(Archive& ar, const unsigned int version)
+  void load(Archive& ar, const unsigned int)
   {
-    ar & m_dictionary;
+    std::map<ID,size_t> dictionary;
+    ar & dictionary;
     ar & m_heap;
+
+    // The saved heap is a binary heap, and may have been saved by a version of this class that did not order elements with
+    // equal keys by their IDs, so rebuild the dictionary and re-establish the heap property for this queue's arity and order.
+    m_dictionary.clear();
+    for(size_t i = 0, size = m_heap.size(); i < size; ++i)
+    {
+      m_dictionary.set(m_heap[i].id(), i);
+    }
+
+    if(m_heap.size() > 1)
+    {
+      for(size_t i = parent(m_heap.size() - 1) + 1; i-- > 0;)
+      {
+        Element elt = m_heap[i];
+        sift_down(i, elt);
+      }
+    }
+
+    ensure_invariant();
+  }
+
+  /**
+   * \brief Saves the priority queue to an archive.
+   *
+   * For compatibility with existing archives, the queue is saved as a map from IDs to positions, followed by a binary heap.
+   * A heap with a different arity is saved in sorted order (which is a valid binary heap).
+   *
+   * \param ar  The archive.
+   */
+  template <typename Archive>
+  void save(Archive& ar, const unsigned int) const
+  {
+    Heap heap(m_heap);
+    if(Arity != 2) std::sort(heap.begin(), heap.end(), ElementOrder());
+
+    std::map<ID,size_t> dictionary;
+    for(size_t i = 0, size = heap.size(); i < size; ++i)
+    {
+      dictionary.insert(std::make_pair(heap[i].id(), i));
+    }
+
+    ar & dictionary;
+    ar & heap;
   }
 
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
   friend class boost::serialization::access;
 };
 
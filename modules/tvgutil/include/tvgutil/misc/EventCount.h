@@ -0,0 +1,88 @@
+/**
+ * tvgutil: EventCount.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_EVENTCOUNT
+#define H_TVGUTIL_EVENTCOUNT
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this class can be used to block threads until a condition that is checked without locking becomes true.
+ *
+ * An event count allows lock-free data structures to put threads to sleep without adding a mutex to their fast paths. A thread
+ * that wants to wait for a condition first calls prepare_wait(), then re-checks the condition, and then either calls cancel_wait()
+ * (if the condition has become true) or commit_wait() (if not). A thread that makes the condition true calls notify_all(), which
+ * is very cheap when there are no waiters.
+ *
+ * On Linux, waiting threads sleep directly on the event count's epoch word using a futex. On other platforms, they fall back to a
+ * condition variable, but the mutex involved is only ever touched on the slow path (i.e. when there are threads to wake up).
+ */
+class EventCount
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The epoch of the event count (incremented each time the waiting threads are notified). */
+  boost::atomic<int> m_epoch;
+
+  /** The number of threads that are currently waiting (or preparing to wait). */
+  boost::atomic<int> m_waiterCount;
+
+#ifndef __linux__
+  /** A condition variable used to put waiting threads to sleep on platforms without futexes. */
+  boost::condition_variable m_epochChanged;
+
+  /** The mutex associated with the condition variable. */
+  boost::mutex m_mutex;
+#endif
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an event count.
+   */
+  EventCount();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  EventCount(const EventCount&);
+  EventCount& operator=(const EventCount&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Cancels a wait that was started with prepare_wait() (because the condition became true in the meantime).
+   */
+  void cancel_wait();
+
+  /**
+   * \brief Blocks until the waiting threads have been notified since the corresponding call to prepare_wait().
+   *
+   * \param key The key returned by the corresponding call to prepare_wait().
+   */
+  void commit_wait(int key);
+
+  /**
+   * \brief Wakes up all of the threads that are waiting on the event count.
+   */
+  void notify_all();
+
+  /**
+   * \brief Starts waiting on the event count.
+   *
+   * The caller must re-check the condition for which it is waiting after calling this function, and must then call either
+   * cancel_wait() or commit_wait().
+   *
+   * \return  A key that must be passed to commit_wait().
+   */
+  int prepare_wait();
+};
+
+}
+
+#endif
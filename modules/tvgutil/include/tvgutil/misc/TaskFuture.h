@@ -0,0 +1,298 @@
+/**
+ * tvgutil: TaskFuture.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TASKFUTURE
+#define H_TVGUTIL_TASKFUTURE
+
+#include <boost/exception_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace tvgutil {
+
+//#################### FORWARD DECLARATIONS ####################
+
+class ThreadPool;
+
+/**
+ * \brief An instance of a class deriving from this one represents the state that is shared between a task that has been submitted to a thread pool
+ *        and the future that refers to it.
+ */
+class TaskStateBase
+{
+  //#################### ENUMERATIONS ####################
+private:
+  /**
+   * \brief The values of this enumeration denote the possible statuses of a task.
+   */
+  enum TaskStatus
+  {
+    TS_PENDING,
+    TS_RUNNING,
+    TS_FINISHED,
+    TS_CANCELLED
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The exception thrown by the task (if any). */
+  boost::exception_ptr m_exception;
+
+  /** A condition variable used to wait for the task to finish (or be cancelled). */
+  mutable boost::condition_variable m_finished;
+
+  /** The mutex used to synchronise access to the task's status. */
+  mutable boost::mutex m_mutex;
+
+  /** The thread pool to which the task was submitted. */
+  ThreadPool *m_pool;
+
+  /** The status of the task. */
+  TaskStatus m_status;
+
+  //#################### CONSTRUCTORS ####################
+protected:
+  /**
+   * \brief Constructs the shared state for a task.
+   *
+   * \param pool  The thread pool to which the task is being submitted.
+   */
+  explicit TaskStateBase(ThreadPool *pool);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the shared state for the task.
+   */
+  virtual ~TaskStateBase();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  TaskStateBase(const TaskStateBase&);
+  TaskStateBase& operator=(const TaskStateBase&);
+
+  //#################### PROTECTED ABSTRACT MEMBER FUNCTIONS ####################
+protected:
+  /**
+   * \brief Executes the task and stores its result.
+   */
+  virtual void execute() = 0;
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Attempts to cancel the task.
+   *
+   * Only a task that has not yet started running can be cancelled.
+   *
+   * \return  true, if the task was successfully cancelled, or false otherwise.
+   */
+  bool cancel();
+
+  /**
+   * \brief Gets whether or not the task has either finished or been cancelled.
+   *
+   * \return  true, if the task has either finished or been cancelled, or false otherwise.
+   */
+  bool is_ready() const;
+
+  /**
+   * \brief Runs the task (unless it has been cancelled), capturing any exception it throws.
+   */
+  void run();
+
+  /**
+   * \brief Blocks until the task has either finished or been cancelled.
+   *
+   * If the calling thread would otherwise have to block, it helps the thread pool by running pending tasks,
+   * which ensures that a task running on the pool can safely wait for another task submitted to the same pool.
+   */
+  void wait() const;
+
+  //#################### PROTECTED MEMBER FUNCTIONS ####################
+protected:
+  /**
+   * \brief Waits for the task to finish, and then rethrows the exception it threw (if any).
+   *
+   * \throws std::runtime_error If the task was cancelled.
+   */
+  void wait_and_rethrow() const;
+};
+
+/**
+ * \brief An instance of an instantiation of this class template represents the shared state for a task that returns a value of type T.
+ */
+template <typename T>
+class TaskState : public TaskStateBase
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef const T& result_type;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The function that performs the task (cleared once it has run). */
+  boost::function<T()> m_func;
+
+  /** The result of the task (if it has finished successfully). */
+  boost::optional<T> m_result;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs the shared state for a task.
+   *
+   * \param pool  The thread pool to which the task is being submitted.
+   * \param func  The function that performs the task.
+   */
+  TaskState(ThreadPool *pool, const boost::function<T()>& func)
+  : TaskStateBase(pool), m_func(func)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Waits for the task to finish, and then gets its result.
+   *
+   * \return                    The result of the task.
+   * \throws std::runtime_error If the task was cancelled.
+   */
+  const T& get() const
+  {
+    wait_and_rethrow();
+    return *m_result;
+  }
+
+  //#################### PROTECTED MEMBER FUNCTIONS ####################
+protected:
+  /** Override */
+  virtual void execute()
+  {
+    m_result = m_func();
+    m_func.clear();
+  }
+};
+
+/**
+ * \brief An instance of this class represents the shared state for a task that does not return a value.
+ */
+template <>
+class TaskState<void> : public TaskStateBase
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef void result_type;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The function that performs the task (cleared once it has run). */
+  boost::function<void()> m_func;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs the shared state for a task.
+   *
+   * \param pool  The thread pool to which the task is being submitted.
+   * \param func  The function that performs the task.
+   */
+  TaskState(ThreadPool *pool, const boost::function<void()>& func)
+  : TaskStateBase(pool), m_func(func)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Waits for the task to finish.
+   *
+   * \throws std::runtime_error If the task was cancelled.
+   */
+  void get() const
+  {
+    wait_and_rethrow();
+  }
+
+  //#################### PROTECTED MEMBER FUNCTIONS ####################
+protected:
+  /** Override */
+  virtual void execute()
+  {
+    m_func();
+    m_func.clear();
+  }
+};
+
+/**
+ * \brief An instance of an instantiation of this class template can be used to wait for (and get the result of) a task that has been submitted to a thread pool.
+ */
+template <typename T>
+class TaskFuture
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The state that is shared with the task. */
+  boost::shared_ptr<TaskState<T> > m_state;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a future that refers to the specified task.
+   *
+   * \param state The state that is shared with the task.
+   */
+  explicit TaskFuture(const boost::shared_ptr<TaskState<T> >& state)
+  : m_state(state)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Attempts to cancel the task (only a task that has not yet started running can be cancelled).
+   *
+   * \return  true, if the task was successfully cancelled, or false otherwise.
+   */
+  bool cancel()
+  {
+    return m_state->cancel();
+  }
+
+  /**
+   * \brief Waits for the task to finish, and then gets its result.
+   *
+   * If the task threw an exception, it will be rethrown here.
+   *
+   * \return                    The result of the task.
+   * \throws std::runtime_error If the task was cancelled.
+   */
+  typename TaskState<T>::result_type get() const
+  {
+    return m_state->get();
+  }
+
+  /**
+   * \brief Gets whether or not the task has either finished or been cancelled.
+   *
+   * \return  true, if the task has either finished or been cancelled, or false otherwise.
+   */
+  bool is_ready() const
+  {
+    return m_state->is_ready();
+  }
+
+  /**
+   * \brief Blocks until the task has either finished or been cancelled.
+   */
+  void wait() const
+  {
+    m_state->wait();
+  }
+};
+
+}
+
+#endif
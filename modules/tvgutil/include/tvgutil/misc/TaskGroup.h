@@ -0,0 +1,125 @@
+/**
+ * tvgutil: TaskGroup.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TASKGROUP
+#define H_TVGUTIL_TASKGROUP
+
+#include <boost/atomic.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+namespace tvgutil {
+
+//#################### FORWARD DECLARATIONS ####################
+
+class ThreadPool;
+
+/**
+ * \brief An instance of this class represents a group of tasks that are run on a thread pool and that can be waited for (or cancelled) together.
+ *
+ * Tasks in a group always run in the thread pool's normal-priority lane. If a task in the group throws an exception, the group is cancelled
+ * (i.e. any of its tasks that have not yet started will be skipped), and the exception is rethrown by wait().
+ */
+class TaskGroup
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A flag indicating whether or not the group has been cancelled. */
+  boost::atomic<bool> m_cancelled;
+
+  /** The first exception thrown by a task in the group since the group was last waited for (if any). */
+  boost::exception_ptr m_exception;
+
+  /** A condition variable used to wait for all of the tasks in the group to finish. */
+  boost::condition_variable m_finished;
+
+  /** The mutex used to synchronise access to the group's task count and exception. */
+  boost::mutex m_mutex;
+
+  /** The number of tasks in the group that have yet to finish. */
+  size_t m_pendingTaskCount;
+
+  /** The thread pool on which to run the tasks. */
+  ThreadPool& m_pool;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a task group whose tasks will be run on the global thread pool.
+   */
+  TaskGroup();
+
+  /**
+   * \brief Constructs a task group whose tasks will be run on the specified thread pool.
+   *
+   * \param pool  The thread pool on which to run the tasks.
+   */
+  explicit TaskGroup(ThreadPool& pool);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the task group.
+   *
+   * \note  Since this waits for all of the tasks in the group to finish, it can block. Any exception thrown by a task is discarded.
+   */
+  ~TaskGroup();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  TaskGroup(const TaskGroup&);
+  TaskGroup& operator=(const TaskGroup&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Cancels the group, i.e. causes any tasks in it that have not yet started to be skipped.
+   *
+   * The group becomes usable again once it has been waited for.
+   */
+  void cancel();
+
+  /**
+   * \brief Gets whether or not the group has been cancelled.
+   *
+   * \return  true, if the group has been cancelled, or false otherwise.
+   */
+  bool is_cancelled() const;
+
+  /**
+   * \brief Adds a task to the group and schedules it to be run on the thread pool.
+   *
+   * \param task  The task.
+   */
+  void run(const boost::function<void()>& task);
+
+  /**
+   * \brief Blocks until all of the tasks in the group have finished (or been skipped).
+   *
+   * While waiting, the calling thread helps the thread pool by running pending tasks. If any task in the group
+   * threw an exception, the first such exception is rethrown once all of the tasks have finished.
+   */
+  void wait();
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs a task in the group (unless the group has been cancelled), and records that it has finished.
+   *
+   * \param task  The task.
+   */
+  void run_task(const boost::function<void()>& task);
+
+  /**
+   * \brief Blocks until all of the tasks in the group have finished (or been skipped), without rethrowing any exception.
+   */
+  void wait_for_tasks();
+};
+
+}
+
+#endif
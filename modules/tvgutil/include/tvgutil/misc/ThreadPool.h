@@ -6,46 +6,157 @@
 #ifndef H_TVGUTIL_THREADPOOL
 #define H_TVGUTIL_THREADPOOL
 
-#include <string>
+#include <algorithm>
+#include <deque>
+#include <vector>
 
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
+#include <boost/utility/result_of.hpp>
 
-#include "../boost/WrappedAsio.h"
+#include "TaskFuture.h"
+#include "TaskGroup.h"
 
 namespace tvgutil {
 
+namespace thread_pool {
+
+//#################### ENUMERATIONS ####################
+
+/**
+ * \brief The values of this enumeration denote the lanes into which tasks can be submitted.
+ */
+enum TaskPriority
+{
+  /** Background tasks (e.g. saving files to disk) are only run when there are no normal tasks waiting, and only on a limited number of threads at once. */
+  TP_BACKGROUND,
+
+  /** Normal tasks (e.g. computation) are run in preference to background tasks. */
+  TP_NORMAL
+};
+
+}
+
 /**
  * \brief An instance of this class represents a pool of threads that can be used to asynchronously execute arbitrary tasks.
+ *
+ * The pool is a work-stealing scheduler. Each thread has its own deque of tasks: normal tasks submitted from one of the pool's
+ * threads are pushed onto (and popped from) the back of that thread's deque, whilst idle threads steal tasks from the fronts
+ * of other threads' deques. Normal tasks submitted from other threads go into a shared FIFO queue. Background tasks go into a
+ * separate FIFO queue, and are only run when no normal tasks are waiting, and on at most half of the pool's threads at once,
+ * so that long-running I/O cannot starve computation.
+ *
+ * Threads that wait for a task group or future help the pool by running pending normal tasks, so tasks running on the pool
+ * can safely wait for other tasks (e.g. in nested calls to parallel_for).
  */
 class ThreadPool
 {
+  //#################### TYPEDEFS ####################
+private:
+  typedef boost::function<void()> Job;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of an instantiation of this struct template can be used to run a loop body over a range of indices.
+   */
+  template <typename Body>
+  struct RangeJob
+  {
+    /** The loop body. */
+    const Body *body;
+
+    /** The first index in the range. */
+    size_t first;
+
+    /** One past the last index in the range. */
+    size_t last;
+
+    RangeJob(const Body *body_, size_t first_, size_t last_)
+    : body(body_), first(first_), last(last_)
+    {}
+
+    void operator()() const
+    {
+      (*body)(first, last);
+    }
+  };
+
+  /**
+   * \brief An instance of this struct represents one of the threads in the pool.
+   */
+  struct Worker
+  {
+    /** The mutex used to synchronise access to the worker's deque. */
+    boost::mutex mutex;
+
+    /** The worker's deque of normal tasks. */
+    std::deque<Job> tasks;
+  };
+
+  typedef boost::shared_ptr<Worker> Worker_Ptr;
+
+  //#################### PRIVATE STATIC VARIABLES ####################
+private:
+  /** The number of threads with which the global instance of the pool should be constructed (0 = one per hardware thread). */
+  static size_t s_defaultThreadCount;
+
   //#################### PRIVATE MEMBER VARIABLES ####################
 private:
-  /** An I/O service used to schedule work for the threads. */
-  boost::asio::io_service m_scheduler;
+  /** The number of background tasks that are currently running. */
+  boost::atomic<size_t> m_activeBackgroundTaskCount;
+
+  /** The queue of background tasks. */
+  std::deque<Job> m_backgroundTasks;
+
+  /** The queue of normal tasks that were submitted from threads outside the pool. */
+  std::deque<Job> m_injectedTasks;
+
+  /** The mutex used to synchronise access to the queue of background tasks and the queue of injected normal tasks. */
+  boost::mutex m_injectionMutex;
+
+  /** The maximum number of background tasks that can be running at once. */
+  size_t m_maxActiveBackgroundTaskCount;
+
+  /** The number of background tasks that are waiting to be run. */
+  boost::atomic<size_t> m_pendingBackgroundTaskCount;
+
+  /** The number of normal tasks that are waiting to be run. */
+  boost::atomic<size_t> m_pendingNormalTaskCount;
+
+  /** The mutex used to synchronise the threads' sleeping and waking. */
+  boost::mutex m_sleepMutex;
+
+  /** A flag indicating whether or not the pool is being destroyed. */
+  bool m_terminating;
 
   /** The threads in the pool. */
   boost::thread_group m_threads;
 
-  /** A worker variable used to keep the scheduler running until we want it to stop. */
-  boost::shared_ptr<boost::asio::io_service::work> m_worker;
+  /** A condition variable used to wake sleeping threads when tasks become available. */
+  boost::condition_variable m_workAvailable;
+
+  /** The workers (one per thread in the pool). */
+  std::vector<Worker_Ptr> m_workers;
 
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Constructs a thread pool.
    *
-   * \param numThreads  The number of threads that should be in the pool.
+   * \param numThreads  The number of threads that should be in the pool (0 = one per hardware thread).
    */
-  explicit ThreadPool(size_t numThreads = 20);
+  explicit ThreadPool(size_t numThreads = 0);
 
   //#################### DESTRUCTOR ####################
 public:
   /**
    * \brief Destroys the thread pool.
    *
-   * \note  Since all threads in the pool are joined, this can block.
+   * \note  Since all threads in the pool are joined, this can block. Running and queued tasks are allowed to finish cleanly.
    */
   ~ThreadPool();
 
@@ -66,18 +177,138 @@ public:
    */
   static ThreadPool& instance();
 
+  /**
+   * \brief Sets the number of threads with which the global instance of the pool should be constructed.
+   *
+   * \note  This only has an effect if it is called before the global instance is first used.
+   *
+   * \param numThreads  The number of threads with which the global instance of the pool should be constructed (0 = one per hardware thread).
+   */
+  static void set_default_thread_count(size_t numThreads);
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Gets the number of threads in the pool.
+   *
+   * \return  The number of threads in the pool.
+   */
+  size_t get_thread_count() const;
+
+  /**
+   * \brief Runs a loop body over the specified range of indices in parallel, and waits for it to finish.
+   *
+   * The range is split into chunks of (at most) the specified grain size, and the loop body is called as body(first, last)
+   * for each chunk [first,last). The calling thread helps to process the chunks.
+   *
+   * \param begin     The first index in the range.
+   * \param end       One past the last index in the range.
+   * \param grainSize The maximum number of indices in each chunk (0 = choose automatically based on the number of threads).
+   * \param body      The loop body.
+   */
+  template <typename Body>
+  void parallel_for(size_t begin, size_t end, size_t grainSize, const Body& body)
+  {
+    if(end <= begin) return;
+
+    if(grainSize == 0)
+    {
+      // Aim for a few chunks per thread, so that stealing can balance the load.
+      grainSize = std::max<size_t>((end - begin) / (4 * (m_workers.size() + 1)), 1);
+    }
+
+    TaskGroup group(*this);
+    size_t first = begin;
+    for(; end - first > grainSize; first += grainSize)
+    {
+      group.run(RangeJob<Body>(&body, first, first + grainSize));
+    }
+
+    group.run(RangeJob<Body>(&body, first, end));
+
+    // Wait for all of the chunks to be processed (note that the calling thread will help to process them).
+    group.wait();
+  }
+
   /**
    * \brief Posts a task to be executed by the thread pool.
    *
-   * \param task  The task to execute.
+   * \param task      The task to execute.
+   * \param priority  The lane into which to submit the task.
+   */
+  template <typename Task>
+  void post_task(Task task, thread_pool::TaskPriority priority = thread_pool::TP_NORMAL)
+  {
+    enqueue(task, priority);
+  }
+
+  /**
+   * \brief Attempts to run a single pending normal task on the calling thread.
+   *
+   * \return  true, if a task was run, or false if there were no pending normal tasks.
+   */
+  bool run_pending_task();
+
+  /**
+   * \brief Submits a task to be executed by the thread pool, and returns a future that can be used to wait for its result.
+   *
+   * \param task      The task to execute (a nullary function object).
+   * \param priority  The lane into which to submit the task.
+   * \return          A future that can be used to wait for (or cancel) the task.
    */
   template <typename Task>
-  void post_task(Task task)
+  TaskFuture<typename boost::result_of<Task()>::type> submit(Task task, thread_pool::TaskPriority priority = thread_pool::TP_NORMAL)
   {
-    m_scheduler.post(task);
+    typedef typename boost::result_of<Task()>::type R;
+    boost::shared_ptr<TaskState<R> > state(new TaskState<R>(this, task));
+    enqueue(boost::bind(&TaskStateBase::run, state), priority);
+    return TaskFuture<R>(state);
   }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Adds a task to the appropriate queue, and wakes a sleeping thread (if any) to run it.
+   *
+   * \param job       The task.
+   * \param priority  The lane into which to submit the task.
+   */
+  void enqueue(const Job& job, thread_pool::TaskPriority priority);
+
+  /**
+   * \brief Gets whether or not there are any tasks that a thread in the pool could run right now.
+   *
+   * \return  true, if there are any tasks that a thread in the pool could run right now, or false otherwise.
+   */
+  bool has_runnable_tasks() const;
+
+  /**
+   * \brief Runs the specified task, reporting (rather than propagating) any exception it throws.
+   *
+   * \param job The task.
+   */
+  static void run_job(const Job& job);
+
+  /**
+   * \brief Runs the main loop of the specified worker.
+   *
+   * \param workerIndex The index of the worker.
+   */
+  void run_worker(size_t workerIndex);
+
+  /**
+   * \brief Attempts to take a task that can be run by the calling thread.
+   *
+   * Normal tasks are preferred to background tasks: the calling thread first looks in its own deque (if it belongs to the pool),
+   * then in the queue of injected tasks, then in the deques of the other workers, and only then in the queue of background tasks.
+   *
+   * \param workerIndex     The index of the calling thread's worker (or -1 if the calling thread does not belong to the pool).
+   * \param allowBackground Whether or not the calling thread is allowed to take a background task.
+   * \param job             A location into which to store the task (if any).
+   * \param isBackground    A location into which to store whether or not the task is a background task.
+   * \return                true, if a task was taken, or false otherwise.
+   */
+  bool try_take_job(int workerIndex, bool allowBackground, Job& job, bool& isBackground);
 };
 
 }
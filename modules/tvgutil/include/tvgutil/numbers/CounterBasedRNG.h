@@ -0,0 +1,251 @@
+/**
+ * tvgutil: CounterBasedRNG.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_COUNTERBASEDRNG
+#define H_TVGUTIL_COUNTERBASEDRNG
+
+#include <cmath>
+
+#include <boost/cstdint.hpp>
+
+#ifdef __CUDACC__
+  #define TVGUTIL_CPU_AND_GPU_CODE __host__ __device__
+#else
+  #define TVGUTIL_CPU_AND_GPU_CODE
+#endif
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this class can be used to generate random numbers using a counter-based generator (Philox4x32-10).
+ *
+ * A counter-based generator has no hidden state: the random numbers it produces are a pure function of a (seed, stream, counter)
+ * triple. This makes it possible to give every tree, thread or pixel its own independent stream of random numbers without storing
+ * any per-stream state (a stream is identified simply by its index), and to reproduce any part of any stream without replaying it.
+ *
+ * Each evaluation of the underlying function produces four 32-bit values. An instance of this class buffers them and advances
+ * its counter as needed, so that it can be used as a drop-in replacement for a conventional stateful generator. It is small
+ * (and trivially copyable), so it can be created on the fly inside shared CPU/GPU code.
+ *
+ * See: Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC 2011.
+ */
+class CounterBasedRNG
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The values produced by the most recent evaluation of the generator function. */
+  boost::uint32_t m_buffer[4];
+
+  /** The index of the next unused value in the buffer (4 if the buffer is exhausted). */
+  boost::uint32_t m_bufferIndex;
+
+  /** The counter to use for the next evaluation of the generator function. */
+  boost::uint64_t m_counter;
+
+  /** The seed (which is used as the key for the generator function). */
+  boost::uint64_t m_seed;
+
+  /** The stream. */
+  boost::uint64_t m_stream;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a counter-based random number generator.
+   *
+   * \param seed    The seed.
+   * \param stream  The stream (e.g. the index of a tree, thread or pixel).
+   * \param counter The position within the stream from which to start generating numbers (in units of 4 numbers).
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  explicit CounterBasedRNG(boost::uint64_t seed, boost::uint64_t stream = 0, boost::uint64_t counter = 0)
+  : m_bufferIndex(4), m_counter(counter), m_seed(seed), m_stream(stream)
+  {}
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Evaluates the generator function for the specified (seed, stream, counter) triple.
+   *
+   * \param seed    The seed.
+   * \param stream  The stream.
+   * \param counter The counter.
+   * \param result  An array into which to write the four 32-bit values produced.
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  static void generate_block(boost::uint64_t seed, boost::uint64_t stream, boost::uint64_t counter, boost::uint32_t *result)
+  {
+    boost::uint32_t c0 = static_cast<boost::uint32_t>(counter), c1 = static_cast<boost::uint32_t>(counter >> 32);
+    boost::uint32_t c2 = static_cast<boost::uint32_t>(stream), c3 = static_cast<boost::uint32_t>(stream >> 32);
+    boost::uint32_t k0 = static_cast<boost::uint32_t>(seed), k1 = static_cast<boost::uint32_t>(seed >> 32);
+
+    for(int round = 0; round < 10; ++round)
+    {
+      boost::uint32_t hi0, lo0, hi1, lo1;
+      mulhilo(0xD2511F53u, c0, hi0, lo0);
+      mulhilo(0xCD9E8D57u, c2, hi1, lo1);
+
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+
+    result[0] = c0;
+    result[1] = c1;
+    result[2] = c2;
+    result[3] = c3;
+  }
+
+  /**
+   * \brief Generates a single random 32-bit value for the specified (seed, stream, counter) triple, without constructing a generator.
+   *
+   * \param seed    The seed.
+   * \param stream  The stream.
+   * \param counter The counter.
+   * \return        The generated value.
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  static boost::uint32_t generate_uint32(boost::uint64_t seed, boost::uint64_t stream, boost::uint64_t counter)
+  {
+    boost::uint32_t result[4];
+    generate_block(seed, stream, counter, result);
+    return result[0];
+  }
+
+  /**
+   * \brief Maps a random 32-bit value to an integer in the specified (closed) range.
+   *
+   * \param value The random value.
+   * \param lower The lower bound of the range.
+   * \param upper The upper bound of the range.
+   * \return      The integer.
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  static int map_to_int_range(boost::uint32_t value, int lower, int upper)
+  {
+    // Note: This uses multiply-and-shift rather than rejection, so it has a (negligible) bias for very large ranges.
+    const boost::uint64_t range = static_cast<boost::uint64_t>(static_cast<boost::int64_t>(upper) - lower + 1);
+    return lower + static_cast<int>((value * range) >> 32);
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Generates a random number from a 1D Gaussian distribution with the specified parameters.
+   *
+   * \param mean  The mean of the Gaussian distribution.
+   * \param sigma The standard deviation of the Gaussian distribution.
+   * \return      The generated number.
+   */
+  template <typename T>
+  TVGUTIL_CPU_AND_GPU_CODE
+  T generate_from_gaussian(T mean, T sigma)
+  {
+    // Use the Box-Muller transform. Note that u1 is in ]0,1], so its logarithm is always finite.
+    const double u1 = (generate_uint32() + 1.0) * (1.0 / 4294967296.0);
+    const double u2 = generate_uint32() * (1.0 / 4294967296.0);
+    return static_cast<T>(mean + sigma * sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2));
+  }
+
+  /**
+   * \brief Generates a random integer from a uniform distribution over the specified (closed) range.
+   *
+   * For example, generate_int_from_uniform(3,5) returns an integer in the range [3,5].
+   *
+   * \param lower The lower bound of the range.
+   * \param upper The upper bound of the range.
+   * \return      The generated integer.
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  int generate_int_from_uniform(int lower, int upper)
+  {
+    return map_to_int_range(generate_uint32(), lower, upper);
+  }
+
+  /**
+   * \brief Generates a random real number from a uniform distribution over the specified range.
+   *
+   * \param lower The lower bound of the range.
+   * \param upper The upper bound of the range.
+   * \return      The generated real number (in [lower,upper[).
+   */
+  template <typename T>
+  TVGUTIL_CPU_AND_GPU_CODE
+  T generate_real_from_uniform(T lower, T upper)
+  {
+    // Use the top 24 bits of a random value, so that the result is exactly representable as a float.
+    const T u = static_cast<T>(generate_uint32() >> 8) * static_cast<T>(1.0 / 16777216.0);
+    return lower + u * (upper - lower);
+  }
+
+  /**
+   * \brief Generates a random 32-bit value.
+   *
+   * \return  The generated value.
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  boost::uint32_t generate_uint32()
+  {
+    if(m_bufferIndex == 4)
+    {
+      generate_block(m_seed, m_stream, m_counter++, m_buffer);
+      m_bufferIndex = 0;
+    }
+
+    return m_buffer[m_bufferIndex++];
+  }
+
+  /**
+   * \brief Makes a generator for an independent sub-stream of this generator's stream.
+   *
+   * For example, a generator for a forest can be split into one generator per tree, and each of those
+   * can then be split into one generator per thread. Splitting is cheap (a single evaluation of the
+   * generator function), and does not affect the state of this generator.
+   *
+   * \param index The index of the sub-stream.
+   * \return      A generator for the sub-stream.
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  CounterBasedRNG split(boost::uint32_t index) const
+  {
+    // Derive the new stream by evaluating the generator function on a counter that is never used for
+    // ordinary generation (its top word is all ones), so that sub-streams are decorrelated from their parent.
+    boost::uint32_t block[4];
+    generate_block(m_seed, m_stream, (static_cast<boost::uint64_t>(0xFFFFFFFFu) << 32) | index, block);
+    const boost::uint64_t stream = (static_cast<boost::uint64_t>(block[1]) << 32) | block[0];
+    return CounterBasedRNG(m_seed, stream);
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Computes the full 64-bit product of two 32-bit values.
+   *
+   * \param a   The first value.
+   * \param b   The second value.
+   * \param hi  A location into which to write the top 32 bits of the product.
+   * \param lo  A location into which to write the bottom 32 bits of the product.
+   */
+  TVGUTIL_CPU_AND_GPU_CODE
+  static void mulhilo(boost::uint32_t a, boost::uint32_t b, boost::uint32_t& hi, boost::uint32_t& lo)
+  {
+#ifdef __CUDA_ARCH__
+    hi = __umulhi(a, b);
+    lo = a * b;
+#else
+    const boost::uint64_t product = static_cast<boost::uint64_t>(a) * b;
+    hi = static_cast<boost::uint32_t>(product >> 32);
+    lo = static_cast<boost::uint32_t>(product);
+#endif
+  }
+};
+
+}
+
+#endif
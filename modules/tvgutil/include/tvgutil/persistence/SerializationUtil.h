@@ -7,6 +7,7 @@
 #define H_TVGUTIL_SERIALIZATIONUTIL
 
 #include <fstream>
+#include <stdexcept>
 
 #include <boost/shared_ptr.hpp>
 
@@ -40,12 +41,14 @@ struct SerializationUtil
    *
    * \param path  The path to the file.
    * \param dummy A dummy parameter that can be used for type inference.
+   * \param mode  The mode in which to open the file.
    * \return      A pointer to the loaded object.
    */
   template <typename Archive, typename T>
-  static inline boost::shared_ptr<T> load(const std::string& path, const boost::shared_ptr<T>& dummy = boost::shared_ptr<T>())
+  static inline boost::shared_ptr<T> load(const std::string& path, const boost::shared_ptr<T>& dummy = boost::shared_ptr<T>(), std::ios_base::openmode mode = std::ios_base::in)
   {
-    std::ifstream fs(path.c_str());
+    std::ifstream fs(path.c_str(), mode);
+    if(!fs) throw std::runtime_error("Error: Could not open " + path + " for reading");
     Archive ar(fs);
     T *ptr;
     ar >> ptr;
@@ -62,7 +65,7 @@ struct SerializationUtil
   template <typename T>
   static inline boost::shared_ptr<T> load_binary(const std::string& path, const boost::shared_ptr<T>& dummy = boost::shared_ptr<T>())
   {
-    return load<boost::archive::binary_iarchive,T>(path);
+    return load<boost::archive::binary_iarchive,T>(path, dummy, std::ios_base::in | std::ios_base::binary);
   }
 
   /**
@@ -83,11 +86,13 @@ struct SerializationUtil
    *
    * \param path  The path to the file.
    * \param obj   The object to save.
+   * \param mode  The mode in which to open the file.
    */
   template <typename Archive, typename T>
-  static inline void save(const std::string& path, const T& obj)
+  static inline void save(const std::string& path, const T& obj, std::ios_base::openmode mode = std::ios_base::out)
   {
-    std::ofstream fs(path.c_str());
+    std::ofstream fs(path.c_str(), mode);
+    if(!fs) throw std::runtime_error("Error: Could not open " + path + " for writing");
     Archive ar(fs);
     const T *ptr = &obj;
     ar << ptr;
@@ -102,7 +107,7 @@ struct SerializationUtil
   template <typename T>
   static inline void save_binary(const std::string& path, const T& obj)
   {
-    save<boost::archive::binary_oarchive>(path, obj);
+    save<boost::archive::binary_oarchive>(path, obj, std::ios_base::out | std::ios_base::binary);
   }
 
   /**
@@ -9,6 +9,8 @@
 #include <boost/chrono.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include "Timer.h"
+
 namespace tvgutil {
 
 /**
@@ -50,6 +52,27 @@ struct TimeUtil
   {
     return boost::chrono::duration_cast<Units>(boost::chrono::system_clock().now().time_since_epoch());
   }
+
+  /**
+   * \brief Measures the average time taken by a function over a number of runs.
+   *
+   * The function is run once before the timing starts, so that any one-off costs (e.g. allocations) are excluded.
+   *
+   * \param func            The function to time (any function object that can be called with no arguments).
+   * \param iterationCount  The number of times to run the function whilst timing it.
+   * \return                The average time taken to run the function once (in milliseconds).
+   */
+  template <typename Func>
+  static double time_average_ms(const Func& func, int iterationCount)
+  {
+    func();
+
+    Timer<boost::chrono::microseconds> timer("Average");
+    for(int i = 0; i < iterationCount; ++i) func();
+    timer.stop();
+
+    return timer.duration().count() / (1000.0 * iterationCount);
+  }
 };
 
 }
@@ -13,8 +13,8 @@ namespace tvgutil {
 
 //#################### CONSTRUCTORS ####################
 
-CommandManager::CommandManager(size_t maxHistorySize)
-: m_maxHistorySize(maxHistorySize)
+CommandManager::CommandManager(size_t maxHistorySize, size_t maxHistoryMemoryUsage)
+: m_maxHistoryMemoryUsage(maxHistoryMemoryUsage), m_maxHistorySize(maxHistorySize)
 {
   if(maxHistorySize == 0)
   {
@@ -40,6 +40,7 @@ void CommandManager::execute_command(const Command_CPtr& c)
   m_executed.push_back(c);
   m_undone.clear();
   c->execute();
+  enforce_memory_budget();
 }
 
 void CommandManager::execute_compressible_command(const Command_CPtr& c, const std::map<std::string,std::string>& precursors)
@@ -60,6 +61,7 @@ void CommandManager::execute_compressible_command(const Command_CPtr& c, const s
       m_executed.push_back(Command_CPtr(new SeqCommand(last, c, it->second)));
       m_undone.clear();
       c->execute();
+      enforce_memory_budget();
       return;
     }
 
@@ -73,6 +75,20 @@ size_t CommandManager::executed_count() const
   return m_executed.size();
 }
 
+size_t CommandManager::history_memory_usage() const
+{
+  size_t result = 0;
+  for(std::deque<Command_CPtr>::const_iterator it = m_executed.begin(), iend = m_executed.end(); it != iend; ++it)
+  {
+    result += (*it)->get_memory_usage();
+  }
+  for(std::deque<Command_CPtr>::const_iterator it = m_undone.begin(), iend = m_undone.end(); it != iend; ++it)
+  {
+    result += (*it)->get_memory_usage();
+  }
+  return result;
+}
+
 void CommandManager::redo()
 {
   if(can_redo())
@@ -108,6 +124,21 @@ size_t CommandManager::undone_count() const
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+void CommandManager::enforce_memory_budget()
+{
+  // This function is called just after the execution of a new command, since commands may only know how much
+  // state they need to store once they have been executed. The undo stack is always empty at this point, so
+  // we only need to consider the executed stack. Note that we always retain the most recent command.
+  if(m_maxHistoryMemoryUsage == std::numeric_limits<size_t>::max()) return;
+
+  size_t memoryUsage = history_memory_usage();
+  while(memoryUsage > m_maxHistoryMemoryUsage && m_executed.size() > 1)
+  {
+    memoryUsage -= m_executed.front()->get_memory_usage();
+    m_executed.pop_front();
+  }
+}
+
 void CommandManager::make_space_for_command()
 {
   // This function is called just before the execution of a new command to ensure that
@@ -0,0 +1,76 @@
+/**
+ * tvgutil: EventCount.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "misc/EventCount.h"
+
+#ifdef __linux__
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/static_assert.hpp>
+#endif
+
+namespace tvgutil {
+
+//#################### CONSTRUCTORS ####################
+
+EventCount::EventCount()
+: m_epoch(0), m_waiterCount(0)
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void EventCount::cancel_wait()
+{
+  m_waiterCount.fetch_sub(1, boost::memory_order_seq_cst);
+}
+
+void EventCount::commit_wait(int key)
+{
+#ifdef __linux__
+  // Sleep on the epoch word for as long as it still has the value it had when the wait was prepared. Note that the kernel
+  // checks the value atomically with respect to wake-ups, so a notification that happens after the check cannot be lost.
+  BOOST_STATIC_ASSERT(sizeof(boost::atomic<int>) == sizeof(int));
+  int *epoch = reinterpret_cast<int*>(&m_epoch);
+  while(m_epoch.load(boost::memory_order_acquire) == key)
+  {
+    syscall(SYS_futex, epoch, FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+  }
+#else
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while(m_epoch.load(boost::memory_order_acquire) == key) m_epochChanged.wait(lock);
+  }
+#endif
+
+  m_waiterCount.fetch_sub(1, boost::memory_order_seq_cst);
+}
+
+void EventCount::notify_all()
+{
+  m_epoch.fetch_add(1, boost::memory_order_seq_cst);
+
+  // Only make a system call (or lock the mutex) if there might be threads to wake up.
+  if(m_waiterCount.load(boost::memory_order_seq_cst) > 0)
+  {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<int*>(&m_epoch), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_epochChanged.notify_all();
+#endif
+  }
+}
+
+int EventCount::prepare_wait()
+{
+  m_waiterCount.fetch_add(1, boost::memory_order_seq_cst);
+  return m_epoch.load(boost::memory_order_seq_cst);
+}
+
+}
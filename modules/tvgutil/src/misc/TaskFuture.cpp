@@ -0,0 +1,95 @@
+/**
+ * tvgutil: TaskFuture.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "misc/TaskFuture.h"
+
+#include <stdexcept>
+
+#include "misc/ThreadPool.h"
+
+namespace tvgutil {
+
+//#################### CONSTRUCTORS ####################
+
+TaskStateBase::TaskStateBase(ThreadPool *pool)
+: m_pool(pool), m_status(TS_PENDING)
+{}
+
+//#################### DESTRUCTOR ####################
+
+TaskStateBase::~TaskStateBase() {}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+bool TaskStateBase::cancel()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    if(m_status != TS_PENDING) return false;
+    m_status = TS_CANCELLED;
+  }
+
+  m_finished.notify_all();
+  return true;
+}
+
+bool TaskStateBase::is_ready() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_status == TS_FINISHED || m_status == TS_CANCELLED;
+}
+
+void TaskStateBase::run()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    if(m_status != TS_PENDING) return;
+    m_status = TS_RUNNING;
+  }
+
+  boost::exception_ptr exception;
+  try
+  {
+    execute();
+  }
+  catch(...)
+  {
+    exception = boost::current_exception();
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_exception = exception;
+    m_status = TS_FINISHED;
+  }
+
+  m_finished.notify_all();
+}
+
+void TaskStateBase::wait() const
+{
+  // Help the pool by running pending tasks until either the task is ready or there are no more tasks to run.
+  // (In the latter case, the task must either be running on another thread or waiting in the background lane.)
+  while(!is_ready())
+  {
+    if(!m_pool->run_pending_task()) break;
+  }
+
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while(m_status != TS_FINISHED && m_status != TS_CANCELLED) m_finished.wait(lock);
+}
+
+//#################### PROTECTED MEMBER FUNCTIONS ####################
+
+void TaskStateBase::wait_and_rethrow() const
+{
+  wait();
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  if(m_status == TS_CANCELLED) throw std::runtime_error("Error: Cannot get the result of a task that has been cancelled");
+  if(m_exception) boost::rethrow_exception(m_exception);
+}
+
+}
@@ -0,0 +1,112 @@
+/**
+ * tvgutil: TaskGroup.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "misc/TaskGroup.h"
+
+#include <boost/bind.hpp>
+
+#include "misc/ThreadPool.h"
+
+namespace tvgutil {
+
+//#################### CONSTRUCTORS ####################
+
+TaskGroup::TaskGroup()
+: m_cancelled(false), m_pendingTaskCount(0), m_pool(ThreadPool::instance())
+{}
+
+TaskGroup::TaskGroup(ThreadPool& pool)
+: m_cancelled(false), m_pendingTaskCount(0), m_pool(pool)
+{}
+
+//#################### DESTRUCTOR ####################
+
+TaskGroup::~TaskGroup()
+{
+  wait_for_tasks();
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void TaskGroup::cancel()
+{
+  m_cancelled = true;
+}
+
+bool TaskGroup::is_cancelled() const
+{
+  return m_cancelled;
+}
+
+void TaskGroup::run(const boost::function<void()>& task)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    ++m_pendingTaskCount;
+  }
+
+  m_pool.post_task(boost::bind(&TaskGroup::run_task, this, task));
+}
+
+void TaskGroup::wait()
+{
+  wait_for_tasks();
+
+  // Reset the group so that it can be reused, and rethrow the first exception thrown by one of its tasks (if any).
+  boost::exception_ptr exception;
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    exception = m_exception;
+    m_exception = boost::exception_ptr();
+  }
+
+  m_cancelled = false;
+
+  if(exception) boost::rethrow_exception(exception);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void TaskGroup::run_task(const boost::function<void()>& task)
+{
+  boost::exception_ptr exception;
+  if(!m_cancelled)
+  {
+    try
+    {
+      task();
+    }
+    catch(...)
+    {
+      exception = boost::current_exception();
+      m_cancelled = true;
+    }
+  }
+
+  // Note: The notification must happen whilst the mutex is held, since the group may be destroyed as soon as its task count reaches zero.
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  if(exception && !m_exception) m_exception = exception;
+  if(--m_pendingTaskCount == 0) m_finished.notify_all();
+}
+
+void TaskGroup::wait_for_tasks()
+{
+  // Help the pool by running pending tasks until either all of the group's tasks have finished or there are no more tasks to run.
+  for(;;)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(m_pendingTaskCount == 0) return;
+    }
+
+    if(!m_pool.run_pending_task()) break;
+  }
+
+  // Any of the group's tasks that are still unfinished must now be running on other threads, so wait for them.
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while(m_pendingTaskCount > 0) m_finished.wait(lock);
+}
+
+}
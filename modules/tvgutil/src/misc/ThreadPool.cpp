@@ -5,18 +5,67 @@
 
 #include "misc/ThreadPool.h"
 
-#include <boost/bind.hpp>
+#include <iostream>
 
 namespace tvgutil {
 
+//#################### LOCAL TYPES ####################
+
+/**
+ * \brief An instance of this struct identifies the worker to which the current thread belongs.
+ */
+struct WorkerContext
+{
+  /** The pool to which the worker belongs. */
+  const ThreadPool *pool;
+
+  /** The index of the worker within its pool. */
+  size_t workerIndex;
+
+  WorkerContext(const ThreadPool *pool_, size_t workerIndex_)
+  : pool(pool_), workerIndex(workerIndex_)
+  {}
+};
+
+//#################### LOCAL VARIABLES ####################
+
+/** The worker to which the current thread belongs (if any). */
+static boost::thread_specific_ptr<WorkerContext> tls_workerContext;
+
+//#################### LOCAL FUNCTIONS ####################
+
+/**
+ * \brief Gets the index of the worker in the specified pool to which the current thread belongs (if any).
+ *
+ * \param pool  The pool.
+ * \return      The index of the worker in the pool to which the current thread belongs, or -1 if it does not belong to the pool.
+ */
+static int get_current_worker_index(const ThreadPool *pool)
+{
+  const WorkerContext *context = tls_workerContext.get();
+  return context && context->pool == pool ? static_cast<int>(context->workerIndex) : -1;
+}
+
+//#################### PRIVATE STATIC VARIABLES ####################
+
+size_t ThreadPool::s_defaultThreadCount = 0;
+
 //#################### CONSTRUCTORS ####################
 
 ThreadPool::ThreadPool(size_t numThreads)
-: m_worker(new boost::asio::io_service::work(m_scheduler))
+: m_activeBackgroundTaskCount(0), m_pendingBackgroundTaskCount(0), m_pendingNormalTaskCount(0), m_terminating(false)
 {
+  if(numThreads == 0) numThreads = std::max(boost::thread::hardware_concurrency(), 1U);
+  m_maxActiveBackgroundTaskCount = std::max<size_t>(numThreads / 2, 1);
+
   for(size_t i = 0; i < numThreads; ++i)
   {
-    m_threads.create_thread(boost::bind(&boost::asio::io_service::run, &m_scheduler));
+    m_workers.push_back(Worker_Ptr(new Worker));
+  }
+
+  for(size_t i = 0; i < numThreads; ++i)
+  {
+    m_threads.create_thread(boost::bind(&ThreadPool::run_worker, this, i));
   }
 }
 
@@ -24,22 +73,201 @@ ThreadPool::ThreadPool(size_t numThreads)
 
 ThreadPool::~ThreadPool()
 {
-  // Stop executing the scheduler's run function, but allow running and queued tasks to finish cleanly.
-  m_worker.reset();
+  // Tell the threads to terminate once all running and queued tasks have finished.
+  {
+    boost::lock_guard<boost::mutex> lock(m_sleepMutex);
+    m_terminating = true;
+  }
+  m_workAvailable.notify_all();
 
   // Wait for all threads to terminate.
   m_threads.join_all();
-
-  // Cleanly stop the scheduler.
-  m_scheduler.stop();
 }
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
 ThreadPool& ThreadPool::instance()
 {
-  static ThreadPool s_instance;
+  static ThreadPool s_instance(s_defaultThreadCount);
   return s_instance;
 }
 
+void ThreadPool::set_default_thread_count(size_t numThreads)
+{
+  s_defaultThreadCount = numThreads;
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+size_t ThreadPool::get_thread_count() const
+{
+  return m_workers.size();
+}
+
+bool ThreadPool::run_pending_task()
+{
+  // Note: Threads that are helping out whilst waiting are never allowed to take background tasks,
+  //       since these can run for a long time and would delay the wait.
+  Job job;
+  bool isBackground = false;
+  if(!try_take_job(get_current_worker_index(this), false, job, isBackground)) return false;
+  run_job(job);
+  return true;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void ThreadPool::enqueue(const Job& job, thread_pool::TaskPriority priority)
+{
+  if(priority == thread_pool::TP_BACKGROUND)
+  {
+    boost::lock_guard<boost::mutex> lock(m_injectionMutex);
+    m_backgroundTasks.push_back(job);
+    ++m_pendingBackgroundTaskCount;
+  }
+  else
+  {
+    // If the calling thread belongs to the pool, push the task onto the back of its own deque; otherwise, inject it into the pool.
+    const int workerIndex = get_current_worker_index(this);
+    if(workerIndex >= 0)
+    {
+      Worker& worker = *m_workers[workerIndex];
+      boost::lock_guard<boost::mutex> lock(worker.mutex);
+      worker.tasks.push_back(job);
+      ++m_pendingNormalTaskCount;
+    }
+    else
+    {
+      boost::lock_guard<boost::mutex> lock(m_injectionMutex);
+      m_injectedTasks.push_back(job);
+      ++m_pendingNormalTaskCount;
+    }
+  }
+
+  // Wake a sleeping thread (if any) to run the task. Note that we must acquire the sleep mutex before notifying,
+  // since otherwise a thread could check for tasks, miss the one we just added, and then go to sleep for good.
+  {
+    boost::lock_guard<boost::mutex> lock(m_sleepMutex);
+  }
+  m_workAvailable.notify_one();
+}
+
+bool ThreadPool::has_runnable_tasks() const
+{
+  return m_pendingNormalTaskCount > 0 || (m_pendingBackgroundTaskCount > 0 && m_activeBackgroundTaskCount < m_maxActiveBackgroundTaskCount);
+}
+
+void ThreadPool::run_job(const Job& job)
+{
+  try
+  {
+    job();
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << "Warning: A thread pool task threw an exception: " << e.what() << '\n';
+  }
+}
+
+void ThreadPool::run_worker(size_t workerIndex)
+{
+  tls_workerContext.reset(new WorkerContext(this, workerIndex));
+
+  for(;;)
+  {
+    // Run tasks for as long as there are some available.
+    Job job;
+    bool isBackground = false;
+    if(try_take_job(static_cast<int>(workerIndex), true, job, isBackground))
+    {
+      run_job(job);
+      if(isBackground) --m_activeBackgroundTaskCount;
+      continue;
+    }
+
+    // Otherwise, go to sleep until more tasks become available, or terminate if the pool is being destroyed.
+    boost::unique_lock<boost::mutex> lock(m_sleepMutex);
+    while(!has_runnable_tasks())
+    {
+      if(m_terminating) return;
+      m_workAvailable.wait(lock);
+    }
+  }
+}
+
+bool ThreadPool::try_take_job(int workerIndex, bool allowBackground, Job& job, bool& isBackground)
+{
+  isBackground = false;
+
+  // If the calling thread belongs to the pool, try to pop a task from the back of its own deque.
+  if(workerIndex >= 0)
+  {
+    Worker& worker = *m_workers[workerIndex];
+    boost::lock_guard<boost::mutex> lock(worker.mutex);
+    if(!worker.tasks.empty())
+    {
+      job = worker.tasks.back();
+      worker.tasks.pop_back();
+      --m_pendingNormalTaskCount;
+      return true;
+    }
+  }
+
+  // Otherwise, try to take the oldest task that was injected into the pool.
+  {
+    boost::lock_guard<boost::mutex> lock(m_injectionMutex);
+    if(!m_injectedTasks.empty())
+    {
+      job = m_injectedTasks.front();
+      m_injectedTasks.pop_front();
+      --m_pendingNormalTaskCount;
+      return true;
+    }
+  }
+
+  // Otherwise, try to steal a task from the front of another worker's deque.
+  const size_t workerCount = m_workers.size();
+  const size_t startIndex = workerIndex >= 0 ? workerIndex + 1 : 0;
+  for(size_t i = 0; i < workerCount; ++i)
+  {
+    const size_t victimIndex = (startIndex + i) % workerCount;
+    if(static_cast<int>(victimIndex) == workerIndex) continue;
+
+    Worker& victim = *m_workers[victimIndex];
+    boost::lock_guard<boost::mutex> lock(victim.mutex);
+    if(!victim.tasks.empty())
+    {
+      job = victim.tasks.front();
+      victim.tasks.pop_front();
+      --m_pendingNormalTaskCount;
+      return true;
+    }
+  }
+
+  // Otherwise, if allowed, try to take a background task, provided too many are not already running.
+  if(allowBackground && m_pendingBackgroundTaskCount > 0)
+  {
+    size_t activeCount = m_activeBackgroundTaskCount.load();
+    while(activeCount < m_maxActiveBackgroundTaskCount)
+    {
+      if(!m_activeBackgroundTaskCount.compare_exchange_weak(activeCount, activeCount + 1)) continue;
+
+      boost::lock_guard<boost::mutex> lock(m_injectionMutex);
+      if(!m_backgroundTasks.empty())
+      {
+        job = m_backgroundTasks.front();
+        m_backgroundTasks.pop_front();
+        --m_pendingBackgroundTaskCount;
+        isBackground = true;
+        return true;
+      }
+
+      --m_activeBackgroundTaskCount;
+      break;
+    }
+  }
+
+  return false;
+}
+
 }
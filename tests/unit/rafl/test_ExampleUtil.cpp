@@ -0,0 +1,165 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+namespace bf = boost::filesystem;
+
+#include <rafl/examples/ExampleUtil.h>
+using namespace rafl;
+
+typedef int Label;
+typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+
+//#################### FIXTURES ####################
+
+/**
+ * \brief An instance of this struct provides a temporary directory in which tests can write example files.
+ */
+struct TemporaryDirectoryFixture
+{
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+  /** The temporary directory (this is deleted, together with its contents, when the fixture is destroyed). */
+  bf::path dir;
+
+  //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+
+  TemporaryDirectoryFixture()
+  : dir(bf::temp_directory_path() / bf::unique_path("rafl-test-%%%%-%%%%-%%%%"))
+  {
+    bf::create_directories(dir);
+  }
+
+  //~~~~~~~~~~~~~~~~~~~~ DESTRUCTOR ~~~~~~~~~~~~~~~~~~~~
+
+  ~TemporaryDirectoryFixture()
+  {
+    bf::remove_all(dir);
+  }
+
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+
+  /**
+   * \brief Gets the path of a file in the temporary directory.
+   *
+   * \param leaf  The name of the file.
+   * \return      The path of the file.
+   */
+  std::string path(const std::string& leaf) const
+  {
+    return (dir / leaf).string();
+  }
+
+  /**
+   * \brief Writes a text file into the temporary directory.
+   *
+   * \param leaf      The name of the file.
+   * \param contents  The contents to write to the file.
+   * \return          The path of the file.
+   */
+  std::string write_text_file(const std::string& leaf, const std::string& contents) const
+  {
+    const std::string filename = path(leaf);
+    std::ofstream fs(filename.c_str());
+    fs << contents;
+    return filename;
+  }
+};
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Checks that two sets of examples are identical.
+ *
+ * \param lhs The first set of examples.
+ * \param rhs The second set of examples.
+ */
+void check_same_examples(const std::vector<Example_CPtr>& lhs, const std::vector<Example_CPtr>& rhs)
+{
+  BOOST_REQUIRE_EQUAL(lhs.size(), rhs.size());
+  for(size_t i = 0, size = lhs.size(); i < size; ++i)
+  {
+    BOOST_CHECK_EQUAL(lhs[i]->get_label(), rhs[i]->get_label());
+
+    const Descriptor& l = *lhs[i]->get_descriptor();
+    const Descriptor& r = *rhs[i]->get_descriptor();
+    BOOST_CHECK_EQUAL_COLLECTIONS(l.begin(), l.end(), r.begin(), r.end());
+  }
+}
+
+//#################### TESTS ####################
+
+BOOST_FIXTURE_TEST_SUITE(test_ExampleUtil, TemporaryDirectoryFixture)
+
+BOOST_AUTO_TEST_CASE(csv_to_binary_round_trip_test)
+{
+  const std::string csvFilename = write_text_file("examples.csv", "1.5, -2, 0.25, 3\n0,0,0,7\n-1e-3 4.75 1024, 2\n");
+  const std::string binaryFilename = path("examples.bin");
+
+  BOOST_CHECK_EQUAL(ExampleUtil::convert_csv_to_binary<Label>(csvFilename, binaryFilename), 3);
+  BOOST_CHECK(ExampleUtil::is_binary_example_file(binaryFilename));
+  BOOST_CHECK(!ExampleUtil::is_binary_example_file(csvFilename));
+
+  // Check that loading the binary file (either directly, or via the format-agnostic loader) produces the same examples as loading the CSV file.
+  std::vector<Example_CPtr> csvExamples = ExampleUtil::load_csv_examples<Label>(csvFilename);
+  check_same_examples(ExampleUtil::load_binary_examples<Label>(binaryFilename), csvExamples);
+  check_same_examples(ExampleUtil::load_examples<Label>(binaryFilename), csvExamples);
+  check_same_examples(ExampleUtil::load_examples<Label>(csvFilename), csvExamples);
+
+  BOOST_REQUIRE_EQUAL(csvExamples.size(), 3);
+  BOOST_CHECK_EQUAL(csvExamples[2]->get_label(), 2);
+  BOOST_CHECK_EQUAL((*csvExamples[2]->get_descriptor())[2], 1024.0f);
+
+  // Check that saving the examples back out to a binary file produces the same examples again.
+  const std::string savedFilename = path("saved.bin");
+  ExampleUtil::save_binary_examples(csvExamples, savedFilename);
+  check_same_examples(ExampleUtil::load_examples<Label>(savedFilename), csvExamples);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_binary_file_test)
+{
+  const std::string csvFilename = write_text_file("examples.csv", "1,2,3\n4,5,6\n");
+  const std::string binaryFilename = path("examples.bin");
+  ExampleUtil::convert_csv_to_binary<Label>(csvFilename, binaryFilename);
+  const boost::uintmax_t fileSize = bf::file_size(binaryFilename);
+
+  // Check that loading a binary file with labels of the wrong type fails.
+  BOOST_CHECK_THROW(ExampleUtil::load_binary_examples<float>(binaryFilename), std::runtime_error);
+
+  // Check that loading a binary file whose label block has been cut short fails.
+  bf::resize_file(binaryFilename, fileSize - 1);
+  BOOST_CHECK_THROW(ExampleUtil::load_binary_examples<Label>(binaryFilename), std::runtime_error);
+
+  // Check that loading a binary file whose descriptor block has been cut short fails.
+  bf::resize_file(binaryFilename, BinaryExampleHeader::SIZE + sizeof(float));
+  BOOST_CHECK_THROW(ExampleUtil::load_examples<Label>(binaryFilename), std::runtime_error);
+
+  // Check that loading a binary file that is too short to contain a complete header fails.
+  bf::resize_file(binaryFilename, BinaryExampleHeader::SIZE - 1);
+  BOOST_CHECK_THROW(ExampleUtil::load_binary_examples<Label>(binaryFilename), std::runtime_error);
+
+  // Check that a file that does not start with the magic string is not treated as a binary example file.
+  const std::string notBinaryFilename = write_text_file("not-binary.bin", "RAFLEXM");
+  BOOST_CHECK(!ExampleUtil::is_binary_example_file(notBinaryFilename));
+  BOOST_CHECK_THROW(ExampleUtil::load_binary_examples<Label>(notBinaryFilename), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_csv_file_test)
+{
+  const std::string binaryFilename = path("examples.bin");
+
+  // Check that converting a CSV file whose lines have different numbers of features fails.
+  const std::string raggedFilename = write_text_file("ragged.csv", "1,2,3\n4,5\n");
+  BOOST_CHECK_THROW(ExampleUtil::convert_csv_to_binary<Label>(raggedFilename, binaryFilename), std::runtime_error);
+
+  // Check that converting a CSV file that contains something other than a number fails.
+  const std::string nonNumericFilename = write_text_file("non-numeric.csv", "1,x,3\n");
+  BOOST_CHECK_THROW(ExampleUtil::convert_csv_to_binary<Label>(nonNumericFilename, binaryFilename), boost::bad_lexical_cast);
+
+  // Check that converting a CSV file that does not exist fails.
+  BOOST_CHECK_THROW(ExampleUtil::convert_csv_to_binary<Label>(path("missing.csv"), binaryFilename), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,77 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+#include <spaint/sampling/PredictionScheduler.h>
+using namespace spaint;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Makes a raycast result in which the first few pixels hit distinct voxels and the remaining pixels are invalid.
+ *
+ * \param validCount  The number of valid pixels.
+ * \return            The raycast result.
+ */
+ITMFloat4Image *make_raycast_result(int validCount)
+{
+  ITMFloat4Image *raycastResult = new ITMFloat4Image(Vector2i(8, 8), true, false);
+  Vector4f *pixels = raycastResult->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0, size = static_cast<int>(raycastResult->dataSize); i < size; ++i)
+  {
+    pixels[i] = i < validCount ? Vector4f(static_cast<float>(i), 2.0f, 3.0f, 1.0f) : Vector4f(0.0f, 0.0f, 0.0f, -1.0f);
+  }
+  return raycastResult;
+}
+
+/**
+ * \brief Gets the x coordinates of the voxel locations in the specified memory block.
+ *
+ * \param voxelLocationsMB  The memory block.
+ * \return                  The x coordinates of the voxel locations in the memory block.
+ */
+std::set<short> scheduled_xs(const ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB)
+{
+  std::set<short> result;
+  const Vector3s *voxelLocations = voxelLocationsMB.GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < voxelLocationsMB.dataSize; ++i) result.insert(voxelLocations[i].x);
+  return result;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_PredictionScheduler)
+
+BOOST_AUTO_TEST_CASE(increasing_count_test)
+{
+  const size_t maxVoxelCount = 16;
+  PredictionScheduler scheduler(12345, 1 << 20, 4);
+  ORUtils::MemoryBlock<Vector3s> voxelLocationsMB(maxVoxelCount, true, false);
+
+  // Only 3 voxels are visible at first, so only they can be scheduled.
+  boost::shared_ptr<ITMFloat4Image> raycastResult(make_raycast_result(3));
+  BOOST_CHECK_EQUAL(scheduler.schedule_voxels(raycastResult.get(), maxVoxelCount, 0, voxelLocationsMB), 3);
+  BOOST_CHECK_EQUAL(voxelLocationsMB.dataSize, 3);
+
+  // Once 10 voxels are visible, the 7 that have never been predicted should all be scheduled (and the memory block should grow to hold them).
+  raycastResult.reset(make_raycast_result(10));
+  BOOST_CHECK_EQUAL(scheduler.schedule_voxels(raycastResult.get(), maxVoxelCount, 0, voxelLocationsMB), 7);
+  BOOST_CHECK_EQUAL(voxelLocationsMB.dataSize, 7);
+
+  std::set<short> xs = scheduled_xs(voxelLocationsMB);
+  BOOST_CHECK_EQUAL(xs.size(), 7);
+  BOOST_CHECK_EQUAL(*xs.begin(), 3);
+  BOOST_CHECK_EQUAL(*xs.rbegin(), 9);
+
+  // When the forest changes, all 10 voxels should be scheduled again.
+  BOOST_CHECK_EQUAL(scheduler.schedule_voxels(raycastResult.get(), maxVoxelCount, 1, voxelLocationsMB), 10);
+  BOOST_CHECK_EQUAL(voxelLocationsMB.dataSize, 10);
+  BOOST_CHECK_EQUAL(scheduled_xs(voxelLocationsMB).size(), 10);
+
+  // Once all of the visible voxels are up to date, nothing should be scheduled.
+  BOOST_CHECK_EQUAL(scheduler.schedule_voxels(raycastResult.get(), maxVoxelCount, 1, voxelLocationsMB), 0);
+  BOOST_CHECK_EQUAL(voxelLocationsMB.dataSize, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -30,6 +30,20 @@ struct TestCommand : Command
   }
 };
 
+struct SizedTestCommand : TestCommand
+{
+  size_t m_memoryUsage;
+
+  SizedTestCommand(std::string& output, const std::string& executeText, const std::string& undoText, const std::string& description, size_t memoryUsage)
+  : TestCommand(output, executeText, undoText, description), m_memoryUsage(memoryUsage)
+  {}
+
+  virtual size_t get_memory_usage() const
+  {
+    return m_memoryUsage;
+  }
+};
+
 BOOST_AUTO_TEST_SUITE(test_CommandManager)
 
 BOOST_AUTO_TEST_CASE(basic_test)
@@ -196,6 +210,60 @@ BOOST_AUTO_TEST_CASE(historysize_test)
     BOOST_CHECK_EQUAL(cm2.undone_count(), 2);
 }
 
+BOOST_AUTO_TEST_CASE(memorybudget_test)
+{
+  std::string output;
+
+  Command_CPtr c1(new SizedTestCommand(output, "E1", "U1", "", 40));
+  Command_CPtr c2(new SizedTestCommand(output, "E2", "U2", "", 50));
+  Command_CPtr c3(new SizedTestCommand(output, "E3", "U3", "", 30));
+  Command_CPtr c4(new SizedTestCommand(output, "E4", "U4", "", 200));
+  Command_CPtr middle(new SizedTestCommand(output, "Em", "Um", "Middle", 20));
+
+  std::map<std::string,std::string> precursors = map_list_of("Middle","Middle");
+
+  CommandManager cm(INT_MAX, 100);
+  cm.execute_command(c1);
+  cm.execute_command(c2);
+    BOOST_CHECK_EQUAL(cm.executed_count(), 2);
+    BOOST_CHECK_EQUAL(cm.history_memory_usage(), 90);
+
+  // Executing c3 takes the history over budget, so the oldest command (c1) should be discarded.
+  cm.execute_command(c3);
+    BOOST_CHECK_EQUAL(output, "E1E2E3");
+    BOOST_CHECK_EQUAL(cm.executed_count(), 2);
+    BOOST_CHECK_EQUAL(cm.history_memory_usage(), 80);
+
+  // Undoing commands should not change the memory usage of the history.
+  cm.undo();
+  cm.undo();
+    BOOST_CHECK_EQUAL(output, "E1E2E3U3U2");
+    BOOST_CHECK_EQUAL(cm.can_undo(), false);
+    BOOST_CHECK_EQUAL(cm.history_memory_usage(), 80);
+  cm.redo();
+  cm.redo();
+
+  // A command that exceeds the budget on its own should still be retained, so that it can be undone.
+  cm.execute_command(c4);
+    BOOST_CHECK_EQUAL(cm.executed_count(), 1);
+    BOOST_CHECK_EQUAL(cm.history_memory_usage(), 200);
+  cm.undo();
+    BOOST_CHECK_EQUAL(output, "E1E2E3U3U2E2E3E4U4");
+  cm.reset();
+
+  // Compressed commands grow as they absorb more commands, so they should also be subject to the budget.
+  output = "";
+  cm.execute_command(c2);
+  cm.execute_command(middle);
+  cm.execute_compressible_command(middle, precursors);
+    BOOST_CHECK_EQUAL(cm.executed_count(), 2);
+    BOOST_CHECK_EQUAL(cm.history_memory_usage(), 90);
+  cm.execute_compressible_command(middle, precursors);
+    BOOST_CHECK_EQUAL(output, "E2EmEmEm");
+    BOOST_CHECK_EQUAL(cm.executed_count(), 1);
+    BOOST_CHECK_EQUAL(cm.history_memory_usage(), 60);
+}
+
 BOOST_AUTO_TEST_CASE(seq_test)
 {
   std::string output;
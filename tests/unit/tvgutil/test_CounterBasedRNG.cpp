@@ -0,0 +1,113 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+#include <tvgutil/numbers/CounterBasedRNG.h>
+using namespace tvgutil;
+
+BOOST_AUTO_TEST_SUITE(test_CounterBasedRNG)
+
+BOOST_AUTO_TEST_CASE(known_answer_test)
+{
+  // Known-answer values for Philox4x32-10 (from the Random123 distribution).
+  boost::uint32_t result[4];
+
+  CounterBasedRNG::generate_block(0, 0, 0, result);
+  BOOST_CHECK_EQUAL(result[0], 0x6627e8d5u);
+  BOOST_CHECK_EQUAL(result[1], 0xe169c58du);
+  BOOST_CHECK_EQUAL(result[2], 0xbc57ac4cu);
+  BOOST_CHECK_EQUAL(result[3], 0x9b00dbd8u);
+
+  CounterBasedRNG::generate_block(0xffffffffffffffffULL, 0xffffffffffffffffULL, 0xffffffffffffffffULL, result);
+  BOOST_CHECK_EQUAL(result[0], 0x408f276du);
+  BOOST_CHECK_EQUAL(result[1], 0x41c83b0eu);
+  BOOST_CHECK_EQUAL(result[2], 0xa20bc7c6u);
+  BOOST_CHECK_EQUAL(result[3], 0x6d5451fdu);
+
+  CounterBasedRNG::generate_block(0x299f31d0a4093822ULL, 0x0370734413198a2eULL, 0x85a308d3243f6a88ULL, result);
+  BOOST_CHECK_EQUAL(result[0], 0xd16cfe09u);
+  BOOST_CHECK_EQUAL(result[1], 0x94fdccebu);
+  BOOST_CHECK_EQUAL(result[2], 0x5001e420u);
+  BOOST_CHECK_EQUAL(result[3], 0x24126ea1u);
+}
+
+BOOST_AUTO_TEST_CASE(generate_int_from_uniform_test)
+{
+  CounterBasedRNG rng(1234);
+  BOOST_CHECK_EQUAL(rng.generate_int_from_uniform(23,23), 23);
+
+  std::set<int> seen;
+  for(int i = 0; i < 1000; ++i)
+  {
+    int x = rng.generate_int_from_uniform(-3,3);
+    BOOST_CHECK(x >= -3 && x <= 3);
+    seen.insert(x);
+  }
+  BOOST_CHECK_EQUAL(seen.size(), 7);
+
+  for(int i = 0; i < 1000; ++i)
+  {
+    float x = rng.generate_real_from_uniform<float>(2.0f, 3.0f);
+    BOOST_CHECK(x >= 2.0f && x < 3.0f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(reproducibility_test)
+{
+  // Generators with the same seed and stream should produce the same sequence, and starting from
+  // counter n should be equivalent to skipping the first 4n numbers.
+  CounterBasedRNG rng1(42, 7), rng2(42, 7), rng3(42, 7, 2);
+  for(int i = 0; i < 8; ++i)
+  {
+    BOOST_CHECK_EQUAL(rng1.generate_uint32(), rng2.generate_uint32());
+  }
+
+  for(int i = 0; i < 100; ++i)
+  {
+    boost::uint32_t block[4];
+    CounterBasedRNG::generate_block(42, 7, 2 + i / 4, block);
+
+    boost::uint32_t x = rng1.generate_uint32();
+    BOOST_CHECK_EQUAL(x, rng3.generate_uint32());
+    BOOST_CHECK_EQUAL(x, block[i % 4]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(stream_test)
+{
+  // Different streams and sub-streams should produce different sequences.
+  CounterBasedRNG rng(42);
+  CounterBasedRNG streams[] = { CounterBasedRNG(42, 1), CounterBasedRNG(43, 0), rng.split(0), rng.split(1), rng.split(0).split(0) };
+  const int streamCount = sizeof(streams) / sizeof(CounterBasedRNG);
+
+  std::set<boost::uint32_t> firstValues;
+  firstValues.insert(rng.generate_uint32());
+  for(int i = 0; i < streamCount; ++i) firstValues.insert(streams[i].generate_uint32());
+  BOOST_CHECK_EQUAL(firstValues.size(), streamCount + 1);
+
+  // Splitting should not depend on (or affect) the parent's position within its stream.
+  CounterBasedRNG a(42, 0, 0), b(42, 0, 100);
+  CounterBasedRNG sa = a.split(5), sb = b.split(5);
+  for(int i = 0; i < 8; ++i) BOOST_CHECK_EQUAL(sa.generate_uint32(), sb.generate_uint32());
+}
+
+BOOST_AUTO_TEST_CASE(generate_from_gaussian_test)
+{
+  CounterBasedRNG rng(1234);
+  const int n = 100000;
+  double sum = 0.0, sumSq = 0.0;
+  for(int i = 0; i < n; ++i)
+  {
+    double x = rng.generate_from_gaussian<double>(5.0, 2.0);
+    sum += x;
+    sumSq += x * x;
+  }
+
+  double mean = sum / n;
+  double variance = sumSq / n - mean * mean;
+  BOOST_CHECK_CLOSE(mean, 5.0, 1.0);
+  BOOST_CHECK_CLOSE(variance, 4.0, 2.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,149 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+
+#include <tvgutil/containers/LockFreePooledQueue.h>
+using namespace tvgutil;
+using namespace tvgutil::pooled_queue;
+
+typedef boost::shared_ptr<int> Int_Ptr;
+typedef LockFreePooledQueue<Int_Ptr,PM_SINGLE> SPSCQueue;
+typedef LockFreePooledQueue<Int_Ptr,PM_MULTIPLE> MPSCQueue;
+
+//#################### HELPER FUNCTIONS ####################
+
+Int_Ptr make_int()
+{
+  return boost::make_shared<int>(0);
+}
+
+template <typename Queue>
+bool push(Queue& q, int value)
+{
+  typename Queue::PushHandler_Ptr pushHandler = q.begin_push();
+  boost::optional<Int_Ptr&> elt = pushHandler->get();
+  if(!elt) return false;
+  **elt = value;
+  return true;
+}
+
+template <typename Queue>
+int pop(Queue& q)
+{
+  int value = *q.peek();
+  q.pop();
+  return value;
+}
+
+void produce(MPSCQueue *q, int producerIndex, int count)
+{
+  for(int i = 0; i < count; ++i) push(*q, producerIndex * count + i);
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_LockFreePooledQueue)
+
+BOOST_AUTO_TEST_CASE(discard_test)
+{
+  SPSCQueue q(PES_DISCARD);
+  q.initialise(2, &make_int);
+    BOOST_CHECK(push(q, 1));
+    BOOST_CHECK(push(q, 2));
+    BOOST_CHECK(!push(q, 3));
+    BOOST_CHECK_EQUAL(q.size(), 2);
+    BOOST_CHECK_EQUAL(pop(q), 1);
+    BOOST_CHECK(push(q, 4));
+    BOOST_CHECK_EQUAL(pop(q), 2);
+    BOOST_CHECK_EQUAL(pop(q), 4);
+    BOOST_CHECK(q.empty());
+}
+
+BOOST_AUTO_TEST_CASE(grow_test)
+{
+  SPSCQueue q(PES_GROW);
+  q.initialise(1, &make_int, 3);
+    BOOST_CHECK(push(q, 1));
+    BOOST_CHECK(push(q, 2));
+    BOOST_CHECK(push(q, 3));
+    BOOST_CHECK_EQUAL(q.size(), 3);
+    BOOST_CHECK_EQUAL(pop(q), 1);
+    BOOST_CHECK_EQUAL(pop(q), 2);
+    BOOST_CHECK_EQUAL(pop(q), 3);
+}
+
+BOOST_AUTO_TEST_CASE(peek_test)
+{
+  SPSCQueue q(PES_DISCARD);
+  q.initialise(3, &make_int);
+  push(q, 7);
+  push(q, 8);
+    BOOST_CHECK_EQUAL(*q.peek(), 7);
+    BOOST_CHECK_EQUAL(*q.peek(), 7);
+  q.pop();
+    BOOST_CHECK_EQUAL(*q.peek(), 8);
+}
+
+BOOST_AUTO_TEST_CASE(replace_random_test)
+{
+  SPSCQueue q(PES_REPLACE_RANDOM);
+  q.initialise(4, &make_int);
+
+  // Push many more elements than the pool can hold: the queue should stay full, and should retain the last element pushed.
+  for(int i = 0; i < 100; ++i) push(q, i);
+    BOOST_CHECK_EQUAL(q.size(), 4);
+
+  std::vector<int> values;
+  while(!q.empty()) values.push_back(pop(q));
+    BOOST_CHECK_EQUAL(values.size(), 4);
+    BOOST_CHECK_EQUAL(values.back(), 99);
+  for(size_t i = 1; i < values.size(); ++i) BOOST_CHECK_LT(values[i-1], values[i]);
+}
+
+BOOST_AUTO_TEST_CASE(replace_random_pinned_test)
+{
+  SPSCQueue q(PES_REPLACE_RANDOM);
+  q.initialise(1, &make_int);
+  push(q, 1);
+
+  // The only element in the queue has been pinned by peeking at it, so it cannot be replaced.
+  Int_Ptr front = q.peek();
+    BOOST_CHECK(!push(q, 2));
+    BOOST_CHECK_EQUAL(*front, 1);
+    BOOST_CHECK_EQUAL(pop(q), 1);
+}
+
+BOOST_AUTO_TEST_CASE(multiple_producers_test)
+{
+  const int producerCount = 4, countPerProducer = 10000;
+  MPSCQueue q(PES_WAIT);
+  q.initialise(8, &make_int);
+
+  boost::thread_group producers;
+  for(int i = 0; i < producerCount; ++i)
+  {
+    producers.create_thread(boost::bind(&produce, &q, i, countPerProducer));
+  }
+
+  // Check that every element pushed is popped exactly once, and that each producer's elements arrive in order.
+  std::set<int> seen;
+  std::vector<int> lastValues(producerCount, -1);
+  for(int i = 0; i < producerCount * countPerProducer; ++i)
+  {
+    int value = pop(q);
+    int producerIndex = value / countPerProducer;
+    BOOST_REQUIRE(seen.insert(value).second);
+    BOOST_REQUIRE_LT(lastValues[producerIndex], value);
+    lastValues[producerIndex] = value;
+  }
+
+  producers.join_all();
+    BOOST_CHECK(q.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
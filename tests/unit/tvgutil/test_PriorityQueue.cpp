@@ -1,10 +1,39 @@
 #define BOOST_TEST_MAIN
 #include <boost/test/unit_test.hpp>
 
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
 #include <tvgutil/containers/PriorityQueue.h>
+#include <tvgutil/numbers/RandomNumberGenerator.h>
 using namespace tvgutil;
 
 typedef PriorityQueue<std::string, double, int, std::greater<double> > PQ;
+typedef PriorityQueue<int, float, signed char, std::greater<float> > MapPQ;
+typedef PriorityQueue<int, float, signed char, std::greater<float>, priority_queue::DenseIndex<int>, 4> DensePQ;
+
+template <typename Q1, typename Q2>
+void check_same_contents(Q1& q1, Q2& q2, int maxID)
+{
+  BOOST_CHECK_EQUAL(q1.size(), q2.size());
+  for(int id = 0; id <= maxID; ++id)
+  {
+    BOOST_CHECK_EQUAL(q1.contains(id), q2.contains(id));
+    if(q1.contains(id) && q2.contains(id)) BOOST_CHECK_EQUAL(q1.element(id).key(), q2.element(id).key());
+  }
+
+  // Note: Elements with equal keys are extracted in order of ID, so the queues should extract exactly the same elements in the same order.
+  while(!q1.empty() && !q2.empty())
+  {
+    BOOST_CHECK_EQUAL(q1.top().id(), q2.top().id());
+    BOOST_CHECK_EQUAL(q1.top().key(), q2.top().key());
+    q1.pop();
+    q2.pop();
+  }
+  BOOST_CHECK_EQUAL(q1.empty(), q2.empty());
+}
 
 BOOST_AUTO_TEST_SUITE(test_PriorityQueue)
 
@@ -40,6 +69,44 @@ BOOST_AUTO_TEST_CASE(element_test)
     BOOST_CHECK_EQUAL(e.data(), 23);
 }
 
+BOOST_AUTO_TEST_CASE(dense_test)
+{
+  // Perform the same random sequence of operations on a map-indexed binary heap and a densely-indexed 4-ary heap.
+  MapPQ mpq;
+  DensePQ dpq;
+  RandomNumberGenerator rng(12345);
+  for(int i = 0; i < 5000; ++i)
+  {
+    const int id = rng.generate_int_from_uniform(0, 499);
+    const float key = static_cast<float>(rng.generate_int_from_uniform(0, 99));
+    if(mpq.contains(id))
+    {
+      BOOST_CHECK(dpq.contains(id));
+      if(rng.generate_int_from_uniform(0, 2) == 0)
+      {
+        mpq.erase(id);
+        dpq.erase(id);
+      }
+      else
+      {
+        mpq.update_key(id, key);
+        dpq.update_key(id, key);
+      }
+    }
+    else
+    {
+      BOOST_CHECK(!dpq.contains(id));
+      mpq.insert(id, key, 0);
+      dpq.insert(id, key, 0);
+    }
+
+    BOOST_CHECK_EQUAL(mpq.size(), dpq.size());
+    if(!mpq.empty()) BOOST_CHECK_EQUAL(mpq.top().id(), dpq.top().id());
+  }
+
+  check_same_contents(mpq, dpq, 499);
+}
+
 // Note: empty() has been tested in other test cases
 
 BOOST_AUTO_TEST_CASE(erase_test)
@@ -68,6 +135,38 @@ BOOST_AUTO_TEST_CASE(pop_test)
     BOOST_CHECK_EQUAL(pq.contains("K"), true);
 }
 
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+  MapPQ mpq;
+  DensePQ dpq;
+  RandomNumberGenerator rng(23456);
+  for(int id = 0; id < 200; ++id)
+  {
+    const float key = static_cast<float>(rng.generate_int_from_uniform(0, 49));
+    mpq.insert(id, key, 0);
+    dpq.insert(id, key, 0);
+  }
+
+  // Check that a queue saved with a map index and a binary heap can be loaded into a queue with a dense index and a 4-ary heap.
+  {
+    std::stringstream ss;
+    { boost::archive::text_oarchive oa(ss); oa << mpq; }
+    DensePQ loaded;
+    { boost::archive::text_iarchive ia(ss); ia >> loaded; }
+    MapPQ copy(mpq);
+    check_same_contents(copy, loaded, 199);
+  }
+
+  // Check that the reverse is also possible.
+  {
+    std::stringstream ss;
+    { boost::archive::text_oarchive oa(ss); oa << dpq; }
+    MapPQ loaded;
+    { boost::archive::text_iarchive ia(ss); ia >> loaded; }
+    check_same_contents(dpq, loaded, 199);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(size_test)
 {
   PQ pq;
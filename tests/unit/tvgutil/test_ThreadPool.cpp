@@ -0,0 +1,135 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+
+#include <tvgutil/misc/ThreadPool.h>
+using namespace tvgutil;
+
+//#################### HELPER FUNCTIONS ####################
+
+int add(int a, int b)
+{
+  return a + b;
+}
+
+void fill_range(std::vector<int> *values, size_t first, size_t last)
+{
+  for(size_t i = first; i < last; ++i) ++(*values)[i];
+}
+
+void increment(boost::atomic<int> *counter)
+{
+  ++*counter;
+}
+
+void block_until(const boost::atomic<bool> *flag)
+{
+  while(!*flag) boost::this_thread::yield();
+}
+
+void nested_parallel_for(ThreadPool *pool, std::vector<int> *values, size_t first, size_t last)
+{
+  for(size_t i = first; i < last; ++i)
+  {
+    pool->parallel_for(i * 10, (i + 1) * 10, 1, boost::bind(&fill_range, values, _1, _2));
+  }
+}
+
+void throw_error()
+{
+  throw std::runtime_error("Error");
+}
+
+void wait_for_future(const TaskFuture<int> *future, boost::atomic<int> *result)
+{
+  *result = future->get();
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_ThreadPool)
+
+BOOST_AUTO_TEST_CASE(background_test)
+{
+  boost::atomic<int> counter(0);
+  {
+    ThreadPool pool(2);
+    for(int i = 0; i < 100; ++i) pool.post_task(boost::bind(&increment, &counter), thread_pool::TP_BACKGROUND);
+  }
+  BOOST_CHECK_EQUAL(counter, 100);
+}
+
+BOOST_AUTO_TEST_CASE(cancel_test)
+{
+  boost::atomic<bool> cancelled(false);
+  ThreadPool pool(1);
+
+  // Block the pool's only thread until the future has been cancelled.
+  pool.post_task(boost::bind(&block_until, &cancelled));
+
+  TaskFuture<int> future = pool.submit(boost::bind(&add, 1, 2), thread_pool::TP_BACKGROUND);
+  BOOST_CHECK(future.cancel());
+  BOOST_CHECK(future.is_ready());
+  BOOST_CHECK_THROW(future.get(), std::runtime_error);
+  cancelled = true;
+}
+
+BOOST_AUTO_TEST_CASE(nested_test)
+{
+  ThreadPool pool(2);
+  std::vector<int> values(1000, 0);
+  pool.parallel_for(0, 100, 1, boost::bind(&nested_parallel_for, &pool, &values, _1, _2));
+  for(size_t i = 0, size = values.size(); i < size; ++i) BOOST_CHECK_EQUAL(values[i], 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_test)
+{
+  ThreadPool pool(4);
+  std::vector<int> values(10007, 0);
+  pool.parallel_for(0, values.size(), 0, boost::bind(&fill_range, &values, _1, _2));
+  pool.parallel_for(0, values.size(), 13, boost::bind(&fill_range, &values, _1, _2));
+  for(size_t i = 0, size = values.size(); i < size; ++i) BOOST_CHECK_EQUAL(values[i], 2);
+}
+
+BOOST_AUTO_TEST_CASE(submit_test)
+{
+  ThreadPool pool(1);
+  TaskFuture<int> future = pool.submit(boost::bind(&add, 20, 3));
+  BOOST_CHECK_EQUAL(future.get(), 23);
+
+  // Check that a task running on the pool's only thread can safely wait for another task.
+  boost::atomic<int> result(0);
+  TaskFuture<int> inner = pool.submit(boost::bind(&add, 4, 5));
+  TaskFuture<void> outer = pool.submit(boost::bind(&wait_for_future, &inner, &result));
+  outer.get();
+  BOOST_CHECK_EQUAL(result, 9);
+
+  TaskFuture<void> failing = pool.submit(&throw_error);
+  BOOST_CHECK_THROW(failing.get(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(task_group_test)
+{
+  ThreadPool pool(3);
+  boost::atomic<int> counter(0);
+
+  TaskGroup group(pool);
+  for(int i = 0; i < 1000; ++i) group.run(boost::bind(&increment, &counter));
+  group.wait();
+  BOOST_CHECK_EQUAL(counter, 1000);
+
+  group.run(&throw_error);
+  BOOST_CHECK_THROW(group.wait(), std::runtime_error);
+
+  // Check that the group is usable again after it has been waited for.
+  group.run(boost::bind(&increment, &counter));
+  group.wait();
+  BOOST_CHECK_EQUAL(counter, 1001);
+}
+
+BOOST_AUTO_TEST_SUITE_END()